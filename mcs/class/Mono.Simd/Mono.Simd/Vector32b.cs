@@ -0,0 +1,141 @@
+// Vector32b.cs
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+using System;
+using System.Runtime.InteropServices;
+
+namespace Mono.Simd
+{
+	/*
+	Thirty two bytes. On cpus with AVX2 the JIT does the arithmetic and bitwise operations with
+	256 bit instructions, otherwise it does them on the two 128 bit halves.
+	*/
+	[StructLayout(LayoutKind.Explicit, Pack = 0, Size = 32)]
+	public struct Vector32b
+	{
+		[ FieldOffset(0) ]
+		internal Vector16b lower;
+		[ FieldOffset(16) ]
+		internal Vector16b upper;
+
+		public Vector16b Lower { get { return lower; } set { lower = value; } }
+		public Vector16b Upper { get { return upper; } set { upper = value; } }
+
+		public static Vector32b Zero
+		{
+			get { return new Vector32b (0); }
+		}
+
+		[System.Runtime.CompilerServices.IndexerName ("Component")]
+		public unsafe byte this [int index]
+		{
+			get {
+				if ((index | 0x1f) != 0x1f) //index < 0 || index > 31
+					throw new ArgumentOutOfRangeException ("index");
+				fixed (byte *v = &lower.v0) {
+					return * (v + index);
+				}
+			}
+			set {
+				if ( (index | 0x1f) != 0x1f) //index < 0 || index > 31
+					throw new ArgumentOutOfRangeException ("index");
+				fixed (byte *v = &lower.v0) {
+					* (v + index) = value;
+				}
+			}
+		}
+
+		public Vector32b (Vector16b lower, Vector16b upper)
+		{
+			this.lower = lower;
+			this.upper = upper;
+		}
+
+		public Vector32b (byte v0, byte v1, byte v2, byte v3, byte v4, byte v5, byte v6, byte v7, byte v8, byte v9, byte v10, byte v11, byte v12, byte v13, byte v14, byte v15, byte v16, byte v17, byte v18, byte v19, byte v20, byte v21, byte v22, byte v23, byte v24, byte v25, byte v26, byte v27, byte v28, byte v29, byte v30, byte v31)
+		{
+			this.lower = new Vector16b (v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15);
+			this.upper = new Vector16b (v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26, v27, v28, v29, v30, v31);
+		}
+
+		public Vector32b (byte v)
+		{
+			this.lower = new Vector16b (v);
+			this.upper = new Vector16b (v);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b operator + (Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower + v2.lower, v1.upper + v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b operator - (Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower - v2.lower, v1.upper - v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b operator & (Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower & v2.lower, v1.upper & v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b operator | (Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower | v2.lower, v1.upper | v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b operator ^ (Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower ^ v2.lower, v1.upper ^ v2.upper);
+		}
+
+		public static bool operator ==(Vector32b v1, Vector32b v2)
+		{
+			return v1.lower == v2.lower && v1.upper == v2.upper;
+		}
+
+		public static bool operator !=(Vector32b v1, Vector32b v2)
+		{
+			return v1.lower != v2.lower || v1.upper != v2.upper;
+		}
+
+		public static unsafe explicit operator Vector8f (Vector32b v)
+		{
+			Vector8f* p = (Vector8f*)&v;
+			return *p;
+		}
+
+		public static unsafe explicit operator Vector8i (Vector32b v)
+		{
+			Vector8i* p = (Vector8i*)&v;
+			return *p;
+		}
+
+		public override string ToString()
+		{
+			return "<" + lower + ", " + upper + ">";
+		}
+	}
+}
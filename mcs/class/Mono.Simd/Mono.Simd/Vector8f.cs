@@ -0,0 +1,153 @@
+// Vector8f.cs
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+using System;
+using System.Runtime.InteropServices;
+
+namespace Mono.Simd
+{
+	/*
+	Eight floats. On cpus with AVX the JIT does the arithmetic and bitwise operations with
+	256 bit instructions, otherwise it does them on the two 128 bit halves.
+	*/
+	[StructLayout(LayoutKind.Explicit, Pack = 0, Size = 32)]
+	public struct Vector8f
+	{
+		[ FieldOffset(0) ]
+		internal Vector4f lower;
+		[ FieldOffset(16) ]
+		internal Vector4f upper;
+
+		public Vector4f Lower { get { return lower; } set { lower = value; } }
+		public Vector4f Upper { get { return upper; } set { upper = value; } }
+
+		public static Vector8f Zero
+		{
+			get { return new Vector8f (0); }
+		}
+
+		[System.Runtime.CompilerServices.IndexerName ("Component")]
+		public unsafe float this [int index]
+		{
+			get {
+				if ((index | 0x7) != 0x7) //index < 0 || index > 7
+					throw new ArgumentOutOfRangeException ("index");
+				fixed (float *v = &lower.x) {
+					return * (v + index);
+				}
+			}
+			set {
+				if ( (index | 0x7) != 0x7) //index < 0 || index > 7
+					throw new ArgumentOutOfRangeException ("index");
+				fixed (float *v = &lower.x) {
+					* (v + index) = value;
+				}
+			}
+		}
+
+		public Vector8f (Vector4f lower, Vector4f upper)
+		{
+			this.lower = lower;
+			this.upper = upper;
+		}
+
+		public Vector8f (float v0, float v1, float v2, float v3, float v4, float v5, float v6, float v7)
+		{
+			this.lower = new Vector4f (v0, v1, v2, v3);
+			this.upper = new Vector4f (v4, v5, v6, v7);
+		}
+
+		public Vector8f (float v)
+		{
+			this.lower = new Vector4f (v);
+			this.upper = new Vector4f (v);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator + (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower + v2.lower, v1.upper + v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator - (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower - v2.lower, v1.upper - v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator * (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower * v2.lower, v1.upper * v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator / (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower / v2.lower, v1.upper / v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator & (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower & v2.lower, v1.upper & v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator | (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower | v2.lower, v1.upper | v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f operator ^ (Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower ^ v2.lower, v1.upper ^ v2.upper);
+		}
+
+		public static bool operator ==(Vector8f v1, Vector8f v2)
+		{
+			return v1.lower == v2.lower && v1.upper == v2.upper;
+		}
+
+		public static bool operator !=(Vector8f v1, Vector8f v2)
+		{
+			return v1.lower != v2.lower || v1.upper != v2.upper;
+		}
+
+		public static unsafe explicit operator Vector8i (Vector8f v)
+		{
+			Vector8i* p = (Vector8i*)&v;
+			return *p;
+		}
+
+		public static unsafe explicit operator Vector32b (Vector8f v)
+		{
+			Vector32b* p = (Vector32b*)&v;
+			return *p;
+		}
+
+		public override string ToString()
+		{
+			return "<" + lower + ", " + upper + ">";
+		}
+	}
+}
@@ -0,0 +1,147 @@
+// Vector8i.cs
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+using System;
+using System.Runtime.InteropServices;
+
+namespace Mono.Simd
+{
+	/*
+	Eight ints. On cpus with AVX2 the JIT does the arithmetic and bitwise operations with
+	256 bit instructions, otherwise it does them on the two 128 bit halves.
+	*/
+	[StructLayout(LayoutKind.Explicit, Pack = 0, Size = 32)]
+	public struct Vector8i
+	{
+		[ FieldOffset(0) ]
+		internal Vector4i lower;
+		[ FieldOffset(16) ]
+		internal Vector4i upper;
+
+		public Vector4i Lower { get { return lower; } set { lower = value; } }
+		public Vector4i Upper { get { return upper; } set { upper = value; } }
+
+		public static Vector8i Zero
+		{
+			get { return new Vector8i (0); }
+		}
+
+		[System.Runtime.CompilerServices.IndexerName ("Component")]
+		public unsafe int this [int index]
+		{
+			get {
+				if ((index | 0x7) != 0x7) //index < 0 || index > 7
+					throw new ArgumentOutOfRangeException ("index");
+				fixed (int *v = &lower.x) {
+					return * (v + index);
+				}
+			}
+			set {
+				if ( (index | 0x7) != 0x7) //index < 0 || index > 7
+					throw new ArgumentOutOfRangeException ("index");
+				fixed (int *v = &lower.x) {
+					* (v + index) = value;
+				}
+			}
+		}
+
+		public Vector8i (Vector4i lower, Vector4i upper)
+		{
+			this.lower = lower;
+			this.upper = upper;
+		}
+
+		public Vector8i (int v0, int v1, int v2, int v3, int v4, int v5, int v6, int v7)
+		{
+			this.lower = new Vector4i (v0, v1, v2, v3);
+			this.upper = new Vector4i (v4, v5, v6, v7);
+		}
+
+		public Vector8i (int v)
+		{
+			this.lower = new Vector4i (v);
+			this.upper = new Vector4i (v);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i operator + (Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower + v2.lower, v1.upper + v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i operator - (Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower - v2.lower, v1.upper - v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE41 | AccelMode.AVX2)]
+		public static Vector8i operator * (Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower * v2.lower, v1.upper * v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i operator & (Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower & v2.lower, v1.upper & v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i operator | (Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower | v2.lower, v1.upper | v2.upper);
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i operator ^ (Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower ^ v2.lower, v1.upper ^ v2.upper);
+		}
+
+		public static bool operator ==(Vector8i v1, Vector8i v2)
+		{
+			return v1.lower == v2.lower && v1.upper == v2.upper;
+		}
+
+		public static bool operator !=(Vector8i v1, Vector8i v2)
+		{
+			return v1.lower != v2.lower || v1.upper != v2.upper;
+		}
+
+		public static unsafe explicit operator Vector8f (Vector8i v)
+		{
+			Vector8f* p = (Vector8f*)&v;
+			return *p;
+		}
+
+		public static unsafe explicit operator Vector32b (Vector8i v)
+		{
+			Vector32b* p = (Vector32b*)&v;
+			return *p;
+		}
+
+		public override string ToString()
+		{
+			return "<" + lower + ", " + upper + ">";
+		}
+	}
+}
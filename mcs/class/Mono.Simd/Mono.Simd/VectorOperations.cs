@@ -1225,5 +1225,79 @@ namespace Mono.Simd
 		public static unsafe Vector2d ConvertToDouble (this Vector4f v0) {
 			return new Vector2d (v0.X, v0.Y);
 		}
+
+		/* ==== 256 bit vectors, see Vector8f ==== */
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f Max (this Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower.Max (v2.lower), v1.upper.Max (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE1 | AccelMode.AVX)]
+		public static Vector8f Min (this Vector8f v1, Vector8f v2)
+		{
+			return new Vector8f (v1.lower.Min (v2.lower), v1.upper.Min (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE41 | AccelMode.AVX2)]
+		public static Vector8i Max (this Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower.Max (v2.lower), v1.upper.Max (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE41 | AccelMode.AVX2)]
+		public static Vector8i Min (this Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower.Min (v2.lower), v1.upper.Min (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i CompareEqual (this Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower.CompareEqual (v2.lower), v1.upper.CompareEqual (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector8i CompareGreaterThan (this Vector8i v1, Vector8i v2)
+		{
+			return new Vector8i (v1.lower.CompareGreaterThan (v2.lower), v1.upper.CompareGreaterThan (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b Max (this Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower.Max (v2.lower), v1.upper.Max (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b Min (this Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower.Min (v2.lower), v1.upper.Min (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b CompareEqual (this Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower.CompareEqual (v2.lower), v1.upper.CompareEqual (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b AddWithSaturation (this Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower.AddWithSaturation (v2.lower), v1.upper.AddWithSaturation (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b SubtractWithSaturation (this Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower.SubtractWithSaturation (v2.lower), v1.upper.SubtractWithSaturation (v2.upper));
+		}
+
+		[Acceleration (AccelMode.SSE2 | AccelMode.AVX2)]
+		public static Vector32b Average (this Vector32b v1, Vector32b v2)
+		{
+			return new Vector32b (v1.lower.Average (v2.lower), v1.upper.Average (v2.upper));
+		}
 	}
 }
@@ -1424,6 +1424,120 @@ typedef union {
 
 #define amd64_sse_prefetch_reg_membase(inst, arg, basereg, disp) emit_sse_reg_membase_op2((inst), (arg), (basereg), (disp), 0x0f, 0x18)
 
+/* AVX defines */
+
+/* The implied legacy prefix of VEX encoded instructions */
+#define AMD64_VEX_PP_NONE 0
+#define AMD64_VEX_PP_66   1
+#define AMD64_VEX_PP_F3   2
+#define AMD64_VEX_PP_F2   3
+
+/* The implied leading opcode bytes of VEX encoded instructions */
+#define AMD64_VEX_MAP_0F   1
+#define AMD64_VEX_MAP_0F38 2
+#define AMD64_VEX_MAP_0F3A 3
+
+/*
+ * Emit a VEX prefix, which replaces the legacy and REX prefixes and the leading opcode
+ * bytes. VREG is the additional source register, 0 if the instruction has none. L selects
+ * 256 bit (ymm) operands. The two byte form is used when it can encode the instruction.
+ */
+#define amd64_emit_vex(inst,w,reg_modrm,reg_index,reg_rm_base,vreg,l,pp,map) do { \
+	if (!(w) && (reg_index) <= 7 && (reg_rm_base) <= 7 && (map) == AMD64_VEX_MAP_0F) { \
+		*(inst)++ = (unsigned char)0xc5; \
+		*(inst)++ = (unsigned char)((((reg_modrm) > 7) ? 0 : 0x80) | ((~(vreg) & 0xf) << 3) | ((l) ? 0x4 : 0) | (pp)); \
+	} else { \
+		*(inst)++ = (unsigned char)0xc4; \
+		*(inst)++ = (unsigned char)((((reg_modrm) > 7) ? 0 : 0x80) | (((reg_index) > 7) ? 0 : 0x40) | (((reg_rm_base) > 7) ? 0 : 0x20) | (map)); \
+		*(inst)++ = (unsigned char)(((w) ? 0x80 : 0) | ((~(vreg) & 0xf) << 3) | ((l) ? 0x4 : 0) | (pp)); \
+	} \
+} while (0)
+
+#define emit_vex_reg_reg(inst,dreg,vreg,reg,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_emit_vex ((inst), 0, (dreg), 0, (reg), (vreg), (l), (pp), (map)); \
+    *(inst)++ = (unsigned char)(op); \
+    x86_reg_emit ((inst), (dreg), (reg)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define emit_vex_reg_membase(inst,dreg,vreg,basereg,disp,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_emit_vex ((inst), 0, (dreg), 0, (basereg) == AMD64_RIP ? 0 : (basereg), (vreg), (l), (pp), (map)); \
+    *(inst)++ = (unsigned char)(op); \
+    amd64_membase_emit ((inst), (dreg), (basereg), (disp)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+/* specific AVX opcode defines, L is 1 for ymm and 0 for xmm operands */
+
+#define amd64_vzeroupper(inst) do { \
+    amd64_codegen_pre(inst); \
+    amd64_emit_vex ((inst), 0, 0, 0, 0, 0, 0, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F); \
+    *(inst)++ = (unsigned char)0x77; \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define amd64_vmovdqu_reg_membase(inst,dreg,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), 0, (basereg), (disp), (l), AMD64_VEX_PP_F3, AMD64_VEX_MAP_0F, 0x6f)
+
+#define amd64_vmovdqu_membase_reg(inst,basereg,disp,reg,l) emit_vex_reg_membase ((inst), (reg), 0, (basereg), (disp), (l), AMD64_VEX_PP_F3, AMD64_VEX_MAP_0F, 0x7f)
+
+#define amd64_vxorps_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x57)
+
+#define amd64_vaddps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x58)
+
+#define amd64_vsubps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5c)
+
+#define amd64_vmulps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x59)
+
+#define amd64_vdivps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5e)
+
+#define amd64_vandps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x54)
+
+#define amd64_vorps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x56)
+
+#define amd64_vxorps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x57)
+
+#define amd64_vmaxps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5f)
+
+#define amd64_vminps_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5d)
+
+#define amd64_vpaddb_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfc)
+
+#define amd64_vpaddd_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfe)
+
+#define amd64_vpsubb_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xf8)
+
+#define amd64_vpsubd_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfa)
+
+#define amd64_vpaddusb_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xdc)
+
+#define amd64_vpsubusb_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xd8)
+
+#define amd64_vpavgb_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xe0)
+
+#define amd64_vpand_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xdb)
+
+#define amd64_vpor_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xeb)
+
+#define amd64_vpxor_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xef)
+
+#define amd64_vpcmpeqb_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0x74)
+
+#define amd64_vpcmpeqd_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0x76)
+
+#define amd64_vpcmpgtd_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0x66)
+
+#define amd64_vpmaxub_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xde)
+
+#define amd64_vpminub_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xda)
+
+#define amd64_vpmulld_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x40)
+
+#define amd64_vpmaxsd_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x3d)
+
+#define amd64_vpminsd_reg_reg_membase(inst,dreg,sreg1,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (sreg1), (basereg), (disp), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x39)
+
 /* Generated from x86-codegen.h */
 
 #define amd64_breakpoint_size(inst,size) do { x86_breakpoint(inst); } while (0)
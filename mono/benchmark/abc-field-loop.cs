@@ -0,0 +1,25 @@
+// Bounds checks in a loop over an array stored in a field, which is
+// reloaded on every iteration
+class Foo {
+	int [] data = new int [1000];
+
+	int Sum ()
+	{
+		int sum = 0;
+		for (int i = 0; i < data.Length; i++)
+			sum += data [i];
+		return sum;
+	}
+
+	static int Main ()
+	{
+		Foo foo = new Foo ();
+		long sum = 0;
+
+		for (int i = 0; i < foo.data.Length; i++)
+			foo.data [i] = i;
+		for (int i = 0; i < 200000; i++)
+			sum += foo.Sum ();
+		return sum == 200000L * 499500 ? 0 : 1;
+	}
+}
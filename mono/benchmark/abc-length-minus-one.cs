@@ -0,0 +1,23 @@
+// Bounds checks in a loop accessing a [i] and a [i + 1], which runs
+// up to a.Length - 1
+class Foo {
+	static int Deltas (int [] a)
+	{
+		int sum = 0;
+		for (int i = 0; i < a.Length - 1; i++)
+			sum += a [i + 1] - a [i];
+		return sum;
+	}
+
+	static int Main ()
+	{
+		int [] a = new int [1000];
+		int sum = 0;
+
+		for (int i = 0; i < a.Length; i++)
+			a [i] = i * 3;
+		for (int i = 0; i < 200000; i++)
+			sum += Deltas (a);
+		return sum == 200000 * 999 * 3 ? 0 : 1;
+	}
+}
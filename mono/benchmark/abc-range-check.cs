@@ -0,0 +1,27 @@
+using System;
+
+// Bounds checks in a loop whose limit is checked against the array
+// length once before the loop
+class Foo {
+	static int Sum (int [] a, int count)
+	{
+		if (count > a.Length)
+			throw new ArgumentOutOfRangeException ("count");
+		int sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += a [i];
+		return sum;
+	}
+
+	static int Main ()
+	{
+		int [] a = new int [1000];
+		int sum = 0;
+
+		for (int i = 0; i < a.Length; i++)
+			a [i] = 1;
+		for (int i = 0; i < 200000; i++)
+			sum += Sum (a, 900);
+		return sum == 200000 * 900 ? 0 : 1;
+	}
+}
@@ -0,0 +1,67 @@
+using System;
+using System.Diagnostics;
+using System.Threading;
+
+/*
+ * Measures how fast threads can register finalizers, with 1 to 64 threads allocating
+ * finalizable objects concurrently, and checks that every one of them gets finalized.
+ */
+class Finalizable
+{
+	public static int finalized;
+
+	~Finalizable ()
+	{
+		Interlocked.Increment (ref finalized);
+	}
+}
+
+public class Tests
+{
+	const int objects_per_round = 1 << 20;
+
+	static void Allocate (int count)
+	{
+		for (int i = 0; i < count; ++i)
+			new Finalizable ();
+	}
+
+	static double Round (int thread_count)
+	{
+		var threads = new Thread [thread_count];
+		int per_thread = objects_per_round / thread_count;
+		var sw = Stopwatch.StartNew ();
+
+		for (int i = 0; i < thread_count; ++i) {
+			threads [i] = new Thread (() => Allocate (per_thread));
+			threads [i].Start ();
+		}
+		for (int i = 0; i < thread_count; ++i)
+			threads [i].Join ();
+
+		sw.Stop ();
+		return per_thread * thread_count / sw.Elapsed.TotalMilliseconds;
+	}
+
+	public static int Main ()
+	{
+		long expected = 0;
+
+		for (int thread_count = 1; thread_count <= 64; thread_count *= 2) {
+			double rate = Round (thread_count);
+			expected += objects_per_round / thread_count * thread_count;
+			Console.WriteLine ("{0,2} threads: {1,8:F0} registrations/ms", thread_count, rate);
+		}
+
+		for (int i = 0; i < 10 && Finalizable.finalized < expected; ++i) {
+			GC.Collect ();
+			GC.WaitForPendingFinalizers ();
+		}
+
+		if (Finalizable.finalized != expected) {
+			Console.WriteLine ("expected {0} finalizers to run, but {1} did", expected, Finalizable.finalized);
+			return 1;
+		}
+		return 0;
+	}
+}
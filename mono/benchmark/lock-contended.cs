@@ -0,0 +1,45 @@
+using System;
+using System.Diagnostics;
+using System.Threading;
+
+/*
+ * Measures the throughput of short critical sections on a shared lock
+ * with 1 to 64 threads, the case monitor spinning is meant for.
+ */
+class T {
+	static object lock_obj = new object ();
+	static long counter;
+	static int iterations;
+
+	static void Work () {
+		for (int i = 0; i < iterations; i ++) {
+			lock (lock_obj) {
+				counter ++;
+			}
+		}
+	}
+
+	static int Main (string[] args) {
+		iterations = args.Length > 0 ? Int32.Parse (args [0]) : 200000;
+
+		for (int nthreads = 1; nthreads <= 64; nthreads *= 2) {
+			Thread[] threads = new Thread [nthreads];
+
+			counter = 0;
+			for (int i = 0; i < nthreads; i ++)
+				threads [i] = new Thread (Work);
+
+			Stopwatch sw = Stopwatch.StartNew ();
+			foreach (Thread t in threads)
+				t.Start ();
+			foreach (Thread t in threads)
+				t.Join ();
+			sw.Stop ();
+
+			if (counter != (long)iterations * nthreads)
+				return 1;
+			Console.WriteLine ("{0} threads: {1} ms, {2:F1} ns per lock", nthreads, sw.ElapsedMilliseconds, sw.Elapsed.TotalMilliseconds * 1000000 / counter);
+		}
+		return 0;
+	}
+}
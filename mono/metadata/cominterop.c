@@ -915,7 +915,7 @@ MonoMethod *
 mono_cominterop_get_native_wrapper (MonoMethod *method)
 {
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethodBuilder *mb;
 	MonoMethodSignature *sig, *csig;
 
@@ -1031,7 +1031,7 @@ mono_cominterop_get_invoke (MonoMethod *method)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	int i;
-	GHashTable* cache;
+	MonoConcurrentHashTable *cache;
 	
 	cache = mono_marshal_get_cache (&mono_method_get_wrapper_cache (method)->cominterop_invoke_cache, mono_aligned_addr_hash, NULL);
 
@@ -13,6 +13,7 @@
 #include <mono/metadata/mono-hash.h>
 #include <mono/utils/mono-compiler.h>
 #include <mono/utils/mono-internal-hash.h>
+#include <mono/utils/mono-conc-hashtable.h>
 #include <mono/io-layer/io-layer.h>
 #include <mono/metadata/mempool-internals.h>
 
@@ -343,6 +344,10 @@ struct _MonoDomain {
 	GPtrArray          *class_vtable_array;
 	/* maps remote class key -> MonoRemoteClass */
 	GHashTable         *proxy_vtable_hash;
+	/* Lock-free index of the strings in ldstr_table */
+	MonoConcurrentHashTable *ldstr_lookup_table;
+	/* Maps (vtable, class) pairs to cast cache entries, see mono_marshal_isinst_with_cache () */
+	MonoConcurrentHashTable *cast_cache;
 	/* Protected by 'jit_code_hash_lock' */
 	MonoInternalHashTable jit_code_hash;
 	mono_mutex_t    jit_code_hash_lock;
@@ -457,6 +457,7 @@ mono_domain_create (void)
 	domain->static_data_array = NULL;
 	mono_jit_code_hash_init (&domain->jit_code_hash);
 	domain->ldstr_table = mono_g_hash_table_new_type ((GHashFunc)mono_string_hash, (GCompareFunc)mono_string_equal, MONO_HASH_KEY_VALUE_GC, MONO_ROOT_SOURCE_DOMAIN, "domain string constants table");
+	domain->ldstr_lookup_table = mono_conc_hashtable_new ((GHashFunc)mono_string_hash, (GEqualFunc)mono_string_equal);
 	domain->num_jit_info_tables = 1;
 	domain->jit_info_table = mono_jit_info_table_new (domain);
 	domain->jit_info_free_queue = NULL;
@@ -1104,6 +1105,8 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 	 * no more such references, or we'll crash if a collection
 	 * occurs.
 	 */
+	mono_conc_hashtable_destroy (domain->ldstr_lookup_table);
+	domain->ldstr_lookup_table = NULL;
 	mono_g_hash_table_destroy (domain->ldstr_table);
 	domain->ldstr_table = NULL;
 
@@ -1198,6 +1201,10 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 	domain->class_vtable_array = NULL;
 	g_hash_table_destroy (domain->proxy_vtable_hash);
 	domain->proxy_vtable_hash = NULL;
+	if (domain->cast_cache) {
+		mono_conc_hashtable_destroy (domain->cast_cache);
+		domain->cast_cache = NULL;
+	}
 	if (domain->static_data_array) {
 		mono_gc_free_fixed (domain->static_data_array);
 		domain->static_data_array = NULL;
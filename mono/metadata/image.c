@@ -1624,32 +1624,39 @@ free_hash (GHashTable *hash)
 		g_hash_table_destroy (hash);
 }
 
+static inline void
+free_conc_hash (MonoConcurrentHashTable *hash)
+{
+	if (hash)
+		mono_conc_hashtable_destroy (hash);
+}
+
 void
 mono_wrapper_caches_free (MonoWrapperCaches *cache)
 {
-	free_hash (cache->delegate_invoke_cache);
-	free_hash (cache->delegate_begin_invoke_cache);
-	free_hash (cache->delegate_end_invoke_cache);
-	free_hash (cache->runtime_invoke_cache);
-	free_hash (cache->runtime_invoke_vtype_cache);
+	free_conc_hash (cache->delegate_invoke_cache);
+	free_conc_hash (cache->delegate_begin_invoke_cache);
+	free_conc_hash (cache->delegate_end_invoke_cache);
+	free_conc_hash (cache->runtime_invoke_cache);
+	free_conc_hash (cache->runtime_invoke_vtype_cache);
 	
 	free_hash (cache->delegate_abstract_invoke_cache);
 
-	free_hash (cache->runtime_invoke_direct_cache);
-	free_hash (cache->managed_wrapper_cache);
+	free_conc_hash (cache->runtime_invoke_direct_cache);
+	free_conc_hash (cache->managed_wrapper_cache);
 
-	free_hash (cache->native_wrapper_cache);
-	free_hash (cache->native_wrapper_aot_cache);
-	free_hash (cache->native_wrapper_check_cache);
-	free_hash (cache->native_wrapper_aot_check_cache);
+	free_conc_hash (cache->native_wrapper_cache);
+	free_conc_hash (cache->native_wrapper_aot_cache);
+	free_conc_hash (cache->native_wrapper_check_cache);
+	free_conc_hash (cache->native_wrapper_aot_check_cache);
 
-	free_hash (cache->native_func_wrapper_aot_cache);
+	free_conc_hash (cache->native_func_wrapper_aot_cache);
 	free_hash (cache->remoting_invoke_cache);
-	free_hash (cache->synchronized_cache);
-	free_hash (cache->unbox_wrapper_cache);
-	free_hash (cache->cominterop_invoke_cache);
-	free_hash (cache->cominterop_wrapper_cache);
-	free_hash (cache->thunk_invoke_cache);
+	free_conc_hash (cache->synchronized_cache);
+	free_conc_hash (cache->unbox_wrapper_cache);
+	free_conc_hash (cache->cominterop_invoke_cache);
+	free_conc_hash (cache->cominterop_wrapper_cache);
+	free_conc_hash (cache->thunk_invoke_cache);
 }
 
 /*
@@ -1794,14 +1801,14 @@ mono_image_close_except_pools (MonoImage *image)
 		g_hash_table_destroy (image->name_cache);
 	}
 
-	free_hash (image->delegate_bound_static_invoke_cache);
-	free_hash (image->runtime_invoke_vcall_cache);
-	free_hash (image->ldfld_wrapper_cache);
-	free_hash (image->ldflda_wrapper_cache);
-	free_hash (image->stfld_wrapper_cache);
-	free_hash (image->isinst_cache);
-	free_hash (image->castclass_cache);
-	free_hash (image->proxy_isinst_cache);
+	free_conc_hash (image->delegate_bound_static_invoke_cache);
+	free_conc_hash (image->runtime_invoke_vcall_cache);
+	free_conc_hash (image->ldfld_wrapper_cache);
+	free_conc_hash (image->ldflda_wrapper_cache);
+	free_conc_hash (image->stfld_wrapper_cache);
+	free_conc_hash (image->isinst_cache);
+	free_conc_hash (image->castclass_cache);
+	free_conc_hash (image->proxy_isinst_cache);
 	free_hash (image->var_cache_slow);
 	free_hash (image->mvar_cache_slow);
 	free_hash (image->var_cache_constrained);
@@ -1809,7 +1816,7 @@ mono_image_close_except_pools (MonoImage *image)
 	free_hash (image->wrapper_param_names);
 	free_hash (image->pinvoke_scopes);
 	free_hash (image->pinvoke_scope_filenames);
-	free_hash (image->native_func_wrapper_cache);
+	free_conc_hash (image->native_func_wrapper_cache);
 	free_hash (image->typespec_cache);
 
 	mono_wrapper_caches_free (&image->wrapper_caches);
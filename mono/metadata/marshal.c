@@ -136,9 +136,6 @@ mono_delegate_end_invoke (MonoDelegate *delegate, gpointer *params);
 static void
 mono_marshal_set_last_error_windows (int error);
 
-static MonoObject *
-mono_marshal_isinst_with_cache (MonoObject *obj, MonoClass *klass, uintptr_t *cache);
-
 static void init_safe_handle (void);
 
 static void*
@@ -2450,15 +2447,19 @@ mono_marshal_need_free (MonoType *t, MonoMethodPInvoke *piinfo, MonoMarshalSpec
 
 /*
  * Return the hash table pointed to by VAR, lazily creating it if neccesary.
+ *
+ * The wrapper caches are looked up without taking a lock, see
+ * mono_marshal_find_in_cache (). Entries are only inserted while holding the
+ * marshal lock, after the wrapper was created.
  */
-static GHashTable*
-get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
+static MonoConcurrentHashTable*
+get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GEqualFunc equal_func)
 {
 	if (!(*var)) {
 		mono_marshal_lock ();
 		if (!(*var)) {
-			GHashTable *cache = 
-				g_hash_table_new (hash_func, equal_func);
+			MonoConcurrentHashTable *cache = 
+				mono_conc_hashtable_new (hash_func, equal_func);
 			mono_memory_barrier ();
 			*var = cache;
 		}
@@ -2467,21 +2468,33 @@ get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
 	return *var;
 }
 
-GHashTable*
-mono_marshal_get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
+MonoConcurrentHashTable*
+mono_marshal_get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GEqualFunc equal_func)
 {
 	return get_cache (var, hash_func, equal_func);
 }
 
 MonoMethod*
-mono_marshal_find_in_cache (GHashTable *cache, gpointer key)
+mono_marshal_find_in_cache (MonoConcurrentHashTable *cache, gpointer key)
+{
+	return (MonoMethod *)mono_conc_hashtable_lookup (cache, key);
+}
+
+/*
+ * cache_insert:
+ *
+ *   Insert VALUE into CACHE unless there is already an entry for KEY, and return the
+ * entry which ends up in CACHE.
+ */
+static MonoMethod*
+cache_insert (MonoConcurrentHashTable *cache, gpointer key, MonoMethod *value)
 {
 	MonoMethod *res;
 
 	mono_marshal_lock ();
-	res = (MonoMethod *)g_hash_table_lookup (cache, key);
+	res = (MonoMethod *)mono_conc_hashtable_insert (cache, key, value);
 	mono_marshal_unlock ();
-	return res;
+	return res ? res : value;
 }
 
 /*
@@ -2503,7 +2516,7 @@ mono_mb_create (MonoMethodBuilder *mb, MonoMethodSignature *sig,
 
 /* Create the method from the builder and place it in the cache */
 MonoMethod*
-mono_mb_create_and_cache_full (GHashTable *cache, gpointer key,
+mono_mb_create_and_cache_full (MonoConcurrentHashTable *cache, gpointer key,
 							   MonoMethodBuilder *mb, MonoMethodSignature *sig,
 							   int max_stack, WrapperInfo *info, gboolean *out_found)
 {
@@ -2512,23 +2525,16 @@ mono_mb_create_and_cache_full (GHashTable *cache, gpointer key,
 	if (out_found)
 		*out_found = FALSE;
 
-	mono_marshal_lock ();
-	res = (MonoMethod *)g_hash_table_lookup (cache, key);
-	mono_marshal_unlock ();
+	res = (MonoMethod *)mono_conc_hashtable_lookup (cache, key);
 	if (!res) {
 		MonoMethod *newm;
 		newm = mono_mb_create_method (mb, sig, max_stack);
-		mono_marshal_lock ();
-		res = (MonoMethod *)g_hash_table_lookup (cache, key);
-		if (!res) {
-			res = newm;
-			g_hash_table_insert (cache, key, res);
-			mono_marshal_set_wrapper_info (res, info);
-			mono_marshal_unlock ();
-		} else {
+		/* The wrapper info has to be set before other threads can find the wrapper */
+		mono_marshal_set_wrapper_info (newm, info);
+		res = cache_insert (cache, key, newm);
+		if (res != newm) {
 			if (out_found)
 				*out_found = TRUE;
-			mono_marshal_unlock ();
 			mono_free_method (newm);
 		}
 	}
@@ -2537,7 +2543,7 @@ mono_mb_create_and_cache_full (GHashTable *cache, gpointer key,
 }		
 
 MonoMethod*
-mono_mb_create_and_cache (GHashTable *cache, gpointer key,
+mono_mb_create_and_cache (MonoConcurrentHashTable *cache, gpointer key,
 							   MonoMethodBuilder *mb, MonoMethodSignature *sig,
 							   int max_stack)
 {
@@ -2689,7 +2695,7 @@ get_wrapper_target_class (MonoImage *image)
  * generic method definition.
  */
 static MonoMethod*
-check_generic_wrapper_cache (GHashTable *cache, MonoMethod *orig_method, gpointer key, gpointer def_key)
+check_generic_wrapper_cache (MonoConcurrentHashTable *cache, MonoMethod *orig_method, gpointer key, gpointer def_key)
 {
 	MonoMethod *res;
 	MonoMethod *inst, *def;
@@ -2715,20 +2721,14 @@ check_generic_wrapper_cache (GHashTable *cache, MonoMethod *orig_method, gpointe
 		g_assert (mono_error_ok (&error)); /* FIXME don't swallow the error */
 		/* Cache it */
 		mono_memory_barrier ();
-		mono_marshal_lock ();
-		res = (MonoMethod *)g_hash_table_lookup (cache, key);
-		if (!res) {
-			g_hash_table_insert (cache, key, inst);
-			res = inst;
-		}
-		mono_marshal_unlock ();
+		res = cache_insert (cache, key, inst);
 		return res;
 	}
 	return NULL;
 }
 
 static MonoMethod*
-cache_generic_wrapper (GHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx, gpointer key)
+cache_generic_wrapper (MonoConcurrentHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx, gpointer key)
 {
 	MonoError error;
 	MonoMethod *inst, *res;
@@ -2739,18 +2739,12 @@ cache_generic_wrapper (GHashTable *cache, MonoMethod *orig_method, MonoMethod *d
 	inst = mono_class_inflate_generic_method_checked (def, ctx, &error);
 	g_assert (mono_error_ok (&error)); /* FIXME don't swallow the error */
 	mono_memory_barrier ();
-	mono_marshal_lock ();
-	res = (MonoMethod *)g_hash_table_lookup (cache, key);
-	if (!res) {
-		g_hash_table_insert (cache, key, inst);
-		res = inst;
-	}
-	mono_marshal_unlock ();
+	res = cache_insert (cache, key, inst);
 	return res;
 }
 
 static MonoMethod*
-check_generic_delegate_wrapper_cache (GHashTable *cache, MonoMethod *orig_method, MonoMethod *def_method, MonoGenericContext *ctx)
+check_generic_delegate_wrapper_cache (MonoConcurrentHashTable *cache, MonoMethod *orig_method, MonoMethod *def_method, MonoGenericContext *ctx)
 {
 	MonoError error;
 	MonoMethod *res;
@@ -2773,20 +2767,14 @@ check_generic_delegate_wrapper_cache (GHashTable *cache, MonoMethod *orig_method
 
 		/* Cache it */
 		mono_memory_barrier ();
-		mono_marshal_lock ();
-		res = (MonoMethod *)g_hash_table_lookup (cache, orig_method->klass);
-		if (!res) {
-			g_hash_table_insert (cache, orig_method->klass, inst);
-			res = inst;
-		}
-		mono_marshal_unlock ();
+		res = cache_insert (cache, orig_method->klass, inst);
 		return res;
 	}
 	return NULL;
 }
 
 static MonoMethod*
-cache_generic_delegate_wrapper (GHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx)
+cache_generic_delegate_wrapper (MonoConcurrentHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx)
 {
 	MonoError error;
 	MonoMethod *inst, *res;
@@ -2798,13 +2786,7 @@ cache_generic_delegate_wrapper (GHashTable *cache, MonoMethod *orig_method, Mono
 	g_assert (mono_error_ok (&error)); /* FIXME don't swallow the error */
 
 	mono_memory_barrier ();
-	mono_marshal_lock ();
-	res = (MonoMethod *)g_hash_table_lookup (cache, orig_method->klass);
-	if (!res) {
-		g_hash_table_insert (cache, orig_method->klass, inst);
-		res = inst;
-	}
-	mono_marshal_unlock ();
+	res = cache_insert (cache, orig_method->klass, inst);
 	return res;
 }
 
@@ -2814,7 +2796,7 @@ mono_marshal_get_delegate_begin_invoke (MonoMethod *method)
 	MonoMethodSignature *sig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int params_var;
 	char *name;
 	MonoGenericContext *ctx = NULL;
@@ -2845,7 +2827,7 @@ mono_marshal_get_delegate_begin_invoke (MonoMethod *method)
 	} else {
 		cache = get_cache (&method->klass->image->wrapper_caches.delegate_begin_invoke_cache,
 						   (GHashFunc)mono_signature_hash, 
-						   (GCompareFunc)mono_metadata_signature_equal);
+						   (GEqualFunc)mono_metadata_signature_equal);
 		if ((res = mono_marshal_find_in_cache (cache, sig)))
 			return res;
 	}
@@ -3039,7 +3021,7 @@ mono_marshal_get_delegate_end_invoke (MonoMethod *method)
 	MonoMethodSignature *sig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int params_var;
 	char *name;
 	MonoGenericContext *ctx = NULL;
@@ -3070,7 +3052,7 @@ mono_marshal_get_delegate_end_invoke (MonoMethod *method)
 	} else {
 		cache = get_cache (&method->klass->image->wrapper_caches.delegate_end_invoke_cache,
 						   (GHashFunc)mono_signature_hash, 
-						   (GCompareFunc)mono_metadata_signature_equal);
+						   (GEqualFunc)mono_metadata_signature_equal);
 		if ((res = mono_marshal_find_in_cache (cache, sig)))
 			return res;
 	}
@@ -3153,7 +3135,8 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 	int i;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache = NULL;
+	GHashTable *abstract_cache = NULL;
 	gpointer cache_key = NULL;
 	SignaturePointerPair key;
 	SignaturePointerPair *new_key;
@@ -3167,7 +3150,6 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 	MonoMethod *orig_method = NULL;
 	WrapperInfo *info;
 	WrapperSubtype subtype = WRAPPER_SUBTYPE_NONE;
-	gboolean found;
 	gboolean void_ret;
 
 	g_assert (method && method->klass->parent == mono_defaults.multicastdelegate_class &&
@@ -3232,7 +3214,7 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 	} else if (static_method_with_first_arg_bound) {
 		cache = get_cache (&method->klass->image->delegate_bound_static_invoke_cache,
 						   (GHashFunc)mono_signature_hash, 
-						   (GCompareFunc)mono_metadata_signature_equal);
+						   (GEqualFunc)mono_metadata_signature_equal);
 		/*
 		 * The wrapper is based on sig+invoke_sig, but sig can be derived from invoke_sig.
 		 */
@@ -3245,14 +3227,17 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 
 		cache_ptr = &mono_method_get_wrapper_cache (method)->delegate_abstract_invoke_cache;
 
-		/* We need to cache the signature+method pair */
+		/*
+		 * We need to cache the signature+method pair. This cache stays protected by the
+		 * marshal lock, since its keys are freed when dynamic methods are freed.
+		 */
 		mono_marshal_lock ();
 		if (!*cache_ptr)
 			*cache_ptr = g_hash_table_new_full (signature_pointer_pair_hash, (GEqualFunc)signature_pointer_pair_equal, (GDestroyNotify)free_signature_pointer_pair, NULL);
-		cache = *cache_ptr;
+		abstract_cache = *cache_ptr;
 		key.sig = invoke_sig;
 		key.pointer = target_method;
-		res = (MonoMethod *)g_hash_table_lookup (cache, &key);
+		res = (MonoMethod *)g_hash_table_lookup (abstract_cache, &key);
 		mono_marshal_unlock ();
 		if (res)
 			return res;
@@ -3261,7 +3246,7 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 		g_assert (!method->is_inflated);
 		cache = get_cache (&method->klass->image->wrapper_caches.delegate_invoke_cache,
 						   (GHashFunc)mono_signature_hash, 
-						   (GCompareFunc)mono_metadata_signature_equal);
+						   (GEqualFunc)mono_metadata_signature_equal);
 		res = mono_marshal_find_in_cache (cache, sig);
 		if (res)
 			return res;
@@ -3465,12 +3450,23 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 		def = mono_mb_create_and_cache_full (cache, cache_key, mb, sig, sig->param_count + 16, info, NULL);
 		res = cache_generic_delegate_wrapper (cache, orig_method, def, ctx);
 	} else if (callvirt) {
+		MonoMethod *newm;
+
 		new_key = g_new0 (SignaturePointerPair, 1);
 		*new_key = key;
 
-		res = mono_mb_create_and_cache_full (cache, new_key, mb, sig, sig->param_count + 16, info, &found);
-		if (found)
+		newm = mono_mb_create (mb, sig, sig->param_count + 16, info);
+		mono_marshal_lock ();
+		res = (MonoMethod *)g_hash_table_lookup (abstract_cache, new_key);
+		if (!res) {
+			res = newm;
+			g_hash_table_insert (abstract_cache, new_key, res);
+		}
+		mono_marshal_unlock ();
+		if (res != newm) {
 			g_free (new_key);
+			mono_free_method (newm);
+		}
 	} else {
 		res = mono_mb_create_and_cache_full (cache, cache_key, mb, sig, sig->param_count + 16, info, NULL);
 	}
@@ -3947,7 +3943,7 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual_)
 {
 	MonoMethodSignature *sig, *csig, *callsig;
 	MonoMethodBuilder *mb;
-	GHashTable *cache = NULL;
+	MonoConcurrentHashTable *cache = NULL;
 	MonoClass *target_klass;
 	MonoMethod *res = NULL;
 	static MonoMethodSignature *cctor_signature = NULL;
@@ -4026,7 +4022,7 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual_)
 		MonoMethodSignature *tmp_sig;
 
 		callsig = mono_marshal_get_runtime_invoke_sig (callsig);
-		GHashTable **cache_table = NULL;
+		MonoConcurrentHashTable **cache_table = NULL;
 
 		if (method->klass->valuetype && mono_method_signature (method)->hasthis)
 			cache_table = &mono_method_get_wrapper_cache (method)->runtime_invoke_vtype_cache;
@@ -4034,12 +4030,9 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual_)
 			cache_table = &mono_method_get_wrapper_cache (method)->runtime_invoke_cache;
 
 		cache = get_cache (cache_table, (GHashFunc)mono_signature_hash,
-							   (GCompareFunc)runtime_invoke_signature_equal);
+							   (GEqualFunc)runtime_invoke_signature_equal);
 
-		/* from mono_marshal_find_in_cache */
-		mono_marshal_lock ();
-		res = (MonoMethod *)g_hash_table_lookup (cache, callsig);
-		mono_marshal_unlock ();
+		res = mono_marshal_find_in_cache (cache, callsig);
 
 		if (res) {
 			g_free (callsig);
@@ -4091,9 +4084,7 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual_)
 		res = mono_mb_create_and_cache_full (cache, method, mb, csig, sig->param_count + 16, info, NULL);
 	} else {
 		/* taken from mono_mb_create_and_cache */
-		mono_marshal_lock ();
-		res = (MonoMethod *)g_hash_table_lookup (cache, callsig);
-		mono_marshal_unlock ();
+		res = mono_marshal_find_in_cache (cache, callsig);
 
 		info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_RUNTIME_INVOKE_NORMAL);
 		info->d.runtime_invoke.sig = callsig;
@@ -4104,19 +4095,18 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual_)
 			newm = mono_mb_create (mb, csig, sig->param_count + 16, info);
 
 			mono_marshal_lock ();
-			res = (MonoMethod *)g_hash_table_lookup (cache, callsig);
+			res = (MonoMethod *)mono_conc_hashtable_insert (cache, callsig, newm);
 			if (!res) {
-				GHashTable *direct_cache;
+				MonoConcurrentHashTable *direct_cache;
 				res = newm;
-				g_hash_table_insert (cache, callsig, res);
 				/* Can't insert it into wrapper_hash since the key is a signature */
-				direct_cache = mono_method_get_wrapper_cache (method)->runtime_invoke_direct_cache;
+				direct_cache = get_cache (&mono_method_get_wrapper_cache (method)->runtime_invoke_direct_cache, mono_aligned_addr_hash, NULL);
 
-				g_hash_table_insert (direct_cache, method, res);
-			} else {
-				mono_free_method (newm);
+				mono_conc_hashtable_insert (direct_cache, method, res);
 			}
 			mono_marshal_unlock ();
+			if (res != newm)
+				mono_free_method (newm);
 		}
 
 		/* end mono_mb_create_and_cache */
@@ -4265,8 +4255,8 @@ mono_marshal_get_runtime_invoke_for_sig (MonoMethodSignature *sig)
 	MonoMethodSignature *csig, *callsig;
 	MonoMethodBuilder *mb;
 	MonoImage *image;
-	GHashTable *cache = NULL;
-	GHashTable **cache_table = NULL;
+	MonoConcurrentHashTable *cache = NULL;
+	MonoConcurrentHashTable **cache_table = NULL;
 	MonoMethod *res = NULL;
 	char *name;
 	const char *param_names [16];
@@ -4281,12 +4271,9 @@ mono_marshal_get_runtime_invoke_for_sig (MonoMethodSignature *sig)
 	cache_table = &image->wrapper_caches.runtime_invoke_sig_cache;
 
 	cache = get_cache (cache_table, (GHashFunc)mono_signature_hash,
-					   (GCompareFunc)runtime_invoke_signature_equal);
+					   (GEqualFunc)runtime_invoke_signature_equal);
 
-	/* from mono_marshal_find_in_cache */
-	mono_marshal_lock ();
-	res = (MonoMethod *)g_hash_table_lookup (cache, callsig);
-	mono_marshal_unlock ();
+	res = mono_marshal_find_in_cache (cache, callsig);
 
 	if (res) {
 		g_free (callsig);
@@ -4323,9 +4310,7 @@ mono_marshal_get_runtime_invoke_for_sig (MonoMethodSignature *sig)
 #endif
 
 	/* taken from mono_mb_create_and_cache */
-	mono_marshal_lock ();
-	res = (MonoMethod *)g_hash_table_lookup (cache, callsig);
-	mono_marshal_unlock ();
+	res = mono_marshal_find_in_cache (cache, callsig);
 
 	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_RUNTIME_INVOKE_NORMAL);
 	info->d.runtime_invoke.sig = callsig;
@@ -4335,15 +4320,9 @@ mono_marshal_get_runtime_invoke_for_sig (MonoMethodSignature *sig)
 		MonoMethod *newm;
 		newm = mono_mb_create (mb, csig, sig->param_count + 16, info);
 
-		mono_marshal_lock ();
-		res = (MonoMethod *)g_hash_table_lookup (cache, callsig);
-		if (!res) {
-			res = newm;
-			g_hash_table_insert (cache, callsig, res);
-		} else {
+		res = cache_insert (cache, callsig, newm);
+		if (res != newm)
 			mono_free_method (newm);
-		}
-		mono_marshal_unlock ();
 	}
 
 	/* end mono_mb_create_and_cache */
@@ -7540,7 +7519,7 @@ mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions,
 	MonoMethodBuilder *mb;
 	MonoMarshalSpec **mspecs;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	gboolean pinvoke = FALSE;
 	gpointer iter;
 	int i;
@@ -7551,7 +7530,7 @@ mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions,
 	g_assert (method != NULL);
 	g_assert (mono_method_signature (method)->pinvoke);
 
-	GHashTable **cache_ptr;
+	MonoConcurrentHashTable **cache_ptr;
 
 	if (aot) {
 		if (check_exceptions)
@@ -7773,7 +7752,7 @@ mono_marshal_get_native_func_wrapper (MonoImage *image, MonoMethodSignature *sig
 	SignaturePointerPair key, *new_key;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	gboolean found;
 	char *name;
 
@@ -7823,7 +7802,7 @@ mono_marshal_get_native_func_wrapper_aot (MonoClass *klass)
 	MonoMethodSignature *sig, *csig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	char *name;
 	WrapperInfo *info;
 	MonoMethodPInvoke mpiinfo;
@@ -8233,7 +8212,7 @@ mono_marshal_get_managed_wrapper (MonoMethod *method, MonoClass *delegate_klass,
 	MonoMethod *res, *invoke;
 	MonoMarshalSpec **mspecs;
 	MonoMethodPInvoke piinfo;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int i;
 	EmitMarshalContext m;
 
@@ -8475,14 +8454,16 @@ mono_marshal_get_vtfixup_ftnptr (MonoImage *image, guint32 token, guint16 type)
  *
  * This function takes a new method builder with 0 locals and adds two locals
  * to create multiple out-branches and the fall through state of having the object
- * on the stack after a cache miss
+ * on the stack after a cache miss. The MONO_CAST_CACHE_ENTRIES entries of the
+ * cache are checked in order, empty entries are 0 so they never match.
  */
 static void
 generate_check_cache (int obj_arg_position, int class_arg_position, int cache_arg_position, // In-parameters
 											int *null_obj, int *cache_hit_neg, int *cache_hit_pos, // Out-parameters
 											MonoMethodBuilder *mb)
 {
-	int cache_miss_pos;
+	int cache_hit [MONO_CAST_CACHE_ENTRIES];
+	int cache_miss_pos, i;
 
 	/* allocate local 0 (pointer) obj_vtable */
 	mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
@@ -8499,21 +8480,30 @@ generate_check_cache (int obj_arg_position, int class_arg_position, int cache_ar
 	mono_mb_emit_byte (mb, CEE_LDIND_I);
 	mono_mb_emit_stloc (mb, 0);
 
-	/* cached_vtable = *cache*/
-	mono_mb_emit_ldarg (mb, cache_arg_position);
-	mono_mb_emit_byte (mb, CEE_LDIND_I);
-	mono_mb_emit_stloc (mb, 1);
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		/* cached_vtable = cache [i]*/
+		mono_mb_emit_ldarg (mb, cache_arg_position);
+		if (i) {
+			mono_mb_emit_icon (mb, i * sizeof (gpointer));
+			mono_mb_emit_byte (mb, CEE_ADD);
+		}
+		mono_mb_emit_byte (mb, CEE_LDIND_I);
+		mono_mb_emit_stloc (mb, 1);
 
-	mono_mb_emit_ldloc (mb, 1);
-	mono_mb_emit_byte (mb, CEE_LDC_I4);
-	mono_mb_emit_i4 (mb, ~0x1);
-	mono_mb_emit_byte (mb, CEE_CONV_I);
-	mono_mb_emit_byte (mb, CEE_AND);
-	mono_mb_emit_ldloc (mb, 0);
-	/*if ((cached_vtable & ~0x1)== obj_vtable)*/
-	cache_miss_pos = mono_mb_emit_branch (mb, CEE_BNE_UN);
+		mono_mb_emit_ldloc (mb, 1);
+		mono_mb_emit_byte (mb, CEE_LDC_I4);
+		mono_mb_emit_i4 (mb, ~0x1);
+		mono_mb_emit_byte (mb, CEE_CONV_I);
+		mono_mb_emit_byte (mb, CEE_AND);
+		mono_mb_emit_ldloc (mb, 0);
+		/*if ((cached_vtable & ~0x1)== obj_vtable)*/
+		cache_hit [i] = mono_mb_emit_branch (mb, CEE_BEQ);
+	}
+	cache_miss_pos = mono_mb_emit_branch (mb, CEE_BR);
 
 	/*return (cached_vtable & 0x1) ? NULL : obj;*/
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i)
+		mono_mb_patch_branch (mb, cache_hit [i]);
 	mono_mb_emit_ldloc (mb, 1);
 	mono_mb_emit_byte(mb, CEE_LDC_I4_1);
 	mono_mb_emit_byte (mb, CEE_CONV_U);
@@ -8596,25 +8586,125 @@ mono_marshal_get_castclass_with_cache (void)
 	return cached;
 }
 
-static MonoObject *
+typedef struct {
+	MonoVTable *vtable;
+	MonoClass *klass;
+} CastCacheKey;
+
+static guint
+cast_cache_key_hash (gconstpointer key)
+{
+	const CastCacheKey *k = (const CastCacheKey *)key;
+
+	return mono_aligned_addr_hash (k->vtable) ^ (mono_aligned_addr_hash (k->klass) * 31);
+}
+
+static gboolean
+cast_cache_key_equal (gconstpointer a, gconstpointer b)
+{
+	const CastCacheKey *k1 = (const CastCacheKey *)a;
+	const CastCacheKey *k2 = (const CastCacheKey *)b;
+
+	return k1->vtable == k2->vtable && k1->klass == k2->klass;
+}
+
+/*
+ * cast_cache_insert:
+ *
+ *   Record ENTRY as the result of checking objects with VTABLE against KLASS in the
+ * cast cache of DOMAIN, creating it if needed. Lookups don't need any locking.
+ */
+static void
+cast_cache_insert (MonoDomain *domain, MonoVTable *vtable, MonoClass *klass, uintptr_t entry)
+{
+	CastCacheKey lookup_key, *key;
+
+	mono_domain_lock (domain);
+	if (!domain->cast_cache) {
+		MonoConcurrentHashTable *hash = mono_conc_hashtable_new (cast_cache_key_hash, cast_cache_key_equal);
+
+		mono_memory_barrier ();
+		domain->cast_cache = hash;
+	}
+	lookup_key.vtable = vtable;
+	lookup_key.klass = klass;
+	if (!mono_conc_hashtable_lookup (domain->cast_cache, &lookup_key)) {
+		key = (CastCacheKey *)mono_domain_alloc (domain, sizeof (CastCacheKey));
+		*key = lookup_key;
+		mono_conc_hashtable_insert (domain->cast_cache, key, (gpointer)entry);
+	}
+	mono_domain_unlock (domain);
+}
+
+/*
+ * mono_marshal_isinst_with_cache:
+ *
+ *   Slow path of the cast checks which go through a per call site cache of
+ * MONO_CAST_CACHE_ENTRIES entries. The result is added to the first free entry of
+ * CACHE. Once all of them are taken the call site is megamorphic, and only then the
+ * result comes from the cast cache of the domain, which maps (vtable, class) pairs to
+ * cache entries, without redoing the check.
+ */
+MonoObject *
 mono_marshal_isinst_with_cache (MonoObject *obj, MonoClass *klass, uintptr_t *cache)
 {
 	MonoError error;
-	MonoObject *isinst = mono_object_isinst_checked (obj, klass, &error);
-	mono_error_raise_exception (&error); /* FIXME don't raise here */
+	MonoVTable *vtable = obj->vtable;
+	MonoDomain *domain = vtable->domain;
+	MonoConcurrentHashTable *hash;
+	MonoObject *isinst;
+	CastCacheKey key;
+	uintptr_t entry = 0;
+	int i;
 
 #ifndef DISABLE_REMOTING
-	if (obj->vtable->klass == mono_defaults.transparent_proxy_class)
+	if (vtable->klass == mono_defaults.transparent_proxy_class) {
+		isinst = mono_object_isinst_checked (obj, klass, &error);
+		mono_error_raise_exception (&error); /* FIXME don't raise here */
 		return isinst;
+	}
 #endif
 
-	uintptr_t cache_update = (uintptr_t)obj->vtable;
-	if (!isinst)
-		cache_update = cache_update | 0x1;
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		if (!cache [i])
+			break;
+	}
+
+	if (i < MONO_CAST_CACHE_ENTRIES) {
+		/* The call site isn't megamorphic yet, so the cast cache of the domain is not needed */
+		isinst = mono_object_isinst_checked (obj, klass, &error);
+		mono_error_raise_exception (&error); /* FIXME don't raise here */
+
+		entry = (uintptr_t)vtable;
+		if (!isinst)
+			entry = entry | 0x1;
+		for (; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+			uintptr_t old = (uintptr_t)InterlockedCompareExchangePointer ((volatile gpointer *)&cache [i], (gpointer)entry, NULL);
 
-	*cache = cache_update;
+			if (!old || old == entry)
+				break;
+		}
+		return isinst;
+	}
+
+	hash = domain->cast_cache;
+	if (hash) {
+		key.vtable = vtable;
+		key.klass = klass;
+		entry = (uintptr_t)mono_conc_hashtable_lookup (hash, &key);
+	}
+
+	if (!entry) {
+		isinst = mono_object_isinst_checked (obj, klass, &error);
+		mono_error_raise_exception (&error); /* FIXME don't raise here */
+
+		entry = (uintptr_t)vtable;
+		if (!isinst)
+			entry = entry | 0x1;
+		cast_cache_insert (domain, vtable, klass, entry);
+	}
 
-	return isinst;
+	return (entry & 0x1) ? NULL : obj;
 }
 
 /*
@@ -8693,7 +8783,7 @@ MonoMethod *
 mono_marshal_get_isinst (MonoClass *klass)
 {
 	static MonoMethodSignature *isint_sig = NULL;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 	WrapperInfo *info;
 	int pos_was_ok, pos_end;
@@ -8802,7 +8892,7 @@ MonoMethod *
 mono_marshal_get_castclass (MonoClass *klass)
 {
 	static MonoMethodSignature *castclass_sig = NULL;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 #ifndef DISABLE_REMOTING
 	int pos_was_ok, pos_was_ok2;
@@ -9084,7 +9174,7 @@ mono_marshal_get_synchronized_wrapper (MonoMethod *method)
 	MonoExceptionClause *clause;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	WrapperInfo *info;
 	int i, pos, pos2, this_local, taken_local, ret_local = 0;
 	MonoGenericContext *ctx = NULL;
@@ -9274,7 +9364,7 @@ mono_marshal_get_unbox_wrapper (MonoMethod *method)
 	int i;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	WrapperInfo *info;
 
 	cache = get_cache (&mono_method_get_wrapper_cache (method)->unbox_wrapper_cache, mono_aligned_addr_hash, NULL);
@@ -10236,7 +10326,7 @@ mono_marshal_get_array_accessor_wrapper (MonoMethod *method)
 	MonoMethodSignature *sig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int i;
 	MonoGenericContext *ctx = NULL;
 	MonoMethod *orig_method = NULL;
@@ -11591,7 +11681,7 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	MonoExceptionClause *clause;
 	MonoImage *image;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 	int i, param_count, sig_size, pos_leave;
 	int coop_gc_var, coop_gc_dummy_local;
@@ -11772,12 +11862,12 @@ mono_marshal_free_dynamic_wrappers (MonoMethod *method)
 	 * they could be shared with other methods ?
 	 */
 	if (image->wrapper_caches.runtime_invoke_direct_cache)
-		g_hash_table_remove (image->wrapper_caches.runtime_invoke_direct_cache, method);
+		mono_conc_hashtable_remove (image->wrapper_caches.runtime_invoke_direct_cache, method);
 	if (image->wrapper_caches.delegate_abstract_invoke_cache)
 		g_hash_table_foreach_remove (image->wrapper_caches.delegate_abstract_invoke_cache, signature_pointer_pair_matches_pointer, method);
 	// FIXME: Need to clear the caches in other images as well
 	if (image->delegate_bound_static_invoke_cache)
-		g_hash_table_remove (image->delegate_bound_static_invoke_cache, mono_method_signature (method));
+		mono_conc_hashtable_remove (image->delegate_bound_static_invoke_cache, mono_method_signature (method));
 
 	if (marshal_mutex_initialized)
 		mono_marshal_unlock ();
@@ -29,6 +29,12 @@
 		mono_marshal_find_nonzero_bit_offset ((guint8*)&tmp, sizeof (tmp), (byte_offset), (bitmask)); \
 	} while (0)
 
+/*
+ * The number of entries in the per call site caches used by isinst/castclass with cache.
+ * Each entry holds a vtable, with the low bit set if the check failed for it.
+ */
+#define MONO_CAST_CACHE_ENTRIES 4
+
 /*
  * This structure holds the state kept by the emit_ marshalling functions.
  * This is exported so it can be used by cominterop.c.
@@ -359,6 +365,9 @@ mono_marshal_get_castclass_with_cache (void);
 MonoMethod *
 mono_marshal_get_isinst_with_cache (void);
 
+MonoObject *
+mono_marshal_isinst_with_cache (MonoObject *obj, MonoClass *klass, uintptr_t *cache);
+
 MonoMethod *
 mono_marshal_get_isinst (MonoClass *klass);
 
@@ -573,14 +582,14 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 void
 mono_marshal_emit_managed_wrapper (MonoMethodBuilder *mb, MonoMethodSignature *invoke_sig, MonoMarshalSpec **mspecs, EmitMarshalContext* m, MonoMethod *method, uint32_t target_handle);
 
-GHashTable*
-mono_marshal_get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func);
+MonoConcurrentHashTable*
+mono_marshal_get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GEqualFunc equal_func);
 
 MonoMethod*
-mono_marshal_find_in_cache (GHashTable *cache, gpointer key);
+mono_marshal_find_in_cache (MonoConcurrentHashTable *cache, gpointer key);
 
 MonoMethod*
-mono_mb_create_and_cache (GHashTable *cache, gpointer key,
+mono_mb_create_and_cache (MonoConcurrentHashTable *cache, gpointer key,
 						  MonoMethodBuilder *mb, MonoMethodSignature *sig,
 						  int max_stack);
 void
@@ -606,7 +615,7 @@ mono_mb_create (MonoMethodBuilder *mb, MonoMethodSignature *sig,
 				int max_stack, WrapperInfo *info);
 
 MonoMethod*
-mono_mb_create_and_cache_full (GHashTable *cache, gpointer key,
+mono_mb_create_and_cache_full (MonoConcurrentHashTable *cache, gpointer key,
 							   MonoMethodBuilder *mb, MonoMethodSignature *sig,
 							   int max_stack, WrapperInfo *info, gboolean *out_found);
 
@@ -102,41 +102,45 @@ struct _MonoAssembly {
 };
 
 typedef struct {
+	/*
+	 * The caches which are MonoConcurrentHashTables can be read without locking,
+	 * inserts and removals are protected by the marshal lock.
+	 */
+
 	/*
 	 * indexed by MonoMethodSignature 
-	 * Protected by the marshal lock
 	 */
-	GHashTable *delegate_invoke_cache;
-	GHashTable *delegate_begin_invoke_cache;
-	GHashTable *delegate_end_invoke_cache;
-	GHashTable *runtime_invoke_cache;
-	GHashTable *runtime_invoke_vtype_cache;
-	GHashTable *runtime_invoke_sig_cache;
+	MonoConcurrentHashTable *delegate_invoke_cache;
+	MonoConcurrentHashTable *delegate_begin_invoke_cache;
+	MonoConcurrentHashTable *delegate_end_invoke_cache;
+	MonoConcurrentHashTable *runtime_invoke_cache;
+	MonoConcurrentHashTable *runtime_invoke_vtype_cache;
+	MonoConcurrentHashTable *runtime_invoke_sig_cache;
 
 	/*
 	 * indexed by SignaturePointerPair
+	 * Protected by the marshal lock
 	 */
 	GHashTable *delegate_abstract_invoke_cache;
 
 	/*
 	 * indexed by MonoMethod pointers
-	 * Protected by the marshal lock
 	 */
-	GHashTable *runtime_invoke_direct_cache;
-	GHashTable *managed_wrapper_cache;
+	MonoConcurrentHashTable *runtime_invoke_direct_cache;
+	MonoConcurrentHashTable *managed_wrapper_cache;
 
-	GHashTable *native_wrapper_cache;
-	GHashTable *native_wrapper_aot_cache;
-	GHashTable *native_wrapper_check_cache;
-	GHashTable *native_wrapper_aot_check_cache;
+	MonoConcurrentHashTable *native_wrapper_cache;
+	MonoConcurrentHashTable *native_wrapper_aot_cache;
+	MonoConcurrentHashTable *native_wrapper_check_cache;
+	MonoConcurrentHashTable *native_wrapper_aot_check_cache;
 
-	GHashTable *native_func_wrapper_aot_cache;
+	MonoConcurrentHashTable *native_func_wrapper_aot_cache;
 	GHashTable *remoting_invoke_cache;
-	GHashTable *synchronized_cache;
-	GHashTable *unbox_wrapper_cache;
-	GHashTable *cominterop_invoke_cache;
-	GHashTable *cominterop_wrapper_cache; /* LOCKING: marshal lock */
-	GHashTable *thunk_invoke_cache;
+	MonoConcurrentHashTable *synchronized_cache;
+	MonoConcurrentHashTable *unbox_wrapper_cache;
+	MonoConcurrentHashTable *cominterop_invoke_cache;
+	MonoConcurrentHashTable *cominterop_wrapper_cache;
+	MonoConcurrentHashTable *thunk_invoke_cache;
 } MonoWrapperCaches;
 
 typedef struct {
@@ -315,27 +319,28 @@ struct _MonoImage {
 	mono_mutex_t szarray_cache_lock;
 
 	/*
+	 * Wrapper caches, see MonoWrapperCaches for the locking.
 	 * indexed by SignaturePointerPair
 	 */
-	GHashTable *delegate_bound_static_invoke_cache;
-	GHashTable *native_func_wrapper_cache;
+	MonoConcurrentHashTable *delegate_bound_static_invoke_cache;
+	MonoConcurrentHashTable *native_func_wrapper_cache;
 
 	/*
 	 * indexed by MonoMethod pointers 
 	 */
-	GHashTable *runtime_invoke_vcall_cache;
+	MonoConcurrentHashTable *runtime_invoke_vcall_cache;
 	GHashTable *wrapper_param_names;
-	GHashTable *array_accessor_cache;
+	MonoConcurrentHashTable *array_accessor_cache;
 
 	/*
 	 * indexed by MonoClass pointers
 	 */
-	GHashTable *ldfld_wrapper_cache;
-	GHashTable *ldflda_wrapper_cache;
-	GHashTable *stfld_wrapper_cache;
-	GHashTable *isinst_cache;
-	GHashTable *castclass_cache;
-	GHashTable *proxy_isinst_cache;
+	MonoConcurrentHashTable *ldfld_wrapper_cache;
+	MonoConcurrentHashTable *ldflda_wrapper_cache;
+	MonoConcurrentHashTable *stfld_wrapper_cache;
+	MonoConcurrentHashTable *isinst_cache;
+	MonoConcurrentHashTable *castclass_cache;
+	MonoConcurrentHashTable *proxy_isinst_cache;
 	GHashTable *rgctx_template_hash; /* LOCKING: templates lock */
 
 	/* Contains rarely used fields of runtime structures belonging to this image */
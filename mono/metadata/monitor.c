@@ -30,6 +30,8 @@
 #include <mono/metadata/profiler-private.h>
 #include <mono/utils/mono-time.h>
 #include <mono/utils/atomic.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-proclib.h>
 
 /*
  * Pull the list of opcodes
@@ -52,16 +54,15 @@ enum {
  * http://www.research.ibm.com/people/d/dfb/papers/Bacon98Thin.ps
  *
  * The Dice paper describes a technique for saving lock record space
- * by returning records to a free list when they become unused.  That
- * sounds like unnecessary complexity to me, though if it becomes
- * clear that unused lock records are taking up lots of space or we
- * need to shave more time off by avoiding a malloc then we can always
- * implement the free list idea later.  The timeout parameter to
- * try_enter voids some of the assumptions about the reference count
- * field in Dice's implementation too.  In his version, the thread
- * attempting to lock a contended object will block until it succeeds,
- * so the reference count will never be decremented while an object is
- * locked.
+ * by returning records to a free list when they become unused.  We do
+ * this after major collections, see mono_monitor_deflate (): the world is stopped,
+ * so a record which isn't owned, waited for or waited on can be
+ * detached from its object without racing with the lock operations.
+ * The timeout parameter to try_enter voids some of the assumptions
+ * about the reference count field in Dice's implementation.  In his
+ * version, the thread attempting to lock a contended object will block
+ * until it succeeds, so the reference count will never be decremented
+ * while an object is locked.
  *
  * Bacon's thin locks have a fast path that doesn't need a lock record
  * for the common case of locking an unlocked or shallow-nested
@@ -84,6 +85,32 @@ static MonoThreadsSync *monitor_freelist;
 static MonitorArray *monitor_allocated;
 static int array_size = 16;
 
+/*
+ * Lock records which are not attached to an object have this owner, so the lock
+ * operations of threads which read the lock word before the record was deflated fail
+ * and start over. Deflated records are kept on monitor_deflated until the next
+ * deflation pass before they are reused.
+ */
+#define MONITOR_OWNER_DETACHED OWNER_MASK
+static MonoThreadsSync *monitor_deflated;
+static gint32 monitor_inflations, monitor_deflations;
+
+/*
+ * Contended locks are spun on before the thread blocks, since critical sections are
+ * often shorter than a sleep/wakeup cycle. Inflated locks start with MONITOR_SPIN_INITIAL
+ * iterations, see mono_monitor_spin_inflated () for how this adapts. Flat locks have no
+ * place to record a budget, they are spun on for MONITOR_SPIN_FLAT iterations before
+ * they are inflated.
+ */
+#define MONITOR_SPIN_MIN 16
+#define MONITOR_SPIN_INITIAL 128
+#define MONITOR_SPIN_MAX 2048
+#define MONITOR_SPIN_FLAT 64
+
+/* Spinning is pointless if the owner can't run at the same time */
+static gboolean monitor_spin_enabled;
+static gint32 monitor_spin_acquired, monitor_spin_failed;
+
 /* MonoThreadsSync status helpers */
 
 static inline guint32
@@ -250,6 +277,12 @@ void
 mono_monitor_init (void)
 {
 	mono_os_mutex_init_recursive (&monitor_mutex);
+
+	monitor_spin_enabled = mono_cpu_count () > 1;
+	mono_counters_register ("Monitor spin acquisitions", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT, &monitor_spin_acquired);
+	mono_counters_register ("Monitor spin failures", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT, &monitor_spin_failed);
+	mono_counters_register ("Monitor inflations", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT, &monitor_inflations);
+	mono_counters_register ("Monitor deflations", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT, &monitor_deflations);
 }
  
 void
@@ -263,6 +296,8 @@ mono_monitor_cleanup (void)
 	/* The monitors on the freelist don't have weak links - mark them */
 	for (mon = monitor_freelist; mon; mon = (MonoThreadsSync *)mon->data)
 		mon->wait_list = (GSList *)-1;
+	for (mon = monitor_deflated; mon; mon = (MonoThreadsSync *)mon->data)
+		mon->wait_list = (GSList *)-1;
 
 	/*
 	 * FIXME: This still crashes with sgen (async_read.exe)
@@ -366,7 +401,8 @@ mon_finalize (MonoThreadsSync *mon)
 	 */
 	g_assert (mon->wait_list == NULL);
 
-	/* owner and nest are set in mon_new, no need to zero them out */
+	/* nest is set in mon_new, no need to zero it out */
+	mon->status = mon_status_set_owner (mon->status, MONITOR_OWNER_DETACHED);
 
 	mon->data = monitor_freelist;
 	monitor_freelist = mon;
@@ -388,6 +424,9 @@ mon_new (gsize id)
 		new_ = NULL;
 		for (marray = monitor_allocated; marray; marray = marray->next) {
 			for (i = 0; i < marray->num_monitors; ++i) {
+				/* Deflated records are linked through data */
+				if (mon_status_get_owner (marray->monitors [i].status) == MONITOR_OWNER_DETACHED)
+					continue;
 				if (mono_gchandle_get_target ((guint32)marray->monitors [i].data) == NULL) {
 					new_ = &marray->monitors [i];
 					if (new_->wait_list) {
@@ -399,6 +438,7 @@ mon_new (gsize id)
 						}
 					}
 					mono_gchandle_free ((guint32)new_->data);
+					new_->status = mon_status_set_owner (new_->status, MONITOR_OWNER_DETACHED);
 					new_->data = monitor_freelist;
 					monitor_freelist = new_;
 				}
@@ -416,8 +456,10 @@ mon_new (gsize id)
 			array_size *= 2;
 			/* link into the freelist */
 			for (i = 0; i < marray->num_monitors - 1; ++i) {
+				marray->monitors [i].status = MONITOR_OWNER_DETACHED;
 				marray->monitors [i].data = &marray->monitors [i + 1];
 			}
+			marray->monitors [i].status = MONITOR_OWNER_DETACHED;
 			marray->monitors [i].data = NULL; /* the last one */
 			monitor_freelist = &marray->monitors [0];
 			/* we happend the marray instead of prepending so that
@@ -441,6 +483,7 @@ mon_new (gsize id)
 	new_->status = mon_status_init_entry_count (new_->status);
 	new_->nest = 1;
 	new_->data = NULL;
+	new_->spin_budget = MONITOR_SPIN_INITIAL;
 	
 #ifndef DISABLE_PERFCOUNTERS
 	mono_perfcounters->gc_sync_blocks++;
@@ -498,6 +541,8 @@ mono_monitor_inflate_owned (MonoObject *obj, int id)
 	if (tmp_lw.sync != old_lw.sync) {
 		/* Someone else inflated the lock in the meantime */
 		discard_mon (mon);
+	} else {
+		InterlockedIncrement (&monitor_inflations);
 	}
 }
 
@@ -540,6 +585,7 @@ mono_monitor_inflate (MonoObject *obj)
 		tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, old_lw.sync);
 		if (tmp_lw.sync == old_lw.sync) {
 			/* Successfully inflated the lock */
+			InterlockedIncrement (&monitor_inflations);
 			return;
 		}
 
@@ -614,12 +660,24 @@ mono_object_hash (MonoObject* obj)
 		lw.sync = obj->synchronisation;
 	}
 
-	/* At this point, the lock is inflated */
-	lock_word_get_inflated_lock (lw)->hash_code = hash;
-	lw = lock_word_set_has_hash (lw);
-	mono_memory_write_barrier ();
-	obj->synchronisation = lw.sync;
-	return hash;
+	/*
+	 * At this point, the lock is inflated, unless the GC deflated it in the meantime.
+	 * The lock word is only replaced if it didn't change, for the same reason.
+	 */
+	for (;;) {
+		LockWord old_lw, nlw;
+
+		if (!lock_word_is_inflated (lw))
+			return mono_object_hash (obj);
+
+		lock_word_get_inflated_lock (lw)->hash_code = hash;
+		nlw = lock_word_set_has_hash (lw);
+		mono_memory_write_barrier ();
+		old_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, lw.sync);
+		if (old_lw.sync == lw.sync)
+			return hash;
+		lw = old_lw;
+	}
 #else
 /*
  * Wang's address-based hash function:
@@ -643,6 +701,40 @@ mono_monitor_ensure_owned (LockWord lw, guint32 id)
 	mono_set_pending_exception (mono_get_exception_synchronization_lock ("Object synchronization method was called from an unsynchronized block of code."));
 }
 
+/*
+ * Release MON, which is owned by the current thread, and wake up a thread
+ * waiting for it if there is one.
+ */
+static void
+mon_release (MonoThreadsSync *mon)
+{
+	guint32 new_status, old_status, tmp_status;
+
+	old_status = mon->status;
+
+	/*
+	 * Release lock and do the wakeup stuff. It's possible that
+	 * the last blocking thread gave up waiting just before we
+	 * release the semaphore resulting in a negative entry count
+	 * and a futile wakeup next time there's contention for this
+	 * object.
+	 */
+	for (;;) {
+		gboolean have_waiters = mon_status_have_waiters (old_status);
+
+		new_status = mon_status_set_owner (old_status, 0);
+		if (have_waiters)
+			new_status = mon_status_decrement_entry_count (new_status);
+		tmp_status = InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status);
+		if (tmp_status == old_status) {
+			if (have_waiters)
+				ReleaseSemaphore (mon->entry_sem, 1, NULL);
+			break;
+		}
+		old_status = tmp_status;
+	}
+}
+
 /*
  * When this function is called it has already been established that the
  * current thread owns the monitor.
@@ -659,31 +751,7 @@ mono_monitor_exit_inflated (MonoObject *obj)
 
 	nest = mon->nest - 1;
 	if (nest == 0) {
-		guint32 new_status, old_status, tmp_status;
-
-		old_status = mon->status;
-
-		/*
-		 * Release lock and do the wakeup stuff. It's possible that
-		 * the last blocking thread gave up waiting just before we
-		 * release the semaphore resulting in a negative entry count
-		 * and a futile wakeup next time there's contention for this
-		 * object.
-		 */
-		for (;;) {
-			gboolean have_waiters = mon_status_have_waiters (old_status);
-	
-			new_status = mon_status_set_owner (old_status, 0);
-			if (have_waiters)
-				new_status = mon_status_decrement_entry_count (new_status);
-			tmp_status = InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status);
-			if (tmp_status == old_status) {
-				if (have_waiters)
-					ReleaseSemaphore (mon->entry_sem, 1, NULL);
-				break;
-			}
-			old_status = tmp_status;
-		}
+		mon_release (mon);
 		LOCK_DEBUG (g_message ("%s: (%d) Object %p is now unlocked", __func__, mono_thread_info_get_small_id (), obj));
 	
 		/* object is now unlocked, leave nest==1 so we don't
@@ -734,8 +802,116 @@ mon_decrement_entry_count (MonoThreadsSync *mon)
 	}
 }
 
+static inline void
+spin_pause (void)
+{
+#if defined(_MSC_VER)
+	YieldProcessor ();
+#elif defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__ ("pause" : : : "memory");
+#else
+	mono_memory_read_barrier ();
+#endif
+}
+
+/*
+ * mono_monitor_spin_inflated:
+ *
+ *   Spin while MON is owned by another thread, and try to acquire it once it is released.
+ * Return whenever it was acquired. The spin budget adapts to the time it took to acquire
+ * MON in the past: it moves towards twice the latency of a successful spin, and halves
+ * after a failed one, so locks which are held for long stop wasting cpu time. The budget
+ * is updated without synchronization, since it is only a heuristic.
+ */
+static gboolean
+mono_monitor_spin_inflated (MonoThreadsSync *mon, guint32 id)
+{
+	guint32 new_status, old_status;
+	gint32 budget = mon->spin_budget;
+	int i;
+
+	if (!monitor_spin_enabled)
+		return FALSE;
+
+	for (i = 0; i < budget; ++i) {
+		spin_pause ();
+		old_status = mon->status;
+		if (G_UNLIKELY (mon_status_get_owner (old_status) == MONITOR_OWNER_DETACHED))
+			return FALSE;
+		if (mon_status_get_owner (old_status) != 0)
+			continue;
+		new_status = mon_status_set_owner (old_status, id);
+		if (InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status) == old_status) {
+			g_assert (mon->nest == 1);
+			mon->spin_budget = CLAMP ((budget + 2 * (i + 1)) / 2, MONITOR_SPIN_MIN, MONITOR_SPIN_MAX);
+			InterlockedIncrement (&monitor_spin_acquired);
+			return TRUE;
+		}
+	}
+
+	mon->spin_budget = MAX (budget / 2, MONITOR_SPIN_MIN);
+	InterlockedIncrement (&monitor_spin_failed);
+	return FALSE;
+}
+
+/*
+ * mono_monitor_spin_flat:
+ *
+ *   Spin while the flat lock of OBJ is owned by another thread, and try to acquire it
+ * once it is released, so short critical sections don't inflate the lock. Return
+ * whenever it was acquired.
+ */
+static gboolean
+mono_monitor_spin_flat (MonoObject *obj, guint32 id)
+{
+	LockWord lw, nlw;
+	int i;
+
+	if (!monitor_spin_enabled)
+		return FALSE;
+
+	nlw = lock_word_new_flat (id);
+	for (i = 0; i < MONITOR_SPIN_FLAT; ++i) {
+		spin_pause ();
+		lw.sync = obj->synchronisation;
+		if (lock_word_is_free (lw)) {
+			if (InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, NULL) == NULL) {
+				InterlockedIncrement (&monitor_spin_acquired);
+				return TRUE;
+			}
+		} else if (!lock_word_is_flat (lw)) {
+			/* Inflated, or a hash code was stored */
+			return FALSE;
+		}
+	}
+
+	InterlockedIncrement (&monitor_spin_failed);
+	return FALSE;
+}
+
+/*
+ * mon_is_attached:
+ *
+ *   Return whenever MON is the lock record of OBJ. MON can be deflated by the GC after
+ * a thread read it from the lock word, and reused for another object.
+ */
+static inline gboolean
+mon_is_attached (MonoObject *obj, MonoThreadsSync *mon)
+{
+	LockWord lw;
+
+	lw.sync = obj->synchronisation;
+	return lock_word_is_inflated (lw) && lock_word_get_inflated_lock (lw) == mon;
+}
+
+static inline gint32
+mono_monitor_try_enter_internal (MonoObject *obj, guint32 ms, gboolean allow_interruption);
+
 /* If allow_interruption==TRUE, the method will be interrumped if abort or suspend
  * is requested. In this case it returns -1.
+ *
+ * If the lock record turns out to have been deflated, the lock is retried through
+ * mono_monitor_try_enter_internal ().
  */ 
 static inline gint32 
 mono_monitor_try_enter_inflated (MonoObject *obj, guint32 ms, gboolean allow_interruption, guint32 id)
@@ -758,10 +934,14 @@ mono_monitor_try_enter_inflated (MonoObject *obj, guint32 ms, gboolean allow_int
 	}
 
 	lw.sync = obj->synchronisation;
+	if (G_UNLIKELY (!lock_word_is_inflated (lw))) {
+		/* Deflated since the caller looked at it */
+		return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
+	}
 	mon = lock_word_get_inflated_lock (lw);
 retry:
-	/* This case differs from Dice's case 3 because we don't
-	 * deflate locks or cache unused lock records
+	/* This case differs from Dice's case 3 because unused lock
+	 * records are only deflated while the world is stopped
 	 */
 	old_status = mon->status;
 	if (G_LIKELY (mon_status_get_owner (old_status) == 0)) {
@@ -772,6 +952,10 @@ retry:
 		new_status = mon_status_set_owner (old_status, id);
 		tmp_status = InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status);
 		if (G_LIKELY (tmp_status == old_status)) {
+			if (G_UNLIKELY (!mon_is_attached (obj, mon))) {
+				mon_release (mon);
+				return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
+			}
 			/* Success */
 			g_assert (mon->nest == 1);
 			return 1;
@@ -783,10 +967,15 @@ retry:
 
 	/* If the object is currently locked by this thread... */
 	if (mon_status_get_owner (old_status) == id) {
+		if (G_UNLIKELY (!mon_is_attached (obj, mon)))
+			return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
 		mon->nest++;
 		return 1;
 	}
 
+	if (G_UNLIKELY (mon_status_get_owner (old_status) == MONITOR_OWNER_DETACHED))
+		return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
+
 	/* The object must be locked by someone else... */
 #ifndef DISABLE_PERFCOUNTERS
 	mono_perfcounters->thread_contentions++;
@@ -800,6 +989,15 @@ retry:
 
 	mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_CONTENTION);
 
+	if (mono_monitor_spin_inflated (mon, id)) {
+		if (G_UNLIKELY (!mon_is_attached (obj, mon))) {
+			mon_release (mon);
+			return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
+		}
+		mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
+		return 1;
+	}
+
 	/* The slow path begins here. */
 retry_contended:
 	/* a small amount of duplicated code, but it allows us to insert the profiler
@@ -807,9 +1005,6 @@ retry_contended:
 	 * retry label, but to retry_contended. At this point mon is already installed in the object
 	 * header.
 	 */
-	/* This case differs from Dice's case 3 because we don't
-	 * deflate locks or cache unused lock records
-	 */
 	old_status = mon->status;
 	if (G_LIKELY (mon_status_get_owner (old_status) == 0)) {
 		/* Try to install our ID in the owner field, nest
@@ -819,6 +1014,10 @@ retry_contended:
 		new_status = mon_status_set_owner (old_status, id);
 		tmp_status = InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status);
 		if (G_LIKELY (tmp_status == old_status)) {
+			if (G_UNLIKELY (!mon_is_attached (obj, mon))) {
+				mon_release (mon);
+				return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
+			}
 			/* Success */
 			g_assert (mon->nest == 1);
 			mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
@@ -828,11 +1027,16 @@ retry_contended:
 
 	/* If the object is currently locked by this thread... */
 	if (mon_status_get_owner (old_status) == id) {
+		if (G_UNLIKELY (!mon_is_attached (obj, mon)))
+			return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
 		mon->nest++;
 		mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
 		return 1;
 	}
 
+	if (G_UNLIKELY (mon_status_get_owner (old_status) == MONITOR_OWNER_DETACHED))
+		return mono_monitor_try_enter_internal (obj, ms, allow_interruption);
+
 	/* We need to make sure there's a semaphore handle (creating it if
 	 * necessary), and block on it
 	 */
@@ -853,7 +1057,7 @@ retry_contended:
 	if (!interrupted) {
 		old_status = mon->status;
 		for (;;) {
-			if (mon_status_get_owner (old_status) == 0)
+			if (mon_status_get_owner (old_status) == 0 || mon_status_get_owner (old_status) == MONITOR_OWNER_DETACHED)
 				goto retry_contended;
 			new_status = mon_status_increment_entry_count (old_status);
 			tmp_status = InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status);
@@ -991,6 +1195,8 @@ mono_monitor_try_enter_internal (MonoObject *obj, guint32 ms, gboolean allow_int
 				return 1;
 			}
 		} else {
+			if (ms != 0 && mono_monitor_spin_flat (obj, id))
+				return 1;
 			mono_monitor_inflate (obj);
 			return mono_monitor_try_enter_inflated (obj, ms, allow_interruption, id);
 		}
@@ -1318,6 +1524,13 @@ ves_icall_System_Threading_Monitor_Monitor_wait (MonoObject *obj, guint32 ms)
 
 	g_assert (regain == 1);
 
+	/* The GC might have deflated the lock while it was released */
+	lw.sync = obj->synchronisation;
+	if (!lock_word_is_inflated (lw)) {
+		mono_monitor_inflate_owned (obj, id);
+		lw.sync = obj->synchronisation;
+	}
+	mon = lock_word_get_inflated_lock (lw);
 	mon->nest = nest;
 
 	LOCK_DEBUG (g_message ("%s: (%d) Regained %p lock %p", __func__, mono_thread_info_get_small_id (), obj, mon));
@@ -1356,3 +1569,73 @@ ves_icall_System_Threading_Monitor_Monitor_wait (MonoObject *obj, guint32 ms)
 	return success;
 }
 
+
+/*
+ * mono_monitor_deflate:
+ *
+ *   Detach the lock records which are not owned, waited for or waited on from their
+ * objects, storing the hash code back in the lock word if the object has one. This is
+ * called by the GC after major collections, while the world is stopped, so no thread can
+ * change the state of these records at the same time. A thread might still be holding a
+ * pointer to one of them though, having read the lock word just before the world was
+ * stopped: the owner of a detached record is MONITOR_OWNER_DETACHED so it can't be
+ * acquired, and the lock operations check whenever the record they acquired is still
+ * attached, in case the record was already reused. To make that case rare, the records
+ * detached by one pass are only put on the free list by the next one.
+ */
+void
+mono_monitor_deflate (void)
+{
+	MonitorArray *marray;
+	MonoThreadsSync *mon, *next;
+	int i;
+
+	/* A thread stopped by the GC might be holding the allocator lock */
+	if (mono_os_mutex_trylock (&monitor_mutex) != 0)
+		return;
+
+	for (mon = monitor_deflated; mon; mon = next) {
+		next = (MonoThreadsSync *)mon->data;
+		mon->data = monitor_freelist;
+		monitor_freelist = mon;
+	}
+	monitor_deflated = NULL;
+
+	for (marray = monitor_allocated; marray; marray = marray->next) {
+		for (i = 0; i < marray->num_monitors; ++i) {
+			MonoObject *obj;
+			LockWord lw;
+
+			mon = &marray->monitors [i];
+			/* Not owned, nobody waiting to acquire it, and not detached */
+			if (mon->status != ENTRY_COUNT_ZERO || mon->nest != 1 || mon->wait_list)
+				continue;
+			obj = (MonoObject *)mono_gchandle_get_target ((guint32)(gsize)mon->data);
+			if (!obj)
+				continue;
+			lw.sync = obj->synchronisation;
+			if (!lock_word_is_inflated (lw) || lock_word_get_inflated_lock (lw) != mon)
+				continue;
+
+#ifdef HAVE_MOVING_COLLECTOR
+			if (lock_word_has_hash (lw))
+				lw = lock_word_new_thin_hash (mon->hash_code);
+			else
+#endif
+				lw.sync = NULL;
+			obj->synchronisation = lw.sync;
+
+			/* The entry semaphore is kept, it isn't signaled since the entry count is 0 */
+			mono_gchandle_free ((guint32)(gsize)mon->data);
+			mon->status = mon_status_set_owner (mon->status, MONITOR_OWNER_DETACHED);
+			mon->data = monitor_deflated;
+			monitor_deflated = mon;
+			monitor_deflations++;
+#ifndef DISABLE_PERFCOUNTERS
+			mono_perfcounters->gc_sync_blocks--;
+#endif
+		}
+	}
+
+	mono_os_mutex_unlock (&monitor_mutex);
+}
@@ -42,6 +42,8 @@ struct _MonoThreadsSync
 	HANDLE entry_sem;
 	GSList *wait_list;
 	void *data;
+	/* How long to spin before blocking on entry_sem, adapted to the time the lock is usually held */
+	gint32 spin_budget;
 };
 
 /*
@@ -105,6 +107,7 @@ MONO_API void mono_locks_dump (gboolean include_untaken);
 
 void mono_monitor_init (void);
 void mono_monitor_cleanup (void);
+void mono_monitor_deflate (void);
 
 gboolean mono_monitor_enter_fast (MonoObject *obj);
 gboolean mono_monitor_enter_v4_fast (MonoObject *obj, char *lock_taken);
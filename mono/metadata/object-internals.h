@@ -572,6 +572,10 @@ typedef struct {
 	void*    (*compile_method) (MonoMethod *method, MonoError *error);
 	gpointer (*create_jump_trampoline) (MonoDomain *domain, MonoMethod *method, gboolean add_sync_wrapper, MonoError *error);
 	gpointer (*create_jit_trampoline) (MonoDomain *domain, MonoMethod *method, MonoError *error);
+	/* Called after a vtable is created, without holding the loader lock */
+	void     (*vtable_created) (MonoVTable *vtable);
+	/* Called once the runtime is flagged for shutdown, to wake up the JIT's own threads */
+	void     (*runtime_shutting_down) (void);
 } MonoRuntimeCallbacks;
 
 typedef gboolean (*MonoInternalStackWalk) (MonoStackFrameInfo *frame, MonoContext *ctx, gpointer data);
@@ -1409,6 +1413,9 @@ mono_get_constant_value_from_blob (MonoDomain* domain, MonoTypeEnum type, const
 void
 mono_release_type_locks (MonoInternalThread *thread);
 
+gboolean
+mono_runtime_is_running_class_init (void);
+
 char *
 mono_string_to_utf8_mp	(MonoMemPool *mp, MonoString *s, MonoError *error);
 
@@ -1600,6 +1607,9 @@ mono_monitor_is_il_fastpath_wrapper (MonoMethod *method);
 MonoString*
 mono_string_intern_checked (MonoString *str, MonoError *error);
 
+MonoString*
+mono_ldstr_if_interned (MonoDomain *domain, MonoImage *image, guint32 idx);
+
 char *
 mono_exception_get_native_backtrace (MonoException *exc);
 
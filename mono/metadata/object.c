@@ -528,6 +528,34 @@ gboolean release_type_locks (gpointer key, gpointer value, gpointer user)
 	return FALSE;
 }
 
+static gboolean
+is_initializing_thread (gpointer key, gpointer value, gpointer user_data)
+{
+	TypeInitializationLock *lock = (TypeInitializationLock*) value;
+
+	return mono_native_thread_id_equals (lock->initializing_tid, MONO_UINT_TO_NATIVE_THREAD_ID (GPOINTER_TO_UINT (user_data))) && !lock->done;
+}
+
+/*
+ * mono_runtime_is_running_class_init:
+ *
+ *   Return whenever the current thread is running a class constructor. Other threads
+ * initializing the class wait for it, so it must not wait for them in ways the type
+ * initialization deadlock detection can't see.
+ */
+gboolean
+mono_runtime_is_running_class_init (void)
+{
+	MonoNativeThreadId tid = mono_native_thread_id_get ();
+	gboolean res;
+
+	mono_type_initialization_lock ();
+	res = g_hash_table_find (type_initialization_hash, is_initializing_thread, GUINT_TO_POINTER (MONO_NATIVE_THREAD_ID_TO_UINT (tid))) != NULL;
+	mono_type_initialization_unlock ();
+
+	return res;
+}
+
 void
 mono_release_type_locks (MonoInternalThread *thread)
 {
@@ -2278,6 +2306,9 @@ mono_class_create_runtime_vtable (MonoDomain *domain, MonoClass *klass, MonoErro
 	mono_domain_unlock (domain);
 	mono_loader_unlock ();
 
+	if (callbacks.vtable_created)
+		callbacks.vtable_created (vt);
+
 	/* make sure the parent is initialized */
 	/*FIXME shouldn't this fail the current type?*/
 	if (klass->parent)
@@ -6143,6 +6174,39 @@ typedef struct {
 	MonoString *res;
 } LDStrInfo;
 
+/*
+ * ldstr_table_lookup:
+ *
+ *   Return the string equal to STR which is interned in DOMAIN, or NULL. This doesn't
+ * take the ldstr lock, see ldstr_table_insert ().
+ */
+static MonoString*
+ldstr_table_lookup (MonoDomain *domain, MonoString *str)
+{
+	return (MonoString *)mono_conc_hashtable_lookup (domain->ldstr_lookup_table, str);
+}
+
+/*
+ * ldstr_table_insert:
+ *
+ *   Intern STR in DOMAIN if no equal string is interned yet, and return the interned
+ * string. STR needs to be pinned. The strings are kept alive by ldstr_table, while
+ * lookups go through ldstr_lookup_table, which can be read without locking.
+ * LOCKING: Assumes the ldstr lock is held.
+ */
+static MonoString*
+ldstr_table_insert (MonoDomain *domain, MonoString *str)
+{
+	MonoString *res;
+
+	res = ldstr_table_lookup (domain, str);
+	if (res)
+		return res;
+	mono_g_hash_table_insert (domain->ldstr_table, str, str);
+	mono_conc_hashtable_insert (domain->ldstr_lookup_table, str, str);
+	return str;
+}
+
 static void
 str_lookup (MonoDomain *domain, gpointer user_data)
 {
@@ -6151,7 +6215,7 @@ str_lookup (MonoDomain *domain, gpointer user_data)
 	LDStrInfo *info = (LDStrInfo *)user_data;
 	if (info->res || domain == info->orig_domain)
 		return;
-	info->res = (MonoString *)mono_g_hash_table_lookup (domain->ldstr_table, info->ins);
+	info->res = ldstr_table_lookup (domain, info->ins);
 }
 
 static MonoString*
@@ -6182,33 +6246,21 @@ mono_string_is_interned_lookup (MonoString *str, int insert, MonoError *error)
 {
 	MONO_REQ_GC_UNSAFE_MODE;
 
-	MonoGHashTable *ldstr_table;
 	MonoString *s, *res;
 	MonoDomain *domain;
 	
 	mono_error_init (error);
 
 	domain = ((MonoObject *)str)->vtable->domain;
-	ldstr_table = domain->ldstr_table;
-	ldstr_lock ();
-	res = (MonoString *)mono_g_hash_table_lookup (ldstr_table, str);
-	if (res) {
-		ldstr_unlock ();
+	res = ldstr_table_lookup (domain, str);
+	if (res)
 		return res;
-	}
 	if (insert) {
-		/* Allocate outside the lock */
-		ldstr_unlock ();
 		s = mono_string_get_pinned (str, error);
 		return_val_if_nok (error, NULL);
 		if (s) {
 			ldstr_lock ();
-			res = (MonoString *)mono_g_hash_table_lookup (ldstr_table, str);
-			if (res) {
-				ldstr_unlock ();
-				return res;
-			}
-			mono_g_hash_table_insert (ldstr_table, s, s);
+			s = ldstr_table_insert (domain, s);
 			ldstr_unlock ();
 		}
 		return s;
@@ -6224,12 +6276,14 @@ mono_string_is_interned_lookup (MonoString *str, int insert, MonoError *error)
 			 * the string was already interned in some other domain:
 			 * intern it in the current one as well.
 			 */
-			mono_g_hash_table_insert (ldstr_table, str, str);
+			s = mono_string_get_pinned (str, error);
+			return_val_if_nok (error, NULL);
+			ldstr_lock ();
+			s = ldstr_table_insert (domain, s);
 			ldstr_unlock ();
-			return str;
+			return s;
 		}
 	}
-	ldstr_unlock ();
 	return NULL;
 }
 
@@ -6309,28 +6363,25 @@ mono_ldstr (MonoDomain *domain, MonoImage *image, guint32 idx)
 	}
 }
 
-/**
- * mono_ldstr_metadata_sig
- * @domain: the domain for the string
- * @sig: the signature of a metadata string
+/*
+ * ldstr_metadata_sig_new:
  *
- * Returns: a MonoString for a string stored in the metadata
+ *   Return a new, not interned MonoString for the metadata string SIG.
  */
 static MonoString*
-mono_ldstr_metadata_sig (MonoDomain *domain, const char* sig)
+ldstr_metadata_sig_new (MonoDomain *domain, const char* sig, MonoError *error)
 {
 	MONO_REQ_GC_UNSAFE_MODE;
 
-	MonoError error;
 	const char *str = sig;
-	MonoString *o, *interned;
+	MonoString *o;
 	size_t len2;
 
 	len2 = mono_metadata_decode_blob_size (str, &str);
 	len2 >>= 1;
 
-	o = mono_string_new_utf16_checked (domain, (guint16*)str, len2, &error);
-	mono_error_raise_exception (&error); /* FIXME don't raise here */
+	o = mono_string_new_utf16_checked (domain, (guint16*)str, len2, error);
+	return_val_if_nok (error, NULL);
 #if G_BYTE_ORDER != G_LITTLE_ENDIAN
 	{
 		int i;
@@ -6341,9 +6392,28 @@ mono_ldstr_metadata_sig (MonoDomain *domain, const char* sig)
 		}
 	}
 #endif
-	ldstr_lock ();
-	interned = (MonoString *)mono_g_hash_table_lookup (domain->ldstr_table, o);
-	ldstr_unlock ();
+	return o;
+}
+
+/**
+ * mono_ldstr_metadata_sig
+ * @domain: the domain for the string
+ * @sig: the signature of a metadata string
+ *
+ * Returns: a MonoString for a string stored in the metadata
+ */
+static MonoString*
+mono_ldstr_metadata_sig (MonoDomain *domain, const char* sig)
+{
+	MONO_REQ_GC_UNSAFE_MODE;
+
+	MonoError error;
+	MonoString *o, *interned;
+
+	o = ldstr_metadata_sig_new (domain, sig, &error);
+	mono_error_raise_exception (&error); /* FIXME don't raise here */
+
+	interned = ldstr_table_lookup (domain, o);
 	if (interned)
 		return interned; /* o will get garbage collected */
 
@@ -6351,17 +6421,42 @@ mono_ldstr_metadata_sig (MonoDomain *domain, const char* sig)
 	mono_error_raise_exception (&error); /* FIXME don't raise here */
 	if (o) {
 		ldstr_lock ();
-		interned = (MonoString *)mono_g_hash_table_lookup (domain->ldstr_table, o);
-		if (!interned) {
-			mono_g_hash_table_insert (domain->ldstr_table, o, o);
-			interned = o;
-		}
+		interned = ldstr_table_insert (domain, o);
 		ldstr_unlock ();
 	}
 
 	return interned;
 }
 
+/**
+ * mono_ldstr_if_interned:
+ * @domain: the domain where the string will be used.
+ * @image: a metadata context
+ * @idx: index into the user string table.
+ *
+ * Returns: the string which mono_ldstr () returns for @image/@idx if it is already
+ * interned in @domain, NULL otherwise. Unlike mono_ldstr (), this doesn't intern the
+ * string or take a lock.
+ */
+MonoString*
+mono_ldstr_if_interned (MonoDomain *domain, MonoImage *image, guint32 idx)
+{
+	MONO_REQ_GC_UNSAFE_MODE;
+
+	MonoError error;
+	MonoString *o;
+
+	if (image->dynamic || !mono_verifier_verify_string_signature (image, idx, NULL))
+		return NULL;
+
+	o = ldstr_metadata_sig_new (domain, mono_metadata_user_string (image, idx), &error);
+	if (!is_ok (&error)) {
+		mono_error_cleanup (&error);
+		return NULL;
+	}
+	return ldstr_table_lookup (domain, o);
+}
+
 /**
  * mono_string_to_utf8:
  * @s: a System.String
@@ -106,14 +106,14 @@ remoting_unlock (void)
 /*
  * Return the hash table pointed to by VAR, lazily creating it if neccesary.
  */
-static GHashTable*
-get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
+static MonoConcurrentHashTable*
+get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GEqualFunc equal_func)
 {
 	if (!(*var)) {
 		remoting_lock ();
 		if (!(*var)) {
-			GHashTable *cache = 
-				g_hash_table_new (hash_func, equal_func);
+			MonoConcurrentHashTable *cache = 
+				mono_conc_hashtable_new (hash_func, equal_func);
 			mono_memory_barrier ();
 			*var = cache;
 		}
@@ -1362,7 +1362,7 @@ mono_marshal_get_ldfld_wrapper (MonoType *type)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	WrapperInfo *info;
 	char *name;
 	int t, pos0, pos1 = 0;
@@ -1519,7 +1519,7 @@ mono_marshal_get_ldflda_wrapper (MonoType *type)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	WrapperInfo *info;
 	char *name;
 	int t, pos0, pos1, pos2, pos3;
@@ -1723,7 +1723,7 @@ mono_marshal_get_stfld_wrapper (MonoType *type)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	WrapperInfo *info;
 	char *name;
 	int t, pos;
@@ -1848,7 +1848,7 @@ MonoMethod *
 mono_marshal_get_proxy_cancast (MonoClass *klass)
 {
 	static MonoMethodSignature *isint_sig = NULL;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 	WrapperInfo *info;
 	int pos_failed, pos_end;
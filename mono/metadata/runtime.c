@@ -20,6 +20,7 @@
 #include <mono/metadata/threads-types.h>
 #include <mono/metadata/threadpool-ms.h>
 #include <mono/metadata/marshal.h>
+#include <mono/metadata/object-internals.h>
 #include <mono/utils/atomic.h>
 
 static gboolean shutting_down_inited = FALSE;
@@ -107,6 +108,10 @@ mono_runtime_try_shutdown (void)
 
 	mono_runtime_set_shutting_down ();
 
+	/* Threads waiting for work can't be aborted, so they have to be woken up to exit */
+	if (mono_get_runtime_callbacks ()->runtime_shutting_down)
+		mono_get_runtime_callbacks ()->runtime_shutting_down ();
+
 	/* This will kill the tp threads which cannot be suspended */
 	mono_threadpool_ms_cleanup ();
 
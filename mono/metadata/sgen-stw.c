@@ -24,6 +24,7 @@
 #include "sgen/sgen-client.h"
 #include "metadata/sgen-bridge-internals.h"
 #include "metadata/gc-internals.h"
+#include "metadata/monitor.h"
 
 #define TV_DECLARE SGEN_TV_DECLARE
 #define TV_GETTIME SGEN_TV_GETTIME
@@ -249,6 +250,14 @@ sgen_client_restart_world (int generation, GGTimingInfo *timing)
 	if (G_UNLIKELY (mono_profiler_events & MONO_PROFILE_GC_MOVES))
 		mono_sgen_gc_event_moves ();
 
+	/*
+	 * Only after major collections, since the weak links of the lock records are up to
+	 * date, and the pass walks all of them. Following them would wait for bridge
+	 * processing, which needs the world running.
+	 */
+	if (timing && generation == GENERATION_OLD && !sgen_need_bridge_processing ())
+		mono_monitor_deflate ();
+
 	FOREACH_THREAD (info) {
 		info->client_info.stack_start = NULL;
 #ifdef USE_MONO_CTX
@@ -137,6 +137,7 @@ typedef struct MonoAotOptions {
 	char *temp_path;
 	char *instances_logfile_path;
 	char *logfile;
+	char *methods_file;
 	gboolean dump_json;
 } MonoAotOptions;
 
@@ -168,6 +169,8 @@ typedef struct GotInfo {
 typedef struct MonoAotCompile {
 	MonoImage *image;
 	GPtrArray *methods;
+	/* The tokens of the methods to compile if the methods-file option is used */
+	GHashTable *method_filter;
 	GHashTable *method_indexes;
 	GHashTable *method_depth;
 	MonoCompile **cfgs;
@@ -7192,6 +7195,8 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			opts->llvm_only = TRUE;
 		} else if (str_begins_with (arg, "data-outfile=")) {
 			opts->data_outfile = g_strdup (arg + strlen ("data-outfile="));
+		} else if (str_begins_with (arg, "methods-file=")) {
+			opts->methods_file = g_strdup (arg + strlen ("methods-file="));
 		} else if (str_begins_with (arg, "help") || str_begins_with (arg, "?")) {
 			printf ("Supported options for --aot:\n");
 			printf ("    outfile=\n");
@@ -7219,6 +7224,7 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			printf ("    soft-debug\n");
 			printf ("    gen-seq-points-file\n");
 			printf ("    gc-maps\n");
+			printf ("    methods-file=\n");
 			printf ("    print-skipped\n");
 			printf ("    no-instances\n");
 			printf ("    stats\n");
@@ -7493,6 +7499,11 @@ compile_method (MonoAotCompile *acfg, MonoMethod *method)
 	if (acfg->aot_opts.metadata_only)
 		return;
 
+	/* Leave the methods which are not in the methods file to the JIT */
+	if (acfg->method_filter && (method->wrapper_type != MONO_WRAPPER_NONE || method->is_inflated || method->klass->image != acfg->image ||
+								!g_hash_table_lookup (acfg->method_filter, GUINT_TO_POINTER (method->token))))
+		return;
+
 	mono_acfg_lock (acfg);
 	index = get_method_index (acfg, method);
 	mono_acfg_unlock (acfg);
@@ -10100,7 +10111,8 @@ acfg_create (MonoAssembly *ass, guint32 opts)
 	acfg->image = image;
 	acfg->opts = opts;
 	/* TODO: Write out set of SIMD instructions used, rather than just those available */
-	acfg->simd_opts = mono_arch_cpu_enumerate_simd_versions ();
+	/* AOT code never uses the AVX encodings, so it doesn't need a cpu which has them */
+	acfg->simd_opts = mono_arch_cpu_enumerate_simd_versions () & ~(SIMD_VERSION_AVX | SIMD_VERSION_AVX2);
 	acfg->mempool = mono_mempool_new ();
 	acfg->extra_methods = g_ptr_array_new ();
 	acfg->unwind_info_offsets = g_hash_table_new (NULL, NULL);
@@ -10152,6 +10164,8 @@ acfg_free (MonoAotCompile *acfg)
 	g_ptr_array_free (acfg->unwind_ops, TRUE);
 	g_hash_table_destroy (acfg->method_indexes);
 	g_hash_table_destroy (acfg->method_depth);
+	if (acfg->method_filter)
+		g_hash_table_destroy (acfg->method_filter);
 	g_hash_table_destroy (acfg->plt_offset_to_entry);
 	for (i = 0; i < MONO_PATCH_INFO_NUM; ++i) {
 		if (acfg->patch_to_plt_entry [i])
@@ -10394,6 +10408,33 @@ add_preinit_got_slots (MonoAotCompile *acfg)
 	acfg->nshared_got_entries = acfg->got_offset;
 }
 
+/*
+ * load_method_filter:
+ *
+ *   Read the tokens of the methods to compile from FNAME, one per line. Lines starting
+ * with '#' are ignored.
+ */
+static gboolean
+load_method_filter (MonoAotCompile *acfg, const char *fname)
+{
+	char line [64];
+	FILE *f;
+
+	f = fopen (fname, "r");
+	if (!f)
+		return FALSE;
+
+	acfg->method_filter = g_hash_table_new (NULL, NULL);
+	while (fgets (line, sizeof (line), f)) {
+		guint32 token;
+
+		if (line [0] != '#' && sscanf (line, "%x", &token) == 1)
+			g_hash_table_insert (acfg->method_filter, GUINT_TO_POINTER (token), GUINT_TO_POINTER (token));
+	}
+	fclose (f);
+	return TRUE;
+}
+
 int
 mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 {
@@ -10436,6 +10477,13 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 		acfg->flags = (MonoAotFileFlags)(acfg->flags | MONO_AOT_FILE_FLAG_SEPARATE_DATA);
 	}
 
+	if (acfg->aot_opts.methods_file) {
+		if (!load_method_filter (acfg, acfg->aot_opts.methods_file)) {
+			aot_printerrf (acfg, "Unable to read file '%s': %s\n", acfg->aot_opts.methods_file, strerror (errno));
+			return 1;
+		}
+	}
+
 	//acfg->aot_opts.print_skipped_methods = TRUE;
 
 #if !defined(MONO_ARCH_GSHAREDVT_SUPPORTED)
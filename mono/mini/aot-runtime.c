@@ -1999,6 +1999,17 @@ load_aot_module (MonoAssembly *assembly, gpointer user_data)
 
 			}
 		}
+		if (!sofile && mono_jit_cache_enabled) {
+			char *err;
+
+			g_free (aot_name);
+			aot_name = mini_jit_cache_get_image_name (assembly);
+			sofile = mono_dl_open (aot_name, MONO_DL_LAZY, &err);
+			if (!sofile) {
+				mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_AOT, "AOT module '%s' not found: %s\n", aot_name, err);
+				g_free (err);
+			}
+		}
 		if (!sofile) {
 			if (mono_aot_only && assembly->image->tables [MONO_TABLE_METHOD].rows)
 				g_error ("Failed to load AOT module '%s' in aot-only mode.\n", aot_name);
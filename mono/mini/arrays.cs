@@ -806,6 +806,178 @@ class Tests
 			arr [i] = 1;
 		return llvm_ldlen_licm (arr);
 	}
+
+	class LicmHolder {
+		public int[] arr;
+		public int scale;
+
+		public int Sum () {
+			int sum = 0;
+			// this.arr, arr.Length and this.scale should be moved out of the loop
+			for (int i = 0; i < arr.Length; ++i)
+				sum += arr [i] * scale;
+			return sum;
+		}
+
+		public void Fill () {
+			// Element stores don't alias the fields
+			for (int i = 0; i < arr.Length; ++i)
+				arr [i] = scale;
+		}
+
+		public int SumModified () {
+			int sum = 0;
+			// The field is written in the loop, so it can't be moved
+			for (int i = 0; i < arr.Length; ++i) {
+				sum += scale;
+				Bump ();
+			}
+			return sum;
+		}
+
+		void Bump () {
+			scale ++;
+		}
+	}
+
+	public static int test_0_licm_field_loads () {
+		var h = new LicmHolder () { arr = new int [10], scale = 3 };
+		h.Fill ();
+		if (h.arr [9] != 3)
+			return 1;
+		if (h.Sum () != 90)
+			return 2;
+		// 3 + 4 + ... + 12
+		if (h.SumModified () != 75)
+			return 3;
+		if (h.scale != 13)
+			return 4;
+		return 0;
+	}
+
+	static int licm_null_in_loop (LicmHolder h, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i)
+			sum += h.scale;
+		return sum;
+	}
+
+	public static int test_0_licm_null_zero_trip () {
+		// The load is only moved to a place which executes it whenever the loop does
+		if (licm_null_in_loop (null, 0) != 0)
+			return 1;
+		try {
+			licm_null_in_loop (null, 1);
+			return 2;
+		} catch (NullReferenceException) {
+		}
+		return 0;
+	}
+
+	static int strength_reduce (int[] arr, int stride, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; i += 2)
+			sum += arr [i * 3] + arr [i * stride];
+		return sum;
+	}
+
+	public static int test_0_loop_strength_reduction () {
+		int[] arr = new int [64];
+		for (int i = 0; i < arr.Length; ++i)
+			arr [i] = i;
+		// (0 + 6 + 12 + 18) + (0 + 4 + 8 + 12)
+		if (strength_reduce (arr, 2, 8) != 60)
+			return 1;
+		if (strength_reduce (arr, 0, 8) != 36)
+			return 2;
+		return 0;
+	}
+
+	class AbcHolder {
+		public int[] arr;
+
+		public int SumPairs () {
+			int sum = 0;
+			// The field load is moved out of the loop, then the checks are removed
+			for (int i = 0; i < arr.Length - 1; ++i)
+				sum += arr [i] + arr [i + 1];
+			return sum;
+		}
+
+		public int SumChecked (int count) {
+			if (count > arr.Length)
+				throw new ArgumentOutOfRangeException ();
+			int sum = 0;
+			for (int i = 0; i < count; ++i)
+				sum += arr [i];
+			return sum;
+		}
+	}
+
+	public static int test_0_loop_abcrem () {
+		var h = new AbcHolder () { arr = new int [] { 1, 2, 3, 4 } };
+		// 3 + 5 + 7
+		if (h.SumPairs () != 15)
+			return 1;
+		if (h.SumChecked (3) != 6)
+			return 2;
+		try {
+			h.SumChecked (5);
+			return 3;
+		} catch (ArgumentOutOfRangeException) {
+		}
+		h.arr = new int [0];
+		if (h.SumPairs () != 0)
+			return 4;
+		return 0;
+	}
+
+	static int loop_abcrem_from (int[] arr, int start, int n) {
+		int sum = 0;
+		for (int i = start; i < n; ++i)
+			sum += arr [i];
+		return sum;
+	}
+
+	static int loop_abcrem_past_end (int[] arr) {
+		int sum = 0;
+		for (int i = 0; i < arr.Length; ++i)
+			sum += arr [i + 1];
+		return sum;
+	}
+
+	static void loop_abcrem_unsigned (int[] arr, int n) {
+		// The signed check lets a negative n through, which is huge as an unsigned limit
+		if (n > arr.Length)
+			return;
+		for (uint i = 0; i < (uint)n; ++i)
+			arr [i] ++;
+	}
+
+	public static int test_0_loop_abcrem_keeps_checks () {
+		int[] arr = new int [] { 1, 2, 3 };
+		try {
+			loop_abcrem_from (arr, -1, arr.Length);
+			return 1;
+		} catch (IndexOutOfRangeException) {
+		}
+		try {
+			loop_abcrem_from (arr, 0, 4);
+			return 2;
+		} catch (IndexOutOfRangeException) {
+		}
+		try {
+			loop_abcrem_past_end (arr);
+			return 3;
+		} catch (IndexOutOfRangeException) {
+		}
+		try {
+			loop_abcrem_unsigned (arr, -1);
+			return 4;
+		} catch (IndexOutOfRangeException) {
+		}
+		return 0;
+	}
 }
 
 
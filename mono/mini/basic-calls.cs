@@ -342,4 +342,41 @@ class Tests
 	    int res = arm64_stack_arg_reg_sbyte (null, null, null, null, null, null, null, -4, -7);
 		return res == -22 ? 0 : 1;
 	}
+
+	/* Above the default inlining size limit, but below the one of hot call sites with --pgo-inline */
+	static int pgo_hot_callee (int a, int b) {
+		int res = a;
+		if (b > 0)
+			res += b * 3;
+		else
+			res -= b * 5;
+		if (a > b)
+			res ^= a;
+		else
+			res ^= b;
+		return res + (a & 7) + (b | 1);
+	}
+
+	static int pgo_hot_caller (int n) {
+		int res = 0;
+		for (int i = 0; i < n; ++i)
+			res += pgo_hot_callee (i, i & 3);
+		return res;
+	}
+
+	/* The call site in pgo_hot_caller () is hot once it was entered enough times, see pgoinlinecheck */
+	public static int test_0_pgo_hot_call_site () {
+		for (int i = 0; i < 100; ++i) {
+			int expected = 0;
+			for (int j = 0; j < 50; ++j) {
+				int a = j, b = j & 3;
+				int res = a + (b > 0 ? b * 3 : - b * 5);
+				res ^= a > b ? a : b;
+				expected += res + (a & 7) + (b | 1);
+			}
+			if (pgo_hot_caller (50) != expected)
+				return 1;
+		}
+		return 0;
+	}
 }
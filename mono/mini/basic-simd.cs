@@ -3304,6 +3304,94 @@ public class SimdTests {
 		return 0;
 	}
 
+	public static int test_0_vector8f_ops () {
+		var a = new Vector8f (1, 2, 3, 4, 5, 6, 7, 8);
+		var b = new Vector8f (8, 7, 6, 5, 4, 3, 2, 1);
+		var c = a + b;
+		for (int i = 0; i < 8; ++i) {
+			if (c [i] != 9)
+				return 1;
+		}
+		c = (a - b) * b / new Vector8f (2);
+		for (int i = 0; i < 8; ++i) {
+			if (c [i] != (a [i] - b [i]) * b [i] / 2)
+				return 2;
+		}
+		c = a.Max (b);
+		if (c [0] != 8 || c [3] != 5 || c [4] != 5 || c [7] != 8)
+			return 3;
+		c = a.Min (b);
+		if (c [0] != 1 || c [3] != 4 || c [4] != 4 || c [7] != 1)
+			return 4;
+		c = a ^ a;
+		if (c != Vector8f.Zero)
+			return 5;
+		return 0;
+	}
+
+	public static int test_0_vector8i_ops () {
+		var a = new Vector8i (1, -2, 3, -4, 5, -6, 7, -8);
+		var b = new Vector8i (3);
+		var c = a * b - a;
+		for (int i = 0; i < 8; ++i) {
+			if (c [i] != a [i] * 2)
+				return 1;
+		}
+		c = a.CompareGreaterThan (b);
+		for (int i = 0; i < 8; ++i) {
+			if (c [i] != (a [i] > 3 ? -1 : 0))
+				return 2;
+		}
+		c = a.CompareEqual (new Vector8i (1, 2, 3, 4, 5, 6, 7, 8));
+		if (c [0] != -1 || c [1] != 0 || c [6] != -1 || c [7] != 0)
+			return 3;
+		c = a.Max (Vector8i.Zero) | a.Min (Vector8i.Zero);
+		if (c != a)
+			return 4;
+		c = a & new Vector8i (0xff);
+		if (c [1] != 0xfe || c [7] != 0xf8)
+			return 5;
+		return 0;
+	}
+
+	public static int test_0_vector32b_ops () {
+		var a = new Vector32b (200);
+		var b = new Vector32b (100);
+		a [31] = 10;
+		var c = a + b;
+		if (c [0] != 44 || c [16] != 44 || c [31] != 110)
+			return 1;
+		c = a.AddWithSaturation (b);
+		if (c [0] != 255 || c [31] != 110)
+			return 2;
+		c = b.SubtractWithSaturation (a);
+		if (c [0] != 0 || c [31] != 90)
+			return 3;
+		c = a.Average (b);
+		if (c [0] != 150 || c [31] != 55)
+			return 4;
+		c = a.CompareEqual (b.Max (a));
+		if (c [0] != 255 || c [31] != 0)
+			return 5;
+		return 0;
+	}
+
+	struct Vector8iPair {
+		public Vector8i a, b;
+	}
+
+	public static int test_0_vector8i_fields () {
+		var p = new Vector8iPair ();
+		p.a = new Vector8i (1, 2, 3, 4, 5, 6, 7, 8);
+		p.b = p.a + p.a;
+		p.a = p.b - p.a;
+		for (int i = 0; i < 8; ++i) {
+			if (p.a [i] != i + 1 || p.b [i] != 2 * (i + 1))
+				return 1;
+		}
+		return 0;
+	}
+
 	public static int Main (String[] args) {
 		return TestDriver.RunTests (typeof (SimdTests), args);
 	}
@@ -1,5 +1,7 @@
 using System;
 using System.Reflection;
+using System.Runtime.CompilerServices;
+using System.Threading;
 
 /*
  * Regression tests for the mono JIT.
@@ -85,6 +87,45 @@ sealed public class SealedFinal : Middle {
 	}
 }
 
+/* The receivers of the calls through these are predicted with --guarded-devirt */
+public interface IGuarded {
+	int Get (int i);
+}
+
+public class GuardedFirst : IGuarded {
+	public virtual int Get (int i) {
+		return i + 1;
+	}
+}
+
+public class GuardedSecond : IGuarded {
+	public int Get (int i) {
+		return i + 2;
+	}
+}
+
+public class GuardedFirstDerived : GuardedFirst {
+	public override int Get (int i) {
+		return i + 3;
+	}
+}
+
+/* The second implementor is only loaded after the callers reached tier 1 */
+public interface IGuardedLate {
+	int Get ();
+}
+
+public class GuardedLateFirst : IGuardedLate {
+	public int Get () {
+		return 1;
+	}
+}
+
+public class GuardedLateSecond : IGuardedLate {
+	public int Get () {
+		return 2;
+	}
+}
 
 class Tests {
 
@@ -152,6 +193,85 @@ class Tests {
 		return 0;
 	}
 
+	static int call_guarded (IGuarded g, int i) {
+		return g.Get (i);
+	}
+
+	static int call_guarded_virtual (GuardedFirst g, int i) {
+		return g.Get (i);
+	}
+
+	static public int test_0_guarded_devirt () {
+		if (call_guarded (new GuardedFirst (), 1) != 2)
+			return 1;
+		if (call_guarded_virtual (new GuardedFirst (), 1) != 2)
+			return 2;
+		/* Classes loaded after the callers were compiled take the fallback path */
+		if (call_guarded (new GuardedSecond (), 1) != 3)
+			return 3;
+		if (call_guarded (new GuardedFirstDerived (), 1) != 4)
+			return 4;
+		if (call_guarded_virtual (new GuardedFirstDerived (), 1) != 4)
+			return 5;
+		if (call_guarded (new GuardedFirst (), 1) != 2)
+			return 6;
+		return 0;
+	}
+
+	static int call_guarded_late (IGuardedLate g) {
+		return g.Get ();
+	}
+
+	/* Not inlined, so the vtable of GuardedLateSecond is only created when this is called */
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static IGuardedLate create_guarded_late_second () {
+		return new GuardedLateSecond ();
+	}
+
+	static public int test_0_guarded_devirt_new_implementor () {
+		IGuardedLate first = new GuardedLateFirst ();
+
+		/* Give the tiered compiler thread the time to compile the caller at tier 1 */
+		for (int i = 0; i < 20; ++i) {
+			for (int j = 0; j < 1000; ++j) {
+				if (call_guarded_late (first) != 1)
+					return 1;
+			}
+			Thread.Sleep (5);
+		}
+
+		/* The predicted implementor is no longer the only one */
+		IGuardedLate second = create_guarded_late_second ();
+		if (call_guarded_late (second) != 2)
+			return 2;
+
+		/* Both are still called correctly once the caller was recompiled */
+		for (int i = 0; i < 20; ++i) {
+			for (int j = 0; j < 1000; ++j) {
+				if (call_guarded_late (first) != 1)
+					return 3;
+				if (call_guarded_late (second) != 2)
+					return 4;
+			}
+			Thread.Sleep (5);
+		}
+		return 0;
+	}
+
+	static public int test_0_guarded_devirt_npe () {
+		try {
+			call_guarded (null, 1);
+			return 1;
+		} catch (NullReferenceException) {
+		}
+		try {
+			call_guarded_virtual (null, 1);
+			return 2;
+		} catch (NullReferenceException) {
+		}
+		return 0;
+	}
+
 	static public int test_0_npe_still_happens() {
 		OpenFinal x = null;
 		SealedFinal y = null;
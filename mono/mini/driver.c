@@ -217,6 +217,34 @@ parse_optimizations (guint32 opt, const char* p, gboolean cpu_opts)
 	return opt;
 }
 
+static int
+parse_tiered_threshold (const char *p)
+{
+	char *end;
+	long calls;
+
+	calls = strtol (p, &end, 10);
+	if (end == p || *end || calls <= 0 || calls > G_MAXINT32) {
+		fprintf (stderr, "Invalid number of calls for --tiered `%s'\n", p);
+		exit (1);
+	}
+	return (int)calls;
+}
+
+static int
+parse_compile_ahead_threads (const char *p)
+{
+	char *end;
+	long threads;
+
+	threads = strtol (p, &end, 10);
+	if (end == p || *end || threads < 0 || threads > 64) {
+		fprintf (stderr, "Invalid number of threads for --compile-ahead `%s'\n", p);
+		exit (1);
+	}
+	return (int)threads;
+}
+
 static gboolean
 parse_debug_options (const char* p)
 {
@@ -340,6 +368,10 @@ opt_sets [] = {
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_ABCREM,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_ABCREM,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_ABCREM | MONO_OPT_SHARED,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_LICM,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_ABCREM | MONO_OPT_LICM,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_ESCAPE,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_GCOLOR,
        DEFAULT_OPTIMIZATIONS, 
 };
 
@@ -1243,6 +1275,19 @@ mini_usage (void)
 		"    --attach=OPTIONS       Pass OPTIONS to the attach agent in the runtime.\n"
 		"                           Currently the only supported option is 'disable'.\n"
 		"    --llvm, --nollvm       Controls whenever the runtime uses LLVM to compile code.\n"
+		"    --tiered[=CALLS]       Compile methods quickly first, and recompile them with all\n"
+		"                           optimizations after CALLS calls (default 30)\n"
+		"    --compile-ahead[=THREADS]\n"
+		"                           Compile the methods called by JITted code on THREADS\n"
+		"                           background threads (default 1) before they are called\n"
+		"    --pgo-inline[=FILE]    Use call site counts to decide which calls to inline. The\n"
+		"                           counts are collected by the --tiered tier 0 code, and\n"
+		"                           read from and written to FILE if given\n"
+		"    --jit-cache[=DIR]      Compile the methods JITted by this process into AOT images\n"
+		"                           in DIR (default ~/.cache/mono/jit-cache) in a background\n"
+		"                           process at shutdown, and use them in later runs\n"
+		"    --guarded-devirt       Devirtualize calls whose receiver has only one loaded\n"
+		"                           class, with a class check and a virtual call fallback\n"
 	        "    --gc=[sgen,boehm]      Select SGen or Boehm GC (runs mono or mono-sgen)\n"
 #ifdef TARGET_OSX
 		"    --arch=[32,64]         Select architecture (runs mono32 or mono64)\n"
@@ -1442,6 +1487,27 @@ mono_jit_parse_options (int argc, char * argv[])
 #else
 			mono_use_llvm = TRUE;
 #endif
+		} else if (strcmp (argv [i], "--tiered") == 0) {
+			mono_tiered_compilation = TRUE;
+		} else if (strncmp (argv [i], "--tiered=", 9) == 0) {
+			mono_tiered_compilation = TRUE;
+			mono_tiered_threshold = parse_tiered_threshold (argv [i] + 9);
+		} else if (strcmp (argv [i], "--compile-ahead") == 0) {
+			mono_compile_ahead_threads = 1;
+		} else if (strncmp (argv [i], "--compile-ahead=", 16) == 0) {
+			mono_compile_ahead_threads = parse_compile_ahead_threads (argv [i] + 16);
+		} else if (strcmp (argv [i], "--pgo-inline") == 0) {
+			mono_pgo_inlining = TRUE;
+		} else if (strncmp (argv [i], "--pgo-inline=", 13) == 0) {
+			mono_pgo_inlining = TRUE;
+			mono_pgo_file = g_strdup (argv [i] + 13);
+		} else if (strcmp (argv [i], "--jit-cache") == 0) {
+			mono_jit_cache_enabled = TRUE;
+		} else if (strncmp (argv [i], "--jit-cache=", 12) == 0) {
+			mono_jit_cache_enabled = TRUE;
+			mono_jit_cache_dir = g_strdup (argv [i] + 12);
+		} else if (strcmp (argv [i], "--guarded-devirt") == 0) {
+			mono_guarded_devirt = TRUE;
 		} else if (argv [i][0] == '-' && argv [i][1] == '-' && mini_parse_debug_option (argv [i] + 2)) {
 		} else {
 			fprintf (stderr, "Unsupported command line option: '%s'\n", argv [i]);
@@ -1905,6 +1971,27 @@ mono_main (int argc, char* argv[])
 #endif
 		} else if (strcmp (argv [i], "--nollvm") == 0){
 			mono_use_llvm = FALSE;
+		} else if (strcmp (argv [i], "--tiered") == 0) {
+			mono_tiered_compilation = TRUE;
+		} else if (strncmp (argv [i], "--tiered=", 9) == 0) {
+			mono_tiered_compilation = TRUE;
+			mono_tiered_threshold = parse_tiered_threshold (argv [i] + 9);
+		} else if (strcmp (argv [i], "--compile-ahead") == 0) {
+			mono_compile_ahead_threads = 1;
+		} else if (strncmp (argv [i], "--compile-ahead=", 16) == 0) {
+			mono_compile_ahead_threads = parse_compile_ahead_threads (argv [i] + 16);
+		} else if (strcmp (argv [i], "--pgo-inline") == 0) {
+			mono_pgo_inlining = TRUE;
+		} else if (strncmp (argv [i], "--pgo-inline=", 13) == 0) {
+			mono_pgo_inlining = TRUE;
+			mono_pgo_file = g_strdup (argv [i] + 13);
+		} else if (strcmp (argv [i], "--jit-cache") == 0) {
+			mono_jit_cache_enabled = TRUE;
+		} else if (strncmp (argv [i], "--jit-cache=", 12) == 0) {
+			mono_jit_cache_enabled = TRUE;
+			mono_jit_cache_dir = g_strdup (argv [i] + 12);
+		} else if (strcmp (argv [i], "--guarded-devirt") == 0) {
+			mono_guarded_devirt = TRUE;
 #ifdef __native_client_codegen__
 		} else if (strcmp (argv [i], "--nacl-align-mask-off") == 0){
 			nacl_align_byte = -1; /* 0xff */
@@ -1961,6 +2048,10 @@ mono_main (int argc, char* argv[])
 	}
 #endif
 
+	/* The AOT compilations started by the JIT cache must not record the methods they compile */
+	if (mono_compile_aot)
+		mono_jit_cache_enabled = FALSE;
+
 	if (g_getenv ("MONO_XDEBUG"))
 		enable_debugging = TRUE;
 
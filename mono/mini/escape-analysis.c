@@ -0,0 +1,576 @@
+/*
+ * escape-analysis.c: Escape analysis and scalar replacement of allocations
+ *
+ * This pass runs on the SSA form, see mini_method_compile (), over the allocations recorded
+ * by handle_alloc () in method-to-ir.c. An object doesn't escape if the only uses of its
+ * address, and of the copies and interior pointers derived from it, are loads and stores of
+ * its fields, null checks and write barriers. Such an object is replaced by one vreg per
+ * field: stores become moves to the vreg, loads become moves from it, and the allocation
+ * call is removed. This also removes box/unbox pairs, since unboxing a value boxed in the
+ * same method is a load from the box.
+ *
+ * Since every vreg has only one definition in SSA form, every use of the address is
+ * dominated by the allocation, and refers to the object created by its last execution, so
+ * the field vregs are zero initialized at the allocation. Addresses flowing into a PHI, a
+ * call argument, the return value or a variable which isn't in SSA form are considered to
+ * escape.
+ *
+ * Copyright 2016 Xamarin, Inc (http://www.xamarin.com)
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include <config.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#include <mono/metadata/abi-details.h>
+
+#ifndef DISABLE_JIT
+
+/* Objects with more fields are not worth keeping in registers */
+#define MAX_FIELDS 16
+
+typedef struct {
+	int offset, size;
+	gboolean is_float, is_ref, is_loaded;
+	int vreg;
+} FieldInfo;
+
+typedef struct {
+	MonoInst *ins;
+	/* The offset of the field accessed by INS */
+	int offset;
+} FieldAccess;
+
+typedef struct {
+	MonoCompile *cfg;
+	int num_vregs;
+	/* The number of definitions of each vreg in the method */
+	int *def_count;
+	MonoInst **def_ins;
+	MonoBasicBlock **def_bb;
+	/* The instructions using each vreg */
+	GSList **uses;
+	/* Vregs which are used in ways not visible through the sregs of instructions */
+	gboolean *hidden_use;
+	/* The index + 1 of the allocation a vreg points into, and the offset it points to */
+	int *member_site;
+	int *member_offset;
+} EscapeData;
+
+typedef struct {
+	MonoAllocSite *site;
+	int index;
+	/* The instructions which become nops */
+	GSList *removed;
+	GSList *accesses;
+	FieldInfo fields [MAX_FIELDS];
+	int nfields;
+} EscapeSite;
+
+static const double r8_0 = 0.0;
+
+static void
+add_use (EscapeData *data, int vreg, MonoInst *ins)
+{
+	if (vreg != -1 && vreg < data->num_vregs)
+		data->uses [vreg] = g_slist_prepend_mempool (data->cfg->mempool, data->uses [vreg], ins);
+}
+
+static void
+collect_defs_and_uses (EscapeData *data)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	GSList *l;
+	int i;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			const char *spec = INS_INFO (ins->opcode);
+			int sregs [MONO_MAX_SRC_REGS];
+			int num_sregs;
+
+			if (ins->opcode == OP_NOP)
+				continue;
+
+			num_sregs = mono_inst_get_src_registers (ins, sregs);
+			for (i = 0; i < num_sregs; ++i)
+				add_use (data, sregs [i], ins);
+
+			if (spec [MONO_INST_DEST] == ' ') {
+			} else if (MONO_IS_STORE_MEMBASE (ins) || spec [MONO_INST_DEST] == 'b') {
+				/* The destination is the base address */
+				add_use (data, ins->dreg, ins);
+			} else if (ins->dreg != -1 && ins->dreg < data->num_vregs) {
+				data->def_count [ins->dreg] ++;
+				data->def_ins [ins->dreg] = ins;
+				data->def_bb [ins->dreg] = bb;
+			}
+
+			if (MONO_IS_PHI (ins)) {
+				for (i = 0; i < ins->inst_phi_args [0]; ++i) {
+					int vreg = ins->inst_phi_args [i + 1];
+
+					if (vreg < data->num_vregs)
+						data->hidden_use [vreg] = TRUE;
+				}
+			}
+
+			if (MONO_IS_CALL (ins)) {
+				MonoCallInst *call = (MonoCallInst*)ins;
+
+				/* The arguments are passed in hard registers, the entries encode (hreg << 24) + vreg */
+				for (l = call->out_ireg_args; l; l = l->next) {
+					int vreg = ((gssize)l->data) & 0xffffff;
+
+					if (vreg < data->num_vregs)
+						data->hidden_use [vreg] = TRUE;
+				}
+				for (l = call->out_freg_args; l; l = l->next) {
+					int vreg = ((gssize)l->data) & 0xffffff;
+
+					if (vreg < data->num_vregs)
+						data->hidden_use [vreg] = TRUE;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * var_escapes:
+ *
+ *   Return whenever storing an object address into VREG might make it visible outside the
+ * method, or to code which doesn't go through the SSA vregs.
+ */
+static gboolean
+var_escapes (MonoCompile *cfg, int vreg)
+{
+	MonoInst *var = get_vreg_to_inst (cfg, vreg);
+	MonoMethodVar *info;
+
+	if (!var)
+		return FALSE;
+	if (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT))
+		return TRUE;
+	/* Renamed variables point to the original */
+	info = MONO_VARINFO (cfg, var->inst_c0);
+	if (info->reg != -1)
+		var = cfg->varinfo [info->reg];
+	return var->opcode == OP_ARG || var == cfg->ret || var == cfg->vret_addr;
+}
+
+static gboolean
+get_access_info (MonoInst *ins, int *size, gboolean *is_float, gboolean *is_store)
+{
+	*is_float = FALSE;
+	*is_store = MONO_IS_STORE_MEMBASE (ins);
+
+	switch (ins->opcode) {
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_STOREI1_MEMBASE_REG:
+	case OP_STOREI1_MEMBASE_IMM:
+		*size = 1;
+		return TRUE;
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_STOREI2_MEMBASE_REG:
+	case OP_STOREI2_MEMBASE_IMM:
+		*size = 2;
+		return TRUE;
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_STOREI4_MEMBASE_REG:
+	case OP_STOREI4_MEMBASE_IMM:
+		*size = 4;
+		return TRUE;
+	case OP_LOAD_MEMBASE:
+	case OP_STORE_MEMBASE_REG:
+	case OP_STORE_MEMBASE_IMM:
+		*size = SIZEOF_VOID_P;
+		return TRUE;
+#if SIZEOF_REGISTER == 8
+	case OP_LOADI8_MEMBASE:
+	case OP_STOREI8_MEMBASE_REG:
+	case OP_STOREI8_MEMBASE_IMM:
+		*size = 8;
+		return TRUE;
+#endif
+	case OP_LOADR8_MEMBASE:
+	case OP_STORER8_MEMBASE_REG:
+		*size = 8;
+		*is_float = TRUE;
+		return TRUE;
+	default:
+		/* Float32 fields would need conversions, valuetype fields are not split */
+		return FALSE;
+	}
+}
+
+static FieldInfo*
+get_field (EscapeSite *esite, int offset, int size, gboolean is_float)
+{
+	FieldInfo *field;
+	int i;
+
+	for (i = 0; i < esite->nfields; ++i) {
+		field = &esite->fields [i];
+
+		if (field->offset == offset)
+			return (field->size == size && field->is_float == is_float) ? field : NULL;
+		/* Overlapping accesses */
+		if (offset < field->offset + field->size && field->offset < offset + size)
+			return NULL;
+	}
+	if (esite->nfields == MAX_FIELDS)
+		return NULL;
+
+	field = &esite->fields [esite->nfields ++];
+	field->offset = offset;
+	field->size = size;
+	field->is_float = is_float;
+	return field;
+}
+
+/*
+ * add_access:
+ *
+ *   Record the load or store INS at OFFSET in the object of ESITE. Return FALSE if it can't
+ * be replaced by a move.
+ */
+static gboolean
+add_access (EscapeData *data, EscapeSite *esite, MonoInst *ins, int offset)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoClass *klass = esite->site->klass;
+	FieldAccess *access;
+	FieldInfo *field;
+	gboolean is_float, is_store;
+	int size;
+
+	if (!get_access_info (ins, &size, &is_float, &is_store))
+		return FALSE;
+
+	if (offset == MONO_STRUCT_OFFSET (MonoObject, vtable) && ins->opcode == OP_LOAD_MEMBASE) {
+		/* Loaded by type checks, the vtable is only a constant when JITting */
+		if (cfg->compile_aot || !esite->site->vtable)
+			return FALSE;
+	} else {
+		if (offset < (int)sizeof (MonoObject) || offset + size > mono_class_instance_size (klass))
+			return FALSE;
+		field = get_field (esite, offset, size, is_float);
+		if (!field)
+			return FALSE;
+		if (is_store) {
+			if (ins->opcode != OP_STORE_MEMBASE_IMM && vreg_is_ref (cfg, ins->sreg1))
+				field->is_ref = TRUE;
+		} else {
+			field->is_loaded = TRUE;
+			if (vreg_is_ref (cfg, ins->dreg))
+				field->is_ref = TRUE;
+		}
+	}
+
+	access = (FieldAccess *)mono_mempool_alloc0 (cfg->mempool, sizeof (FieldAccess));
+	access->ins = ins;
+	access->offset = offset;
+	esite->accesses = g_slist_prepend_mempool (cfg->mempool, esite->accesses, access);
+	return TRUE;
+}
+
+static gboolean
+add_member (EscapeData *data, EscapeSite *esite, GSList **worklist, int vreg, int offset)
+{
+	if (vreg < 0 || vreg >= data->num_vregs || data->member_site [vreg])
+		return FALSE;
+	if (data->def_count [vreg] != 1 || data->hidden_use [vreg] || var_escapes (data->cfg, vreg))
+		return FALSE;
+	if (offset < 0 || offset > mono_class_instance_size (esite->site->klass))
+		return FALSE;
+
+	data->member_site [vreg] = esite->index + 1;
+	data->member_offset [vreg] = offset;
+	*worklist = g_slist_prepend_mempool (data->cfg->mempool, *worklist, GINT_TO_POINTER (vreg));
+	return TRUE;
+}
+
+/*
+ * analyze_site:
+ *
+ *   Return whenever the object allocated by ESITE doesn't escape, collecting the
+ * instructions which need to be changed.
+ */
+static gboolean
+analyze_site (EscapeData *data, EscapeSite *esite)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoCallInst *call = (MonoCallInst*)esite->site->ins;
+	GSList *worklist = NULL, *l;
+	int alloc_vreg = call->inst.dreg;
+
+	if (alloc_vreg < 0 || alloc_vreg >= data->num_vregs || data->def_ins [alloc_vreg] != &call->inst)
+		return FALSE;
+	/* Only arguments passed in registers are set up by instructions without side effects */
+	if (call->stack_usage || call->outarg_vts)
+		return FALSE;
+
+	if (!add_member (data, esite, &worklist, alloc_vreg, 0))
+		return FALSE;
+
+	while (worklist) {
+		int vreg = GPOINTER_TO_INT (worklist->data);
+		int offset = data->member_offset [vreg];
+
+		worklist = worklist->next;
+
+		for (l = data->uses [vreg]; l; l = l->next) {
+			MonoInst *ins = (MonoInst *)l->data;
+
+			switch (ins->opcode) {
+			case OP_MOVE:
+				if (!add_member (data, esite, &worklist, ins->dreg, offset))
+					return FALSE;
+				esite->removed = g_slist_prepend_mempool (cfg->mempool, esite->removed, ins);
+				break;
+			case OP_ADD_IMM:
+#if SIZEOF_REGISTER == 8
+			case OP_LADD_IMM:
+#endif
+				/* Interior pointers computed by write barriers and unbox */
+				if (!add_member (data, esite, &worklist, ins->dreg, offset + ins->inst_imm))
+					return FALSE;
+				esite->removed = g_slist_prepend_mempool (cfg->mempool, esite->removed, ins);
+				break;
+			case OP_NOT_NULL:
+			case OP_CHECK_THIS:
+				esite->removed = g_slist_prepend_mempool (cfg->mempool, esite->removed, ins);
+				break;
+			case OP_CARD_TABLE_WBARRIER:
+				/* Storing the address into another field of the object is a store through a member */
+				if (ins->sreg1 != vreg || ins->sreg2 == vreg)
+					return FALSE;
+				esite->removed = g_slist_prepend_mempool (cfg->mempool, esite->removed, ins);
+				break;
+			default:
+				if (MONO_IS_LOAD_MEMBASE (ins)) {
+					if (!add_access (data, esite, ins, offset + ins->inst_offset))
+						return FALSE;
+				} else if (MONO_IS_STORE_MEMBASE (ins)) {
+					/* Storing the address itself makes it escape */
+					if (ins->dreg != vreg || ins->sreg1 == vreg)
+						return FALSE;
+					if (!add_access (data, esite, ins, offset + ins->inst_offset))
+						return FALSE;
+				} else {
+					return FALSE;
+				}
+				break;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+replace_load (MonoCompile *cfg, EscapeSite *esite, MonoInst *ins, FieldInfo *field)
+{
+	if (!field) {
+		/* A load of the vtable */
+		ins->opcode = OP_PCONST;
+		ins->sreg1 = -1;
+		ins->inst_p0 = esite->site->vtable;
+		ins->flags &= ~MONO_INST_FAULT;
+		return;
+	}
+
+	switch (ins->opcode) {
+	case OP_LOADI1_MEMBASE:
+		ins->opcode = OP_ICONV_TO_I1;
+		break;
+	case OP_LOADU1_MEMBASE:
+		ins->opcode = OP_ICONV_TO_U1;
+		break;
+	case OP_LOADI2_MEMBASE:
+		ins->opcode = OP_ICONV_TO_I2;
+		break;
+	case OP_LOADU2_MEMBASE:
+		ins->opcode = OP_ICONV_TO_U2;
+		break;
+#if SIZEOF_REGISTER == 8
+	case OP_LOADI4_MEMBASE:
+		ins->opcode = OP_SEXT_I4;
+		break;
+	case OP_LOADU4_MEMBASE:
+		ins->opcode = OP_ZEXT_I4;
+		break;
+#endif
+	case OP_LOADR8_MEMBASE:
+		ins->opcode = OP_FMOVE;
+		break;
+	default:
+		ins->opcode = OP_MOVE;
+		break;
+	}
+	ins->sreg1 = field->vreg;
+	ins->flags &= ~MONO_INST_FAULT;
+}
+
+static void
+replace_store (MonoCompile *cfg, MonoInst *ins, FieldInfo *field)
+{
+	gssize imm;
+
+	switch (ins->opcode) {
+	case OP_STORER8_MEMBASE_REG:
+		ins->opcode = OP_FMOVE;
+		break;
+	case OP_STOREI1_MEMBASE_IMM:
+	case OP_STOREI2_MEMBASE_IMM:
+	case OP_STOREI4_MEMBASE_IMM:
+	case OP_STOREI8_MEMBASE_IMM:
+	case OP_STORE_MEMBASE_IMM:
+		/* Narrow fields are truncated by the loads */
+		imm = ins->inst_imm;
+		ins->sreg1 = -1;
+		if (field->size == 8) {
+			ins->opcode = OP_I8CONST;
+			ins->inst_l = imm;
+		} else {
+			ins->opcode = OP_ICONST;
+			ins->inst_c0 = imm;
+		}
+		break;
+	default:
+		ins->opcode = OP_MOVE;
+		break;
+	}
+	ins->dreg = field->vreg;
+	ins->flags &= ~MONO_INST_FAULT;
+}
+
+static void
+scalar_replace (EscapeData *data, EscapeSite *esite)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoInst *call = esite->site->ins;
+	MonoBasicBlock *bb = data->def_bb [call->dreg];
+	GSList *l;
+	int i;
+
+	for (i = 0; i < esite->nfields; ++i) {
+		FieldInfo *field = &esite->fields [i];
+		MonoInst *ins;
+
+		if (field->is_float)
+			field->vreg = mono_alloc_freg (cfg);
+		else if (field->is_ref)
+			field->vreg = mono_alloc_ireg_ref (cfg);
+		else if (field->size == 8)
+			field->vreg = mono_alloc_lreg (cfg);
+		else
+			field->vreg = mono_alloc_ireg (cfg);
+
+		if (!field->is_loaded)
+			continue;
+
+		/* New objects are zero filled */
+		if (field->is_float) {
+			MONO_INST_NEW (cfg, ins, OP_R8CONST);
+			ins->inst_p0 = (gpointer)&r8_0;
+		} else if (field->size == 8) {
+			MONO_INST_NEW (cfg, ins, OP_I8CONST);
+			ins->inst_l = 0;
+		} else {
+			MONO_INST_NEW (cfg, ins, OP_ICONST);
+			ins->inst_c0 = 0;
+		}
+		ins->dreg = field->vreg;
+		mono_bblock_insert_after_ins (bb, call, ins);
+	}
+
+	for (l = esite->accesses; l; l = l->next) {
+		FieldAccess *access = (FieldAccess *)l->data;
+		FieldInfo *field = NULL;
+
+		for (i = 0; i < esite->nfields; ++i) {
+			if (esite->fields [i].offset == access->offset)
+				field = &esite->fields [i];
+		}
+
+		if (MONO_IS_STORE_MEMBASE (access->ins))
+			replace_store (cfg, access->ins, field);
+		else
+			replace_load (cfg, esite, access->ins, field);
+	}
+
+	for (l = esite->removed; l; l = l->next) {
+		MonoInst *ins = (MonoInst *)l->data;
+
+		NULLIFY_INS (ins);
+	}
+	/* The argument setup is removed as dead code */
+	NULLIFY_INS (call);
+
+	if (cfg->verbose_level > 1)
+		printf ("escape: scalar replaced allocation of %s (%d fields) in %s\n", mono_type_full_name (&esite->site->klass->byval_arg), esite->nfields, mono_method_full_name (cfg->method, TRUE));
+	mono_jit_stats.allocations_scalar_replaced ++;
+}
+
+/*
+ * mono_escape_analysis:
+ *
+ *   Replace the objects allocated by CFG which don't escape the method by their fields.
+ * The IR needs to be in SSA form. The new vregs are used in multiple bblocks and have
+ * multiple definitions, so the IR is not in SSA form afterwards, and needs to be
+ * processed by mono_handle_global_vregs ().
+ *
+ * For example, in
+ *
+ *   var p = new Point (x, y);
+ *   return p.X + p.Y;
+ *
+ * the inlined constructor stores to the fields of p, and the loads of p.X and p.Y become
+ * moves of x and y, which copy propagation removes.
+ */
+void
+mono_escape_analysis (MonoCompile *cfg)
+{
+	EscapeData data;
+	GSList *l;
+	int index;
+
+	if (!cfg->alloc_sites || !(cfg->comp_done & MONO_COMP_SSA))
+		return;
+
+	memset (&data, 0, sizeof (data));
+	data.cfg = cfg;
+	data.num_vregs = cfg->next_vreg;
+	data.def_count = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * data.num_vregs);
+	data.def_ins = (MonoInst **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * data.num_vregs);
+	data.def_bb = (MonoBasicBlock **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * data.num_vregs);
+	data.uses = (GSList **)mono_mempool_alloc0 (cfg->mempool, sizeof (GSList*) * data.num_vregs);
+	data.hidden_use = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * data.num_vregs);
+	data.member_site = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * data.num_vregs);
+	data.member_offset = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * data.num_vregs);
+
+	collect_defs_and_uses (&data);
+
+	index = 0;
+	for (l = cfg->alloc_sites; l; l = l->next) {
+		EscapeSite *esite = (EscapeSite *)mono_mempool_alloc0 (cfg->mempool, sizeof (EscapeSite));
+
+		esite->site = (MonoAllocSite *)l->data;
+		esite->index = index ++;
+
+		/* The instructions are only changed once all of their uses were checked */
+		if (analyze_site (&data, esite))
+			scalar_replace (&data, esite);
+	}
+}
+
+#endif /* DISABLE_JIT */
@@ -1135,6 +1135,61 @@ class Tests
 		}
 	}
 
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static bool is_covariant_object (object o) {
+		return o is ICovariant<object>;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static ICovariant<object> cast_covariant_object (object o) {
+		return (ICovariant<object>)o;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static ICovariant<object> cast_covariant_object2 (object o) {
+		return (ICovariant<object>)o;
+	}
+
+	public static int test_0_variant_cast_cache_polymorphic () {
+		// More types than the call site caches have entries
+		object[] pos = new object [] { new Sample<string> (), new Sample<IMyInterface> (), new Sample<object> (), new Sample<Tests> (), new Sample<Exception> (), new Sample<Type> () };
+		object[] neg = new object [] { new Sample<int> (), new Sample<double> (), new object (), "A" };
+
+		// The second round is answered from the caches
+		for (int i = 0; i < 2; ++i) {
+			foreach (object o in pos) {
+				if (!is_covariant_object (o))
+					return 1;
+				if (cast_covariant_object (o) != o)
+					return 2;
+			}
+			foreach (object o in neg) {
+				if (is_covariant_object (o))
+					return 3;
+				try {
+					cast_covariant_object (o);
+					return 4;
+				} catch (InvalidCastException) {
+				}
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_variant_castclass_cached_negative () {
+		object o = new Sample<int> ();
+
+		// The first cast caches a negative entry, the second one has to throw too
+		for (int i = 0; i < 2; ++i) {
+			try {
+				cast_covariant_object2 (o);
+				return 1;
+			} catch (InvalidCastException) {
+			}
+		}
+		return 0;
+	}
+
 	struct FooStruct2 {
 		public int a1, a2, a3;
 	}
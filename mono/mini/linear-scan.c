@@ -13,6 +13,7 @@
 #ifndef DISABLE_JIT
 
 static void mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask);
+static void assign_regs (MonoCompile *cfg, GList *vars, GList *regs, gint32 *gains, int n_regs, regmask_t *used_mask);
 
 GList *
 mono_varlist_insert_sorted (MonoCompile *cfg, GList *list, MonoMethodVar *mv, int sort_type)
@@ -284,8 +285,7 @@ mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_m
 	MonoMethodVar *vmv;
 	gint32 free_pos [sizeof (regmask_t) * 8];
 	gint32 gains [sizeof (regmask_t) * 8];
-	regmask_t used_regs = 0;
-	int n_regs, n_regvars, i;
+	int n_regs, i;
 
 	for (l = vars; l; l = l->next) {
 		vmv = (MonoMethodVar *)l->data;
@@ -457,6 +457,27 @@ mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_m
 		}
 	}
 
+	assign_regs (cfg, vars, regs, gains, n_regs, used_mask);
+
+	g_list_free (active);
+	g_list_free (inactive);
+}
+
+/*
+ * assign_regs:
+ *
+ *   Turn the vars in VARS which were allocated to a register into OP_REGVAR, if that is
+ * profitable. During allocation, vmv->reg is an index into REGS, and GAINS contains
+ * the total spill costs of the vars allocated to each register.
+ */
+static void
+assign_regs (MonoCompile *cfg, GList *vars, GList *regs, gint32 *gains, int n_regs, regmask_t *used_mask)
+{
+	GList *l;
+	MonoMethodVar *vmv;
+	regmask_t used_regs = 0;
+	int n_regvars, i;
+
 	/* Decrease the gains by the cost of saving+restoring the register */
 	for (i = 0; i < n_regs; ++i) {
 		if (gains [i]) {
@@ -505,9 +526,193 @@ mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_m
 	}
 
 	*used_mask |= used_regs;
+}
 
-	g_list_free (active);
-	g_list_free (inactive);
+/*
+ * Graph coloring global register allocation, used instead of linear scan with
+ * MONO_OPT_GCOLOR. This is a Chaitin-Briggs style allocator: vars whose live intervals
+ * intersect interfere, vars with fewer neighbors than there are registers are removed
+ * from the graph one by one, and when there are none, the var with the lowest spill cost
+ * relative to its degree is removed optimistically. Registers are then assigned in the
+ * reverse order. Unlike linear scan, this doesn't give up on a var just because a more
+ * expensive one is live at its start, and it takes the holes in the intervals into account.
+ *
+ * Vars which are copied to each other prefer the same register, so the peephole pass can
+ * remove the copy. This is biased coloring, a form of coalescing which never makes the
+ * graph harder to color.
+ */
+
+/* Building the graph is quadratic, larger methods are allocated using linear scan */
+#define GCOLOR_MAX_VARS 1024
+
+#if 0
+#define GCOLOR_DEBUG(a) do { a; } while (0)
+#else
+#define GCOLOR_DEBUG(a)
+#endif
+
+/*
+ * add_move_partners:
+ *
+ *   Record the vars which are copied to each other in PARTNERS.
+ */
+static void
+add_move_partners (MonoCompile *cfg, int *var_to_node, GSList **partners)
+{
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			MonoInst *dvar, *svar;
+			int dnode, snode;
+
+			if (ins->opcode != OP_MOVE)
+				continue;
+			dvar = get_vreg_to_inst (cfg, ins->dreg);
+			svar = get_vreg_to_inst (cfg, ins->sreg1);
+			if (!dvar || !svar)
+				continue;
+			dnode = var_to_node [dvar->inst_c0];
+			snode = var_to_node [svar->inst_c0];
+			if (dnode == -1 || snode == -1 || dnode == snode)
+				continue;
+			partners [dnode] = g_slist_prepend_mempool (cfg->mempool, partners [dnode], GINT_TO_POINTER (snode));
+			partners [snode] = g_slist_prepend_mempool (cfg->mempool, partners [snode], GINT_TO_POINTER (dnode));
+		}
+	}
+}
+
+void
+mono_graph_coloring (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask)
+{
+	MonoMethodVar **nodes;
+	MonoBitSet **adj;
+	GSList **partners, *l2;
+	GList *l;
+	gint32 gains [sizeof (regmask_t) * 8];
+	int *var_to_node, *degree, *stack;
+	gboolean *removed;
+	guint32 bitsize;
+	guint8 *mem;
+	int n, n_regs, nvars, i, j, sp;
+
+	nvars = g_list_length (vars);
+	/* The intervals are only computed when registers can be reused */
+	if (cfg->disable_reuse_registers || !vars || !((MonoMethodVar*)vars->data)->interval || nvars > GCOLOR_MAX_VARS) {
+		mono_linear_scan (cfg, vars, regs, used_mask);
+		return;
+	}
+
+	GCOLOR_DEBUG (printf ("Graph coloring for %s:\n", mono_method_full_name (cfg->method, TRUE)));
+
+	n_regs = g_list_length (regs);
+	memset (gains, 0, n_regs * sizeof (gint32));
+
+	/* Vars without a live range don't need a register */
+	nodes = (MonoMethodVar **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoMethodVar*) * nvars);
+	var_to_node = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * cfg->num_varinfo);
+	for (i = 0; i < cfg->num_varinfo; ++i)
+		var_to_node [i] = -1;
+	n = 0;
+	for (l = vars; l; l = l->next) {
+		MonoMethodVar *vmv = (MonoMethodVar *)l->data;
+
+		vmv->reg = -1;
+		if (vmv->interval->range) {
+			var_to_node [vmv->idx] = n;
+			nodes [n ++] = vmv;
+		}
+	}
+
+	/* Build the interference graph */
+	bitsize = mono_bitset_alloc_size (MAX (n, 1), 0);
+	mem = (guint8 *)mono_mempool_alloc0 (cfg->mempool, bitsize * n);
+	adj = (MonoBitSet **)mono_mempool_alloc (cfg->mempool, sizeof (MonoBitSet*) * n);
+	degree = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * n);
+	for (i = 0; i < n; ++i)
+		adj [i] = mono_bitset_mem_new (mem + i * bitsize, n, 0);
+	for (i = 0; i < n; ++i) {
+		for (j = i + 1; j < n; ++j) {
+			if (mono_linterval_get_intersect_pos (nodes [i]->interval, nodes [j]->interval) != -1) {
+				mono_bitset_set_fast (adj [i], j);
+				mono_bitset_set_fast (adj [j], i);
+				degree [i] ++;
+				degree [j] ++;
+			}
+		}
+	}
+
+	partners = (GSList **)mono_mempool_alloc0 (cfg->mempool, sizeof (GSList*) * n);
+	add_move_partners (cfg, var_to_node, partners);
+
+	/* Simplify */
+	removed = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * n);
+	stack = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * n);
+	for (sp = 0; sp < n; ++sp) {
+		int node = -1;
+
+		for (i = 0; i < n; ++i) {
+			if (!removed [i] && degree [i] < n_regs) {
+				node = i;
+				break;
+			}
+		}
+		if (node == -1) {
+			/* Every node has at least n_regs neighbors, pick a potential spill */
+			for (i = 0; i < n; ++i) {
+				if (removed [i])
+					continue;
+				if (node == -1 || (gint64)nodes [i]->spill_costs * degree [node] < (gint64)nodes [node]->spill_costs * degree [i])
+					node = i;
+			}
+			GCOLOR_DEBUG (printf ("\tPotential spill R%d (cost %d, degree %d)\n", cfg->varinfo [nodes [node]->idx]->dreg, nodes [node]->spill_costs, degree [node]));
+		}
+
+		removed [node] = TRUE;
+		stack [sp] = node;
+		for (i = 0; i < n; ++i) {
+			if (mono_bitset_test_fast (adj [node], i))
+				degree [i] --;
+		}
+	}
+
+	/* Select */
+	while (sp > 0) {
+		MonoMethodVar *vmv;
+		regmask_t busy = 0;
+		int node, reg = -1;
+
+		node = stack [-- sp];
+		vmv = nodes [node];
+		for (i = 0; i < n; ++i) {
+			if (mono_bitset_test_fast (adj [node], i) && nodes [i]->reg >= 0)
+				busy |= (regmask_t)1 << nodes [i]->reg;
+		}
+
+		for (l2 = partners [node]; l2; l2 = l2->next) {
+			MonoMethodVar *partner = nodes [GPOINTER_TO_INT (l2->data)];
+
+			if (partner->reg >= 0 && !(busy & ((regmask_t)1 << partner->reg))) {
+				reg = partner->reg;
+				break;
+			}
+		}
+		for (i = 0; reg == -1 && i < n_regs; ++i) {
+			if (!(busy & ((regmask_t)1 << i)))
+				reg = i;
+		}
+
+		if (reg == -1) {
+			GCOLOR_DEBUG (printf ("\tSpilled R%d\n", cfg->varinfo [vmv->idx]->dreg));
+			continue;
+		}
+		GCOLOR_DEBUG (printf ("\tAssigned hreg %d to R%d\n", reg, cfg->varinfo [vmv->idx]->dreg));
+		vmv->reg = reg;
+		gains [reg] += vmv->spill_costs;
+	}
+
+	assign_regs (cfg, vars, regs, gains, n_regs, used_mask);
 }
 
 #endif /* #ifndef DISABLE_JIT */
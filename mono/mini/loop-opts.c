@@ -0,0 +1,1567 @@
+/*
+ * loop-opts.c: Loop invariant code motion, induction variable strength reduction and
+ * bounds check removal for counted loops
+ *
+ * These passes run on the IR after it was taken out of SSA form, see mini_method_compile (),
+ * and use the natural loops computed by mono_compute_natural_loops (). All of them only
+ * handle loops with a preheader, i.e. a bblock outside the loop which is the only way to
+ * enter it, and which falls through or branches to the loop header. The code moved out of
+ * the loop or created by the passes is placed at the end of the preheader.
+ *
+ * The alias analysis used for moving loads is very simple: a loop containing a call or a
+ * store through an unknown address is assumed to write all of memory. Stores to array
+ * elements and to the stack are recognized, so loads of object fields and of array lengths
+ * can still be moved out of loops which write arrays.
+ *
+ * Copyright 2016 Xamarin, Inc (http://www.xamarin.com)
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include <config.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#include <mono/metadata/abi-details.h>
+
+#ifndef DISABLE_JIT
+
+typedef enum {
+	WRITE_NONE,
+	/* Writes a local variable or the stack */
+	WRITE_STACK,
+	/* Writes an element of an array */
+	WRITE_ELEMENT,
+	WRITE_UNKNOWN
+} WriteKind;
+
+typedef struct {
+	MonoCompile *cfg;
+	int num_vregs;
+	/* The number of definitions of each vreg in the method */
+	int *def_count;
+	/* The definition of each vreg which has only one */
+	MonoInst **def_ins;
+} LoopOptData;
+
+typedef struct {
+	MonoBasicBlock *header;
+	MonoBasicBlock *preheader;
+	/* The vregs defined inside the loop */
+	MonoBitSet *defs;
+	gboolean has_stack_writes, has_element_writes, has_unknown_writes;
+} LoopInfo;
+
+static int
+get_defined_vregs (MonoInst *ins, int *vregs)
+{
+	const char *spec = INS_INFO (ins->opcode);
+	int n = 0;
+
+	/* The dreg of stores is the base register */
+	if (spec [MONO_INST_DEST] == ' ' || MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins))
+		return 0;
+	vregs [n ++] = ins->dreg;
+#if SIZEOF_REGISTER == 4
+	if (spec [MONO_INST_DEST] == 'l') {
+		vregs [n ++] = MONO_LVREG_LS (ins->dreg);
+		vregs [n ++] = MONO_LVREG_MS (ins->dreg);
+	}
+#endif
+	return n;
+}
+
+static void
+compute_defs (LoopOptData *data)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int i, j, n, vregs [3];
+
+	data->num_vregs = cfg->next_vreg;
+	data->def_count = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * data->num_vregs);
+	data->def_ins = (MonoInst **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * data->num_vregs);
+
+	/* Arguments are defined on entry */
+	for (i = 0; i < cfg->num_varinfo; ++i) {
+		MonoInst *var = cfg->varinfo [i];
+
+		if (var->opcode == OP_ARG && var->dreg < data->num_vregs)
+			data->def_count [var->dreg] ++;
+	}
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			n = get_defined_vregs (ins, vregs);
+			for (j = 0; j < n; ++j) {
+				data->def_count [vregs [j]] ++;
+				data->def_ins [vregs [j]] = ins;
+			}
+		}
+	}
+}
+
+static MonoInst*
+get_single_def (LoopOptData *data, int vreg)
+{
+	if (vreg < 0 || vreg >= data->num_vregs || data->def_count [vreg] != 1)
+		return NULL;
+	return data->def_ins [vreg];
+}
+
+/*
+ * get_vreg_info:
+ *
+ *   Return the variable or the single definition of VREG, which has its stack type
+ * and class.
+ */
+static MonoInst*
+get_vreg_info (LoopOptData *data, int vreg)
+{
+	MonoInst *ins = get_vreg_to_inst (data->cfg, vreg);
+
+	return ins ? ins : get_single_def (data, vreg);
+}
+
+/* Return whenever objects of class KLASS can't be arrays */
+static gboolean
+class_is_non_array (MonoClass *klass)
+{
+	if (!klass || klass->rank || klass->valuetype)
+		return FALSE;
+	if (klass == mono_defaults.object_class || klass == mono_defaults.array_class || MONO_CLASS_IS_INTERFACE (klass))
+		return FALSE;
+	if (klass->byval_arg.type == MONO_TYPE_VAR || klass->byval_arg.type == MONO_TYPE_MVAR)
+		return FALSE;
+	return TRUE;
+}
+
+/*
+ * is_pure_op:
+ *
+ *   Return whenever INS computes its result from its operands only, without reading
+ * memory or throwing exceptions.
+ */
+static gboolean
+is_pure_op (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_MOVE:
+	case OP_IADD:
+	case OP_ISUB:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+	case OP_ISHL:
+	case OP_ISHR:
+	case OP_ISHR_UN:
+	case OP_INEG:
+	case OP_INOT:
+	case OP_IADD_IMM:
+	case OP_ISUB_IMM:
+	case OP_IMUL_IMM:
+	case OP_IAND_IMM:
+	case OP_IOR_IMM:
+	case OP_IXOR_IMM:
+	case OP_ISHL_IMM:
+	case OP_ISHR_IMM:
+	case OP_ISHR_UN_IMM:
+	case OP_ICONV_TO_I1:
+	case OP_ICONV_TO_I2:
+	case OP_ICONV_TO_U1:
+	case OP_ICONV_TO_U2:
+	case OP_SEXT_I4:
+	case OP_ZEXT_I4:
+	case OP_ADD_IMM:
+	case OP_SUB_IMM:
+	case OP_MUL_IMM:
+	case OP_AND_IMM:
+	case OP_OR_IMM:
+	case OP_XOR_IMM:
+	case OP_SHL_IMM:
+	case OP_SHR_IMM:
+	case OP_SHR_UN_IMM:
+#if SIZEOF_REGISTER == 8
+	case OP_LADD:
+	case OP_LSUB:
+	case OP_LMUL:
+	case OP_LAND:
+	case OP_LOR:
+	case OP_LXOR:
+	case OP_LSHL:
+	case OP_LSHR:
+	case OP_LSHR_UN:
+	case OP_LNEG:
+	case OP_LNOT:
+	case OP_LADD_IMM:
+	case OP_LSUB_IMM:
+	case OP_LMUL_IMM:
+	case OP_LAND_IMM:
+	case OP_LOR_IMM:
+	case OP_LXOR_IMM:
+	case OP_LSHL_IMM:
+	case OP_LSHR_IMM:
+	case OP_LSHR_UN_IMM:
+#endif
+#if defined(TARGET_X86) || defined(TARGET_AMD64)
+	case OP_X86_LEA:
+#endif
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* Return whenever INS only uses and defines integer registers */
+static gboolean
+has_int_regs (MonoInst *ins)
+{
+	const char *spec = INS_INFO (ins->opcode);
+
+	return (spec [MONO_INST_DEST] == ' ' || spec [MONO_INST_DEST] == 'i') &&
+		(spec [MONO_INST_SRC1] == ' ' || spec [MONO_INST_SRC1] == 'i') &&
+		(spec [MONO_INST_SRC2] == ' ' || spec [MONO_INST_SRC2] == 'i') &&
+		spec [MONO_INST_SRC3] == ' ';
+}
+
+/* Return whenever INS is a load which can be moved out of a loop if it's invariant */
+static gboolean
+is_movable_load (MonoInst *ins)
+{
+	if (ins->flags & MONO_INST_VOLATILE)
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_LOAD_MEMBASE:
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_LOADI8_MEMBASE:
+		return has_int_regs (ins);
+#if !defined(TARGET_X86)
+	/* Global float vregs don't work on x86, see mono_handle_global_vregs () */
+	case OP_LOADR8_MEMBASE:
+		return !mono_arch_is_soft_float ();
+#endif
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_CHECK_THIS:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * is_element_address:
+ *
+ *   Return whenever VREG holds the address of an array element computed by
+ * mini_emit_ldelema_1_ins ().
+ */
+static gboolean
+is_element_address (LoopOptData *data, int vreg)
+{
+#if defined(TARGET_X86) || defined(TARGET_AMD64)
+	MonoInst *def = get_single_def (data, vreg);
+
+	return def && def->opcode == OP_X86_LEA && def->inst_imm == MONO_STRUCT_OFFSET (MonoArray, vector);
+#else
+	return FALSE;
+#endif
+}
+
+static WriteKind
+get_write_kind (LoopOptData *data, MonoInst *ins)
+{
+	if (MONO_IS_STORE_MEMBASE (ins)) {
+		MonoInst *def;
+
+		if ((ins->opcode >= OP_ATOMIC_STORE_I1 && ins->opcode <= OP_ATOMIC_STORE_R8) || (ins->flags & MONO_INST_VOLATILE))
+			return WRITE_UNKNOWN;
+		def = get_single_def (data, ins->inst_destbasereg);
+		if (def && def->opcode == OP_LDADDR)
+			return WRITE_STACK;
+		if (is_element_address (data, ins->inst_destbasereg))
+			return WRITE_ELEMENT;
+		/* Element stores with a constant index */
+		def = get_vreg_info (data, ins->inst_destbasereg);
+		if (def && def->type == STACK_OBJ && def->klass && def->klass->rank && ins->inst_offset >= MONO_STRUCT_OFFSET (MonoArray, vector))
+			return WRITE_ELEMENT;
+		return WRITE_UNKNOWN;
+	}
+
+	if (MONO_IS_LOAD_MEMBASE (ins)) {
+		/* Volatile and atomic loads can't be reordered with later loads */
+		if ((ins->opcode >= OP_ATOMIC_LOAD_I1 && ins->opcode <= OP_ATOMIC_LOAD_R8) || (ins->flags & MONO_INST_VOLATILE))
+			return WRITE_UNKNOWN;
+		return WRITE_NONE;
+	}
+
+	switch (ins->opcode) {
+	case OP_VMOVE:
+	case OP_VZERO:
+		return WRITE_STACK;
+	case OP_JMP:
+	case OP_TAILCALL:
+	case OP_BREAK:
+		return WRITE_UNKNOWN;
+	case OP_NOP:
+	case OP_IL_SEQ_POINT:
+	case OP_DUMMY_USE:
+	case OP_NOT_NULL:
+	case OP_CHECK_THIS:
+	case OP_LDADDR:
+	case OP_ICONST:
+	case OP_I8CONST:
+	case OP_R4CONST:
+	case OP_R8CONST:
+	case OP_COMPARE:
+	case OP_COMPARE_IMM:
+	case OP_ICOMPARE:
+	case OP_ICOMPARE_IMM:
+	case OP_LCOMPARE:
+	case OP_LCOMPARE_IMM:
+	case OP_FCOMPARE:
+	case OP_RCOMPARE:
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_BOUNDS_CHECK:
+	/* Only writes the card table */
+	case OP_CARD_TABLE_WBARRIER:
+		return WRITE_NONE;
+	default:
+		break;
+	}
+
+	/* Moves, arithmetic, conversions, branches and conditional exceptions */
+	if (ins->opcode >= OP_MOVE && ins->opcode <= OP_FGETHIGH32)
+		return WRITE_NONE;
+	if (ins->opcode >= OP_BIGMUL && ins->opcode <= OP_ROUND)
+		return WRITE_NONE;
+	return WRITE_UNKNOWN;
+}
+
+/* Return whenever INS can't throw and has no side effects */
+static gboolean
+is_harmless (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_COMPARE:
+	case OP_COMPARE_IMM:
+	case OP_ICOMPARE:
+	case OP_ICOMPARE_IMM:
+	case OP_LCOMPARE:
+	case OP_LCOMPARE_IMM:
+	case OP_ICONST:
+	case OP_I8CONST:
+		return TRUE;
+	default:
+		return is_pure_op (ins) || MONO_INS_HAS_NO_SIDE_EFFECT (ins);
+	}
+}
+
+/*
+ * get_preheader:
+ *
+ *   Return the bblock through which the loop headed by H is entered, or NULL if it
+ * doesn't have one, or if its code can't be moved around.
+ */
+static MonoBasicBlock*
+get_preheader (MonoCompile *cfg, MonoBasicBlock *h)
+{
+	MonoBasicBlock *preheader = NULL;
+	GList *l;
+	int i;
+
+	for (i = 0; i < h->in_count; ++i) {
+		MonoBasicBlock *pred = h->in_bb [i];
+
+		if (g_list_find (h->loop_blocks, pred))
+			continue;
+		if (preheader)
+			return NULL;
+		preheader = pred;
+	}
+
+	if (!preheader || preheader == cfg->bb_entry || preheader->out_count != 1 || preheader->region != h->region)
+		return NULL;
+	if (preheader->last_ins && MONO_IS_BRANCH_OP (preheader->last_ins) && preheader->last_ins->opcode != OP_BR)
+		return NULL;
+
+	/* Moving code across exception clauses would change which handler runs */
+	for (l = h->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+
+		if (bb->region != h->region)
+			return NULL;
+	}
+
+	return preheader;
+}
+
+static gboolean
+init_loop_info (LoopOptData *data, LoopInfo *li, MonoBasicBlock *h)
+{
+	MonoCompile *cfg = data->cfg;
+	GList *l;
+
+	memset (li, 0, sizeof (LoopInfo));
+	li->header = h;
+	li->preheader = get_preheader (cfg, h);
+	if (!li->preheader)
+		return FALSE;
+
+	li->defs = mono_bitset_mem_new (mono_mempool_alloc0 (cfg->mempool, mono_bitset_alloc_size (data->num_vregs, 0)), data->num_vregs, 0);
+	for (l = h->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+		MonoInst *ins;
+		int j, n, vregs [3];
+
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			n = get_defined_vregs (ins, vregs);
+			for (j = 0; j < n; ++j)
+				mono_bitset_set_fast (li->defs, vregs [j]);
+
+			switch (get_write_kind (data, ins)) {
+			case WRITE_STACK:
+				li->has_stack_writes = TRUE;
+				break;
+			case WRITE_ELEMENT:
+				li->has_element_writes = TRUE;
+				break;
+			case WRITE_UNKNOWN:
+				li->has_unknown_writes = TRUE;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+is_invariant (MonoCompile *cfg, LoopInfo *li, int vreg)
+{
+	return !mono_bitset_test_fast (li->defs, vreg) && !vreg_is_volatile (cfg, vreg);
+}
+
+static gboolean
+sregs_are_invariant (MonoCompile *cfg, LoopInfo *li, MonoInst *ins)
+{
+	int sregs [MONO_MAX_SRC_REGS];
+	int i, num_sregs;
+
+	num_sregs = mono_inst_get_src_registers (ins, sregs);
+	for (i = 0; i < num_sregs; ++i) {
+		if (!is_invariant (cfg, li, sregs [i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Return whenever the definition of the dreg of INS can be moved out of the loop */
+static gboolean
+dreg_is_movable (LoopOptData *data, MonoInst *ins)
+{
+	if (INS_INFO (ins->opcode) [MONO_INST_DEST] == ' ')
+		return TRUE;
+	if (get_single_def (data, ins->dreg) != ins || vreg_is_volatile (data->cfg, ins->dreg))
+		return FALSE;
+	return !data->cfg->ret || ins->dreg != data->cfg->ret->dreg;
+}
+
+/*
+ * load_is_invariant:
+ *
+ *   Return whenever the memory read by the load INS can't be written by the loop.
+ */
+static gboolean
+load_is_invariant (LoopOptData *data, LoopInfo *li, MonoInst *ins)
+{
+	MonoInst *base;
+
+	if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN || ins->opcode == OP_CHECK_THIS)
+		return TRUE;
+	if (li->has_unknown_writes)
+		return FALSE;
+	if (!li->has_stack_writes && !li->has_element_writes)
+		return TRUE;
+
+	/* Fields of objects are not on the stack, and element stores only write past the array header */
+	base = get_vreg_info (data, ins->inst_basereg);
+	if (!base || base->type != STACK_OBJ)
+		return FALSE;
+	if (!li->has_element_writes)
+		return TRUE;
+	return ins->inst_offset < MONO_STRUCT_OFFSET (MonoArray, vector) || class_is_non_array (base->klass);
+}
+
+static void
+move_to_preheader (MonoCompile *cfg, LoopInfo *li, MonoBasicBlock *bb, MonoInst *ins)
+{
+	if (cfg->verbose_level > 1) {
+		printf ("licm: moving from BB%d to BB%d: ", bb->block_num, li->preheader->block_num);
+		mono_print_ins (ins);
+	}
+
+	MONO_REMOVE_INS (bb, ins);
+	mono_add_ins_to_end (li->preheader, ins);
+	if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN)
+		li->preheader->has_array_access = TRUE;
+
+	if (INS_INFO (ins->opcode) [MONO_INST_DEST] != ' ')
+		mono_bitset_clear_fast (li->defs, ins->dreg);
+}
+
+/*
+ * replace_redundant_loads:
+ *
+ *   Replace the loads in the loop which read the same memory as LOAD, which was moved to
+ * the preheader, with moves from its dreg. They can't fault, since LOAD executed first.
+ */
+static void
+replace_redundant_loads (MonoCompile *cfg, LoopInfo *li, MonoInst *load)
+{
+	GList *l;
+
+	if (load->opcode == OP_CHECK_THIS)
+		return;
+
+	for (l = li->header->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+		MonoInst *ins;
+
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			if (ins->opcode != load->opcode || ins->sreg1 != load->sreg1 || (ins->flags & MONO_INST_VOLATILE))
+				continue;
+			if (load->opcode != OP_LDLEN && load->opcode != OP_STRLEN && ins->inst_offset != load->inst_offset)
+				continue;
+
+			if (cfg->verbose_level > 1) {
+				printf ("licm: replacing in BB%d: ", bb->block_num);
+				mono_print_ins (ins);
+			}
+			ins->opcode = load->opcode == OP_LOADR8_MEMBASE ? OP_FMOVE : OP_MOVE;
+			ins->sreg1 = load->dreg;
+			ins->inst_offset = 0;
+			ins->flags &= ~MONO_INST_FAULT;
+		}
+	}
+}
+
+static gboolean
+licm_loop (LoopOptData *data, MonoBasicBlock *h)
+{
+	MonoCompile *cfg = data->cfg;
+	LoopInfo li;
+	gboolean changed, res = FALSE;
+	GList *l;
+
+	if (!init_loop_info (data, &li, h))
+		return FALSE;
+
+	do {
+		changed = FALSE;
+		for (l = h->loop_blocks; l; l = l->next) {
+			MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+			MonoInst *ins, *n;
+			/*
+			 * Loads can only be moved if they are executed whenever the loop is entered, and
+			 * moving them doesn't change which exception is thrown first.
+			 */
+			gboolean in_prefix = bb == h;
+
+			MONO_BB_FOR_EACH_INS_SAFE (bb, n, ins) {
+				if (is_pure_op (ins) && has_int_regs (ins)) {
+					if (sregs_are_invariant (cfg, &li, ins) && dreg_is_movable (data, ins)) {
+						move_to_preheader (cfg, &li, bb, ins);
+						changed = TRUE;
+					}
+					continue;
+				}
+
+				if (in_prefix && is_movable_load (ins) && sregs_are_invariant (cfg, &li, ins) && dreg_is_movable (data, ins) && load_is_invariant (data, &li, ins)) {
+					move_to_preheader (cfg, &li, bb, ins);
+					replace_redundant_loads (cfg, &li, ins);
+					changed = TRUE;
+					continue;
+				}
+
+				if (!is_harmless (ins))
+					in_prefix = FALSE;
+			}
+		}
+		res |= changed;
+	} while (changed);
+
+	return res;
+}
+
+static gint
+compare_loop_nesting (gconstpointer a, gconstpointer b)
+{
+	MonoBasicBlock *bb1 = *(MonoBasicBlock **)a;
+	MonoBasicBlock *bb2 = *(MonoBasicBlock **)b;
+
+	/* Inner loops first, so their invariants can be moved further out */
+	return bb2->nesting - bb1->nesting;
+}
+
+static GPtrArray*
+get_loop_headers (MonoCompile *cfg)
+{
+	GPtrArray *headers = g_ptr_array_new ();
+	MonoBasicBlock *bb;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (bb->loop_blocks)
+			g_ptr_array_add (headers, bb);
+	}
+	g_ptr_array_sort (headers, compare_loop_nesting);
+	return headers;
+}
+
+/*
+ * mono_loop_invariant_code_motion:
+ *
+ *   Move the computations whose value doesn't change inside loops, along with the loads
+ * of memory the loop doesn't write, to the preheaders of the loops. Return whenever the
+ * code changed.
+ */
+gboolean
+mono_loop_invariant_code_motion (MonoCompile *cfg)
+{
+	LoopOptData data;
+	GPtrArray *headers;
+	gboolean changed = FALSE;
+	int i;
+
+	if (!(cfg->comp_done & MONO_COMP_LOOPS) || cfg->gen_sdb_seq_points)
+		return FALSE;
+
+	memset (&data, 0, sizeof (data));
+	data.cfg = cfg;
+	compute_defs (&data);
+
+	headers = get_loop_headers (cfg);
+	for (i = 0; i < headers->len; ++i)
+		changed |= licm_loop (&data, (MonoBasicBlock *)g_ptr_array_index (headers, i));
+	g_ptr_array_free (headers, TRUE);
+
+	return changed;
+}
+
+typedef struct {
+	/* The induction variable and the instruction which increments it */
+	int iv;
+	MonoInst *iv_def;
+	MonoBasicBlock *iv_def_bb;
+	/* The multiplication by a loop invariant value */
+	int opcode, sreg2;
+	mgreg_t imm;
+	/* The vreg holding the product */
+	int vreg;
+} ReducedMul;
+
+/* Return the opcodes used to update a product of OPCODE in ADD_IMM_OPCODE and ADD_OPCODE */
+static gboolean
+get_mul_info (int opcode, int *add_imm_opcode, int *add_opcode, int *mul_imm_opcode)
+{
+	switch (opcode) {
+	case OP_IMUL:
+	case OP_IMUL_IMM:
+		*add_imm_opcode = OP_IADD_IMM;
+		*add_opcode = OP_IADD;
+		*mul_imm_opcode = OP_IMUL_IMM;
+		return TRUE;
+#if SIZEOF_REGISTER == 8
+	case OP_LMUL:
+	case OP_LMUL_IMM:
+		*add_imm_opcode = OP_LADD_IMM;
+		*add_opcode = OP_LADD;
+		*mul_imm_opcode = OP_LMUL_IMM;
+		return TRUE;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * get_basic_iv:
+ *
+ *   Return the instruction incrementing VREG by a constant, if that is the only definition
+ * of VREG inside the loop.
+ */
+static MonoInst*
+get_basic_iv (MonoCompile *cfg, LoopInfo *li, int vreg, int add_imm_opcode, MonoBasicBlock **def_bb)
+{
+	MonoInst *def = NULL;
+	GList *l;
+
+	if (vreg_is_volatile (cfg, vreg) || !mono_bitset_test_fast (li->defs, vreg))
+		return NULL;
+
+	for (l = li->header->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+		MonoInst *ins;
+		int j, n, vregs [3];
+
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			n = get_defined_vregs (ins, vregs);
+			for (j = 0; j < n; ++j) {
+				if (vregs [j] != vreg)
+					continue;
+				if (def || ins->opcode != add_imm_opcode || ins->sreg1 != vreg)
+					return NULL;
+				def = ins;
+				*def_bb = bb;
+			}
+		}
+	}
+	return def;
+}
+
+static gboolean
+reduce_mul (LoopOptData *data, LoopInfo *li, GSList **reduced, MonoInst *ins)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoInst *iv_def, *init, *update;
+	MonoBasicBlock *iv_def_bb = NULL;
+	ReducedMul *r = NULL;
+	GSList *l;
+	int add_imm_opcode, add_opcode, mul_imm_opcode, iv, sreg2 = -1;
+	gint64 step = 0;
+
+	if (!get_mul_info (ins->opcode, &add_imm_opcode, &add_opcode, &mul_imm_opcode))
+		return FALSE;
+	if (!has_int_regs (ins) || get_single_def (data, ins->dreg) != ins || vreg_is_volatile (cfg, ins->dreg))
+		return FALSE;
+
+	iv = ins->sreg1;
+	if (ins->opcode == OP_IMUL || ins->opcode == OP_LMUL) {
+		/* The product of the induction variable and a loop invariant vreg */
+		sreg2 = ins->sreg2;
+		if (!is_invariant (cfg, li, sreg2)) {
+			sreg2 = ins->sreg1;
+			iv = ins->sreg2;
+			if (!is_invariant (cfg, li, sreg2))
+				return FALSE;
+		}
+	}
+	if (iv == ins->dreg)
+		return FALSE;
+	iv_def = get_basic_iv (cfg, li, iv, add_imm_opcode, &iv_def_bb);
+	if (!iv_def)
+		return FALSE;
+
+	if (sreg2 == -1) {
+		if (iv_def->inst_imm != (gint32)iv_def->inst_imm || ins->inst_imm != (gint32)ins->inst_imm)
+			return FALSE;
+		step = (gint64)iv_def->inst_imm * (gint64)ins->inst_imm;
+		if (add_imm_opcode == OP_IADD_IMM)
+			step = (gint32)(guint32)(guint64)step;
+		if (step != (gint32)step)
+			return FALSE;
+	}
+
+	for (l = *reduced; l; l = l->next) {
+		ReducedMul *r2 = (ReducedMul *)l->data;
+
+		if (r2->iv == iv && r2->opcode == ins->opcode && (sreg2 == -1 ? r2->imm == ins->inst_imm : r2->sreg2 == sreg2)) {
+			r = r2;
+			break;
+		}
+	}
+
+	if (!r) {
+		r = (ReducedMul *)mono_mempool_alloc0 (cfg->mempool, sizeof (ReducedMul));
+		r->iv = iv;
+		r->iv_def = iv_def;
+		r->iv_def_bb = iv_def_bb;
+		r->opcode = ins->opcode;
+		r->sreg2 = sreg2;
+		r->imm = ins->inst_imm;
+		r->vreg = alloc_ireg (cfg);
+
+		/* Compute the initial value in the preheader */
+		MONO_INST_NEW (cfg, init, ins->opcode);
+		init->dreg = r->vreg;
+		init->sreg1 = iv;
+		init->sreg2 = sreg2;
+		init->inst_imm = ins->inst_imm;
+		mono_add_ins_to_end (li->preheader, init);
+
+		/* Update it along with the induction variable */
+		if (sreg2 == -1) {
+			MONO_INST_NEW (cfg, update, add_imm_opcode);
+			update->inst_imm = step;
+		} else {
+			int step_reg = sreg2;
+
+			if (iv_def->inst_imm != 1) {
+				MonoInst *mul;
+
+				step_reg = alloc_ireg (cfg);
+				MONO_INST_NEW (cfg, mul, mul_imm_opcode);
+				mul->dreg = step_reg;
+				mul->sreg1 = sreg2;
+				mul->inst_imm = iv_def->inst_imm;
+				mono_add_ins_to_end (li->preheader, mul);
+			}
+			MONO_INST_NEW (cfg, update, add_opcode);
+			update->sreg2 = step_reg;
+		}
+		update->dreg = r->vreg;
+		update->sreg1 = r->vreg;
+		mono_bblock_insert_after_ins (iv_def_bb, iv_def, update);
+
+		*reduced = g_slist_prepend (*reduced, r);
+	}
+
+	if (cfg->verbose_level > 1) {
+		printf ("strength reduction: replacing with R%d: ", r->vreg);
+		mono_print_ins (ins);
+	}
+
+	ins->opcode = OP_MOVE;
+	ins->sreg1 = r->vreg;
+	ins->sreg2 = -1;
+	ins->inst_imm = 0;
+	return TRUE;
+}
+
+static gboolean
+strength_reduce_loop (LoopOptData *data, MonoBasicBlock *h)
+{
+	LoopInfo li;
+	GSList *reduced = NULL;
+	gboolean changed = FALSE;
+	GList *l;
+
+	if (!init_loop_info (data, &li, h))
+		return FALSE;
+
+	for (l = h->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+		MonoInst *ins;
+
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			if (ins->dreg < data->num_vregs)
+				changed |= reduce_mul (data, &li, &reduced, ins);
+		}
+	}
+
+	g_slist_free (reduced);
+	return changed;
+}
+
+/*
+ * mono_loop_strength_reduction:
+ *
+ *   Replace multiplications of induction variables by loop invariant values with additions:
+ * if I is only modified by I += C inside a loop, I * K is kept in a new vreg which is
+ * initialized in the preheader and incremented by C * K along with I. Only multiplications
+ * with the same width as the induction variable are handled, so the result is exact even if
+ * the additions overflow. Return whenever the code changed.
+ */
+gboolean
+mono_loop_strength_reduction (MonoCompile *cfg)
+{
+	LoopOptData data;
+	GPtrArray *headers;
+	gboolean changed = FALSE;
+	int i;
+
+	if (!(cfg->comp_done & MONO_COMP_LOOPS) || cfg->gen_sdb_seq_points)
+		return FALSE;
+
+	memset (&data, 0, sizeof (data));
+	data.cfg = cfg;
+
+	compute_defs (&data);
+
+	headers = get_loop_headers (cfg);
+	for (i = 0; i < headers->len; ++i) {
+		if (strength_reduce_loop (&data, (MonoBasicBlock *)g_ptr_array_index (headers, i))) {
+			/* The enclosing loops contain the new vregs */
+			compute_defs (&data);
+			changed = TRUE;
+		}
+	}
+	g_ptr_array_free (headers, TRUE);
+
+	return changed;
+}
+
+/* The maximum number of bblocks before a loop searched for the code computing its bounds */
+#define MAX_ENTRY_BBS 8
+/* The maximum constant added to array lengths and induction variables */
+#define MAX_DELTA 0x10000
+
+/*
+ * The straight line code through which a loop is entered: each bblock is only entered from
+ * the previous one, and the last one is the preheader. A value computed by this code stays
+ * the same during the whole loop if the vregs it depends on are not changed later in the
+ * path or inside the loop.
+ */
+typedef struct {
+	MonoBasicBlock *bbs [MAX_ENTRY_BBS];
+	int nbbs;
+} EntryPath;
+
+/*
+ * A loop whose header exits unless IV < LIMIT, where IV is only modified by the increment
+ * IV_DEF, and LIMIT is loop invariant.
+ */
+typedef struct {
+	int iv, limit;
+	/* Whenever the comparison is unsigned, or LE instead of LT */
+	gboolean is_unsigned, is_le;
+	MonoInst *iv_def;
+	MonoBasicBlock *iv_def_bb;
+	/* The bblock entered from the header if the condition holds */
+	MonoBasicBlock *body;
+	/* The value of IV on entry to the loop */
+	gboolean has_init;
+	int init;
+	/* The bblocks of the loop, and a scratch set, indexed by block_num */
+	MonoBitSet *loop_bbs, *visited;
+} CountedLoop;
+
+static gboolean
+is_in_loop (CountedLoop *cl, MonoBasicBlock *bb)
+{
+	return bb->block_num < mono_bitset_size (cl->loop_bbs) && mono_bitset_test_fast (cl->loop_bbs, bb->block_num);
+}
+
+static void
+get_entry_path (LoopInfo *li, EntryPath *path)
+{
+	MonoBasicBlock *bbs [MAX_ENTRY_BBS];
+	MonoBasicBlock *bb = li->preheader;
+	int i, n = 0;
+
+	bbs [n ++] = bb;
+	while (n < MAX_ENTRY_BBS && bb->in_count == 1) {
+		MonoBasicBlock *pred = bb->in_bb [0];
+
+		if (pred->region != li->preheader->region)
+			break;
+		for (i = 0; i < n; ++i) {
+			if (bbs [i] == pred)
+				break;
+		}
+		if (i < n)
+			break;
+		bbs [n ++] = pred;
+		bb = pred;
+	}
+
+	path->nbbs = n;
+	for (i = 0; i < n; ++i)
+		path->bbs [i] = bbs [n - i - 1];
+}
+
+static gboolean
+find_in_entry_path (EntryPath *path, MonoInst *ins, int *index)
+{
+	int i;
+
+	for (i = 0; i < path->nbbs; ++i) {
+		MonoInst *cur;
+
+		MONO_BB_FOR_EACH_INS (path->bbs [i], cur) {
+			if (cur == ins) {
+				*index = i;
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * is_stable:
+ *
+ *   Return whenever the value of VREG after INS, which is in the INDEXth bblock of PATH,
+ * is the value it has during the whole loop.
+ */
+static gboolean
+is_stable (MonoCompile *cfg, LoopInfo *li, EntryPath *path, int index, MonoInst *ins, int vreg)
+{
+	int i, j, n, vregs [3];
+
+	if (!is_invariant (cfg, li, vreg))
+		return FALSE;
+
+	for (i = index; i < path->nbbs; ++i) {
+		MonoInst *cur = i == index ? ins->next : path->bbs [i]->code;
+
+		for (; cur; cur = cur->next) {
+			n = get_defined_vregs (cur, vregs);
+			for (j = 0; j < n; ++j) {
+				if (vregs [j] == vreg)
+					return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * find_earlier_load:
+ *
+ *   Return a load in the entry path before LOAD, which is in its INDEXth bblock, which reads
+ * the same field, if nothing but the stack is written in between.
+ */
+static MonoInst*
+find_earlier_load (LoopOptData *data, LoopInfo *li, EntryPath *path, int index, MonoInst *load)
+{
+	MonoInst *ins, *base;
+	int i, j, n, vregs [3];
+
+	/* Stack writes could modify fields of valuetypes */
+	base = get_vreg_info (data, load->inst_basereg);
+	if (!base || base->type != STACK_OBJ)
+		return NULL;
+
+	for (i = index; i >= 0; --i) {
+		for (ins = i == index ? load->prev : path->bbs [i]->last_ins; ins; ins = ins->prev) {
+			if (ins->opcode == load->opcode && ins->inst_basereg == load->inst_basereg && ins->inst_offset == load->inst_offset && !(ins->flags & MONO_INST_VOLATILE))
+				return is_stable (data->cfg, li, path, i, ins, ins->dreg) ? ins : NULL;
+			switch (get_write_kind (data, ins)) {
+			case WRITE_NONE:
+			case WRITE_STACK:
+				break;
+			default:
+				return NULL;
+			}
+			n = get_defined_vregs (ins, vregs);
+			for (j = 0; j < n; ++j) {
+				if (vregs [j] == load->inst_basereg)
+					return NULL;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+ * get_array_vreg:
+ *
+ *   Return the vreg which VREG is a copy of during the whole loop, so arrays loaded from
+ * the same field before the loop and in its preheader are recognized as the same.
+ */
+static int
+get_array_vreg (LoopOptData *data, LoopInfo *li, EntryPath *path, int vreg)
+{
+	int i, index;
+
+	for (i = 0; i < MAX_ENTRY_BBS; ++i) {
+		MonoInst *def = get_single_def (data, vreg);
+
+		if (!def || !find_in_entry_path (path, def, &index) || !is_stable (data->cfg, li, path, index, def, def->sreg1))
+			break;
+		if (def->opcode == OP_MOVE) {
+			vreg = def->sreg1;
+		} else if (def->opcode == OP_LOAD_MEMBASE && !(def->flags & MONO_INST_VOLATILE)) {
+			MonoInst *load = find_earlier_load (data, li, path, index, def);
+
+			if (!load)
+				break;
+			vreg = load->dreg;
+		} else {
+			break;
+		}
+	}
+	return vreg;
+}
+
+/*
+ * resolve_length:
+ *
+ *   Follow the definitions of VREG in the entry path of the loop, setting *BASE and *K so
+ * VREG == *BASE - *K during the whole loop. If *BASE is the length of an array or a string,
+ * set *ARRAY to its vreg, and *OFFSET to the offset of its length field, otherwise set
+ * *ARRAY to -1. Return FALSE if VREG can't be related to a loop invariant vreg.
+ */
+static gboolean
+resolve_length (LoopOptData *data, LoopInfo *li, EntryPath *path, int vreg, int *base, int *k, int *array, int *offset)
+{
+	int i, index;
+
+	*base = vreg;
+	*k = 0;
+	*array = -1;
+	if (!is_invariant (data->cfg, li, vreg))
+		return FALSE;
+
+	for (i = 0; i < MAX_ENTRY_BBS; ++i) {
+		MonoInst *def = get_single_def (data, *base);
+		mgreg_t delta;
+
+		if (!def || !find_in_entry_path (path, def, &index))
+			return TRUE;
+		if (!is_stable (data->cfg, li, path, index, def, def->sreg1))
+			return TRUE;
+
+		switch (def->opcode) {
+		case OP_LDLEN:
+			*array = get_array_vreg (data, li, path, def->sreg1);
+			*offset = MONO_STRUCT_OFFSET (MonoArray, max_length);
+			return TRUE;
+		case OP_STRLEN:
+			*array = get_array_vreg (data, li, path, def->sreg1);
+			*offset = MONO_STRUCT_OFFSET (MonoString, length);
+			return TRUE;
+		case OP_MOVE:
+			delta = 0;
+			break;
+		case OP_ISUB_IMM:
+			delta = def->inst_imm;
+			break;
+		case OP_IADD_IMM:
+			delta = -def->inst_imm;
+			break;
+		default:
+			return TRUE;
+		}
+		/* The length minus a positive constant can't overflow */
+		if (delta < 0 || delta > MAX_DELTA)
+			return TRUE;
+		*base = def->sreg1;
+		*k += delta;
+	}
+	return TRUE;
+}
+
+static CompRelation
+swap_cond (CompRelation cond)
+{
+	switch (cond) {
+	case CMP_LE:
+		return CMP_GE;
+	case CMP_GE:
+		return CMP_LE;
+	case CMP_LT:
+		return CMP_GT;
+	case CMP_GT:
+		return CMP_LT;
+	case CMP_LE_UN:
+		return CMP_GE_UN;
+	case CMP_GE_UN:
+		return CMP_LE_UN;
+	case CMP_LT_UN:
+		return CMP_GT_UN;
+	case CMP_GT_UN:
+		return CMP_LT_UN;
+	default:
+		return cond;
+	}
+}
+
+/*
+ * get_checked_bound:
+ *
+ *   Return the largest K such that the conditional branches in the entry path of the loop
+ * establish VREG <= the length of ARRAY - K for the whole loop, or -1. If IS_UNSIGNED is
+ * TRUE, only unsigned comparisons are taken into account, since VREG is used as an unsigned
+ * value, and a signed check lets negative values through.
+ */
+static int
+get_checked_bound (LoopOptData *data, LoopInfo *li, EntryPath *path, int vreg, int array, int offset, gboolean is_unsigned)
+{
+	MonoCompile *cfg = data->cfg;
+	int i, res = -1;
+
+	for (i = 0; i < path->nbbs - 1; ++i) {
+		MonoBasicBlock *next = path->bbs [i + 1];
+		MonoInst *branch = path->bbs [i]->last_ins;
+		MonoInst *compare;
+		CompRelation cond;
+		int other, base, k, e, other_array, other_offset;
+
+		if (!branch || !MONO_IS_COND_BRANCH_OP (branch) || !branch->prev || branch->prev->opcode != OP_ICOMPARE)
+			continue;
+		compare = branch->prev;
+
+		cond = mono_opcode_to_cond (branch->opcode);
+		if (branch->inst_true_bb == next && branch->inst_false_bb != next)
+			;
+		else if (branch->inst_false_bb == next && branch->inst_true_bb != next)
+			cond = mono_negate_cond (cond);
+		else
+			continue;
+
+		if (compare->sreg1 == vreg) {
+			other = compare->sreg2;
+		} else if (compare->sreg2 == vreg) {
+			other = compare->sreg1;
+			cond = swap_cond (cond);
+		} else {
+			continue;
+		}
+		if (!is_stable (cfg, li, path, i, compare, vreg) || !is_stable (cfg, li, path, i, compare, other))
+			continue;
+		if (!resolve_length (data, li, path, other, &base, &k, &other_array, &other_offset))
+			continue;
+		if (other_array == -1 || other_array != array || other_offset != offset)
+			continue;
+
+		/* VREG <= OTHER - E */
+		switch (cond) {
+		case CMP_EQ:
+			e = 0;
+			break;
+		case CMP_LE:
+			if (is_unsigned)
+				continue;
+			e = 0;
+			break;
+		case CMP_LT:
+			if (is_unsigned)
+				continue;
+			e = 1;
+			break;
+		case CMP_LE_UN:
+		case CMP_LT_UN:
+			/* OTHER could be negative otherwise */
+			if (k != 0)
+				continue;
+			e = cond == CMP_LT_UN ? 1 : 0;
+			break;
+		default:
+			continue;
+		}
+		res = MAX (res, k + e);
+	}
+	return res;
+}
+
+/*
+ * condition_holds_at:
+ *
+ *   Return whenever the loop condition, which holds on entry to the loop body, still holds
+ * at INS in BB, i.e. the induction variable is not incremented on any path from the body
+ * to INS inside the loop.
+ */
+static gboolean
+condition_holds_at (MonoBasicBlock *h, CountedLoop *cl, MonoBasicBlock *bb, MonoInst *ins)
+{
+	GSList *todo;
+	gboolean res = TRUE;
+
+	if (bb == h)
+		return FALSE;
+	if (bb == cl->iv_def_bb) {
+		MonoInst *cur;
+
+		for (cur = ins; cur; cur = cur->next) {
+			if (cur == cl->iv_def)
+				break;
+		}
+		if (!cur)
+			return FALSE;
+	}
+	if (bb == cl->body)
+		return TRUE;
+
+	mono_bitset_clear_all (cl->visited);
+	todo = g_slist_prepend (NULL, bb);
+	while (todo && res) {
+		MonoBasicBlock *cur = (MonoBasicBlock *)todo->data;
+		int i;
+
+		todo = g_slist_delete_link (todo, todo);
+		for (i = 0; i < cur->in_count; ++i) {
+			MonoBasicBlock *pred = cur->in_bb [i];
+
+			if (pred == cl->iv_def_bb || pred == h || !is_in_loop (cl, pred)) {
+				res = FALSE;
+				break;
+			}
+			if (pred == cl->body || mono_bitset_test_fast (cl->visited, pred->block_num))
+				continue;
+			mono_bitset_set_fast (cl->visited, pred->block_num);
+			todo = g_slist_prepend (todo, pred);
+		}
+	}
+	g_slist_free (todo);
+	return res;
+}
+
+/*
+ * get_counted_loop:
+ *
+ *   Return whenever the loop described by LI is exited by its header unless the induction
+ * variable is smaller than a loop invariant limit.
+ */
+static gboolean
+get_counted_loop (LoopOptData *data, LoopInfo *li, EntryPath *path, CountedLoop *cl)
+{
+	MonoCompile *cfg = data->cfg;
+	MonoBasicBlock *h = li->header;
+	MonoInst *branch = h->last_ins;
+	MonoInst *compare, *ins;
+	CompRelation cond;
+	gboolean true_in_loop, false_in_loop;
+	GList *l;
+	int i, j, n, vregs [3];
+
+	memset (cl, 0, sizeof (CountedLoop));
+
+	if (!branch || !MONO_IS_COND_BRANCH_OP (branch) || !branch->prev || branch->prev->opcode != OP_ICOMPARE)
+		return FALSE;
+	compare = branch->prev;
+
+	cl->loop_bbs = mono_bitset_mem_new (mono_mempool_alloc0 (cfg->mempool, mono_bitset_alloc_size (cfg->num_bblocks, 0)), cfg->num_bblocks, 0);
+	cl->visited = mono_bitset_mem_new (mono_mempool_alloc0 (cfg->mempool, mono_bitset_alloc_size (cfg->num_bblocks, 0)), cfg->num_bblocks, 0);
+	for (l = h->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+
+		if (bb->block_num >= cfg->num_bblocks)
+			return FALSE;
+		mono_bitset_set_fast (cl->loop_bbs, bb->block_num);
+	}
+
+	/* The condition has to hold whenever the loop body is entered */
+	cond = mono_opcode_to_cond (branch->opcode);
+	true_in_loop = is_in_loop (cl, branch->inst_true_bb);
+	false_in_loop = is_in_loop (cl, branch->inst_false_bb);
+	if (true_in_loop && !false_in_loop) {
+		cl->body = branch->inst_true_bb;
+	} else if (false_in_loop && !true_in_loop) {
+		cl->body = branch->inst_false_bb;
+		cond = mono_negate_cond (cond);
+	} else {
+		return FALSE;
+	}
+	if (cl->body == h || cl->body->in_count != 1)
+		return FALSE;
+
+	if (is_invariant (cfg, li, compare->sreg2)) {
+		cl->iv = compare->sreg1;
+		cl->limit = compare->sreg2;
+	} else if (is_invariant (cfg, li, compare->sreg1)) {
+		cl->iv = compare->sreg2;
+		cl->limit = compare->sreg1;
+		cond = swap_cond (cond);
+	} else {
+		return FALSE;
+	}
+
+	switch (cond) {
+	case CMP_LT:
+		break;
+	case CMP_LE:
+		cl->is_le = TRUE;
+		break;
+	case CMP_LT_UN:
+		cl->is_unsigned = TRUE;
+		break;
+	default:
+		return FALSE;
+	}
+
+	cl->iv_def = get_basic_iv (cfg, li, cl->iv, OP_IADD_IMM, &cl->iv_def_bb);
+	if (!cl->iv_def || cl->iv_def->inst_imm < 1 || cl->iv_def->inst_imm > MAX_DELTA)
+		return FALSE;
+	/* The increment has to be executed at most once per iteration, after the condition */
+	if (!condition_holds_at (h, cl, cl->iv_def_bb, cl->iv_def))
+		return FALSE;
+
+	/* The last definition of the induction variable before the loop */
+	for (i = 0; i < path->nbbs; ++i) {
+		MONO_BB_FOR_EACH_INS (path->bbs [i], ins) {
+			n = get_defined_vregs (ins, vregs);
+			for (j = 0; j < n; ++j) {
+				if (vregs [j] != cl->iv)
+					continue;
+				cl->has_init = ins->opcode == OP_ICONST;
+				cl->init = ins->inst_c0;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * get_index_delta:
+ *
+ *   Return whenever the index used by the bounds check INS is the induction variable
+ * plus *DELTA, computed in the same bblock.
+ */
+static gboolean
+get_index_delta (CountedLoop *cl, MonoInst *ins, int *delta)
+{
+	MonoInst *cur;
+	int vreg = ins->sreg2;
+	int j, n, vregs [3];
+
+	*delta = 0;
+	for (cur = ins->prev; cur && vreg != cl->iv; cur = cur->prev) {
+		n = get_defined_vregs (cur, vregs);
+		for (j = 0; j < n; ++j) {
+			if (vregs [j] == vreg)
+				break;
+		}
+		if (j == n)
+			continue;
+
+		switch (cur->opcode) {
+		case OP_MOVE:
+		case OP_SEXT_I4:
+			break;
+		case OP_IADD_IMM:
+		case OP_ISUB_IMM:
+			if (cur->inst_imm < -MAX_DELTA || cur->inst_imm > MAX_DELTA)
+				return FALSE;
+			*delta += cur->opcode == OP_IADD_IMM ? cur->inst_imm : -cur->inst_imm;
+			if (*delta < -MAX_DELTA || *delta > MAX_DELTA)
+				return FALSE;
+			break;
+		default:
+			return FALSE;
+		}
+		vreg = cur->sreg1;
+	}
+	return vreg == cl->iv;
+}
+
+/*
+ * get_limit_bound:
+ *
+ *   Return the largest K such that the loop limit is known to be <= the length of ARRAY - K
+ * during the whole loop, or -1.
+ */
+static int
+get_limit_bound (LoopOptData *data, LoopInfo *li, EntryPath *path, CountedLoop *cl, int array, int offset)
+{
+	int base, k, k2, base_array, base_offset;
+
+	if (!resolve_length (data, li, path, cl->limit, &base, &k, &base_array, &base_offset))
+		return -1;
+	if (base_array != -1)
+		return base_array == array && base_offset == offset ? k : -1;
+
+	/* A range check before the loop */
+	k2 = get_checked_bound (data, li, path, base, array, offset, cl->is_unsigned);
+	return k2 == -1 ? -1 : k + k2;
+}
+
+static gboolean
+remove_bounds_check (LoopOptData *data, LoopInfo *li, EntryPath *path, CountedLoop *cl, MonoBasicBlock *bb, MonoInst *ins)
+{
+	MonoCompile *cfg = data->cfg;
+	int array, k, delta, e;
+
+	if (!is_invariant (cfg, li, ins->sreg1) || !get_index_delta (cl, ins, &delta) || !condition_holds_at (li->header, cl, bb, ins))
+		return FALSE;
+	array = get_array_vreg (data, li, path, ins->sreg1);
+	k = get_limit_bound (data, li, path, cl, array, ins->inst_imm);
+	if (k == -1)
+		return FALSE;
+
+	if (cl->is_unsigned) {
+		/* IV <u LIMIT <= LENGTH implies 0 <= IV < LENGTH */
+		if (k != 0 || delta != 0)
+			return FALSE;
+	} else {
+		/*
+		 * IV <= LIMIT - E <= LENGTH - K - E holds at INS, and IV only grows from INIT, since it
+		 * can't overflow while it's incremented by at most K + E.
+		 */
+		e = cl->is_le ? 0 : 1;
+		if (k + e < 1 + delta)
+			return FALSE;
+		if (!cl->has_init || (gint64)cl->init + delta < 0 || cl->iv_def->inst_imm > k + e)
+			return FALSE;
+	}
+
+	if (cfg->verbose_level > 1) {
+		printf ("loop abcrem: removing bounds check in BB%d: ", bb->block_num);
+		mono_print_ins (ins);
+	}
+	NULLIFY_INS (ins);
+	return TRUE;
+}
+
+static gboolean
+remove_bounds_checks_in_loop (LoopOptData *data, MonoBasicBlock *h)
+{
+	LoopInfo li;
+	EntryPath path;
+	CountedLoop cl;
+	gboolean changed = FALSE;
+	GList *l;
+
+	if (!init_loop_info (data, &li, h))
+		return FALSE;
+	get_entry_path (&li, &path);
+	if (!get_counted_loop (data, &li, &path, &cl))
+		return FALSE;
+
+	for (l = h->loop_blocks; l; l = l->next) {
+		MonoBasicBlock *bb = (MonoBasicBlock *)l->data;
+		MonoInst *ins;
+
+		if (!bb->has_array_access)
+			continue;
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			if (ins->opcode == OP_BOUNDS_CHECK)
+				changed |= remove_bounds_check (data, &li, &path, &cl, bb, ins);
+		}
+	}
+	return changed;
+}
+
+/*
+ * mono_loop_bounds_check_removal:
+ *
+ *   Remove the bounds checks in loops which the loop condition makes redundant. This
+ * complements mono_perform_abc_removal (), which runs on the SSA form before the loop
+ * invariant code is moved out of loops, so it can't relate an array loaded from a field
+ * inside the loop to the length in the condition. The condition can compare the induction
+ * variable with the length of the array minus a constant, or with a limit which is checked
+ * against the length before the loop, like in:
+ *
+ *   if (count > this.arr.Length)
+ *       throw new ArgumentException ();
+ *   for (int i = 0; i < count; ++i)
+ *       sum += this.arr [i];
+ *
+ * Return whenever the code changed.
+ */
+gboolean
+mono_loop_bounds_check_removal (MonoCompile *cfg)
+{
+	LoopOptData data;
+	GPtrArray *headers;
+	gboolean changed = FALSE;
+	int i;
+
+	if (!(cfg->comp_done & MONO_COMP_LOOPS) || cfg->gen_sdb_seq_points)
+		return FALSE;
+
+	memset (&data, 0, sizeof (data));
+	data.cfg = cfg;
+	compute_defs (&data);
+
+	headers = get_loop_headers (cfg);
+	for (i = 0; i < headers->len; ++i)
+		changed |= remove_bounds_checks_in_loop (&data, (MonoBasicBlock *)g_ptr_array_index (headers, i));
+	g_ptr_array_free (headers, TRUE);
+
+	return changed;
+}
+
+#endif /* DISABLE_JIT */
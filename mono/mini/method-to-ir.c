@@ -78,6 +78,8 @@
 
 #define BRANCH_COST 10
 #define INLINE_LENGTH_LIMIT 20
+/* Valuetypes without references up to this size are copied and zeroed inline by backends with OP_MEMCPY/OP_MEMSET */
+#define MAX_INLINE_BLOCK_OP_SIZE 256
 
 /* These have 'cfg' as an implicit argument */
 #define INLINE_FAILURE(msg) do {									\
@@ -1965,6 +1967,48 @@ mini_emit_memcpy (MonoCompile *cfg, int destreg, int doffset, int srcreg, int so
 	}
 }
 
+/*
+ * mini_emit_block_op:
+ *
+ *   Copy SIZE bytes from SRCREG to DESTREG, or zero them if SRCREG is -1, using
+ * OP_MEMCPY/OP_MEMSET for the bulk and mini_emit_memcpy/memset () for the remainder.
+ * The backend implements these opcodes using unaligned vector moves, so the data
+ * can't contain object references, they would be invisible to the GC while they are
+ * in a vector register. Return FALSE if the backend doesn't support these opcodes.
+ */
+static gboolean
+mini_emit_block_op (MonoCompile *cfg, int destreg, int srcreg, int size, int align)
+{
+	MonoInst *ins;
+	int offset, block_size;
+
+	if (!cfg->backend->have_inline_block_ops || COMPILE_LLVM (cfg) || size < 32)
+		return FALSE;
+
+	for (offset = 0; offset + 16 <= size; offset += block_size) {
+		/* The size of the native code is linear in the size of the block */
+		block_size = MIN ((size - offset) & ~15, 128);
+
+		MONO_INST_NEW (cfg, ins, srcreg == -1 ? OP_MEMSET : OP_MEMCPY);
+		ins->sreg1 = destreg;
+		ins->inst_offset = offset;
+		ins->sreg2 = srcreg;
+		ins->inst_imm = offset;
+		ins->backend.memcpy_args = (MonoMemcpyArgs *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoMemcpyArgs));
+		ins->backend.memcpy_args->size = block_size;
+		ins->backend.memcpy_args->align = align;
+		MONO_ADD_INS (cfg->cbb, ins);
+	}
+
+	if (offset < size) {
+		if (srcreg == -1)
+			mini_emit_memset (cfg, destreg, offset, size - offset, 0, align);
+		else
+			mini_emit_memcpy (cfg, destreg, offset, srcreg, offset, size - offset, align);
+	}
+	return TRUE;
+}
+
 static void
 emit_tls_set (MonoCompile *cfg, int sreg1, MonoTlsKey tls_key)
 {
@@ -2131,6 +2175,101 @@ emit_instrumentation_call (MonoCompile *cfg, void *func)
 	}
 }
 
+/*
+ * emit_tier0_prologue:
+ *
+ *   Emit the prologue of tier 0 code between START_BB and BODY_BB. If the tier 1 code
+ * is ready, it jumps to it, otherwise it decrements the invocation counter and requests
+ * tier 1 compilation once it reaches zero. See mini-tiered.c.
+ */
+static void
+emit_tier0_prologue (MonoCompile *cfg, MonoBasicBlock *start_bb, MonoBasicBlock *body_bb)
+{
+	MonoMethodSignature *sig = mono_method_signature (cfg->method);
+	MonoBasicBlock *tier_bb, *count_bb, *hot_bb, *tier1_bb;
+	MonoCallInst *call;
+	MonoInst *ins, *iargs [1];
+	int info_reg, state_reg, counter_reg, i, n;
+
+	NEW_BBLOCK (cfg, tier_bb);
+	NEW_BBLOCK (cfg, count_bb);
+	NEW_BBLOCK (cfg, hot_bb);
+	NEW_BBLOCK (cfg, tier1_bb);
+
+	start_bb->next_bb = tier_bb;
+	link_bblock (cfg, start_bb, tier_bb);
+	ADD_BBLOCK (cfg, tier_bb);
+	cfg->cbb = tier_bb;
+
+	info_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_PCONST (cfg, info_reg, cfg->tier_info);
+	state_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, state_reg, info_reg, MONO_STRUCT_OFFSET (MonoTierInfo, state));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, state_reg, MONO_TIER_STATE_READY);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBEQ, tier1_bb);
+
+	/* The counter is updated racily, it only needs to be approximate */
+	MONO_START_BB (cfg, count_bb);
+	counter_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, counter_reg, info_reg, MONO_STRUCT_OFFSET (MonoTierInfo, counter));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, counter_reg, counter_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, info_reg, MONO_STRUCT_OFFSET (MonoTierInfo, counter), counter_reg);
+	if (cfg->pgo_instrument) {
+		int entries_reg = alloc_ireg (cfg);
+		int entries_addr_reg = alloc_preg (cfg);
+
+		MONO_EMIT_NEW_PCONST (cfg, entries_addr_reg, mini_pgo_get_entry_counter (cfg->method));
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, entries_reg, entries_addr_reg, 0);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, entries_reg, entries_reg, 1);
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, entries_addr_reg, 0, entries_reg);
+	}
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, counter_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGT, body_bb);
+
+	MONO_START_BB (cfg, hot_bb);
+	EMIT_NEW_PCONST (cfg, iargs [0], cfg->tier_info);
+	mono_emit_jit_icall (cfg, mono_tiered_request_tier1, iargs);
+	MONO_INST_NEW (cfg, ins, OP_BR);
+	ins->inst_target_bb = body_bb;
+	MONO_ADD_INS (cfg->cbb, ins);
+	link_bblock (cfg, cfg->cbb, body_bb);
+
+	/* Jump to the method itself, the jump is patched to the tier 1 code before the state is set */
+	MONO_START_BB (cfg, tier1_bb);
+	n = sig->param_count + sig->hasthis;
+	MONO_INST_NEW_CALL (cfg, call, OP_TAILCALL);
+	call->method = cfg->method;
+	call->tail_call = TRUE;
+	call->signature = sig;
+	call->args = (MonoInst **)mono_mempool_alloc (cfg->mempool, sizeof (MonoInst*) * n);
+	call->inst.inst_p0 = cfg->method;
+	for (i = 0; i < n; ++i)
+		EMIT_NEW_ARGLOAD (cfg, call->args [i], i);
+	mono_arch_emit_call (cfg, call);
+	cfg->param_area = MAX(cfg->param_area, call->stack_usage);
+	MONO_ADD_INS (cfg->cbb, (MonoInst*)call);
+
+	tier1_bb->next_bb = body_bb;
+}
+
+/*
+ * emit_pgo_call_site_count:
+ *
+ *   Emit code to count the executions of the call at IP, see mini-pgo.c.
+ */
+static void
+emit_pgo_call_site_count (MonoCompile *cfg, const guint8 *ip)
+{
+	int addr_reg, count_reg;
+
+	addr_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, mini_pgo_get_call_site_counter (cfg->method, ip - cfg->cil_start));
+	count_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, count_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, count_reg);
+}
+
 static int
 ret_type_to_call_opcode (MonoCompile *cfg, MonoType *type, int calli, int virt)
 {
@@ -2942,6 +3081,11 @@ mono_emit_method_call_full (MonoCompile *cfg, MonoMethod *method, MonoMethodSign
 	if (rgctx_arg)
 		set_rgctx_arg (cfg, call, rgctx_reg, rgctx_arg);
 
+	/* Direct calls to methods which aren't compiled yet are compiled ahead, see mono_jit_compile_ahead () */
+	if (mono_compile_ahead_threads && !cfg->compile_aot && !cfg->llvm_only && !call->is_virtual && !rgctx_arg &&
+		(call->inst.flags & MONO_INST_HAS_METHOD) && !g_slist_find (cfg->compile_ahead_methods, call->method))
+		cfg->compile_ahead_methods = g_slist_prepend_mempool (cfg->mempool, cfg->compile_ahead_methods, call->method);
+
 	return (MonoInst*)call;
 }
 
@@ -3395,6 +3539,11 @@ mini_emit_stobj (MonoCompile *cfg, MonoInst *dest, MonoInst *src, MonoClass *kla
 		}
 	}
 
+	if (!size_ins && (cfg->opt & MONO_OPT_INTRINS) && (native || !klass->has_references) && n <= MAX_INLINE_BLOCK_OP_SIZE) {
+		if (mini_emit_block_op (cfg, dest->dreg, src->dreg, n, align))
+			return;
+	}
+
 	if (!size_ins && (cfg->opt & MONO_OPT_INTRINS) && n <= sizeof (gpointer) * 8) {
 		/* FIXME: Optimize the case when src/dest is OP_LDADDR */
 		mini_emit_memcpy (cfg, dest->dreg, 0, src->dreg, 0, n, align);
@@ -3455,6 +3604,9 @@ mini_emit_initobj (MonoCompile *cfg, MonoInst *dest, const guchar *ip, MonoClass
 
 	n = mono_class_value_size (klass, &align);
 
+	if (!klass->has_references && n <= MAX_INLINE_BLOCK_OP_SIZE && mini_emit_block_op (cfg, dest->dreg, -1, n, align))
+		return;
+
 	if (n <= sizeof (gpointer) * 8) {
 		mini_emit_memset (cfg, dest->dreg, 0, n, 0, align);
 	}
@@ -4192,6 +4344,33 @@ handle_unbox_gsharedvt (MonoCompile *cfg, MonoClass *klass, MonoInst *obj)
 	return ins;
 }
 
+/*
+ * record_alloc_site:
+ *
+ *   Record that ALLOC allocates an object of KLASS, so mono_escape_analysis () can remove it.
+ * Returns ALLOC.
+ */
+static MonoInst*
+record_alloc_site (MonoCompile *cfg, MonoInst *alloc, MonoClass *klass, MonoVTable *vtable)
+{
+	MonoAllocSite *site;
+
+	if (!(cfg->opt & MONO_OPT_ESCAPE) || COMPILE_LLVM (cfg) || cfg->gen_sdb_seq_points)
+		return alloc;
+	/* Finalizers, remoting and the profiler need to see the object */
+	if (mono_class_has_finalizer (klass) || mono_class_is_marshalbyref (klass) || mono_class_is_contextbound (klass) || klass->delegate)
+		return alloc;
+	if (mono_profiler_events & MONO_PROFILE_ALLOCATIONS)
+		return alloc;
+
+	site = (MonoAllocSite *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoAllocSite));
+	site->ins = alloc;
+	site->klass = klass;
+	site->vtable = cfg->compile_aot ? NULL : vtable;
+	cfg->alloc_sites = g_slist_prepend_mempool (cfg->mempool, cfg->alloc_sites, site);
+	return alloc;
+}
+
 /*
  * Returns NULL and set the cfg exception on error.
  */
@@ -4268,7 +4447,7 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 
 			EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
 			EMIT_NEW_ICONST (cfg, iargs [1], mono_gc_get_aligned_size_for_allocator (size));
-			return mono_emit_method_call (cfg, managed_alloc, iargs, NULL);
+			return record_alloc_site (cfg, mono_emit_method_call (cfg, managed_alloc, iargs, NULL), klass, vtable);
 		}
 		alloc_ftn = mono_class_get_allocation_ftn (vtable, for_box, &pass_lw);
 		if (pass_lw) {
@@ -4280,6 +4459,7 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 		else {
 			EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
 		}
+		return record_alloc_site (cfg, mono_emit_jit_icall (cfg, alloc_ftn, iargs), klass, vtable);
 	}
 
 	return mono_emit_jit_icall (cfg, alloc_ftn, iargs);
@@ -4472,16 +4652,83 @@ icall_is_direct_callable (MonoCompile *cfg, MonoMethod *cmethod)
 
 #define is_complex_isinst(klass) ((klass->flags & TYPE_ATTRIBUTE_INTERFACE) || klass->rank || mono_class_is_nullable (klass) || mono_class_is_marshalbyref (klass) || (klass->flags & TYPE_ATTRIBUTE_SEALED) || klass->byval_arg.type == MONO_TYPE_VAR || klass->byval_arg.type == MONO_TYPE_MVAR)
 
+/*
+ * emit_cast_cache_check:
+ *
+ *   Emit an isinst/castclass check of ARGS [0] against the class ARGS [1] using the call
+ * site cache ARGS [2]. The MONO_CAST_CACHE_ENTRIES entries of the cache are checked inline
+ * against the vtable of the object, so call sites which see a few types don't leave the
+ * method. Misses call mono_marshal_isinst_with_cache (), which fills the cache.
+ */
+static MonoInst*
+emit_cast_cache_check (MonoCompile *cfg, MonoClass *klass, MonoInst **args, gboolean is_castclass)
+{
+	MonoBasicBlock *false_bb, *end_bb;
+	MonoInst *ins, *call;
+	int obj_reg = args [0]->dreg;
+	int cache_reg = args [2]->dreg;
+	int vtable_reg = alloc_preg (cfg);
+	int res_reg = alloc_ireg_ref (cfg);
+	int neg_reg = -1;
+	int i;
+
+	NEW_BBLOCK (cfg, false_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	/* Do the assignment at the beginning, so null objects and cache hits can branch to the end */
+	EMIT_NEW_UNALU (cfg, ins, OP_MOVE, res_reg, obj_reg);
+	ins->type = STACK_OBJ;
+	ins->klass = klass;
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, obj_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, end_bb);
+
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, vtable_reg, obj_reg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	if (!is_castclass) {
+		/* Negative entries have the low bit set, castclass leaves them to the slow path which throws */
+		neg_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PADD_IMM, neg_reg, vtable_reg, 1);
+	}
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		int entry_reg = alloc_preg (cfg);
+
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, entry_reg, cache_reg, i * sizeof (gpointer));
+		MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, entry_reg, vtable_reg);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, end_bb);
+		if (!is_castclass) {
+			MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, entry_reg, neg_reg);
+			MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, false_bb);
+		}
+	}
+
+	call = mono_emit_jit_icall (cfg, mono_marshal_isinst_with_cache, args);
+	if (is_castclass) {
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, call->dreg, 0);
+		MONO_EMIT_NEW_COND_EXC (cfg, EQ, "InvalidCastException");
+	} else {
+		MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, res_reg, call->dreg);
+	}
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	if (!is_castclass) {
+		MONO_START_BB (cfg, false_bb);
+
+		MONO_EMIT_NEW_PCONST (cfg, res_reg, 0);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+	}
+
+	MONO_START_BB (cfg, end_bb);
+
+	return ins;
+}
+
 static MonoInst*
 emit_castclass_with_cache (MonoCompile *cfg, MonoClass *klass, MonoInst **args)
 {
-	MonoMethod *mono_castclass;
 	MonoInst *res;
 
-	mono_castclass = mono_marshal_get_castclass_with_cache ();
-
 	save_cast_details (cfg, klass, args [0]->dreg, TRUE);
-	res = mono_emit_method_call (cfg, mono_castclass, args, NULL);
+	res = emit_cast_cache_check (cfg, klass, args, TRUE);
 	reset_cast_details (cfg);
 
 	return res;
@@ -4511,7 +4758,6 @@ emit_castclass_with_cache_nonshared (MonoCompile *cfg, MonoInst *obj, MonoClass
 	idx = get_castclass_cache_idx (cfg);
 	args [2] = emit_runtime_constant (cfg, MONO_PATCH_INFO_CASTCLASS_CACHE, GINT_TO_POINTER (idx));
 
-	/*The wrapper doesn't inline well so the bloat of inlining doesn't pay off.*/
 	return emit_castclass_with_cache (cfg, klass, args);
 }
 
@@ -4566,8 +4812,8 @@ handle_castclass (MonoCompile *cfg, MonoClass *klass, MonoInst *src, guint8 *ip,
 			/* obj */
 			args [0] = src;
 
-			/* klass - it's the second element of the cache entry*/
-			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer));
+			/* klass - it follows the entries of the cache*/
+			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, MONO_CAST_CACHE_ENTRIES * sizeof (gpointer));
 
 			/* cache */
 			args [2] = cache_ins;
@@ -4641,7 +4887,6 @@ handle_isinst (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context_us
 		MonoInst *args [3];
 
 		if(mini_class_has_reference_variant_generic_argument (cfg, klass, context_used) || is_complex_isinst (klass)) {
-			MonoMethod *mono_isinst = mono_marshal_get_isinst_with_cache ();
 			MonoInst *cache_ins;
 
 			cache_ins = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_CAST_CACHE);
@@ -4649,13 +4894,13 @@ handle_isinst (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context_us
 			/* obj */
 			args [0] = src;
 
-			/* klass - it's the second element of the cache entry*/
-			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer));
+			/* klass - it follows the entries of the cache*/
+			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, MONO_CAST_CACHE_ENTRIES * sizeof (gpointer));
 
 			/* cache */
 			args [2] = cache_ins;
 
-			return mono_emit_method_call (cfg, mono_isinst, args, NULL);
+			return emit_cast_cache_check (cfg, klass, args, FALSE);
 		}
 
 		klass_inst = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_KLASS);
@@ -5289,11 +5534,17 @@ mono_emit_load_got_addr (MonoCompile *cfg)
 static int inline_limit;
 static gboolean inline_limit_inited;
 
+/*
+ * mono_method_check_inlining:
+ *
+ *   Return whenever METHOD can be inlined at the call at IP in cfg->current_method.
+ */
 static gboolean
-mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
+mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method, const guint8 *ip)
 {
 	MonoMethodHeaderSummary header;
 	MonoVTable *vtable;
+	int limit;
 #ifdef MONO_ARCH_SOFT_FLOAT_FALLBACK
 	MonoMethodSignature *sig = mono_method_signature (method);
 	int i;
@@ -5326,7 +5577,11 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 			inline_limit = INLINE_LENGTH_LIMIT;
 		inline_limit_inited = TRUE;
 	}
-	if (header.code_size >= inline_limit && !(method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))
+	limit = inline_limit;
+	/* Refuse cold call sites and allow larger methods at hot ones */
+	if (mono_pgo_inlining && mono_pgo_have_counts)
+		limit = mini_pgo_get_inline_limit (cfg->current_method, ip - cfg->cil_start, header.code_size, limit);
+	if (header.code_size >= limit && !(method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))
 		return FALSE;
 
 	/*
@@ -7696,6 +7951,118 @@ emit_optimized_ldloca_ir (MonoCompile *cfg, unsigned char *ip, unsigned char *en
 	return NULL;
 }
 
+/*
+ * get_guarded_devirt_target:
+ *
+ *   Return the method called by a virtual call to CMETHOD if its receiver is an instance of
+ * the class predicted by mini_cha_get_implementor (), and set OUT_VTABLE to the vtable of
+ * that class. Return NULL if the call can't be devirtualized this way.
+ */
+static MonoMethod*
+get_guarded_devirt_target (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoVTable **out_vtable)
+{
+	MonoClass *klass;
+	MonoVTable *vtable;
+	MonoMethod *target;
+	MonoMethodSignature *target_sig;
+	int slot;
+
+	if (cmethod->klass->valuetype || mono_class_is_marshalbyref (cmethod->klass))
+		return NULL;
+
+	klass = mini_cha_get_implementor (cmethod->klass, cfg->method);
+	/* Valuetype receivers are boxed, their methods expect an unboxed this */
+	if (!klass || klass->valuetype || mono_class_is_marshalbyref (klass) || !klass->vtable)
+		return NULL;
+	vtable = mono_class_try_get_vtable (cfg->domain, klass);
+	if (!vtable)
+		return NULL;
+
+	slot = mono_method_get_vtable_slot (cmethod);
+	if (slot < 0)
+		return NULL;
+	if (MONO_CLASS_IS_INTERFACE (cmethod->klass)) {
+		int offset = mono_class_interface_offset (klass, cmethod->klass);
+
+		if (offset < 0)
+			return NULL;
+		slot += offset;
+	}
+	target = klass->vtable [slot];
+	if (!target || (target->flags & (METHOD_ATTRIBUTE_ABSTRACT | METHOD_ATTRIBUTE_PINVOKE_IMPL)) || target->is_generic)
+		return NULL;
+	if (target->iflags & (METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL | METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED))
+		return NULL;
+	target_sig = mono_method_signature (target);
+	if (!target_sig || !mono_metadata_signature_equal (fsig, target_sig))
+		return NULL;
+	if (mono_method_needs_static_rgctx_invoke (target, TRUE))
+		return NULL;
+
+	*out_vtable = vtable;
+	return target;
+}
+
+/*
+ * emit_guarded_devirt_call:
+ *
+ *   Emit a virtual call to CMETHOD whose receiver is predicted to have VTABLE, see
+ * get_guarded_devirt_target (): the vtable of the receiver is compared with VTABLE, and if
+ * they match, TARGET is called directly or inlined, otherwise a normal virtual call is made.
+ * Set OUT_INS to the result of the call and OUT_COSTS to the inlining costs.
+ */
+static void
+emit_guarded_devirt_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethod *target, MonoVTable *vtable, MonoMethodSignature *fsig,
+						  MonoInst **sp, unsigned char *ip, MonoInst **out_ins, int *out_costs)
+{
+	MonoBasicBlock *miss_bb, *end_bb;
+	MonoInst *ins, *store, *rvar = NULL;
+	MonoInst **args;
+	int vtable_reg, costs = 0;
+
+	if (cfg->verbose_level > 2)
+		printf ("GUARDED DEVIRT %s -> %s\n", mono_method_full_name (cmethod, TRUE), mono_method_full_name (target, TRUE));
+
+	NEW_BBLOCK (cfg, miss_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	if (!MONO_TYPE_IS_VOID (fsig->ret))
+		rvar = mono_compile_create_var (cfg, fsig->ret, OP_LOCAL);
+
+	vtable_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, sp [0]->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, vtable_reg, (gssize)vtable);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, miss_bb);
+
+	/* The receiver is an instance of the predicted class */
+	if ((cfg->opt & MONO_OPT_INLINE) && mono_method_check_inlining (cfg, target, ip)) {
+		/* inline_method () overwrites the arguments with the result */
+		args = (MonoInst **)mono_mempool_alloc (cfg->mempool, sizeof (MonoInst*) * (fsig->param_count + 1));
+		memcpy (args, sp, sizeof (MonoInst*) * (fsig->param_count + 1));
+		costs = inline_method (cfg, target, fsig, args, ip, cfg->real_offset, FALSE);
+		ins = args [0];
+	}
+	if (!costs)
+		ins = mono_emit_method_call_full (cfg, target, fsig, FALSE, sp, NULL, NULL, NULL);
+	if (rvar)
+		EMIT_NEW_TEMPSTORE (cfg, store, rvar->inst_c0, ins);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Some other class */
+	MONO_START_BB (cfg, miss_bb);
+	ins = mono_emit_method_call_full (cfg, cmethod, fsig, FALSE, sp, sp [0], NULL, NULL);
+	if (rvar)
+		EMIT_NEW_TEMPSTORE (cfg, store, rvar->inst_c0, ins);
+
+	MONO_START_BB (cfg, end_bb);
+	ins = NULL;
+	if (rvar)
+		EMIT_NEW_TEMPLOAD (cfg, ins, rvar->inst_c0);
+
+	*out_ins = ins;
+	*out_costs = costs;
+}
+
 static MonoInst*
 emit_llvmonly_virtual_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, int context_used, MonoInst **sp)
 {
@@ -8047,7 +8414,7 @@ handle_ctor_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fs
 		g_assert (MONO_TYPE_IS_VOID (fsig->ret));
 		CHECK_CFG_EXCEPTION;
 	} else if ((cfg->opt & MONO_OPT_INLINE) && cmethod && !context_used && !vtable_arg &&
-			   mono_method_check_inlining (cfg, cmethod) &&
+			   mono_method_check_inlining (cfg, cmethod, ip) &&
 			   !mono_class_is_subclass_of (cmethod->klass, mono_defaults.exception_class, FALSE)) {
 		int costs;
 
@@ -8464,10 +8831,14 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 	NEW_BBLOCK (cfg, init_localsbb);
 	cfg->bb_init = init_localsbb;
 	init_localsbb->real_offset = cfg->real_offset;
-	start_bblock->next_bb = init_localsbb;
 	init_localsbb->next_bb = cfg->cbb;
-	link_bblock (cfg, start_bblock, init_localsbb);
 	link_bblock (cfg, init_localsbb, cfg->cbb);
+	if (cfg->tier0 && cfg->method == method) {
+		emit_tier0_prologue (cfg, start_bblock, init_localsbb);
+	} else {
+		start_bblock->next_bb = init_localsbb;
+		link_bblock (cfg, start_bblock, init_localsbb);
+	}
 		
 	cfg->cbb = init_localsbb;
 
@@ -9212,6 +9583,9 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			CHECK_OPSIZE (5);
 			token = read32 (ip + 1);
 
+			if (cfg->pgo_instrument && method == cfg->method)
+				emit_pgo_call_site_count (cfg, ip);
+
 			ins = NULL;
 
 			cmethod = mini_get_method (cfg, method, token, NULL, generic_context);
@@ -9681,7 +10055,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			/* Inlining */
 			if ((cfg->opt & MONO_OPT_INLINE) &&
 				(!virtual_ || !(cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) || MONO_METHOD_IS_FINAL (cmethod)) &&
-			    mono_method_check_inlining (cfg, cmethod)) {
+			    mono_method_check_inlining (cfg, cmethod, ip)) {
 				int costs;
 				gboolean always = FALSE;
 
@@ -9709,6 +10083,29 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				}
 			}
 
+			/* Guarded devirtualization */
+			if (mono_guarded_devirt && virtual_ && (cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) && !MONO_METHOD_IS_FINAL (cmethod) &&
+				!cfg->compile_aot && !cfg->gshared && !cfg->llvm_only && !cfg->gen_sdb_seq_points && !(cfg->opt & MONO_OPT_SHARED) &&
+				!constrained_class && !imt_arg && !vtable_arg && !pass_imt_from_rgctx && !(ins_flag & MONO_INST_TAILCALL) && !delegate_invoke &&
+				!array_rank && !direct_icall && !fsig->generic_param_count && !MONO_TYPE_ISSTRUCT (fsig->ret)) {
+				MonoMethod *target;
+				MonoVTable *vtable;
+				int costs;
+
+				target = get_guarded_devirt_target (cfg, cmethod, fsig, &vtable);
+				if (target) {
+					/* Methods making a guarded call are not inlined themselves */
+					INLINE_FAILURE ("call");
+					emit_guarded_devirt_call (cfg, cmethod, target, vtable, fsig, sp, ip, &ins, &costs);
+					if (costs) {
+						cfg->real_offset += 5;
+						inline_costs += costs;
+					}
+					CHECK_CFG_EXCEPTION;
+					goto call_end;
+				}
+			}
+
 			/* Tail recursion elimination */
 			if ((cfg->opt & MONO_OPT_TAILC) && call_opcode == CEE_CALL && cmethod == method && ip [5] == CEE_RET && !vtable_arg) {
 				gboolean has_vtargs = FALSE;
@@ -10739,7 +11136,17 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					*sp = mono_emit_jit_icall (cfg, mono_ldstr, iargs);
 					mono_ldstr (cfg->domain, image, mono_metadata_token_index (n));
 				} else {
-					if (cfg->cbb->out_of_line) {
+					MonoString *interned = NULL;
+
+					/* Strings which are already interned can be referenced directly even in out of line code */
+					if (cfg->cbb->out_of_line && !cfg->compile_aot)
+						interned = mono_ldstr_if_interned (cfg->domain, image, mono_metadata_token_index (n));
+
+					if (interned) {
+						EMIT_NEW_PCONST (cfg, ins, interned);
+						ins->type = STACK_OBJ;
+						*sp = ins;
+					} else if (cfg->cbb->out_of_line) {
 						MonoInst *iargs [2];
 
 						if (image == mono_defaults.corlib) {
@@ -10787,6 +11194,10 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 			CHECK_OPSIZE (5);
 			token = read32 (ip + 1);
+
+			if (cfg->pgo_instrument && method == cfg->method)
+				emit_pgo_call_site_count (cfg, ip);
+
 			cmethod = mini_get_method (cfg, method, token, NULL, generic_context);
 			CHECK_CFG_ERROR;
 
@@ -10981,7 +11392,6 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			context_used = mini_class_check_context_used (cfg, klass);
 
 			if (!context_used && mini_class_has_reference_variant_generic_argument (cfg, klass, context_used)) {
-				MonoMethod *mono_isinst = mono_marshal_get_isinst_with_cache ();
 				MonoInst *args [3];
 				int idx;
 
@@ -10995,7 +11405,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				idx = get_castclass_cache_idx (cfg);
 				args [2] = emit_runtime_constant (cfg, MONO_PATCH_INFO_CASTCLASS_CACHE, GINT_TO_POINTER (idx));
 
-				*sp++ = mono_emit_method_call (cfg, mono_isinst, args, NULL);
+				*sp++ = emit_cast_cache_check (cfg, klass, args, FALSE);
 				ip += 5;
 				inline_costs += 2;
 			} else if (!context_used && (mono_class_is_marshalbyref (klass) || klass->flags & TYPE_ATTRIBUTE_INTERFACE)) {
@@ -1502,6 +1502,12 @@ mono_arch_cpu_enumerate_simd_versions (void)
 	if (mono_hwcap_x86_has_sse4a)
 		sse_opts |= SIMD_VERSION_SSE4a;
 
+	if (mono_hwcap_x86_has_avx)
+		sse_opts |= SIMD_VERSION_AVX;
+
+	if (mono_hwcap_x86_has_avx2)
+		sse_opts |= SIMD_VERSION_AVX2;
+
 	return sse_opts;
 }
 
@@ -3893,6 +3899,221 @@ emit_setup_lmf (MonoCompile *cfg, guint8 *code, gint32 lmf_offset, int cfa_offse
 #define bb_is_loop_start(bb) ((bb)->loop_body_start && (bb)->nesting)
 
 #ifndef DISABLE_JIT
+#ifdef MONO_ARCH_SIMD_INTRINSICS
+/* The 128 bit SSE binary ops which have a 256 bit form, see OP_XBINOP_256 */
+static guint8*
+emit_sse_binop (guint8 *code, int opcode, int dreg, int sreg)
+{
+	switch (opcode) {
+	case OP_ADDPS:
+		amd64_sse_addps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_SUBPS:
+		amd64_sse_subps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_MULPS:
+		amd64_sse_mulps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_DIVPS:
+		amd64_sse_divps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_ANDPS:
+		amd64_sse_andps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_ORPS:
+		amd64_sse_orps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_XORPS:
+		amd64_sse_xorps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_MAXPS:
+		amd64_sse_maxps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_MINPS:
+		amd64_sse_minps_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PADDD:
+		amd64_sse_paddd_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PSUBD:
+		amd64_sse_psubd_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PMULD:
+		amd64_sse_pmulld_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PAND:
+		amd64_sse_pand_reg_reg (code, dreg, sreg);
+		break;
+	case OP_POR:
+		amd64_sse_por_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PXOR:
+		amd64_sse_pxor_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PCMPEQD:
+		amd64_sse_pcmpeqd_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PCMPGTD:
+		amd64_sse_pcmpgtd_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PMAXD:
+		amd64_sse_pmaxsd_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PMIND:
+		amd64_sse_pminsd_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PADDB:
+		amd64_sse_paddb_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PSUBB:
+		amd64_sse_psubb_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PADDB_SAT_UN:
+		amd64_sse_paddusb_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PSUBB_SAT_UN:
+		amd64_sse_psubusb_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PAVGB_UN:
+		amd64_sse_pavgb_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PMAXB_UN:
+		amd64_sse_pmaxub_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PMINB_UN:
+		amd64_sse_pminub_reg_reg (code, dreg, sreg);
+		break;
+	case OP_PCMPEQB:
+		amd64_sse_pcmpeqb_reg_reg (code, dreg, sreg);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+	return code;
+}
+
+/* The ymm forms of the ops handled by emit_sse_binop () */
+static guint8*
+emit_vex_binop_membase (guint8 *code, int opcode, int dreg, int sreg1, int basereg, int disp)
+{
+	switch (opcode) {
+	case OP_ADDPS:
+		amd64_vaddps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_SUBPS:
+		amd64_vsubps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_MULPS:
+		amd64_vmulps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_DIVPS:
+		amd64_vdivps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_ANDPS:
+		amd64_vandps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_ORPS:
+		amd64_vorps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_XORPS:
+		amd64_vxorps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_MAXPS:
+		amd64_vmaxps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_MINPS:
+		amd64_vminps_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PADDD:
+		amd64_vpaddd_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PSUBD:
+		amd64_vpsubd_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PMULD:
+		amd64_vpmulld_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PAND:
+		amd64_vpand_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_POR:
+		amd64_vpor_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PXOR:
+		amd64_vpxor_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PCMPEQD:
+		amd64_vpcmpeqd_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PCMPGTD:
+		amd64_vpcmpgtd_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PMAXD:
+		amd64_vpmaxsd_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PMIND:
+		amd64_vpminsd_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PADDB:
+		amd64_vpaddb_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PSUBB:
+		amd64_vpsubb_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PADDB_SAT_UN:
+		amd64_vpaddusb_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PSUBB_SAT_UN:
+		amd64_vpsubusb_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PAVGB_UN:
+		amd64_vpavgb_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PMAXB_UN:
+		amd64_vpmaxub_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PMINB_UN:
+		amd64_vpminub_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	case OP_PCMPEQB:
+		amd64_vpcmpeqb_reg_reg_membase (code, dreg, sreg1, basereg, disp, 1);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+	return code;
+}
+
+/*
+ * emit_xbinop_256:
+ *
+ *   Emit the code of an OP_XBINOP_256. The ymm form loads the left operand into the fp
+ * scratch reg and takes the right operand from memory. Otherwise the operands are processed
+ * in two 128 bit halves, using DREG as the second register.
+ */
+static guint8*
+emit_xbinop_256 (guint8 *code, MonoInst *ins)
+{
+	int offset;
+
+	if (ins->inst_c1) {
+		amd64_vmovdqu_reg_membase (code, MONO_ARCH_FP_SCRATCH_REG, ins->sreg2, 0, 1);
+		code = emit_vex_binop_membase (code, ins->inst_c0, MONO_ARCH_FP_SCRATCH_REG, MONO_ARCH_FP_SCRATCH_REG, ins->sreg3, 0);
+		amd64_vmovdqu_membase_reg (code, ins->sreg1, 0, MONO_ARCH_FP_SCRATCH_REG, 1);
+		amd64_vzeroupper (code);
+		return code;
+	}
+
+	for (offset = 0; offset < 32; offset += 16) {
+		amd64_sse_movups_reg_membase (code, MONO_ARCH_FP_SCRATCH_REG, ins->sreg2, offset);
+		amd64_sse_movups_reg_membase (code, ins->dreg, ins->sreg3, offset);
+		code = emit_sse_binop (code, ins->inst_c0, MONO_ARCH_FP_SCRATCH_REG, ins->dreg);
+		amd64_sse_movups_membase_reg (code, ins->sreg1, offset, MONO_ARCH_FP_SCRATCH_REG);
+	}
+	return code;
+}
+#endif
+
 void
 mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 {
@@ -5116,6 +5337,37 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 				amd64_alu_reg_imm (code, X86_ADD, ins->dreg, cfg->param_area);
 			break;
 		}
+		case OP_MEMCPY:
+		case OP_MEMSET: {
+			int size = ins->backend.memcpy_args->size;
+			int offset, step;
+			/* AOT code can run on other cpus */
+			gboolean use_avx = mono_hwcap_x86_has_avx && !cfg->compile_aot;
+
+			/* The fp scratch reg is never allocated, so it can hold the data, the size is a multiple of 16 */
+			if (ins->opcode == OP_MEMSET) {
+				if (use_avx)
+					amd64_vxorps_reg_reg_reg (code, MONO_ARCH_FP_SCRATCH_REG, MONO_ARCH_FP_SCRATCH_REG, MONO_ARCH_FP_SCRATCH_REG, 1);
+				else
+					amd64_sse_xorps_reg_reg (code, MONO_ARCH_FP_SCRATCH_REG, MONO_ARCH_FP_SCRATCH_REG);
+			}
+			for (offset = 0; offset < size; offset += step) {
+				step = use_avx && offset + 32 <= size ? 32 : 16;
+				if (use_avx) {
+					/* The 128 bit tail is VEX encoded too, mixing 256 bit AVX and legacy SSE code is slow */
+					if (ins->opcode == OP_MEMCPY)
+						amd64_vmovdqu_reg_membase (code, MONO_ARCH_FP_SCRATCH_REG, ins->sreg2, ins->inst_imm + offset, step == 32);
+					amd64_vmovdqu_membase_reg (code, ins->sreg1, ins->inst_offset + offset, MONO_ARCH_FP_SCRATCH_REG, step == 32);
+				} else {
+					if (ins->opcode == OP_MEMCPY)
+						amd64_sse_movups_reg_membase (code, MONO_ARCH_FP_SCRATCH_REG, ins->sreg2, ins->inst_imm + offset);
+					amd64_sse_movups_membase_reg (code, ins->sreg1, ins->inst_offset + offset, MONO_ARCH_FP_SCRATCH_REG);
+				}
+			}
+			if (use_avx)
+				amd64_vzeroupper (code);
+			break;
+		}
 		case OP_THROW: {
 			amd64_mov_reg_reg (code, AMD64_ARG_REG1, ins->sreg1, 8);
 			code = emit_call (cfg, code, MONO_PATCH_INFO_INTERNAL_METHOD, 
@@ -6099,6 +6351,9 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 		}
 #ifdef MONO_ARCH_SIMD_INTRINSICS
 		/* TODO: Some of these IR opcodes are marked as no clobber when they indeed do. */
+		case OP_XBINOP_256:
+			code = emit_xbinop_256 (code, ins);
+			break;
 		case OP_ADDPS:
 			amd64_sse_addps_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
@@ -0,0 +1,223 @@
+/*
+ * mini-cha.c: Class hierarchy analysis for guarded devirtualization
+ *
+ * When guarded devirtualization is enabled (--guarded-devirt), the runtime keeps track of
+ * the concrete classes which have a vtable, and for every class and interface, whenever it
+ * has exactly one concrete subclass or implementor. The JIT uses this to predict the
+ * receiver of virtual and interface calls, see emit_guarded_devirt_call () in
+ * method-to-ir.c: it emits a compare of the vtable of the receiver with the vtable of the
+ * predicted class, followed by a direct, possibly inlined call to the method the class
+ * implements, with the normal virtual call as the fallback.
+ *
+ * The code stays correct when a second implementor is loaded since the guard fails for its
+ * instances, but every call from then on might take the slow path. So the methods which
+ * were compiled with a prediction are recorded, and with --tiered, their tier 1 code is
+ * recompiled when the prediction no longer holds.
+ *
+ * Copyright 2016 Xamarin, Inc (http://www.xamarin.com)
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "mini.h"
+
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-counters.h>
+
+gboolean mono_guarded_devirt;
+
+#ifndef DISABLE_JIT
+
+/* Stored in the implementors table for classes with more than one concrete subclass */
+#define MULTIPLE_IMPLEMENTORS ((MonoClass*)GINT_TO_POINTER (-1))
+
+static MonoCoopMutex cha_mutex;
+/* Maps classes and interfaces to their only concrete subclass or implementor */
+static GHashTable *implementors;
+/* Maps classes and interfaces to the set of methods compiled assuming they have one implementor */
+static GHashTable *dependents;
+/* Maps the methods in the sets above to a GSList of the classes they are recorded for */
+static GHashTable *dependencies;
+
+static gint32 cha_predictions, cha_invalidations;
+
+void
+mini_cha_init (void)
+{
+	if (!mono_guarded_devirt)
+		return;
+
+	mono_coop_mutex_init (&cha_mutex);
+	implementors = g_hash_table_new (NULL, NULL);
+	dependents = g_hash_table_new (NULL, NULL);
+	dependencies = g_hash_table_new (NULL, NULL);
+
+	mono_counters_register ("CHA predictions", MONO_COUNTER_JIT | MONO_COUNTER_INT, &cha_predictions);
+	mono_counters_register ("CHA invalidations", MONO_COUNTER_JIT | MONO_COUNTER_INT, &cha_invalidations);
+}
+
+/*
+ * add_implementor:
+ *
+ *   Record that KLASS derives from or implements PARENT. Return the methods which need to
+ * be recompiled, if this invalidates a prediction.
+ * LOCKING: Called with cha_mutex held.
+ */
+static GSList*
+add_implementor (MonoClass *parent, MonoClass *klass, GSList *invalidated)
+{
+	MonoClass *cur = (MonoClass *)g_hash_table_lookup (implementors, parent);
+	GHashTable *deps;
+	GHashTableIter iter;
+	MonoMethod *method;
+
+	if (cur == klass || cur == MULTIPLE_IMPLEMENTORS)
+		return invalidated;
+	if (!cur) {
+		g_hash_table_insert (implementors, parent, klass);
+		return invalidated;
+	}
+
+	g_hash_table_insert (implementors, parent, MULTIPLE_IMPLEMENTORS);
+	deps = (GHashTable *)g_hash_table_lookup (dependents, parent);
+	if (deps) {
+		/* The entries of PARENT in the dependencies lists are dropped by remove_dependent () */
+		g_hash_table_remove (dependents, parent);
+		g_hash_table_iter_init (&iter, deps);
+		while (g_hash_table_iter_next (&iter, (gpointer *)&method, NULL))
+			invalidated = g_slist_prepend (invalidated, method);
+		g_hash_table_destroy (deps);
+		InterlockedIncrement (&cha_invalidations);
+	}
+	return invalidated;
+}
+
+/*
+ * add_dependent:
+ *
+ *   Record that METHOD was compiled assuming KLASS has one implementor.
+ * LOCKING: Called with cha_mutex held.
+ */
+static void
+add_dependent (MonoClass *klass, MonoMethod *method)
+{
+	GHashTable *deps = (GHashTable *)g_hash_table_lookup (dependents, klass);
+
+	if (!deps) {
+		deps = g_hash_table_new (NULL, NULL);
+		g_hash_table_insert (dependents, klass, deps);
+	} else if (g_hash_table_lookup (deps, method)) {
+		return;
+	}
+	g_hash_table_insert (deps, method, method);
+	g_hash_table_insert (dependencies, method, g_slist_prepend ((GSList *)g_hash_table_lookup (dependencies, method), klass));
+}
+
+/*
+ * mini_cha_vtable_created:
+ *
+ *   Called by the runtime after VTABLE is created.
+ */
+void
+mini_cha_vtable_created (MonoVTable *vtable)
+{
+	MonoClass *klass = vtable->klass;
+	MonoClass *parent;
+	GSList *invalidated = NULL, *l;
+	int i;
+
+	if (!mono_guarded_devirt)
+		return;
+	/* Only instances of concrete classes can be receivers */
+	if (MONO_CLASS_IS_INTERFACE (klass) || (klass->flags & TYPE_ATTRIBUTE_ABSTRACT))
+		return;
+
+	mono_coop_mutex_lock (&cha_mutex);
+	for (parent = klass; parent; parent = parent->parent)
+		invalidated = add_implementor (parent, klass, invalidated);
+	for (i = 0; i < klass->interface_offsets_count; ++i)
+		invalidated = add_implementor (klass->interfaces_packed [i], klass, invalidated);
+	mono_coop_mutex_unlock (&cha_mutex);
+
+	for (l = invalidated; l; l = l->next)
+		mini_tiered_recompile ((MonoMethod *)l->data);
+	g_slist_free (invalidated);
+}
+
+/*
+ * mini_cha_get_implementor:
+ *
+ *   Return the only concrete class deriving from or implementing KLASS which has a vtable,
+ * or NULL if there is none or more than one. DEPENDENT is the method compiled using the
+ * result, it is recompiled if another implementor is loaded later.
+ */
+MonoClass*
+mini_cha_get_implementor (MonoClass *klass, MonoMethod *dependent)
+{
+	MonoClass *res;
+
+	if (!mono_guarded_devirt)
+		return NULL;
+
+	mono_coop_mutex_lock (&cha_mutex);
+	res = (MonoClass *)g_hash_table_lookup (implementors, klass);
+	if (res == MULTIPLE_IMPLEMENTORS) {
+		res = NULL;
+	} else if (res && mono_tiered_compilation) {
+		/* Only tier 1 code can be replaced */
+		add_dependent (klass, dependent);
+	}
+	mono_coop_mutex_unlock (&cha_mutex);
+
+	if (res)
+		InterlockedIncrement (&cha_predictions);
+	return res;
+}
+
+/*
+ * mini_cha_remove_dependent:
+ *
+ *   Forget the predictions METHOD was compiled with. Called before METHOD is recompiled,
+ * which records the predictions it still makes again, and when METHOD is freed.
+ */
+void
+mini_cha_remove_dependent (MonoMethod *method)
+{
+	GSList *classes, *l;
+	GHashTable *deps;
+
+	if (!mono_guarded_devirt)
+		return;
+
+	mono_coop_mutex_lock (&cha_mutex);
+	classes = (GSList *)g_hash_table_lookup (dependencies, method);
+	if (classes) {
+		g_hash_table_remove (dependencies, method);
+		for (l = classes; l; l = l->next) {
+			/* The set is gone if the prediction was invalidated */
+			deps = (GHashTable *)g_hash_table_lookup (dependents, l->data);
+			if (deps)
+				g_hash_table_remove (deps, method);
+		}
+		g_slist_free (classes);
+	}
+	mono_coop_mutex_unlock (&cha_mutex);
+}
+
+#else /* DISABLE_JIT */
+
+void
+mini_cha_init (void)
+{
+}
+
+void
+mini_cha_vtable_created (MonoVTable *vtable)
+{
+}
+
+void
+mini_cha_remove_dependent (MonoMethod *method)
+{
+}
+
+#endif /* DISABLE_JIT */
@@ -880,9 +880,9 @@ class_type_info (MonoDomain *domain, MonoClass *klass, MonoRgctxInfoType info_ty
 		return vtable;
 	}
 	case MONO_RGCTX_INFO_CAST_CACHE: {
-		/*First slot is the cache itself, the second the vtable.*/
-		gpointer **cache_data = (gpointer **)mono_domain_alloc0 (domain, sizeof (gpointer) * 2);
-		cache_data [1] = (gpointer *)klass;
+		/*The first MONO_CAST_CACHE_ENTRIES slots are the cache itself, the next one the class.*/
+		gpointer **cache_data = (gpointer **)mono_domain_alloc0 (domain, sizeof (gpointer) * (MONO_CAST_CACHE_ENTRIES + 1));
+		cache_data [MONO_CAST_CACHE_ENTRIES] = (gpointer *)klass;
 		return cache_data;
 	}
 	case MONO_RGCTX_INFO_ARRAY_ELEMENT_SIZE:
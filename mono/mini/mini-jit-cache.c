@@ -0,0 +1,444 @@
+/*
+ * mini-jit-cache.c: Persistent cache of JITted code
+ *
+ * When the JIT cache is enabled (--jit-cache), the runtime records the methods it JITs.
+ * At shutdown, the methods recorded for each assembly are added to a list kept in the cache
+ * directory. If the list changed, a detached child process AOT compiles the assembly with
+ * only the methods in the list, using the methods-file AOT option, so the compilation
+ * doesn't hold up the shutdown or run next to the threads still running in it. On the next
+ * start, load_aot_module () in aot-runtime.c loads the
+ * cached image if the assembly has no other AOT image, so those methods don't need to be
+ * JITted again.
+ *
+ * JITted code can't be written out as it is, since it embeds the addresses of runtime data
+ * structures without recording them as patches, so the methods are recompiled by the AOT
+ * compiler, which emits relocatable code.
+ *
+ * The cached files are named after the MVID of the assembly, and the AOT loader checks the
+ * MVIDs of the assemblies the image was compiled against before using it, so images which
+ * are out of date are ignored, and replaced at the next shutdown.
+ *
+ * Only one compilation runs for an image at a time, it creates a marker file which it removes
+ * when it exits. When the list changes while it runs, a pending file is left behind, so the
+ * image is compiled again by the next process which shuts down.
+ *
+ * Copyright 2016 Xamarin, Inc (http://www.xamarin.com)
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "mini.h"
+
+#include <errno.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifndef HOST_WIN32
+#include <fcntl.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
+#include <mono/metadata/assembly.h>
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-dl.h>
+#include <mono/utils/mono-logger-internals.h>
+
+gboolean mono_jit_cache_enabled;
+char *mono_jit_cache_dir;
+
+#if !defined(DISABLE_JIT) && !defined(DISABLE_AOT)
+
+static MonoCoopMutex jit_cache_mutex;
+/* The images which have no AOT image besides the cached one */
+static GHashTable *cached_images;
+/* Maps images to a hash table of the tokens of their JITted methods */
+static GHashTable *jitted_methods;
+
+static gint32 jit_cache_methods_recorded;
+
+/* Markers older than this were left behind by compilations which didn't finish */
+#define STALE_MARKER_SECONDS (60 * 60)
+
+void
+mini_jit_cache_init (void)
+{
+	if (!mono_jit_cache_enabled)
+		return;
+
+	if (!mono_jit_cache_dir) {
+		const char *home = g_get_home_dir ();
+
+		if (!home) {
+			mono_jit_cache_enabled = FALSE;
+			return;
+		}
+		mono_jit_cache_dir = g_build_filename (home, ".cache", "mono", "jit-cache", NULL);
+	}
+	if (!g_file_test (mono_jit_cache_dir, G_FILE_TEST_IS_DIR) && g_mkdir_with_parents (mono_jit_cache_dir, 0777) != 0) {
+		g_warning ("Could not create the JIT cache directory '%s': %s", mono_jit_cache_dir, g_strerror (errno));
+		mono_jit_cache_enabled = FALSE;
+		return;
+	}
+
+	mono_coop_mutex_init (&jit_cache_mutex);
+	cached_images = g_hash_table_new (NULL, NULL);
+	jitted_methods = g_hash_table_new (NULL, NULL);
+
+	mono_counters_register ("Methods recorded in the JIT cache", MONO_COUNTER_JIT | MONO_COUNTER_INT, &jit_cache_methods_recorded);
+}
+
+static char*
+get_cache_file_name (MonoImage *image, const char *suffix)
+{
+	char *name, *res;
+
+	name = g_strdup_printf ("%s-%s%s", image->assembly_name, image->guid, suffix);
+	res = g_build_filename (mono_jit_cache_dir, name, NULL);
+	g_free (name);
+	return res;
+}
+
+/*
+ * mini_jit_cache_get_image_name:
+ *
+ *   Return the file name of the cached AOT image of ASSEMBLY. This is called by the AOT
+ * loader if ASSEMBLY has no other AOT image, only the methods of those assemblies are
+ * recorded.
+ */
+char*
+mini_jit_cache_get_image_name (MonoAssembly *assembly)
+{
+	g_assert (mono_jit_cache_enabled);
+
+	mono_coop_mutex_lock (&jit_cache_mutex);
+	g_hash_table_insert (cached_images, assembly->image, assembly->image);
+	mono_coop_mutex_unlock (&jit_cache_mutex);
+
+	return get_cache_file_name (assembly->image, MONO_SOLIB_EXT);
+}
+
+/*
+ * mini_jit_cache_add_method:
+ *
+ *   Record that METHOD was JITted, so it is compiled into the cached image of its assembly.
+ */
+void
+mini_jit_cache_add_method (MonoMethod *method)
+{
+	MonoImage *image = method->klass->image;
+	GHashTable *tokens;
+
+	if (!mono_jit_cache_enabled)
+		return;
+	/* The AOT compiler is only asked for the methods in the method table of the assembly */
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->is_inflated || method->is_generic || method->dynamic)
+		return;
+	if (image_is_dynamic (image) || !image->assembly || image->assembly->ref_only)
+		return;
+	if (mono_metadata_token_table (method->token) != MONO_TABLE_METHOD)
+		return;
+
+	mono_coop_mutex_lock (&jit_cache_mutex);
+	if (!g_hash_table_lookup (cached_images, image)) {
+		mono_coop_mutex_unlock (&jit_cache_mutex);
+		return;
+	}
+	tokens = (GHashTable *)g_hash_table_lookup (jitted_methods, image);
+	if (!tokens) {
+		tokens = g_hash_table_new (NULL, NULL);
+		g_hash_table_insert (jitted_methods, image, tokens);
+	}
+	if (!g_hash_table_lookup (tokens, GUINT_TO_POINTER (method->token))) {
+		g_hash_table_insert (tokens, GUINT_TO_POINTER (method->token), GUINT_TO_POINTER (method->token));
+		jit_cache_methods_recorded ++;
+	}
+	mono_coop_mutex_unlock (&jit_cache_mutex);
+}
+
+/*
+ * lock_cache_file:
+ *
+ *   Take an exclusive lock on FNAME, so processes which shut down at the same time don't
+ * lose each other's updates of the method list. Return the fd to pass to unlock_cache_file (),
+ * or -1 if the lock couldn't be taken.
+ */
+static int
+lock_cache_file (const char *fname)
+{
+#ifndef HOST_WIN32
+	int fd = open (fname, O_RDWR | O_CREAT, 0666);
+
+	if (fd == -1)
+		return -1;
+	while (flock (fd, LOCK_EX) == -1) {
+		if (errno != EINTR) {
+			close (fd);
+			return -1;
+		}
+	}
+	return fd;
+#else
+	return -1;
+#endif
+}
+
+static void
+unlock_cache_file (int fd)
+{
+#ifndef HOST_WIN32
+	flock (fd, LOCK_UN);
+	close (fd);
+#endif
+}
+
+/*
+ * update_method_list:
+ *
+ *   Add the tokens in TOKENS to the method list in FNAME. Return whenever the list changed.
+ * The lock file of the list must be held.
+ */
+static gboolean
+update_method_list (const char *fname, GHashTable *tokens)
+{
+	GHashTable *all = g_hash_table_new (NULL, NULL);
+	GHashTableIter iter;
+	gpointer key;
+	gboolean changed = FALSE;
+	char line [64];
+	char *tmp_fname;
+	FILE *f;
+
+	f = fopen (fname, "r");
+	if (f) {
+		while (fgets (line, sizeof (line), f)) {
+			guint32 token;
+
+			if (line [0] != '#' && sscanf (line, "%x", &token) == 1)
+				g_hash_table_insert (all, GUINT_TO_POINTER (token), GUINT_TO_POINTER (token));
+		}
+		fclose (f);
+	}
+
+	g_hash_table_iter_init (&iter, tokens);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		if (!g_hash_table_lookup (all, key)) {
+			g_hash_table_insert (all, key, key);
+			changed = TRUE;
+		}
+	}
+
+	if (changed) {
+		/* A compilation started by another process might be reading the old list */
+		tmp_fname = g_strdup_printf ("%s.%d", fname, getpid ());
+		f = fopen (tmp_fname, "w");
+		if (f) {
+			fprintf (f, "# Tokens of the methods to compile into the cached image\n");
+			g_hash_table_iter_init (&iter, all);
+			while (g_hash_table_iter_next (&iter, &key, NULL))
+				fprintf (f, "0x%08x\n", GPOINTER_TO_UINT (key));
+			if (fclose (f) != 0 || rename (tmp_fname, fname) != 0) {
+				unlink (tmp_fname);
+				changed = FALSE;
+			}
+		} else {
+			changed = FALSE;
+		}
+		g_free (tmp_fname);
+	}
+
+	g_hash_table_destroy (all);
+	return changed;
+}
+
+/*
+ * create_marker:
+ *
+ *   Create the marker file FNAME of the compilation of an image. Return FALSE if another
+ * process already created it.
+ */
+static gboolean
+create_marker (const char *fname)
+{
+#ifndef HOST_WIN32
+	struct stat st;
+	int fd;
+
+	fd = open (fname, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	if (fd == -1 && errno == EEXIST && stat (fname, &st) == 0 && time (NULL) - st.st_mtime > STALE_MARKER_SECONDS) {
+		/* The compilation was killed */
+		unlink (fname);
+		fd = open (fname, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	}
+	if (fd == -1)
+		return FALSE;
+	close (fd);
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/*
+ * spawn_compiler:
+ *
+ *   Start a detached child process which AOT compiles IMAGE with the methods in LIST_FNAME
+ * into IMAGE_FNAME, or creates FAILURE_FNAME if that fails, and removes MARKER_FNAME when it
+ * is done. Other processes might be loading the old image, so it is replaced atomically.
+ * Return FALSE if the process couldn't be started.
+ */
+static gboolean
+spawn_compiler (MonoImage *image, const char *image_fname, const char *list_fname, const char *failure_fname, const char *marker_fname)
+{
+#ifndef HOST_WIN32
+	char mono_path [4096];
+	char *tmp_fname, *aot_option;
+	char *argv [11];
+	GError *gerror = NULL;
+	gboolean res = TRUE;
+	int len;
+
+	len = mono_dl_get_executable_path (mono_path, sizeof (mono_path));
+	if (len <= 0) {
+		mono_trace (G_LOG_LEVEL_MESSAGE, MONO_TRACE_AOT, "JIT cache: can't find the runtime executable to compile '%s'.", image->name);
+		return FALSE;
+	}
+	mono_path [len] = '\0';
+
+	tmp_fname = g_strdup_printf ("%s.%d", image_fname, getpid ());
+	aot_option = g_strdup_printf ("--aot=outfile=%s,methods-file=%s,internal-logfile=%s.log", tmp_fname, list_fname, image_fname);
+
+	argv [0] = (char*)"/bin/sh";
+	argv [1] = (char*)"-c";
+	argv [2] = (char*)"\"$0\" \"$1\" \"$2\" > /dev/null 2>&1 && mv -f \"$3\" \"$4\" || { rm -f \"$3\"; : > \"$5\"; }; rm -f \"$6\"";
+	argv [3] = mono_path;
+	argv [4] = aot_option;
+	argv [5] = image->name;
+	argv [6] = tmp_fname;
+	argv [7] = (char*)image_fname;
+	argv [8] = (char*)failure_fname;
+	argv [9] = (char*)marker_fname;
+	argv [10] = NULL;
+
+	mono_trace (G_LOG_LEVEL_MESSAGE, MONO_TRACE_AOT, "JIT cache: compiling assembly '%s' to '%s'.", image->name, image_fname);
+	if (!g_spawn_async_with_pipes (NULL, argv, NULL, (GSpawnFlags)(G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL), NULL, NULL, NULL, NULL, NULL, NULL, &gerror)) {
+		mono_trace (G_LOG_LEVEL_MESSAGE, MONO_TRACE_AOT, "JIT cache: failed to start the compiler: %s", gerror->message);
+		g_error_free (gerror);
+		res = FALSE;
+	}
+
+	g_free (aot_option);
+	g_free (tmp_fname);
+	return res;
+#else
+	return FALSE;
+#endif
+}
+
+static void
+compile_image (MonoImage *image, GHashTable *tokens)
+{
+	char *image_fname, *list_fname, *lock_fname, *failure_fname, *marker_fname, *pending_fname;
+	gboolean changed;
+	int lock_fd;
+
+	image_fname = get_cache_file_name (image, MONO_SOLIB_EXT);
+	list_fname = get_cache_file_name (image, ".methods");
+	lock_fname = get_cache_file_name (image, ".lock");
+	failure_fname = get_cache_file_name (image, ".failure");
+	marker_fname = get_cache_file_name (image, ".compiling");
+	pending_fname = get_cache_file_name (image, ".pending");
+
+	/* Don't retry assemblies the AOT compiler failed on */
+	if (g_file_test (failure_fname, G_FILE_TEST_EXISTS))
+		goto done;
+
+	lock_fd = lock_cache_file (lock_fname);
+	if (lock_fd == -1)
+		goto done;
+	changed = update_method_list (list_fname, tokens);
+
+	/* The cached image also needs to be replaced if it was missing or out of date */
+	if (changed || !image->aot_module)
+		g_file_set_contents (pending_fname, "", 0, NULL);
+
+	/*
+	 * The pending file is removed before the compiler reads the list, so if the list changes
+	 * while it runs, the file is created again and the image compiled again later.
+	 */
+	if (g_file_test (pending_fname, G_FILE_TEST_EXISTS) && create_marker (marker_fname)) {
+		unlink (pending_fname);
+		if (!spawn_compiler (image, image_fname, list_fname, failure_fname, marker_fname)) {
+			g_file_set_contents (pending_fname, "", 0, NULL);
+			unlink (marker_fname);
+		}
+	}
+	unlock_cache_file (lock_fd);
+
+done:
+	g_free (image_fname);
+	g_free (list_fname);
+	g_free (lock_fname);
+	g_free (failure_fname);
+	g_free (marker_fname);
+	g_free (pending_fname);
+}
+
+/*
+ * mini_jit_cache_cleanup:
+ *
+ *   Record the methods JITted by this process in the method lists of the cached images,
+ * and start the compilation of the images whose list changed. This is called before the
+ * runtime shuts down.
+ */
+void
+mini_jit_cache_cleanup (void)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GHashTable *to_compile;
+
+	if (!mono_jit_cache_enabled)
+		return;
+
+	mono_coop_mutex_lock (&jit_cache_mutex);
+	to_compile = jitted_methods;
+	jitted_methods = g_hash_table_new (NULL, NULL);
+	mono_coop_mutex_unlock (&jit_cache_mutex);
+
+	mono_jit_cache_enabled = FALSE;
+
+	g_hash_table_iter_init (&iter, to_compile);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		compile_image ((MonoImage *)key, (GHashTable *)value);
+		g_hash_table_destroy ((GHashTable *)value);
+	}
+	g_hash_table_destroy (to_compile);
+}
+
+#else
+
+void
+mini_jit_cache_init (void)
+{
+	mono_jit_cache_enabled = FALSE;
+}
+
+char*
+mini_jit_cache_get_image_name (MonoAssembly *assembly)
+{
+	g_assert_not_reached ();
+	return NULL;
+}
+
+void
+mini_jit_cache_add_method (MonoMethod *method)
+{
+}
+
+void
+mini_jit_cache_cleanup (void)
+{
+}
+
+#endif
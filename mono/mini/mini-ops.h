@@ -707,10 +707,13 @@ MINI_OP(OP_LDLEN, "ldlen", IREG, IREG, NONE)
 MINI_OP(OP_BOUNDS_CHECK, "bounds_check", NONE, IREG, IREG)
 /* get adress of element in a 2D array */
 MINI_OP(OP_LDELEMA2D, "getldelema2", NONE, NONE, NONE)
-/* inlined small memcpy with constant length */
-MINI_OP(OP_MEMCPY, "memcpy", NONE, NONE, NONE)
-/* inlined small memset with constant length */
-MINI_OP(OP_MEMSET, "memset", NONE, NONE, NONE)
+/*
+ * inlined small memcpy with constant length, see mini_emit_block_op ().
+ * sreg1+inst_offset is the destination, sreg2+inst_imm is the source, the length is in backend.memcpy_args.
+ */
+MINI_OP(OP_MEMCPY, "memcpy", NONE, IREG, IREG)
+/* inlined small memset to zero with constant length, same as OP_MEMCPY without a source */
+MINI_OP(OP_MEMSET, "memset", NONE, IREG, NONE)
 MINI_OP(OP_SAVE_LMF, "save_lmf", NONE, NONE, NONE)
 MINI_OP(OP_RESTORE_LMF, "restore_lmf", NONE, NONE, NONE)
 
@@ -943,6 +946,13 @@ MINI_OP(OP_CVTPS2PD, "cvtps2pd", XREG, XREG, NONE)
 MINI_OP(OP_CVTTPD2DQ, "cvttpd2dq", XREG, XREG, NONE)
 MINI_OP(OP_CVTTPS2DQ, "cvttps2dq", XREG, XREG, NONE)
 
+/*
+ * A binary op on two 256 bit vectors which live in memory, sreg1 is the address of the
+ * result, sreg2 and sreg3 are the addresses of the operands. inst_c0 is the opcode of the
+ * 128 bit op, inst_c1 is TRUE if the ymm form can be used. dreg is clobbered.
+ */
+MINI_OP3(OP_XBINOP_256, "xbinop_256", XREG, IREG, IREG, IREG)
+
 #endif
 
 MINI_OP(OP_XMOVE,   "xmove", XREG, XREG, NONE)
@@ -0,0 +1,360 @@
+/*
+ * mini-pgo.c: Profile guided inlining
+ *
+ * When PGO inlining is enabled (--pgo-inline), the inliner consults call site frequencies
+ * before inlining a call: calls which are never made are not inlined, and the size limit is
+ * raised for calls which are made at least as often as their caller is entered, so small
+ * accessors called from hot loops are inlined even if they are above the default limit.
+ *
+ * The frequencies come from two sources. With --tiered, the tier 0 code counts method entries
+ * and call sites, see emit_tier0_prologue () and emit_pgo_call_site_count () in method-to-ir.c,
+ * so the tier 1 code is compiled with the counts of the process itself. They can also be
+ * loaded from a file, which is written back at shutdown, so later runs can use the counts of
+ * earlier ones even without --tiered. The file is a text file with lines like:
+ *
+ *   method <entries> <full method name>
+ *   site <IL offset> <count>
+ *
+ * with the site lines following the method they belong to. Lines starting with '#' are ignored.
+ *
+ * Copyright 2016 Xamarin, Inc (http://www.xamarin.com)
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "mini.h"
+
+#include <errno.h>
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-counters.h>
+
+gboolean mono_pgo_inlining;
+char *mono_pgo_file;
+/* Set once counts were loaded from the file or the tier 0 code started collecting them */
+gboolean mono_pgo_have_counts;
+
+#ifndef DISABLE_JIT
+
+/* Methods entered less often than this don't have meaningful counts */
+#define PGO_MIN_ENTRIES 10
+/* The inlining size limit for hot call sites */
+#define PGO_HOT_INLINE_LENGTH_LIMIT 64
+
+/* How often a call site is executed */
+typedef enum {
+	PGO_UNKNOWN,
+	PGO_COLD,
+	PGO_WARM,
+	PGO_HOT
+} PgoHotness;
+
+typedef struct {
+	char *name;
+	/* Incremented on every entry by the tier 0 code */
+	gint32 entries;
+	/* Maps IL offsets to gint32 counters */
+	GHashTable *sites;
+} PgoMethodData;
+
+static MonoCoopMutex pgo_mutex;
+/* Maps methods to their PgoMethodData */
+static GHashTable *method_data;
+/* Maps method names to the PgoMethodData loaded from the file which no method claimed yet */
+static GHashTable *loaded_data;
+
+static gint32 pgo_sites_cold, pgo_sites_hot, pgo_limits_raised;
+
+static PgoMethodData*
+pgo_method_data_new (char *name)
+{
+	PgoMethodData *data = g_new0 (PgoMethodData, 1);
+
+	data->name = name;
+	data->sites = g_hash_table_new (NULL, NULL);
+	return data;
+}
+
+static gint32*
+pgo_method_data_get_site (PgoMethodData *data, int il_offset, gboolean create)
+{
+	gint32 *counter = (gint32 *)g_hash_table_lookup (data->sites, GINT_TO_POINTER (il_offset));
+
+	if (!counter && create) {
+		counter = g_new0 (gint32, 1);
+		g_hash_table_insert (data->sites, GINT_TO_POINTER (il_offset), counter);
+	}
+	return counter;
+}
+
+static void
+load_file (const char *filename)
+{
+	PgoMethodData *data = NULL;
+	char line [4096];
+	int lineno = 0;
+	FILE *f;
+
+	f = fopen (filename, "r");
+	if (!f) {
+		/* The file is created at shutdown */
+		if (errno != ENOENT)
+			g_warning ("Could not open PGO file '%s': %s", filename, g_strerror (errno));
+		return;
+	}
+
+	while (fgets (line, sizeof (line), f)) {
+		int entries, offset, count, pos = 0;
+
+		lineno ++;
+		g_strchomp (line);
+		if (line [0] == '#' || line [0] == '\0')
+			continue;
+
+		if (sscanf (line, "method %d %n", &entries, &pos) == 1 && pos > 0 && line [pos]) {
+			data = (PgoMethodData *)g_hash_table_lookup (loaded_data, line + pos);
+			if (!data) {
+				data = pgo_method_data_new (g_strdup (line + pos));
+				g_hash_table_insert (loaded_data, data->name, data);
+			}
+			data->entries = entries;
+		} else if (data && sscanf (line, "site %d %d", &offset, &count) == 2) {
+			*pgo_method_data_get_site (data, offset, TRUE) = count;
+			mono_pgo_have_counts = TRUE;
+		} else {
+			g_warning ("Invalid line %d in PGO file '%s'", lineno, filename);
+			data = NULL;
+		}
+	}
+
+	fclose (f);
+}
+
+void
+mini_pgo_init (void)
+{
+	if (!mono_pgo_inlining)
+		return;
+
+	mono_coop_mutex_init (&pgo_mutex);
+	method_data = g_hash_table_new (NULL, NULL);
+	loaded_data = g_hash_table_new (g_str_hash, g_str_equal);
+
+	if (mono_pgo_file)
+		load_file (mono_pgo_file);
+
+	mono_counters_register ("PGO cold call sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &pgo_sites_cold);
+	mono_counters_register ("PGO hot call sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &pgo_sites_hot);
+	mono_counters_register ("PGO raised inline limits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &pgo_limits_raised);
+}
+
+/*
+ * lookup_method_data:
+ *
+ *   Return the counts of METHOD, claiming the ones loaded from the file for it, or NULL
+ * if there are none.
+ * LOCKING: Called with pgo_mutex held.
+ */
+static PgoMethodData*
+lookup_method_data (MonoMethod *method)
+{
+	PgoMethodData *data;
+	char *name;
+
+	data = (PgoMethodData *)g_hash_table_lookup (method_data, method);
+	if (data || !g_hash_table_size (loaded_data))
+		return data;
+
+	name = mono_method_full_name (method, TRUE);
+	data = (PgoMethodData *)g_hash_table_lookup (loaded_data, name);
+	g_free (name);
+	if (data) {
+		g_hash_table_remove (loaded_data, data->name);
+		g_hash_table_insert (method_data, method, data);
+	}
+	return data;
+}
+
+/*
+ * get_method_data:
+ *
+ *   Return the counts of METHOD, creating them if needed, so the tier 0 code can collect them.
+ * LOCKING: Called with pgo_mutex held.
+ */
+static PgoMethodData*
+get_method_data (MonoMethod *method)
+{
+	PgoMethodData *data = lookup_method_data (method);
+
+	if (data)
+		return data;
+
+	data = pgo_method_data_new (mono_method_full_name (method, TRUE));
+	g_hash_table_insert (method_data, method, data);
+	mono_pgo_have_counts = TRUE;
+	return data;
+}
+
+/*
+ * mini_pgo_get_entry_counter:
+ *
+ *   Return the address of the entry counter of METHOD. It is never freed, so it can be
+ * embedded into JITted code.
+ */
+gint32*
+mini_pgo_get_entry_counter (MonoMethod *method)
+{
+	gint32 *res;
+
+	g_assert (mono_pgo_inlining);
+
+	mono_coop_mutex_lock (&pgo_mutex);
+	res = &get_method_data (method)->entries;
+	mono_coop_mutex_unlock (&pgo_mutex);
+
+	return res;
+}
+
+/*
+ * mini_pgo_get_call_site_counter:
+ *
+ *   Return the address of the counter of the call at IL_OFFSET in METHOD. It is never
+ * freed, so it can be embedded into JITted code.
+ */
+gint32*
+mini_pgo_get_call_site_counter (MonoMethod *method, int il_offset)
+{
+	gint32 *res;
+
+	g_assert (mono_pgo_inlining);
+
+	mono_coop_mutex_lock (&pgo_mutex);
+	res = pgo_method_data_get_site (get_method_data (method), il_offset, TRUE);
+	mono_coop_mutex_unlock (&pgo_mutex);
+
+	return res;
+}
+
+/*
+ * get_call_site_hotness:
+ *
+ *   Return how often the call at IL_OFFSET in METHOD is made, relative to the number of
+ * times METHOD is entered. Methods without counts are not added, this is called for every
+ * inlining candidate.
+ */
+static PgoHotness
+get_call_site_hotness (MonoMethod *method, int il_offset)
+{
+	PgoMethodData *data;
+	gint32 *counter;
+	gint64 entries = 0, count = -1;
+
+	mono_coop_mutex_lock (&pgo_mutex);
+	data = lookup_method_data (method);
+	if (data) {
+		counter = pgo_method_data_get_site (data, il_offset, FALSE);
+		/* The counters are updated racily by the tier 0 code */
+		entries = data->entries;
+		count = counter ? *counter : -1;
+	}
+	mono_coop_mutex_unlock (&pgo_mutex);
+
+	if (entries < PGO_MIN_ENTRIES || count < 0)
+		return PGO_UNKNOWN;
+
+	if (count * 100 < entries) {
+		InterlockedIncrement (&pgo_sites_cold);
+		return PGO_COLD;
+	} else if (count >= entries) {
+		InterlockedIncrement (&pgo_sites_hot);
+		return PGO_HOT;
+	}
+	return PGO_WARM;
+}
+
+/*
+ * mini_pgo_get_inline_limit:
+ *
+ *   Return the maximum IL size of methods to inline at the call at IL_OFFSET in METHOD,
+ * given the default limit LIMIT. CODE_SIZE is the IL size of the candidate.
+ * The caller checks mono_pgo_have_counts first.
+ */
+int
+mini_pgo_get_inline_limit (MonoMethod *method, int il_offset, int code_size, int limit)
+{
+	g_assert (mono_pgo_inlining);
+
+	switch (get_call_site_hotness (method, il_offset)) {
+	case PGO_COLD:
+		return 0;
+	case PGO_HOT:
+		if (code_size >= limit && code_size < PGO_HOT_INLINE_LENGTH_LIMIT)
+			InterlockedIncrement (&pgo_limits_raised);
+		return MAX (limit, PGO_HOT_INLINE_LENGTH_LIMIT);
+	default:
+		return limit;
+	}
+}
+
+static void
+write_method_data (FILE *f, PgoMethodData *data)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (!data->entries && !g_hash_table_size (data->sites))
+		return;
+
+	fprintf (f, "method %d %s\n", data->entries, data->name);
+	g_hash_table_iter_init (&iter, data->sites);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		fprintf (f, "site %d %d\n", GPOINTER_TO_INT (key), *(gint32 *)value);
+}
+
+/*
+ * mini_pgo_cleanup:
+ *
+ *   Write the counts to the PGO file, if there is one. The counts of the methods which
+ * were not used by this process are kept.
+ */
+void
+mini_pgo_cleanup (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	FILE *f;
+
+	if (!mono_pgo_inlining || !mono_pgo_file)
+		return;
+
+	f = fopen (mono_pgo_file, "w");
+	if (!f) {
+		g_warning ("Could not write PGO file '%s': %s", mono_pgo_file, g_strerror (errno));
+		return;
+	}
+
+	fprintf (f, "# Mono PGO inlining data\n");
+
+	mono_coop_mutex_lock (&pgo_mutex);
+	g_hash_table_iter_init (&iter, method_data);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		write_method_data (f, (PgoMethodData *)value);
+	g_hash_table_iter_init (&iter, loaded_data);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		write_method_data (f, (PgoMethodData *)value);
+	mono_coop_mutex_unlock (&pgo_mutex);
+
+	fclose (f);
+}
+
+#else /* DISABLE_JIT */
+
+void
+mini_pgo_init (void)
+{
+}
+
+void
+mini_pgo_cleanup (void)
+{
+}
+
+#endif /* DISABLE_JIT */
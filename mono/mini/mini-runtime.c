@@ -64,6 +64,8 @@
 #include <mono/utils/mono-signal-handler.h>
 #include <mono/utils/mono-threads.h>
 #include <mono/utils/checked-build.h>
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-time.h>
 #include <mono/io-layer/io-layer.h>
 
 #include "mini.h"
@@ -114,6 +116,12 @@ int mini_verbose = 0;
  */
 gboolean mono_use_llvm = FALSE;
 
+/*
+ * The number of background threads which compile the methods called by JITted code
+ * before they are first invoked, 0 if disabled.
+ */
+int mono_compile_ahead_threads = 0;
+
 #define mono_jit_lock() mono_os_mutex_lock (&jit_mutex)
 #define mono_jit_unlock() mono_os_mutex_unlock (&jit_mutex)
 static mono_mutex_t jit_mutex;
@@ -1779,7 +1787,7 @@ mono_resolve_patch_target (MonoMethod *method, MonoDomain *domain, guint8 *code,
 		break;
 	}
 	case MONO_PATCH_INFO_CASTCLASS_CACHE: {
-		target = mono_domain_alloc0 (domain, sizeof (gpointer));
+		target = mono_domain_alloc0 (domain, sizeof (gpointer) * MONO_CAST_CACHE_ENTRIES);
 		break;
 	}
 	case MONO_PATCH_INFO_JIT_TLS_ID: {
@@ -1952,6 +1960,267 @@ no_gsharedvt_in_wrapper (void)
 	g_assert_not_reached ();
 }
 
+/*
+ * Methods which are being compiled. Threads which need a method which another thread is
+ * already compiling wait for that compilation to finish instead of compiling it again.
+ */
+typedef struct {
+	MonoMethod *method;
+	MonoDomain *domain;
+	/* The number of threads compiling the method */
+	int compilation_count;
+	/* One reference is held by in_flight_methods, the rest by waiting threads */
+	int ref_count;
+	gboolean done;
+	MonoCoopCond cond;
+} JitCompilationEntry;
+
+/*
+ * How long to wait for another thread to compile a method. Waiting isn't visible to the
+ * class init deadlock detection, so threads which are running a class constructor don't
+ * wait, and the compiling thread only runs the class constructor of the method's class
+ * once it stopped being registered. Class constructors run while compiling, or locks held
+ * by the callers of the JIT could still make the compiling thread wait for a waiter, so
+ * waiters give up after a while and compile the method themselves, like all threads did
+ * before.
+ */
+#define JIT_COMPILATION_WAIT_MS 1000
+
+static MonoCoopMutex compilation_lock;
+static GPtrArray *in_flight_methods;
+
+static JitCompilationEntry*
+find_compilation_entry (MonoMethod *method, MonoDomain *domain)
+{
+	int i;
+
+	for (i = 0; i < in_flight_methods->len; ++i) {
+		JitCompilationEntry *entry = (JitCompilationEntry *)g_ptr_array_index (in_flight_methods, i);
+
+		if (entry->method == method && entry->domain == domain)
+			return entry;
+	}
+	return NULL;
+}
+
+static void
+unref_compilation_entry (JitCompilationEntry *entry)
+{
+	if (--entry->ref_count)
+		return;
+	mono_coop_cond_destroy (&entry->cond);
+	g_free (entry);
+}
+
+/* Record that the current thread compiles METHOD. The compilation lock must be held. */
+static void
+register_method_to_compile (MonoMethod *method, MonoDomain *domain, JitCompilationEntry *entry)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+
+	if (jit_tls)
+		jit_tls->active_jit_methods++;
+
+	if (entry) {
+		entry->compilation_count++;
+		InterlockedIncrement (&mono_jit_stats.methods_compiled_concurrently);
+		return;
+	}
+
+	entry = g_new0 (JitCompilationEntry, 1);
+	entry->method = method;
+	entry->domain = domain;
+	entry->compilation_count = entry->ref_count = 1;
+	mono_coop_cond_init (&entry->cond);
+	g_ptr_array_add (in_flight_methods, entry);
+}
+
+/*
+ * wait_or_register_method_to_compile:
+ *
+ *   If another thread is compiling METHOD, wait for it to finish and return TRUE, so the
+ * caller looks up the compiled code. Otherwise, register the current thread as compiling
+ * METHOD and return FALSE. Threads which are compiling another method or running a class
+ * constructor don't wait, since the other compilation could depend on them.
+ */
+static gboolean
+wait_or_register_method_to_compile (MonoMethod *method, MonoDomain *domain)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+	JitCompilationEntry *entry;
+	gint64 start;
+
+	mono_coop_mutex_lock (&compilation_lock);
+
+	entry = find_compilation_entry (method, domain);
+	if (!entry || !jit_tls || jit_tls->active_jit_methods > 0 || mono_runtime_is_running_class_init ()) {
+		register_method_to_compile (method, domain, entry);
+		mono_coop_mutex_unlock (&compilation_lock);
+		return FALSE;
+	}
+
+	InterlockedIncrement (&mono_jit_stats.methods_waited);
+	entry->ref_count++;
+	start = mono_msec_ticks ();
+	while (!entry->done) {
+		gint64 left = JIT_COMPILATION_WAIT_MS - (mono_msec_ticks () - start);
+
+		if (left <= 0)
+			break;
+		mono_coop_cond_timedwait (&entry->cond, &compilation_lock, (guint32)left);
+	}
+
+	if (!entry->done) {
+		register_method_to_compile (method, domain, entry);
+		unref_compilation_entry (entry);
+		mono_coop_mutex_unlock (&compilation_lock);
+		return FALSE;
+	}
+
+	unref_compilation_entry (entry);
+	mono_coop_mutex_unlock (&compilation_lock);
+	return TRUE;
+}
+
+/*
+ * try_register_method_to_compile:
+ *
+ *   Same as wait_or_register_method_to_compile (), but return FALSE instead of waiting if
+ * another thread is compiling METHOD.
+ */
+static gboolean
+try_register_method_to_compile (MonoMethod *method, MonoDomain *domain)
+{
+	gboolean res = FALSE;
+
+	mono_coop_mutex_lock (&compilation_lock);
+	if (!find_compilation_entry (method, domain)) {
+		register_method_to_compile (method, domain, NULL);
+		res = TRUE;
+	}
+	mono_coop_mutex_unlock (&compilation_lock);
+
+	return res;
+}
+
+static void
+unregister_method_for_compile (MonoMethod *method, MonoDomain *domain)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+	JitCompilationEntry *entry;
+
+	mono_coop_mutex_lock (&compilation_lock);
+
+	if (jit_tls)
+		jit_tls->active_jit_methods--;
+
+	entry = find_compilation_entry (method, domain);
+	g_assert (entry);
+	if (--entry->compilation_count == 0) {
+		g_ptr_array_remove (in_flight_methods, entry);
+		entry->done = TRUE;
+		mono_coop_cond_broadcast (&entry->cond);
+		unref_compilation_entry (entry);
+	}
+
+	mono_coop_mutex_unlock (&compilation_lock);
+}
+
+/*
+ * Compile ahead. The callees which are called directly by newly JITted code are queued, and
+ * compiled by a pool of background threads, so they are usually ready by the time they are
+ * first called. The compilation doesn't run class constructors, so it has no side effects.
+ */
+
+/* Limits the memory used by the queue if the pool can't keep up */
+#define COMPILE_AHEAD_QUEUE_MAX 4096
+
+static MonoCoopMutex compile_ahead_lock;
+static MonoCoopCond compile_ahead_cond;
+static GQueue *compile_ahead_queue;
+static gint32 compile_ahead_started;
+
+static gboolean
+can_compile_ahead (MonoMethod *method)
+{
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->dynamic)
+		return FALSE;
+	if (method->iflags & (METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL | METHOD_IMPL_ATTRIBUTE_RUNTIME | METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED))
+		return FALSE;
+	if (method->flags & (METHOD_ATTRIBUTE_PINVOKE_IMPL | METHOD_ATTRIBUTE_ABSTRACT))
+		return FALSE;
+	if (method->is_generic || method->klass->generic_container || mono_method_is_generic_sharable (method, FALSE))
+		return FALSE;
+	return TRUE;
+}
+
+static void
+compile_ahead_thread (gpointer unused)
+{
+	MonoDomain *domain = mono_get_root_domain ();
+
+	for (;;) {
+		MonoMethod *method;
+		MonoError error;
+
+		mono_coop_mutex_lock (&compile_ahead_lock);
+		while (g_queue_is_empty (compile_ahead_queue) && !mono_runtime_is_shutting_down ())
+			mono_coop_cond_wait (&compile_ahead_cond, &compile_ahead_lock);
+		method = (MonoMethod *)g_queue_pop_head (compile_ahead_queue);
+		mono_coop_mutex_unlock (&compile_ahead_lock);
+
+		if (mono_runtime_is_shutting_down ())
+			return;
+
+		if (lookup_method (domain, method) || !try_register_method_to_compile (method, domain))
+			continue;
+
+		/* Errors are reported when the method is compiled on first call */
+		mono_jit_compile_method_inner (method, domain, mono_get_optimizations_for_method (method, default_opt), (JitFlags)0, &error);
+		if (mono_error_ok (&error))
+			InterlockedIncrement (&mono_jit_stats.methods_compiled_ahead);
+		else
+			mono_error_cleanup (&error);
+
+		unregister_method_for_compile (method, domain);
+	}
+}
+
+/*
+ * mono_jit_compile_ahead:
+ *
+ *   Queue METHODS, the callees of a method which was just compiled in DOMAIN, for
+ * compilation by the compile ahead threads.
+ */
+void
+mono_jit_compile_ahead (MonoDomain *domain, GSList *methods)
+{
+	GSList *l;
+	int i;
+
+	if (domain != mono_get_root_domain ())
+		return;
+
+	mono_coop_mutex_lock (&compile_ahead_lock);
+	for (l = methods; l; l = l->next) {
+		MonoMethod *method = (MonoMethod *)l->data;
+
+		if (compile_ahead_queue->length >= COMPILE_AHEAD_QUEUE_MAX)
+			break;
+		if (can_compile_ahead (method))
+			g_queue_push_tail (compile_ahead_queue, method);
+	}
+	mono_coop_cond_broadcast (&compile_ahead_cond);
+	mono_coop_mutex_unlock (&compile_ahead_lock);
+
+	if (!compile_ahead_started && InterlockedCompareExchange (&compile_ahead_started, 1, 0) == 0) {
+		for (i = 0; i < mono_compile_ahead_threads; ++i) {
+			if (!mono_thread_create_internal (mono_get_root_domain (), compile_ahead_thread, NULL, TRUE, 0))
+				g_error ("mono_jit_compile_ahead: mono_thread_create_internal () failed");
+		}
+	}
+}
+
 static gpointer
 mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoError *error)
 {
@@ -2002,6 +2271,7 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoError *er
 		}
 	}
 
+lookup_start:
 	info = lookup_method (target_domain, method);
 	if (info) {
 		/* We can't use a domain specific method in another domain */
@@ -2058,8 +2328,21 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoError *er
 		}
 	}
 
-	if (!code)
-		code = mono_jit_compile_method_inner (method, target_domain, opt, error);
+	if (!code) {
+		if (wait_or_register_method_to_compile (method, target_domain))
+			goto lookup_start;
+		code = mono_jit_compile_method_inner (method, target_domain, opt, JIT_FLAG_RUN_CCTORS, error);
+		unregister_method_for_compile (method, target_domain);
+
+		/* Threads waiting for the code are released first, the cctor could need them */
+		if (code) {
+			MonoVTable *vtable = mono_class_vtable (target_domain, method->klass);
+
+			g_assert (vtable);
+			if (!mono_runtime_class_init_full (vtable, error))
+				return NULL;
+		}
+	}
 	if (!mono_error_ok (error))
 		return NULL;
 
@@ -2140,6 +2423,7 @@ mono_jit_free_method (MonoDomain *domain, MonoMethod *method)
 		return;
 
 	mono_debug_remove_method (method, domain);
+	mini_cha_remove_dependent (method);
 
 	mono_domain_lock (domain);
 	g_hash_table_remove (domain_jit_info (domain)->dynamic_code_hash, method);
@@ -3416,16 +3700,19 @@ register_jit_stats (void)
 	mono_counters_register ("JIT/ssa_cprop (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_ssa_cprop);
 	mono_counters_register ("JIT/ssa_deadce(sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_ssa_deadce);
 	mono_counters_register ("JIT/perform_abc_removal (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_perform_abc_removal);
+	mono_counters_register ("JIT/escape_analysis (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_escape_analysis);
 	mono_counters_register ("JIT/ssa_remove (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_ssa_remove);
 	mono_counters_register ("JIT/local_cprop2 (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_local_cprop2);
 	mono_counters_register ("JIT/handle_global_vregs2 (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_handle_global_vregs2);
 	mono_counters_register ("JIT/local_deadce2 (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_local_deadce2);
+	mono_counters_register ("JIT/loop_opts (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_loop_opts);
 	mono_counters_register ("JIT/optimize_branches2 (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_optimize_branches2);
 	mono_counters_register ("JIT/decompose_vtype_opts (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_decompose_vtype_opts);
 	mono_counters_register ("JIT/decompose_array_access_opts (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_decompose_array_access_opts);
 	mono_counters_register ("JIT/liveness_handle_exception_clauses2 (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_liveness_handle_exception_clauses2);
 	mono_counters_register ("JIT/analyze_liveness (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_analyze_liveness);
 	mono_counters_register ("JIT/linear_scan (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_linear_scan);
+	mono_counters_register ("JIT/graph_coloring (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_graph_coloring);
 	mono_counters_register ("JIT/arch_allocate_vars (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_arch_allocate_vars);
 	mono_counters_register ("JIT/spill_global_vars (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_spill_global_vars);
 	mono_counters_register ("JIT/local_cprop3 (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_local_cprop3);
@@ -3446,6 +3733,10 @@ register_jit_stats (void)
 	mono_counters_register ("Regvars", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.regvars);
 	mono_counters_register ("Locals stack size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.locals_stack_size);
 	mono_counters_register ("Method cache lookups", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_lookups);
+	mono_counters_register ("Methods waited for", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_waited);
+	mono_counters_register ("Methods compiled concurrently", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_compiled_concurrently);
+	mono_counters_register ("Methods compiled ahead", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_compiled_ahead);
+	mono_counters_register ("Allocations scalar replaced", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.allocations_scalar_replaced);
 	mono_counters_register ("Compiled CIL code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.cil_code_size);
 	mono_counters_register ("Native code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.native_code_size);
 	mono_counters_register ("Aliases found", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.alias_found);
@@ -3681,6 +3972,9 @@ mini_init (const char *filename, const char *runtime_version)
 	callbacks.create_jump_trampoline = mono_create_jump_trampoline;
 	callbacks.create_jit_trampoline = mono_create_jit_trampoline;
 #endif
+	if (mono_guarded_devirt)
+		callbacks.vtable_created = mini_cha_vtable_created;
+	callbacks.runtime_shutting_down = mini_tiered_shutdown;
 
 	mono_install_callbacks (&callbacks);
 
@@ -3734,6 +4028,17 @@ mini_init (const char *filename, const char *runtime_version)
 
 	mono_trampolines_init ();
 
+	mini_tiered_init ();
+	mini_pgo_init ();
+	mini_jit_cache_init ();
+	mini_cha_init ();
+
+	mono_coop_mutex_init (&compilation_lock);
+	in_flight_methods = g_ptr_array_new ();
+	mono_coop_mutex_init (&compile_ahead_lock);
+	mono_coop_cond_init (&compile_ahead_cond);
+	compile_ahead_queue = g_queue_new ();
+
 	mono_native_tls_alloc (&mono_jit_tls_id, NULL);
 
 	if (default_opt & MONO_OPT_AOT)
@@ -4080,6 +4385,7 @@ register_icalls (void)
 	register_icall (mono_object_castclass_with_cache, "mono_object_castclass_with_cache", "object object ptr ptr", FALSE);
 	register_icall (mono_object_isinst_with_cache, "mono_object_isinst_with_cache", "object object ptr ptr", FALSE);
 	register_icall (mono_generic_class_init, "mono_generic_class_init", "void ptr", FALSE);
+	register_icall (mono_tiered_request_tier1, "mono_tiered_request_tier1", "void ptr", FALSE);
 	register_icall (mono_fill_class_rgctx, "mono_class_fill_rgctx", "ptr ptr int", FALSE);
 	register_icall (mono_fill_method_rgctx, "mono_method_fill_rgctx", "ptr ptr int", FALSE);
 
@@ -4182,6 +4488,9 @@ mini_cleanup (MonoDomain *domain)
 	/* This accesses metadata so needs to be called before runtime shutdown */
 	print_jit_stats ();
 
+	mini_pgo_cleanup ();
+	mini_jit_cache_cleanup ();
+
 	mono_profiler_shutdown ();
 
 #ifndef MONO_CROSS_COMPILE
@@ -0,0 +1,339 @@
+/*
+ * mini-tiered.c: Tiered compilation
+ *
+ * When tiered compilation is enabled (--tiered), eligible methods are first compiled with a
+ * cheap set of optimizations (tier 0). The tier 0 code starts with a prologue which counts
+ * invocations, see emit_tier0_prologue () in method-to-ir.c. Once the counter reaches zero
+ * the method is queued, and a background thread recompiles it with the full set of
+ * optimizations (tier 1). The tier 1 code replaces the tier 0 code in the jit code hash, so
+ * trampolines resolve to it from then on, and the jump at the start of the tier 0 code is
+ * patched to it through the jump_target_hash, so callers which were already patched to the
+ * tier 0 code are redirected.
+ *
+ * Copyright 2016 Xamarin, Inc (http://www.xamarin.com)
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "mini.h"
+
+#include <mono/metadata/threads-types.h>
+#include <mono/metadata/runtime.h>
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-counters.h>
+
+gboolean mono_tiered_compilation;
+int mono_tiered_threshold = MONO_TIERED_DEFAULT_THRESHOLD;
+
+#ifndef DISABLE_JIT
+
+/*
+ * The optimizations which are too expensive for tier 0. LOOP is kept since coop needs it, and
+ * TAILC since programs can depend on tail calls not growing the stack.
+ */
+#define TIER1_ONLY_OPTIMIZATIONS (MONO_OPT_INLINE | MONO_OPT_CONSPROP | MONO_OPT_COPYPROP | MONO_OPT_DEADCE | \
+								  MONO_OPT_LINEARS | MONO_OPT_ABCREM | MONO_OPT_SSA | MONO_OPT_ALIAS_ANALYSIS | \
+								  MONO_OPT_SCHED | MONO_OPT_CMOV | MONO_OPT_FCMOV | MONO_OPT_LICM | \
+								  MONO_OPT_ESCAPE | MONO_OPT_GCOLOR)
+
+static MonoCoopMutex tiered_mutex;
+static MonoCoopCond tiered_cond;
+/* Maps methods to their MonoTierInfo */
+static GHashTable *tier_infos;
+/* MonoTierInfo's waiting to be compiled at tier 1 */
+static GQueue *tier1_queue;
+static gint32 tiered_thread_started;
+
+static gint32 methods_tier0, methods_tier1, methods_tier1_failed;
+
+void
+mini_tiered_init (void)
+{
+	mono_coop_mutex_init (&tiered_mutex);
+	mono_coop_cond_init (&tiered_cond);
+	tier_infos = g_hash_table_new (NULL, NULL);
+	tier1_queue = g_queue_new ();
+
+	mono_counters_register ("Methods compiled at tier 0", MONO_COUNTER_JIT | MONO_COUNTER_INT, &methods_tier0);
+	mono_counters_register ("Methods compiled at tier 1", MONO_COUNTER_JIT | MONO_COUNTER_INT, &methods_tier1);
+	mono_counters_register ("Methods failed at tier 1", MONO_COUNTER_JIT | MONO_COUNTER_INT, &methods_tier1_failed);
+}
+
+/*
+ * mini_tiered_shutdown:
+ *
+ *   Called when the runtime starts shutting down. The tiered compiler thread waits for
+ * work without being interruptible, so it has to be woken up to notice the shutdown.
+ */
+void
+mini_tiered_shutdown (void)
+{
+	mono_coop_mutex_lock (&tiered_mutex);
+	mono_coop_cond_broadcast (&tiered_cond);
+	mono_coop_mutex_unlock (&tiered_mutex);
+}
+
+/*
+ * mini_tiered_method_is_eligible:
+ *
+ *   Return whenever CFG can be compiled at tier 0. The prologue needs to be able to jump
+ * to the tier 1 code with the incoming arguments, so methods whose arguments can't be
+ * passed along by a tail call are excluded, along with everything which isn't plain
+ * JITted code running in the root domain.
+ */
+gboolean
+mini_tiered_method_is_eligible (MonoCompile *cfg)
+{
+	MonoMethod *method = cfg->method;
+	MonoMethodSignature *sig = mono_method_signature (method);
+	int i;
+
+	if (!mono_tiered_compilation || !cfg->backend->have_op_tail_call)
+		return FALSE;
+	if (cfg->compile_aot || cfg->gshared || COMPILE_LLVM (cfg) || cfg->gen_sdb_seq_points)
+		return FALSE;
+	if (cfg->domain != mono_get_root_domain ())
+		return FALSE;
+	if (cfg->prof_options & (MONO_PROFILE_ENTER_LEAVE | MONO_PROFILE_COVERAGE))
+		return FALSE;
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->dynamic || method->save_lmf)
+		return FALSE;
+	if (method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED)
+		return FALSE;
+	if (sig->pinvoke || sig->call_convention == MONO_CALL_VARARG)
+		return FALSE;
+	if (MONO_TYPE_ISSTRUCT (mini_get_underlying_type (sig->ret)))
+		return FALSE;
+	for (i = 0; i < sig->param_count; ++i) {
+		if (MONO_TYPE_ISSTRUCT (mini_get_underlying_type (sig->params [i])))
+			return FALSE;
+	}
+	return mono_arch_tail_call_supported (cfg, sig, sig);
+}
+
+/*
+ * mini_tiered_get_tier0_optimizations:
+ *
+ *   Return the optimizations to use for tier 0 code, given the optimizations OPTS the
+ * method would normally be compiled with.
+ */
+guint32
+mini_tiered_get_tier0_optimizations (guint32 opts)
+{
+	return opts & ~TIER1_ONLY_OPTIMIZATIONS;
+}
+
+/*
+ * mini_tiered_get_info:
+ *
+ *   Return the tier info for METHOD, creating it if needed. OPTS is the set of
+ * optimizations used to compile METHOD at tier 1.
+ */
+MonoTierInfo*
+mini_tiered_get_info (MonoMethod *method, MonoDomain *domain, guint32 opts)
+{
+	MonoTierInfo *info;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	info = (MonoTierInfo *)g_hash_table_lookup (tier_infos, method);
+	if (!info) {
+		info = g_new0 (MonoTierInfo, 1);
+		info->method = method;
+		info->domain = domain;
+		info->opt = opts;
+		info->counter = mono_tiered_threshold;
+		info->state = MONO_TIER_STATE_TIER0;
+		g_hash_table_insert (tier_infos, method, info);
+	}
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	return info;
+}
+
+/*
+ * mini_tiered_register_tier0:
+ *
+ *   Called when the tier 0 code compiled by CFG is registered in the jit code hash.
+ * The domain lock must be held.
+ */
+void
+mini_tiered_register_tier0 (MonoCompile *cfg)
+{
+	g_assert (cfg->tier_jump_site);
+	cfg->tier_info->jump_site = cfg->tier_jump_site;
+	InterlockedIncrement (&methods_tier0);
+}
+
+static void
+compile_tier1 (MonoTierInfo *info)
+{
+	MonoDomain *domain = info->domain;
+	MonoMethod *method = info->method;
+	MonoCompile *cfg;
+	MonoJumpList *jlist;
+	MonoError error;
+
+	/* The compilation records the receiver predictions which still hold again */
+	mini_cha_remove_dependent (method);
+	/* Class constructors are run by the tier 0 code and by the calls it makes, never by this thread */
+	cfg = mini_method_compile (method, info->opt, domain, (JitFlags)0, 0, -1);
+	if (cfg->exception_type != MONO_EXCEPTION_NONE) {
+		/* Keep running the tier 0 code */
+		if (cfg->exception_type == MONO_EXCEPTION_MONO_ERROR)
+			mono_error_cleanup (&cfg->error);
+		mono_destroy_compile (cfg);
+		InterlockedIncrement (&methods_tier1_failed);
+		/* A failed recompilation keeps the previous tier 1 code */
+		InterlockedCompareExchange (&info->state, MONO_TIER_STATE_FAILED, MONO_TIER_STATE_QUEUED);
+		return;
+	}
+
+	mono_domain_lock (domain);
+
+	mono_domain_jit_code_hash_lock (domain);
+	if (mono_internal_hash_table_lookup (&domain->jit_code_hash, method))
+		mono_internal_hash_table_remove (&domain->jit_code_hash, method);
+	mono_internal_hash_table_insert (&domain->jit_code_hash, method, cfg->jit_info);
+	mono_domain_jit_code_hash_unlock (domain);
+
+	/* Redirect the jump in the tier 0 prologue along with any other jumps to the method */
+	jlist = (MonoJumpList *)g_hash_table_lookup (domain_jit_info (domain)->jump_target_hash, method);
+	if (!jlist) {
+		jlist = (MonoJumpList *)mono_domain_alloc0 (domain, sizeof (MonoJumpList));
+		g_hash_table_insert (domain_jit_info (domain)->jump_target_hash, method, jlist);
+	}
+	if (!g_slist_find (jlist->list, info->jump_site))
+		jlist->list = g_slist_prepend (jlist->list, info->jump_site);
+	mono_jit_patch_jump_targets (domain, method, &error);
+
+	mono_domain_unlock (domain);
+
+	if (!mono_error_ok (&error)) {
+		/* The new code is registered, so only the tier 0 prologue could be left unpatched */
+		mono_error_cleanup (&error);
+		mono_destroy_compile (cfg);
+		InterlockedIncrement (&methods_tier1_failed);
+		InterlockedCompareExchange (&info->state, MONO_TIER_STATE_FAILED, MONO_TIER_STATE_QUEUED);
+		return;
+	}
+
+	mono_emit_jit_map (cfg->jit_info);
+	mono_destroy_compile (cfg);
+
+	InterlockedIncrement (&methods_tier1);
+	/* The patched jump has to be visible before the prologue takes it */
+	mono_memory_barrier ();
+	InterlockedExchange (&info->state, MONO_TIER_STATE_READY);
+}
+
+static void
+tiered_compiler_thread (gpointer unused)
+{
+	for (;;) {
+		MonoTierInfo *info;
+		guint32 invalidations = 0;
+
+		mono_coop_mutex_lock (&tiered_mutex);
+		while (g_queue_is_empty (tier1_queue) && !mono_runtime_is_shutting_down ())
+			mono_coop_cond_wait (&tiered_cond, &tiered_mutex);
+		info = (MonoTierInfo *)g_queue_pop_head (tier1_queue);
+		if (info) {
+			info->queued = FALSE;
+			invalidations = info->invalidations;
+		}
+		mono_coop_mutex_unlock (&tiered_mutex);
+
+		if (mono_runtime_is_shutting_down ())
+			return;
+
+		compile_tier1 (info);
+
+		/* The code could have been compiled using an assumption invalidated in the meantime */
+		mono_coop_mutex_lock (&tiered_mutex);
+		if (info->invalidations != invalidations && info->state == MONO_TIER_STATE_READY && !info->queued) {
+			g_queue_push_tail (tier1_queue, info);
+			info->queued = TRUE;
+		}
+		mono_coop_mutex_unlock (&tiered_mutex);
+	}
+}
+
+/*
+ * mono_tiered_request_tier1:
+ *
+ *   Called by the tier 0 prologue when the invocation counter of a method reaches zero.
+ */
+void
+mono_tiered_request_tier1 (MonoTierInfo *info)
+{
+	/* Back off, so the prologue doesn't call us on every invocation until tier 1 is ready */
+	info->counter = mono_tiered_threshold;
+
+	if (InterlockedCompareExchange (&info->state, MONO_TIER_STATE_QUEUED, MONO_TIER_STATE_TIER0) != MONO_TIER_STATE_TIER0)
+		return;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	g_queue_push_tail (tier1_queue, info);
+	info->queued = TRUE;
+	mono_coop_cond_signal (&tiered_cond);
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	if (!tiered_thread_started && InterlockedCompareExchange (&tiered_thread_started, 1, 0) == 0) {
+		if (!mono_thread_create_internal (mono_get_root_domain (), tiered_compiler_thread, NULL, TRUE, 0))
+			g_error ("mono_tiered_request_tier1: mono_thread_create_internal () failed");
+	}
+}
+
+/*
+ * mini_tiered_recompile:
+ *
+ *   Queue METHOD to be compiled at tier 1 again, if it already was. This is used when an
+ * assumption its tier 1 code was compiled with no longer holds. Callers which were patched
+ * to call the old code directly keep calling it, so the code needs to stay correct. The
+ * old code also keeps being dispatched to by the tier 0 prologue until the new code replaces
+ * it. If the tier 1 code is being compiled, it is compiled again once it is done.
+ */
+void
+mini_tiered_recompile (MonoMethod *method)
+{
+	MonoTierInfo *info;
+
+	if (!mono_tiered_compilation)
+		return;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	info = (MonoTierInfo *)g_hash_table_lookup (tier_infos, method);
+	if (info) {
+		info->invalidations ++;
+		if (info->state == MONO_TIER_STATE_READY && !info->queued) {
+			g_queue_push_tail (tier1_queue, info);
+			info->queued = TRUE;
+			mono_coop_cond_signal (&tiered_cond);
+		}
+	}
+	mono_coop_mutex_unlock (&tiered_mutex);
+}
+
+#else /* DISABLE_JIT */
+
+void
+mini_tiered_init (void)
+{
+}
+
+void
+mini_tiered_shutdown (void)
+{
+}
+
+void
+mini_tiered_recompile (MonoMethod *method)
+{
+}
+
+void
+mono_tiered_request_tier1 (MonoTierInfo *info)
+{
+	g_assert_not_reached ();
+}
+
+#endif /* DISABLE_JIT */
@@ -804,6 +804,12 @@ mono_arch_cpu_enumerate_simd_versions (void)
 	if (mono_hwcap_x86_has_sse4a)
 		sse_opts |= SIMD_VERSION_SSE4a;
 
+	if (mono_hwcap_x86_has_avx)
+		sse_opts |= SIMD_VERSION_AVX;
+
+	if (mono_hwcap_x86_has_avx2)
+		sse_opts |= SIMD_VERSION_AVX2;
+
 	return sse_opts;
 }
 
@@ -2361,9 +2361,19 @@ mono_print_code (MonoCompile *cfg, const char* msg)
 static void
 mono_postprocess_patches (MonoCompile *cfg)
 {
-	MonoJumpInfo *patch_info;
+	MonoJumpInfo *patch_info, *tier_jump = NULL;
 	int i;
 
+	if (cfg->tier0) {
+		/* The jump in the tier 0 prologue is the first jump to the method itself */
+		for (patch_info = cfg->patch_info; patch_info; patch_info = patch_info->next) {
+			if (patch_info->type == MONO_PATCH_INFO_METHOD_JUMP && patch_info->data.method == cfg->method &&
+				(!tier_jump || patch_info->ip.i < tier_jump->ip.i))
+				tier_jump = patch_info;
+		}
+		g_assert (tier_jump);
+	}
+
 	for (patch_info = cfg->patch_info; patch_info; patch_info = patch_info->next) {
 		switch (patch_info->type) {
 		case MONO_PATCH_INFO_ABS: {
@@ -2436,6 +2446,12 @@ mono_postprocess_patches (MonoCompile *cfg)
 			ip = nacl_inverse_modify_patch_target (cfg->native_code) + patch_info->ip.i;
 #endif
 
+			if (patch_info == tier_jump) {
+				/* Patched by mini-tiered.c once the tier 1 code is ready */
+				cfg->tier_jump_site = ip;
+				break;
+			}
+
 			mono_domain_lock (domain);
 			jlist = (MonoJumpList *)g_hash_table_lookup (domain_jit_info (domain)->jump_target_hash, patch_info->data.method);
 			if (!jlist) {
@@ -3341,6 +3357,9 @@ init_backend (MonoBackend *backend)
 #ifdef MONO_ARCH_HAVE_OP_TAIL_CALL
 	backend->have_op_tail_call = 1;
 #endif
+#ifdef MONO_ARCH_HAVE_INLINE_BLOCK_OPS
+	backend->have_inline_block_ops = 1;
+#endif
 #ifndef MONO_ARCH_MONITOR_ENTER_ADJUSTMENT
 	backend->monitor_enter_adjustment = 1;
 #else
@@ -3631,6 +3650,14 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		cfg->disable_out_of_line_bblocks = TRUE;
 	}
 
+	if ((flags & JIT_FLAG_TIER0) && mini_tiered_method_is_eligible (cfg)) {
+		cfg->tier0 = TRUE;
+		cfg->tier_info = mini_tiered_get_info (method, domain, opts);
+		cfg->opt = mini_tiered_get_tier0_optimizations (cfg->opt);
+		/* The counts are used when compiling the tier 1 code */
+		cfg->pgo_instrument = mono_pgo_inlining;
+	}
+
 	if (mono_using_xdebug) {
 		/* 
 		 * Make each variable use its own register/stack slot and extend 
@@ -3692,6 +3719,11 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 
 	if (cfg->opt & MONO_OPT_ABCREM)
 		cfg->opt |= MONO_OPT_SSA;
+	/* The loop optimizations need the natural loops, and run as part of the SSA passes */
+	if (cfg->opt & MONO_OPT_LICM)
+		cfg->opt |= MONO_OPT_SSA | MONO_OPT_LOOP;
+	if (cfg->opt & MONO_OPT_ESCAPE)
+		cfg->opt |= MONO_OPT_SSA;
 
 	cfg->rs = mono_regstate_new ();
 	cfg->next_vreg = cfg->rs->next_vreg;
@@ -3900,12 +3932,28 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		if ((cfg->flags & (MONO_CFG_HAS_LDELEMA|MONO_CFG_HAS_CHECK_THIS)) && (cfg->opt & MONO_OPT_ABCREM))
 			MONO_TIME_TRACK (mono_jit_stats.jit_perform_abc_removal, mono_perform_abc_removal (cfg));
 
+		/* Before the SSA removal, since this depends on every vreg having one definition */
+		if (cfg->opt & MONO_OPT_ESCAPE)
+			MONO_TIME_TRACK (mono_jit_stats.jit_escape_analysis, mono_escape_analysis (cfg));
+
 		MONO_TIME_TRACK (mono_jit_stats.jit_ssa_remove, mono_ssa_remove (cfg));
 		MONO_TIME_TRACK (mono_jit_stats.jit_local_cprop2, mono_local_cprop (cfg));
 		MONO_TIME_TRACK (mono_jit_stats.jit_handle_global_vregs2, mono_handle_global_vregs (cfg));
 		if (cfg->opt & MONO_OPT_DEADCE)
 			MONO_TIME_TRACK (mono_jit_stats.jit_local_deadce2, mono_local_deadce (cfg));
 
+		if (cfg->opt & MONO_OPT_LICM) {
+			gboolean changed = FALSE;
+
+			MONO_TIME_TRACK (mono_jit_stats.jit_loop_opts, changed |= mono_loop_invariant_code_motion (cfg));
+			MONO_TIME_TRACK (mono_jit_stats.jit_loop_opts, changed |= mono_loop_strength_reduction (cfg));
+			if ((cfg->flags & MONO_CFG_HAS_ARRAY_ACCESS) && (cfg->opt & MONO_OPT_ABCREM))
+				MONO_TIME_TRACK (mono_jit_stats.jit_loop_opts, changed |= mono_loop_bounds_check_removal (cfg));
+			/* The moved code uses local vregs in other bblocks */
+			if (changed)
+				MONO_TIME_TRACK (mono_jit_stats.jit_handle_global_vregs2, mono_handle_global_vregs (cfg));
+		}
+
 		if (cfg->opt & MONO_OPT_BRANCH)
 			MONO_TIME_TRACK (mono_jit_stats.jit_optimize_branches2, mono_optimize_branches (cfg));
 	}
@@ -3988,7 +4036,11 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 					}
 				}
 			}
-			MONO_TIME_TRACK (mono_jit_stats.jit_linear_scan, mono_linear_scan (cfg, vars, regs, &cfg->used_int_regs));
+			if (cfg->opt & MONO_OPT_GCOLOR) {
+				MONO_TIME_TRACK (mono_jit_stats.jit_graph_coloring, mono_graph_coloring (cfg, vars, regs, &cfg->used_int_regs));
+			} else {
+				MONO_TIME_TRACK (mono_jit_stats.jit_linear_scan, mono_linear_scan (cfg, vars, regs, &cfg->used_int_regs));
+			}
 		}
 	}
 
@@ -4217,13 +4269,67 @@ void mono_update_jit_stats (MonoCompile *cfg)
 	mono_jit_stats.code_reallocs += cfg->stat_code_reallocs;
 }
 
+#ifndef DISABLE_JIT
+
+/*
+ * mono_jit_patch_jump_targets:
+ *
+ *   Patch the jumps to METHOD recorded in the jump_target_hash of DOMAIN to point to
+ * the code of METHOD registered in the jit code hash. The domain lock must be held.
+ */
+void
+mono_jit_patch_jump_targets (MonoDomain *domain, MonoMethod *method, MonoError *error)
+{
+	MonoJumpInfo patch_info;
+	MonoJumpList *jlist;
+	GSList *tmp;
+
+	mono_error_init (error);
+
+	if (!domain_jit_info (domain)->jump_target_hash)
+		return;
+
+	jlist = (MonoJumpList *)g_hash_table_lookup (domain_jit_info (domain)->jump_target_hash, method);
+	if (!jlist)
+		return;
+
+	patch_info.next = NULL;
+	patch_info.ip.i = 0;
+	patch_info.type = MONO_PATCH_INFO_METHOD_JUMP;
+	patch_info.data.method = method;
+	g_hash_table_remove (domain_jit_info (domain)->jump_target_hash, method);
+
+#if defined(__native_client_codegen__) && defined(__native_client__)
+	/* These patches are applied after a method has been installed, no target munging is needed. */
+	nacl_allow_target_modification (FALSE);
+#endif
+#ifdef MONO_ARCH_HAVE_PATCH_CODE_NEW
+	for (tmp = jlist->list; tmp; tmp = tmp->next) {
+		gpointer target = mono_resolve_patch_target (NULL, domain, (guint8 *)tmp->data, &patch_info, TRUE, error);
+		if (!mono_error_ok (error))
+			break;
+		mono_arch_patch_code_new (NULL, domain, (guint8 *)tmp->data, &patch_info, target);
+	}
+#else
+	for (tmp = jlist->list; tmp; tmp = tmp->next)
+		mono_arch_patch_code (NULL, NULL, domain, tmp->data, &patch_info, TRUE);
+#endif
+#if defined(__native_client_codegen__) && defined(__native_client__)
+	nacl_allow_target_modification (TRUE);
+#endif
+}
+
+#endif
+
 /*
  * mono_jit_compile_method_inner:
  *
- *   Main entry point for the JIT.
+ *   Main entry point for the JIT. FLAGS is passed to mini_method_compile (). The class
+ * constructor of the method's class is not run, callers do that once other threads can
+ * use the code, since it can call methods which wait for it.
  */
 gpointer
-mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, MonoError *error)
+mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, JitFlags flags, MonoError *error)
 {
 	MonoCompile *cfg;
 	gpointer code = NULL;
@@ -4233,6 +4339,7 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	guint32 prof_options;
 	GTimer *jit_timer;
 	MonoMethod *prof_method, *shared;
+	GSList *compile_ahead_methods = NULL;
 
 	mono_error_init (error);
 
@@ -4350,8 +4457,11 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		return NULL;
 	}
 
+	if (mono_tiered_compilation)
+		flags |= JIT_FLAG_TIER0;
+
 	jit_timer = mono_time_track_start ();
-	cfg = mini_method_compile (method, opt, target_domain, JIT_FLAG_RUN_CCTORS, 0, -1);
+	cfg = mini_method_compile (method, opt, target_domain, flags, 0, -1);
 	mono_time_track_end (&mono_jit_stats.jit_time, jit_timer);
 
 	prof_method = cfg->method;
@@ -4431,6 +4541,15 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 
 		code = cfg->native_code;
 
+		if (cfg->tier0)
+			mini_tiered_register_tier0 (cfg);
+
+		/* Queued once the domain lock is released, since it can start threads */
+		compile_ahead_methods = g_slist_copy (cfg->compile_ahead_methods);
+
+		if (mono_jit_cache_enabled)
+			mini_jit_cache_add_method (method);
+
 		if (cfg->gshared && mono_method_is_generic_sharable (method, FALSE))
 			mono_stats.generics_shared_methods++;
 		if (cfg->gsharedvt)
@@ -4450,38 +4569,7 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	mono_destroy_compile (cfg);
 
 #ifndef DISABLE_JIT
-	if (domain_jit_info (target_domain)->jump_target_hash) {
-		MonoJumpInfo patch_info;
-		MonoJumpList *jlist;
-		GSList *tmp;
-		jlist = (MonoJumpList *)g_hash_table_lookup (domain_jit_info (target_domain)->jump_target_hash, method);
-		if (jlist) {
-			patch_info.next = NULL;
-			patch_info.ip.i = 0;
-			patch_info.type = MONO_PATCH_INFO_METHOD_JUMP;
-			patch_info.data.method = method;
-			g_hash_table_remove (domain_jit_info (target_domain)->jump_target_hash, method);
-
-#if defined(__native_client_codegen__) && defined(__native_client__)
-			/* These patches are applied after a method has been installed, no target munging is needed. */
-			nacl_allow_target_modification (FALSE);
-#endif
-#ifdef MONO_ARCH_HAVE_PATCH_CODE_NEW
-			for (tmp = jlist->list; tmp; tmp = tmp->next) {
-				gpointer target = mono_resolve_patch_target (NULL, target_domain, (guint8 *)tmp->data, &patch_info, TRUE, error);
-				if (!mono_error_ok (error))
-					break;
-				mono_arch_patch_code_new (NULL, target_domain, (guint8 *)tmp->data, &patch_info, target);
-			}
-#else
-			for (tmp = jlist->list; tmp; tmp = tmp->next)
-				mono_arch_patch_code (NULL, NULL, target_domain, tmp->data, &patch_info, TRUE);
-#endif
-#if defined(__native_client_codegen__) && defined(__native_client__)
-			nacl_allow_target_modification (TRUE);
-#endif
-		}
-	}
+	mono_jit_patch_jump_targets (target_domain, method, error);
 
 	/* Update llvm callees */
 	if (domain_jit_info (target_domain)->llvm_jit_callees) {
@@ -4499,6 +4587,11 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 #endif
 	mono_domain_unlock (target_domain);
 
+	if (compile_ahead_methods) {
+		mono_jit_compile_ahead (target_domain, compile_ahead_methods);
+		g_slist_free (compile_ahead_methods);
+	}
+
 	if (!mono_error_ok (error))
 		return NULL;
 
@@ -4524,8 +4617,6 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		}
 	}
 
-	if (!mono_runtime_class_init_full (vtable, error))
-		return NULL;
 	return code;
 }
 
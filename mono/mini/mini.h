@@ -115,7 +115,7 @@
 #endif
 
 /* Version number of the AOT file format */
-#define MONO_AOT_FILE_VERSION 133
+#define MONO_AOT_FILE_VERSION 134
 
 //TODO: This is x86/amd64 specific.
 #define mono_simd_shuffle_mask(a,b,c,d) ((a) | ((b) << 2) | ((c) << 4) | ((d) << 6))
@@ -547,6 +547,15 @@ extern const char *mono_build_date;
 extern gboolean mono_do_signal_chaining;
 extern gboolean mono_do_crash_chaining;
 extern MONO_API gboolean mono_use_llvm;
+extern gboolean mono_tiered_compilation;
+extern int mono_tiered_threshold;
+extern int mono_compile_ahead_threads;
+extern gboolean mono_pgo_inlining;
+extern char *mono_pgo_file;
+extern gboolean mono_pgo_have_counts;
+extern gboolean mono_jit_cache_enabled;
+extern char *mono_jit_cache_dir;
+extern gboolean mono_guarded_devirt;
 extern gboolean mono_do_single_method_regression;
 extern guint32 mono_single_method_regression_opt;
 extern MonoMethod *mono_current_single_method;
@@ -900,6 +909,17 @@ struct MonoInst {
 	MonoClass *klass;
 };
 	
+/*
+ * An allocation emitted by handle_alloc (), which can be removed by
+ * mono_escape_analysis () if the object doesn't escape.
+ */
+typedef struct {
+	MonoInst *ins;
+	MonoClass *klass;
+	/* NULL if the vtable is not a constant */
+	MonoVTable *vtable;
+} MonoAllocSite;
+
 struct MonoCallInst {
 	MonoInst inst;
 	MonoMethodSignature *signature;
@@ -1166,6 +1186,11 @@ typedef struct {
 	 * The calling assembly in llvmonly mode.
 	 */
 	MonoImage *calling_image;
+
+	/*
+	 * The number of methods this thread is compiling, see wait_or_register_method_to_compile ().
+	 */
+	int active_jit_methods;
 } MonoJitTlsData;
 
 /*
@@ -1464,6 +1489,7 @@ typedef struct {
 	guint            have_tls_get_reg : 1;
 	guint            have_liverange_ops: 1;
 	guint            have_op_tail_call : 1;
+	guint            have_inline_block_ops : 1;
 	guint            have_dummy_init : 1;
 	guint            gshared_supported : 1;
 	guint            use_fpstack : 1;
@@ -1491,8 +1517,40 @@ typedef enum {
 	JIT_FLAG_EXPLICIT_NULL_CHECKS = (1 << 5),
 	/* Whenever to compile in llvm-only mode */
 	JIT_FLAG_LLVM_ONLY = (1 << 6),
+	/* Whenever to compile a tier 0 version of the method if possible, see mini-tiered.c */
+	JIT_FLAG_TIER0 = (1 << 7),
 } JitFlags;
 
+#define MONO_TIERED_DEFAULT_THRESHOLD 30
+
+typedef enum {
+	MONO_TIER_STATE_TIER0,
+	MONO_TIER_STATE_QUEUED,
+	MONO_TIER_STATE_READY,
+	MONO_TIER_STATE_FAILED
+} MonoTierState;
+
+/*
+ * Per-method state of tiered compilation. It is referenced directly by the prologue
+ * of the tier 0 code, so it is never freed.
+ */
+typedef struct {
+	/* Decremented on every invocation of the tier 0 code */
+	gint32 counter;
+	/* A MonoTierState */
+	gint32 state;
+	MonoMethod *method;
+	MonoDomain *domain;
+	/* The optimizations to use for tier 1 */
+	guint32 opt;
+	/* The jump to the method itself in the tier 0 prologue */
+	guint8 *jump_site;
+	/* Whenever the info is in the tier 1 queue, protected by the tiered mutex */
+	gboolean queued;
+	/* Incremented by mini_tiered_recompile (), protected by the tiered mutex */
+	guint32 invalidations;
+} MonoTierInfo;
+
 /* Bit-fields in the MonoBasicBlock.region */
 #define MONO_REGION_TRY       0
 #define MONO_REGION_FINALLY  16
@@ -1701,12 +1759,19 @@ typedef struct {
 	guint            gsharedvt : 1;
 	guint            r4fp : 1;
 	guint            llvm_only : 1;
+	guint            tier0 : 1;
+	guint            pgo_instrument : 1;
 	int              r4_stack_type;
 	gpointer         debug_info;
 	guint32          lmf_offset;
     guint16          *intvars;
 	MonoProfileCoverageInfo *coverage_info;
 	GHashTable       *token_info_hash;
+	/* Tiered compilation, only set when compiling tier 0 code */
+	MonoTierInfo     *tier_info;
+	guint8           *tier_jump_site;
+	/* Methods called directly by this method, see mono_jit_compile_ahead () */
+	GSList           *compile_ahead_methods;
 	MonoCompileArch  arch;
 	guint32          inline_depth;
 	/* Size of memory reserved for thunks */
@@ -1819,6 +1884,9 @@ typedef struct {
 
 	GSList *signatures;
 
+	/* The MonoAllocSites of the allocations mono_escape_analysis () might remove */
+	GSList *alloc_sites;
+
 	/* GC Maps */
    
 	/* The offsets of the locals area relative to the frame pointer */
@@ -1889,6 +1957,10 @@ typedef struct {
 	gint32 alias_removed;
 	gint32 loads_eliminated;
 	gint32 stores_eliminated;
+	gint32 methods_waited;
+	gint32 methods_compiled_concurrently;
+	gint32 methods_compiled_ahead;
+	gint32 allocations_scalar_replaced;
 	int methods_with_llvm;
 	int methods_without_llvm;
 	char *max_ratio_method;
@@ -1912,16 +1984,19 @@ typedef struct {
 	double jit_ssa_cprop;
 	double jit_ssa_deadce;
 	double jit_perform_abc_removal;
+	double jit_escape_analysis;
 	double jit_ssa_remove;
 	double jit_local_cprop2;
 	double jit_handle_global_vregs2;
 	double jit_local_deadce2;
+	double jit_loop_opts;
 	double jit_optimize_branches2;
 	double jit_decompose_vtype_opts;
 	double jit_decompose_array_access_opts;
 	double jit_liveness_handle_exception_clauses2;
 	double jit_analyze_liveness;
 	double jit_linear_scan;
+	double jit_graph_coloring;
 	double jit_arch_allocate_vars;
 	double jit_spill_global_vars;
 	double jit_local_cprop3;
@@ -2369,7 +2444,9 @@ gpointer  mono_resolve_patch_target         (MonoMethod *method, MonoDomain *dom
 gpointer  mono_jit_find_compiled_method_with_jit_info (MonoDomain *domain, MonoMethod *method, MonoJitInfo **ji);
 gpointer  mono_jit_find_compiled_method     (MonoDomain *domain, MonoMethod *method);
 gpointer  mono_jit_compile_method           (MonoMethod *method, MonoError *error);
-gpointer  mono_jit_compile_method_inner     (MonoMethod *method, MonoDomain *target_domain, int opt, MonoError *error);
+gpointer  mono_jit_compile_method_inner     (MonoMethod *method, MonoDomain *target_domain, int opt, JitFlags flags, MonoError *error);
+void      mono_jit_compile_ahead            (MonoDomain *domain, GSList *methods);
+void      mono_jit_patch_jump_targets       (MonoDomain *domain, MonoMethod *method, MonoError *error);
 MonoLMF * mono_get_lmf                      (void);
 MonoLMF** mono_get_lmf_addr                 (void);
 void      mono_set_lmf                      (MonoLMF *lmf);
@@ -2392,6 +2469,7 @@ GList    *mono_varlist_sort                 (MonoCompile *cfg, GList *list, int
 void      mono_analyze_liveness             (MonoCompile *cfg);
 void      mono_analyze_liveness_gc          (MonoCompile *cfg);
 void      mono_linear_scan                  (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask);
+void      mono_graph_coloring               (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask);
 void      mono_global_regalloc              (MonoCompile *cfg);
 void      mono_create_jump_table            (MonoCompile *cfg, MonoInst *label, MonoBasicBlock **bbs, int num_blocks);
 MonoCompile *mini_method_compile            (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFlags flags, int parts, int aot_method_index);
@@ -2940,6 +3018,43 @@ extern void
 mono_local_deadce (MonoCompile *cfg);
 void
 mono_local_alias_analysis (MonoCompile *cfg);
+gboolean
+mono_loop_invariant_code_motion (MonoCompile *cfg);
+gboolean
+mono_loop_strength_reduction (MonoCompile *cfg);
+gboolean
+mono_loop_bounds_check_removal (MonoCompile *cfg);
+void
+mono_escape_analysis (MonoCompile *cfg);
+
+/* Tiered compilation */
+void         mini_tiered_init                    (void);
+void         mini_tiered_shutdown                (void);
+gboolean     mini_tiered_method_is_eligible      (MonoCompile *cfg);
+guint32      mini_tiered_get_tier0_optimizations (guint32 opts);
+MonoTierInfo *mini_tiered_get_info               (MonoMethod *method, MonoDomain *domain, guint32 opts);
+void         mini_tiered_register_tier0          (MonoCompile *cfg);
+void         mono_tiered_request_tier1           (MonoTierInfo *info);
+void         mini_tiered_recompile               (MonoMethod *method);
+
+/* Profile guided inlining */
+void         mini_pgo_init                       (void);
+void         mini_pgo_cleanup                    (void);
+gint32      *mini_pgo_get_entry_counter          (MonoMethod *method);
+gint32      *mini_pgo_get_call_site_counter      (MonoMethod *method, int il_offset);
+int          mini_pgo_get_inline_limit           (MonoMethod *method, int il_offset, int code_size, int limit);
+
+/* Persistent JIT cache */
+void         mini_jit_cache_init                 (void);
+void         mini_jit_cache_cleanup              (void);
+char        *mini_jit_cache_get_image_name       (MonoAssembly *assembly);
+void         mini_jit_cache_add_method           (MonoMethod *method);
+
+/* Class hierarchy analysis */
+void         mini_cha_init                       (void);
+void         mini_cha_vtable_created             (MonoVTable *vtable);
+MonoClass   *mini_cha_get_implementor            (MonoClass *klass, MonoMethod *dependent);
+void         mini_cha_remove_dependent           (MonoMethod *method);
 
 /* Generic sharing */
 
@@ -3100,15 +3215,18 @@ enum {
 	SIMD_VERSION_SSE41	= 1 << 4,
 	SIMD_VERSION_SSE42	= 1 << 5,
 	SIMD_VERSION_SSE4a	= 1 << 6,
+	SIMD_VERSION_AVX	= 1 << 7,
+	SIMD_VERSION_AVX2	= 1 << 8,
 	SIMD_VERSION_ALL	= SIMD_VERSION_SSE1 | SIMD_VERSION_SSE2 |
 			  SIMD_VERSION_SSE3 | SIMD_VERSION_SSSE3 |
 			  SIMD_VERSION_SSE41 | SIMD_VERSION_SSE42 |
-			  SIMD_VERSION_SSE4a,
+			  SIMD_VERSION_SSE4a | SIMD_VERSION_AVX |
+			  SIMD_VERSION_AVX2,
 
 	/* this value marks the end of the bit indexes used in 
 	 * this emum.
 	 */
-	SIMD_VERSION_INDEX_END = 6 
+	SIMD_VERSION_INDEX_END = 8 
 };
 
 enum {
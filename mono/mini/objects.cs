@@ -117,6 +117,25 @@ struct Gamma {
 	public Beta a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t,u,v;
 }
 
+class EscapePoint {
+	public int x, y;
+	public EscapePoint (int x, int y) {
+		this.x = x;
+		this.y = y;
+	}
+	public int Sum () {
+		return x + y;
+	}
+}
+
+class EscapeFields {
+	public byte b;
+	public short s;
+	public long l;
+	public double d;
+	public object o;
+}
+
 class Tests {
 
 #if !__MOBILE__
@@ -1765,6 +1784,107 @@ ncells ) {
 	public static int test_142_byte_enum_arg_zero_extend () {
 		return enum_arg_zero_extend (ByteEnum2.High);
 	}
+
+	public static int test_0_escape_scalar_replace () {
+		int sum = 0;
+		for (int i = 0; i < 10; ++i) {
+			var p = new EscapePoint (i, 2 * i);
+			sum += p.Sum ();
+		}
+		return sum == 135 ? 0 : 1;
+	}
+
+	public static int test_0_escape_fields_zeroed () {
+		var f = new EscapeFields ();
+		if (f.b != 0 || f.s != 0 || f.l != 0 || f.d != 0.0 || f.o != null)
+			return 1;
+		f.b = 255;
+		f.s = -2;
+		f.l = 1L << 40;
+		f.d = 1.5;
+		f.o = "A";
+		if (f.b != 255 || f.s != -2 || f.l != 1L << 40 || f.d != 1.5 || (string)f.o != "A")
+			return 2;
+		return 0;
+	}
+
+	static int escape_branches (bool b) {
+		var p = new EscapePoint (1, 2);
+		if (b)
+			p.x = 5;
+		else
+			p.y = 7;
+		return p.Sum ();
+	}
+
+	public static int test_0_escape_branches () {
+		if (escape_branches (true) != 7)
+			return 1;
+		if (escape_branches (false) != 8)
+			return 2;
+		return 0;
+	}
+
+	static EscapePoint escaped_point;
+
+	public static int test_0_escape_escaping () {
+		var p = new EscapePoint (3, 4);
+		escaped_point = p;
+		p.x = 10;
+		return escaped_point.x == 10 ? 0 : 1;
+	}
+
+	public static int test_0_escape_box_unbox () {
+		int sum = 0;
+		for (int i = 0; i < 10; ++i) {
+			object o = i;
+			sum += (int)o;
+		}
+		object l = 1L << 33;
+		if ((long)l != 1L << 33)
+			return 2;
+		return sum == 45 ? 0 : 1;
+	}
+
+	public static int test_0_escape_unbox_wrong_type () {
+		object o = 1;
+		try {
+			long l = (long)o;
+			return 1;
+		} catch (InvalidCastException) {
+		}
+		return 0;
+	}
+
+	// 16 * 8 + 4 + 3 bytes, copied using vector moves with a scalar tail
+	struct BlockStruct {
+		public long a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15;
+		public int b;
+		public byte c0, c1, c2;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static BlockStruct copy_block_struct (ref BlockStruct s) {
+		BlockStruct res = s;
+		return res;
+	}
+
+	public static int test_0_block_struct_copy_init () {
+		BlockStruct s = new BlockStruct ();
+		s.a0 = 1;
+		s.a8 = 9;
+		s.a15 = 16;
+		s.b = 17;
+		s.c2 = 18;
+
+		BlockStruct s2 = copy_block_struct (ref s);
+		if (s2.a0 != 1 || s2.a8 != 9 || s2.a15 != 16 || s2.b != 17 || s2.c0 != 0 || s2.c2 != 18)
+			return 1;
+		s2 = new BlockStruct ();
+		if (s2.a0 != 0 || s2.a15 != 0 || s2.b != 0 || s2.c2 != 0)
+			return 2;
+		return 0;
+	}
 }
 
 #if __MOBILE__
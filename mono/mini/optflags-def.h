@@ -20,6 +20,7 @@ OPTFLAG(ABCREM   ,18, "abcrem",     "Array bound checks removal")
 OPTFLAG(SSAPRE   ,19, "ssapre",     "SSA based Partial Redundancy Elimination (obsolete)")
 OPTFLAG(EXCEPTION,20, "exception",  "Optimize exception catch blocks")
 OPTFLAG(SSA      ,21, "ssa",        "Use plain SSA form")
+OPTFLAG(ESCAPE   ,22, "escape",     "Escape analysis and scalar replacement")
 OPTFLAG(SSE2     ,23, "sse2",       "SSE2 instructions on x86")
 OPTFLAG(GSHARED  ,25, "gshared",    "Generic Sharing")
 /* The id has to be smaller than gshared's, the parser code depends on this */
@@ -28,4 +29,6 @@ OPTFLAG(SIMD	 ,26, "simd",	    "Simd intrinsics")
 OPTFLAG(UNSAFE	 ,27, "unsafe",	    "Remove bound checks and perform other dangerous changes")
 OPTFLAG(ALIAS_ANALYSIS	 ,28, "alias-analysis",      "Alias analysis of locals")
 OPTFLAG(FLOAT32  ,29, "float32",    "Use 32 bit float arithmetic if possible")
+OPTFLAG(LICM     ,30, "licm",       "Loop invariant code motion and strength reduction")
+OPTFLAG(GCOLOR   ,31, "gcolor",     "Graph coloring instead of linear scan global reg allocation")
 
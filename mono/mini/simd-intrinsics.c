@@ -90,7 +90,14 @@ enum {
 	SIMD_EMIT_LOAD_ALIGNED,
 	SIMD_EMIT_STORE,
 	SIMD_EMIT_EXTRACT_MASK,
-	SIMD_EMIT_PREFETCH
+	SIMD_EMIT_PREFETCH,
+	SIMD_EMIT_BINARY_256
+};
+
+/* The instruction set which has the ymm form of a SIMD_EMIT_BINARY_256 intrinsic */
+enum {
+	SIMD_256_AVX,
+	SIMD_256_AVX2
 };
 
 #ifdef HAVE_ARRAY_ELEM_INIT
@@ -132,7 +139,7 @@ enum {
 typedef struct {
 	guint16 name;
 	guint16 opcode;
-	guint8 simd_version_flags;
+	guint16 simd_version_flags;
 	guint8 simd_emit_mode : 4;
 	guint8 flags : 4;
 } SimdIntrinsc;
@@ -594,6 +601,51 @@ static const SimdIntrinsc vector16sb_intrinsics[] = {
 	{ SN_set_V9, 9, SIMD_VERSION_SSE1, SIMD_EMIT_SETTER },
 };
 
+#ifdef MONO_ARCH_HAVE_SIMD_256_OPS
+/*
+ * The simd version is the one the two 128 bit halves need, the flags say which version
+ * the ymm form needs.
+ */
+static const SimdIntrinsc vector8f_intrinsics[] = {
+	{ SN_Max, OP_MAXPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_Min, OP_MINPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_Addition, OP_ADDPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_BitwiseAnd, OP_ANDPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_BitwiseOr, OP_ORPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_Division, OP_DIVPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_ExclusiveOr, OP_XORPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_Multiply, OP_MULPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+	{ SN_op_Subtraction, OP_SUBPS, SIMD_VERSION_SSE1, SIMD_EMIT_BINARY_256, SIMD_256_AVX },
+};
+
+static const SimdIntrinsc vector8i_intrinsics[] = {
+	{ SN_CompareEqual, OP_PCMPEQD, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_CompareGreaterThan, OP_PCMPGTD, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_Max, OP_PMAXD, SIMD_VERSION_SSE41, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_Min, OP_PMIND, SIMD_VERSION_SSE41, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_Addition, OP_PADDD, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_BitwiseAnd, OP_PAND, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_BitwiseOr, OP_POR, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_ExclusiveOr, OP_PXOR, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_Multiply, OP_PMULD, SIMD_VERSION_SSE41, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_Subtraction, OP_PSUBD, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+};
+
+static const SimdIntrinsc vector32b_intrinsics[] = {
+	{ SN_AddWithSaturation, OP_PADDB_SAT_UN, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_Average, OP_PAVGB_UN, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_CompareEqual, OP_PCMPEQB, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_Max, OP_PMAXB_UN, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_Min, OP_PMINB_UN, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_SubtractWithSaturation, OP_PSUBB_SAT_UN, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_Addition, OP_PADDB, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_BitwiseAnd, OP_PAND, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_BitwiseOr, OP_POR, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_ExclusiveOr, OP_PXOR, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+	{ SN_op_Subtraction, OP_PSUBB, SIMD_VERSION_SSE2, SIMD_EMIT_BINARY_256, SIMD_256_AVX2 },
+};
+#endif
+
 static guint32 simd_supported_versions;
 
 /*TODO match using number of parameters as well*/
@@ -1475,10 +1527,50 @@ simd_version_name (guint32 version)
 		return "sse42";
 	case SIMD_VERSION_SSE4a:
 		return "sse4a";
+	case SIMD_VERSION_AVX:
+		return "avx";
+	case SIMD_VERSION_AVX2:
+		return "avx2";
 	}
 	return "n/a";
 }
 
+#ifdef MONO_ARCH_HAVE_SIMD_256_OPS
+/*
+ * The 256 bit vectors don't fit into an xreg, so they aren't simd types, they live in
+ * memory like other 32 byte valuetypes and OP_XBINOP_256 works on their addresses.
+ */
+static MonoInst*
+simd_intrinsic_emit_binary_256 (const SimdIntrinsc *intrinsic, MonoCompile *cfg, MonoMethod *cmethod, MonoInst **args)
+{
+	MonoMethodSignature *sig = mono_method_signature (cmethod);
+	MonoClass *klass = mono_class_from_mono_type (sig->ret);
+	MonoInst *ins, *result, *dest, *left, *right;
+	guint32 ymm_version = intrinsic->flags == SIMD_256_AVX2 ? SIMD_VERSION_AVX2 : SIMD_VERSION_AVX;
+
+	if (COMPILE_LLVM (cfg) || args [0]->type != STACK_VTYPE || args [1]->type != STACK_VTYPE)
+		return NULL;
+
+	result = mono_compile_create_var (cfg, &klass->byval_arg, OP_LOCAL);
+	EMIT_NEW_VARLOADA_VREG (cfg, left, args [0]->dreg, sig->params [0]);
+	EMIT_NEW_VARLOADA_VREG (cfg, right, args [1]->dreg, sig->params [1]);
+	EMIT_NEW_VARLOADA (cfg, dest, result, &klass->byval_arg);
+
+	MONO_INST_NEW (cfg, ins, OP_XBINOP_256);
+	ins->dreg = alloc_ireg (cfg);
+	ins->sreg1 = dest->dreg;
+	ins->sreg2 = left->dreg;
+	ins->sreg3 = right->dreg;
+	ins->inst_c0 = intrinsic->opcode;
+	/* AOT code can run on other cpus */
+	ins->inst_c1 = !cfg->compile_aot && (simd_supported_versions & ymm_version);
+	MONO_ADD_INS (cfg->cbb, ins);
+
+	EMIT_NEW_TEMPLOAD (cfg, ins, result->inst_c0);
+	return ins;
+}
+#endif
+
 static MonoInst*
 emit_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args, const SimdIntrinsc *intrinsics, guint32 size)
 {
@@ -1538,6 +1630,10 @@ emit_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsi
 		return simd_intrinsic_emit_extract_mask (result, cfg, cmethod, args);
 	case SIMD_EMIT_PREFETCH:
 		return simd_intrinsic_emit_prefetch (result, cfg, cmethod, args);
+#ifdef MONO_ARCH_HAVE_SIMD_256_OPS
+	case SIMD_EMIT_BINARY_256:
+		return simd_intrinsic_emit_binary_256 (result, cfg, cmethod, args);
+#endif
 	}
 	g_assert_not_reached ();
 }
@@ -1654,8 +1750,13 @@ mono_emit_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSign
 		if (!(cmethod->flags & METHOD_ATTRIBUTE_STATIC))
 			return NULL;
 		class_name = mono_class_from_mono_type (mono_method_signature (cmethod)->params [0])->name;
-	} else if (!cmethod->klass->simd_type)
-		return NULL;
+	} else if (!cmethod->klass->simd_type) {
+#ifdef MONO_ARCH_HAVE_SIMD_256_OPS
+		/* See simd_intrinsic_emit_binary_256 () */
+		if (strcmp ("Vector8f", class_name) && strcmp ("Vector8i", class_name) && strcmp ("Vector32b", class_name))
+#endif
+			return NULL;
+	}
 
 	cfg->uses_simd_intrinsics = 1;
 	if (!strcmp ("Vector2d", class_name))
@@ -1678,6 +1779,14 @@ mono_emit_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSign
 		return emit_intrinsics (cfg, cmethod, fsig, args, vector16b_intrinsics, sizeof (vector16b_intrinsics) / sizeof (SimdIntrinsc));
 	if (!strcmp ("Vector16sb", class_name))
 		return emit_intrinsics (cfg, cmethod, fsig, args, vector16sb_intrinsics, sizeof (vector16sb_intrinsics) / sizeof (SimdIntrinsc));
+#ifdef MONO_ARCH_HAVE_SIMD_256_OPS
+	if (!strcmp ("Vector8f", class_name))
+		return emit_intrinsics (cfg, cmethod, fsig, args, vector8f_intrinsics, sizeof (vector8f_intrinsics) / sizeof (SimdIntrinsc));
+	if (!strcmp ("Vector8i", class_name))
+		return emit_intrinsics (cfg, cmethod, fsig, args, vector8i_intrinsics, sizeof (vector8i_intrinsics) / sizeof (SimdIntrinsc));
+	if (!strcmp ("Vector32b", class_name))
+		return emit_intrinsics (cfg, cmethod, fsig, args, vector32b_intrinsics, sizeof (vector32b_intrinsics) / sizeof (SimdIntrinsc));
+#endif
 
 	return NULL;
 }
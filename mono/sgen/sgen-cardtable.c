@@ -36,6 +36,11 @@
 #endif
 #include <sys/types.h>
 
+#if defined(__SSE2__) && defined(__GNUC__)
+#define SGEN_HAVE_SSE2_CARD_SCAN	1
+#include <emmintrin.h>
+#endif
+
 guint8 *sgen_cardtable;
 
 static gboolean need_mod_union;
@@ -56,6 +61,23 @@ static guint64 last_los_scan_time;
 
 static void sgen_card_tables_collect_stats (gboolean begin);
 
+#ifdef SGEN_HAVE_OVERLAPPING_CARDS
+/*
+ * The summary has one bit per CARDS_PER_SUMMARY_BIT cards of the shadow card table, set if
+ * any of those cards is marked.  It's built while the cards are moved to the shadow table
+ * at the start of a nursery collection, and lets the remembered set scan skip clean blocks
+ * and large objects without touching their cards.  Bits can be set spuriously, because
+ * the stale parts of the shadow table are summarized, too, but never the other way round.
+ */
+#define CARD_SUMMARY_BITS	6
+#define CARDS_PER_SUMMARY_BIT	(1 << CARD_SUMMARY_BITS)
+#define CARD_SUMMARY_COUNT	(CARD_COUNT_IN_BYTES >> CARD_SUMMARY_BITS)
+#define CARD_SUMMARY_MASK	(CARD_SUMMARY_COUNT - 1)
+
+static guint8 *card_summary;
+static gboolean card_summary_valid;
+#endif
+
 mword
 sgen_card_table_number_of_cards_in_range (mword address, mword size)
 {
@@ -138,6 +160,80 @@ sgen_card_table_wbarrier_generic_nostore (gpointer ptr)
 	sgen_card_table_mark_address ((mword)ptr);	
 }
 
+static inline int
+find_card_offset (mword card)
+{
+#if defined(__i386__) && defined(__GNUC__)
+	return  (__builtin_ffs (card) - 1) / 8;
+#elif defined(__x86_64__) && defined(__GNUC__)
+	return (__builtin_ffsll (card) - 1) / 8;
+#elif defined(__s390x__) && defined(__GNUC__)
+	return (__builtin_ffsll (GUINT64_TO_LE(card)) - 1) / 8;
+#else
+	int i;
+	guint8 *ptr = (guint8 *) &card;
+	for (i = 0; i < sizeof (mword); ++i) {
+		if (ptr[i])
+			return i;
+	}
+	return 0;
+#endif
+}
+
+/*
+ * Returns the first marked card in [cards, end), or `end` if there is none.  Most cards are
+ * clean, so we test 16 (with SSE2) or a word's worth of cards at once.
+ */
+guint8*
+sgen_card_table_find_next_marked_card (guint8 *cards, guint8 *end)
+{
+#ifdef SGEN_HAVE_SSE2_CARD_SCAN
+	const __m128i zero = _mm_setzero_si128 ();
+
+	while ((((mword)cards) & 15) && cards < end) {
+		if (*cards)
+			return cards;
+		++cards;
+	}
+
+	for (; end - cards >= 16; cards += 16) {
+		int clean = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_load_si128 ((__m128i*)cards), zero));
+		if (clean != 0xffff)
+			return cards + __builtin_ctz (~clean);
+	}
+#else
+	mword *words, *words_end;
+
+	while ((((mword)cards) & (sizeof (mword) - 1)) && cards < end) {
+		if (*cards)
+			return cards;
+		++cards;
+	}
+
+	words = (mword*)cards;
+	words_end = (mword*)((mword)end & ~(sizeof (mword) - 1));
+	for (; words < words_end; ++words) {
+		mword card = *words;
+		if (card)
+			return (guint8*)words + find_card_offset (card);
+	}
+	cards = (guint8*)words;
+#endif
+
+	for (; cards < end; ++cards) {
+		if (*cards)
+			return cards;
+	}
+
+	return end;
+}
+
+static inline gboolean
+cards_are_clean (guint8 *cards, guint8 *end)
+{
+	return sgen_card_table_find_next_marked_card (cards, end) == end;
+}
+
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
 
 guint8 *sgen_shadow_cardtable;
@@ -147,14 +243,33 @@ guint8 *sgen_shadow_cardtable;
 static gboolean
 sgen_card_table_region_begin_scanning (mword start, mword size)
 {
-	mword end = start + size;
-	/*XXX this can be improved to work on words and have a single loop induction var */
-	while (start < end) {
-		if (sgen_card_table_card_begin_scanning (start))
-			return TRUE;
-		start += CARD_SIZE_IN_BYTES;
+	guint8 *card = sgen_card_table_get_shadow_card_address (start);
+	mword num_cards = MIN (sgen_card_table_number_of_cards_in_range (start, size), CARD_COUNT_IN_BYTES);
+
+	if (card + num_cards > SGEN_SHADOW_CARDTABLE_END) {
+		mword first_chunk = SGEN_SHADOW_CARDTABLE_END - card;
+		return !cards_are_clean (card, SGEN_SHADOW_CARDTABLE_END) ||
+			!cards_are_clean (sgen_shadow_cardtable, sgen_shadow_cardtable + (num_cards - first_chunk));
+	}
+
+	return !cards_are_clean (card, card + num_cards);
+}
+
+/*
+ * Sets the summary bits for the `count` shadow cards starting at index `first`.  The range
+ * must not wrap around the end of the shadow table.
+ */
+static void
+summarize_shadow_cards (size_t first, size_t count)
+{
+	size_t chunk = first >> CARD_SUMMARY_BITS;
+	size_t last = (first + count - 1) >> CARD_SUMMARY_BITS;
+
+	for (; chunk <= last; ++chunk) {
+		guint8 *cards = sgen_shadow_cardtable + (chunk << CARD_SUMMARY_BITS);
+		if (!cards_are_clean (cards, cards + CARDS_PER_SUMMARY_BIT))
+			card_summary [chunk >> 3] |= 1 << (chunk & 7);
 	}
-	return FALSE;
 }
 
 #else
@@ -162,17 +277,9 @@ sgen_card_table_region_begin_scanning (mword start, mword size)
 static gboolean
 sgen_card_table_region_begin_scanning (mword start, mword size)
 {
-	gboolean res = FALSE;
 	guint8 *card = sgen_card_table_get_card_address (start);
 	guint8 *end = card + sgen_card_table_number_of_cards_in_range (start, size);
-
-	/*XXX this can be improved to work on words and have a branchless body */
-	while (card != end) {
-		if (*card++) {
-			res = TRUE;
-			break;
-		}
-	}
+	gboolean res = !cards_are_clean (card, end);
 
 	memset (sgen_card_table_get_card_address (start), 0, size >> CARD_BITS);
 
@@ -181,6 +288,36 @@ sgen_card_table_region_begin_scanning (mword start, mword size)
 
 #endif
 
+/*
+ * Whether any of the cards covering the range might have been marked before the current
+ * nursery collection.  Only meaningful while the remembered set is being scanned; at all
+ * other times, and without overlapping cards, this conservatively returns TRUE.
+ */
+gboolean
+sgen_card_table_summary_range_is_dirty (mword address, mword size)
+{
+#ifdef SGEN_HAVE_OVERLAPPING_CARDS
+	mword first, num_chunks;
+
+	if (!card_summary_valid)
+		return TRUE;
+
+	first = (address >> CARD_BITS) & CARD_MASK;
+	num_chunks = ((first + sgen_card_table_number_of_cards_in_range (address, size) - 1) >> CARD_SUMMARY_BITS) - (first >> CARD_SUMMARY_BITS) + 1;
+	if (num_chunks >= CARD_SUMMARY_COUNT)
+		return TRUE;
+
+	for (first >>= CARD_SUMMARY_BITS; num_chunks; --num_chunks, ++first) {
+		mword chunk = first & CARD_SUMMARY_MASK;
+		if (card_summary [chunk >> 3] & (1 << (chunk & 7)))
+			return TRUE;
+	}
+	return FALSE;
+#else
+	return TRUE;
+#endif
+}
+
 /*FIXME this assumes that major blocks are multiple of 4K which is pretty reasonable */
 gboolean
 sgen_card_table_get_card_data (guint8 *data_dest, mword address, mword cards)
@@ -238,12 +375,7 @@ sgen_card_table_is_range_marked (guint8 *cards, mword address, mword size)
 	guint8 *end = cards + sgen_card_table_number_of_cards_in_range (address, size);
 
 	/*This is safe since this function is only called by code that only passes continuous card blocks*/
-	while (cards != end) {
-		if (*cards++)
-			return TRUE;
-	}
-	return FALSE;
-
+	return !cards_are_clean (cards, end);
 }
 
 static void
@@ -365,14 +497,18 @@ move_cards_to_shadow_table (mword start, mword size)
 
 	if (bytes >= CARD_COUNT_IN_BYTES) {
 		memcpy (sgen_shadow_cardtable, sgen_cardtable, CARD_COUNT_IN_BYTES);
+		summarize_shadow_cards (0, CARD_COUNT_IN_BYTES);
 	} else if (to + bytes > SGEN_SHADOW_CARDTABLE_END) {
 		size_t first_chunk = SGEN_SHADOW_CARDTABLE_END - to;
 		size_t second_chunk = MIN (CARD_COUNT_IN_BYTES, bytes) - first_chunk;
 
 		memcpy (to, from, first_chunk);
 		memcpy (sgen_shadow_cardtable, sgen_cardtable, second_chunk);
+		summarize_shadow_cards (to - sgen_shadow_cardtable, first_chunk);
+		summarize_shadow_cards (0, second_chunk);
 	} else {
 		memcpy (to, from, bytes);
+		summarize_shadow_cards (to - sgen_shadow_cardtable, bytes);
 	}
 }
 
@@ -430,9 +566,11 @@ sgen_card_table_scan_remsets (ScanCopyContext ctx)
 
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
 	/*FIXME we should have a bit on each block/los object telling if the object have marked cards.*/
-	/*First we copy*/
+	/*First we copy, building the summary of the shadow table*/
+	memset (card_summary, 0, CARD_SUMMARY_COUNT / 8);
 	sgen_major_collector_iterate_live_block_ranges (move_cards_to_shadow_table);
 	sgen_los_iterate_live_block_ranges (move_cards_to_shadow_table);
+	card_summary_valid = TRUE;
 
 	/*Then we clear*/
 	sgen_card_table_clear_cards ();
@@ -446,6 +584,10 @@ sgen_card_table_scan_remsets (ScanCopyContext ctx)
 	SGEN_TV_GETTIME (atv);
 	last_los_scan_time = SGEN_TV_ELAPSED (btv, atv);
 	los_card_scan_time += last_los_scan_time;
+
+#ifdef SGEN_HAVE_OVERLAPPING_CARDS
+	card_summary_valid = FALSE;
+#endif
 }
 
 guint8*
@@ -493,6 +635,10 @@ sgen_cardtable_scan_object (GCObject *obj, mword block_obj_size, guint8 *cards,
 {
 	HEAVY_STAT (++large_objects);
 
+	/* Without a card array we're scanning the remembered set, so the summary is valid. */
+	if (!cards && !sgen_card_table_summary_range_is_dirty ((mword)obj, block_obj_size))
+		return;
+
 	if (sgen_client_cardtable_scan_object (obj, block_obj_size, cards, ctx))
 		return;
 
@@ -577,6 +723,7 @@ sgen_card_table_init (SgenRememberedSet *remset)
 
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
 	sgen_shadow_cardtable = (guint8 *)sgen_alloc_os_memory (CARD_COUNT_IN_BYTES, (SgenAllocFlags)(SGEN_ALLOC_INTERNAL | SGEN_ALLOC_ACTIVATE), "shadow card table");
+	card_summary = (guint8 *)sgen_alloc_os_memory (CARD_SUMMARY_COUNT / 8, (SgenAllocFlags)(SGEN_ALLOC_INTERNAL | SGEN_ALLOC_ACTIVATE), "card table summary");
 #endif
 
 #ifdef HEAVY_STATISTICS
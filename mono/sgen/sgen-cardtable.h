@@ -17,6 +17,8 @@ void sgen_cardtable_scan_object (GCObject *obj, mword obj_size, guint8 *cards,
 		ScanCopyContext ctx);
 
 gboolean sgen_card_table_get_card_data (guint8 *dest, mword address, mword cards);
+guint8* sgen_card_table_find_next_marked_card (guint8 *cards, guint8 *end);
+gboolean sgen_card_table_summary_range_is_dirty (mword address, mword size);
 
 guint8* sgen_card_table_alloc_mod_union (char *obj, mword obj_size);
 void sgen_card_table_free_mod_union (guint8 *mod_union, char *obj, mword obj_size);
@@ -17,6 +17,8 @@ extern guint64 stat_nursery_copy_object_failed_pinned;
 
 extern guint64 stat_slots_allocated_in_vain;
 
+#ifndef SGEN_SIMPLE_PAR_NURSERY
+
 /*
  * Copies an object and enqueues it if a queue is given.
  *
@@ -73,3 +75,75 @@ copy_object_no_checks (GCObject *obj, SgenGrayQueue *queue)
 
 	return (GCObject *)destination;
 }
+
+#endif /* SGEN_SIMPLE_PAR_NURSERY */
+
+#ifdef COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION
+
+/*
+ * Thread safe version of copy_object_no_checks (), used by the parallel
+ * nursery collector.  Multiple workers can race to copy the same object.
+ * Only the copy whose forwarding pointer gets installed is used, the others
+ * are cleared so they look like free slots to the major heap.
+ *
+ * This can return OBJ itself on OOM.
+ */
+static MONO_NEVER_INLINE GCObject *
+copy_object_no_checks_par (GCObject *obj, SgenGrayQueue *queue)
+{
+	mword vtable_word = *(volatile mword*)obj;
+	GCObject *destination;
+	GCObject *final_destination;
+	GCVTable vt;
+	gboolean has_references;
+	mword objsize;
+
+	if ((destination = (GCObject*)SGEN_VTABLE_IS_FORWARDED (vtable_word)))
+		return destination;
+	/* Pinned by another worker that failed to promote it */
+	if (SGEN_VTABLE_IS_PINNED (vtable_word))
+		return obj;
+
+	/* We must not load the vtable through OBJ again, it might be forwarded at any time. */
+	vt = (GCVTable)vtable_word;
+	has_references = SGEN_VTABLE_HAS_REFERENCES (vt);
+	objsize = SGEN_ALIGN_UP (sgen_client_par_object_get_size (vt, obj));
+	destination = COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION (vt, obj, objsize, has_references);
+
+	if (G_UNLIKELY (!destination)) {
+		GCObject *pinned = sgen_pin_object_par (obj, queue);
+		if (pinned == obj)
+			sgen_set_pinned_from_failed_allocation (objsize);
+		return pinned;
+	}
+
+	/* The vtable word of DESTINATION is already set by the allocator */
+	sgen_client_pre_copy_checks ((char*)destination, vt, obj, objsize);
+	memcpy ((char*)destination + sizeof (mword), (char*)obj + sizeof (mword), objsize - sizeof (mword));
+	SGEN_ASSERT (9, sgen_vtable_get_descriptor (vt), "vtable %p has no gc descriptor", vt);
+
+	/* The copy must be visible before other workers can reach it through the forwarding pointer */
+	mono_memory_write_barrier ();
+
+	final_destination = (GCObject*)SGEN_CAS_PTR ((gpointer*)obj, SGEN_POINTER_TAG_FORWARDED (destination), vt);
+	if (final_destination == (GCObject*)vt) {
+		binary_protocol_copy (obj, destination, vt, objsize);
+		/* Nobody scans DESTINATION before we enqueue it, so we can still fix it up */
+		sgen_client_update_copied_object ((char*)destination, vt, obj, objsize);
+		if (has_references) {
+			SGEN_LOG (9, "Enqueuing gray object %p (%s)", destination, sgen_client_vtable_get_name (vt));
+			GRAY_OBJECT_ENQUEUE (queue, destination, sgen_vtable_get_descriptor (vt));
+		}
+		return destination;
+	}
+
+	/* We lost the race, so leave the slot we allocated as an unused, cleared one. */
+	HEAVY_STAT (++stat_slots_allocated_in_vain);
+	memset (destination, 0, objsize);
+
+	if (SGEN_POINTER_IS_TAGGED_PINNED (final_destination))
+		return obj;
+	return (GCObject*)SGEN_POINTER_UNTAG_VTABLE (final_destination);
+}
+
+#endif /* COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION */
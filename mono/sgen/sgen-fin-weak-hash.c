@@ -315,9 +315,41 @@ typedef struct {
 
 #define NUM_FIN_STAGE_ENTRIES	1024
 
+/*
+ * The global stage is used by threads that aren't registered with the GC, and for
+ * deregistrations.
+ */
 static volatile gint32 next_fin_stage_entry = 0;
 static StageEntry fin_stage_entries [NUM_FIN_STAGE_ENTRIES];
 
+/*
+ * Registered threads each get their own stage, so threads that register lots of finalizers
+ * don't contend on `next_entry`, and only take the GC lock when their own stage overflows.
+ * The protocol above still applies, since the drainer runs concurrently with the owning
+ * thread.
+ *
+ * Entries for the same object can come from different threads, so the stages must not
+ * reorder them.  Thread stages only ever hold registrations, whose order among each other
+ * doesn't matter, and a registration only goes to a thread stage if the global stage is
+ * empty, i.e. no deregistration which precedes it is still pending.  Everything in the
+ * thread stages therefore precedes the entries in the global stage, so the thread stages
+ * are always drained before it, and can be drained on their own at any time.
+ *
+ * Thread stages are never freed.  When a thread unregisters, its stage is released for
+ * reuse by another thread, and the entries it still holds are processed in the next drain
+ * like any others.
+ */
+#define NUM_THREAD_FIN_STAGE_ENTRIES	256
+
+struct _SgenThreadFinStage {
+	SgenThreadFinStage *next;
+	volatile gint32 in_use;
+	volatile gint32 next_entry;
+	StageEntry entries [NUM_THREAD_FIN_STAGE_ENTRIES];
+};
+
+static SgenThreadFinStage * volatile thread_fin_stages = NULL;
+
 /*
  * This is used to lock the stage when processing is forced, i.e. when it's triggered by a
  * garbage collection.  In that case, the world is already stopped and there's only one
@@ -329,6 +361,22 @@ lock_stage_for_processing (volatile gint32 *next_entry)
 	*next_entry = -1;
 }
 
+/*
+ * This is used to lock a thread stage when the global stage overflows, so the thread stage
+ * can be drained first.  Its owner keeps running, so it can't just be overwritten.  If the
+ * owner has locked it already, it's waiting for the GC lock, which we hold, to drain it, and
+ * it will find it drained.
+ */
+static void
+force_lock_stage_for_processing (volatile gint32 *next_entry)
+{
+	gint32 old;
+
+	do {
+		old = *next_entry;
+	} while (old >= 0 && InterlockedCompareExchange (next_entry, -1, old) != old);
+}
+
 /*
  * When processing is triggered by an overflow, we don't want to take the GC lock
  * immediately, and then set `next_index` to `-1`, because another thread might have drained
@@ -540,17 +588,99 @@ process_fin_stage_entry (GCObject *obj, void *user_data, int index)
 void
 sgen_process_fin_stage_entries (void)
 {
+	SgenThreadFinStage *stage;
+
+	/* The thread stages precede the global stage */
+	for (stage = thread_fin_stages; stage; stage = stage->next) {
+		lock_stage_for_processing (&stage->next_entry);
+		process_stage_entries (NUM_THREAD_FIN_STAGE_ENTRIES, &stage->next_entry, stage->entries, process_fin_stage_entry);
+	}
+
 	lock_stage_for_processing (&next_fin_stage_entry);
 	process_stage_entries (NUM_FIN_STAGE_ENTRIES, &next_fin_stage_entry, fin_stage_entries, process_fin_stage_entry);
 }
 
+/*
+ * LOCKING: requires that the GC lock is held, and that the global stage is locked for
+ * processing.
+ */
+static void
+process_global_fin_stage_entries (void)
+{
+	SgenThreadFinStage *stage;
+
+	for (stage = thread_fin_stages; stage; stage = stage->next) {
+		force_lock_stage_for_processing (&stage->next_entry);
+		process_stage_entries (NUM_THREAD_FIN_STAGE_ENTRIES, &stage->next_entry, stage->entries, process_fin_stage_entry);
+	}
+
+	process_stage_entries (NUM_FIN_STAGE_ENTRIES, &next_fin_stage_entry, fin_stage_entries, process_fin_stage_entry);
+}
+
+static SgenThreadFinStage*
+acquire_thread_fin_stage (void)
+{
+	SgenThreadFinStage *stage, *head;
+
+	for (stage = thread_fin_stages; stage; stage = stage->next) {
+		if (!stage->in_use && InterlockedCompareExchange (&stage->in_use, 1, 0) == 0)
+			return stage;
+	}
+
+	stage = (SgenThreadFinStage *)sgen_alloc_internal_dynamic (sizeof (SgenThreadFinStage), INTERNAL_MEM_FIN_TABLE, TRUE);
+	stage->in_use = 1;
+	do {
+		head = thread_fin_stages;
+		stage->next = head;
+	} while (SGEN_CAS_PTR ((gpointer*)&thread_fin_stages, stage, head) != head);
+
+	return stage;
+}
+
+void
+sgen_thread_release_fin_stage (SgenThreadInfo *info)
+{
+	SgenThreadFinStage *stage = info->fin_stage;
+
+	if (!stage)
+		return;
+
+	info->fin_stage = NULL;
+	mono_memory_write_barrier ();
+	stage->in_use = 0;
+}
+
 void
 sgen_object_register_for_finalization (GCObject *obj, void *user_data)
 {
-	while (add_stage_entry (NUM_FIN_STAGE_ENTRIES, &next_fin_stage_entry, fin_stage_entries, obj, user_data) == -1) {
-		if (try_lock_stage_for_processing (NUM_FIN_STAGE_ENTRIES, &next_fin_stage_entry)) {
+	SgenThreadInfo *info = mono_thread_info_current ();
+	volatile gint32 *next_entry;
+	StageEntry *entries;
+	int num_entries;
+
+	/*
+	 * A non-zero `next_fin_stage_entry` means the global stage might hold deregistrations
+	 * this registration has to follow.
+	 */
+	if (info && user_data && next_fin_stage_entry == 0) {
+		if (!info->fin_stage)
+			info->fin_stage = acquire_thread_fin_stage ();
+		num_entries = NUM_THREAD_FIN_STAGE_ENTRIES;
+		next_entry = &info->fin_stage->next_entry;
+		entries = info->fin_stage->entries;
+	} else {
+		num_entries = NUM_FIN_STAGE_ENTRIES;
+		next_entry = &next_fin_stage_entry;
+		entries = fin_stage_entries;
+	}
+
+	while (add_stage_entry (num_entries, next_entry, entries, obj, user_data) == -1) {
+		if (try_lock_stage_for_processing (num_entries, next_entry)) {
 			LOCK_GC;
-			process_stage_entries (NUM_FIN_STAGE_ENTRIES, &next_fin_stage_entry, fin_stage_entries, process_fin_stage_entry);
+			if (entries == fin_stage_entries)
+				process_global_fin_stage_entries ();
+			else
+				process_stage_entries (num_entries, next_entry, entries, process_fin_stage_entry);
 			UNLOCK_GC;
 		}
 	}
@@ -185,6 +185,7 @@
 #include "mono/sgen/sgen-cardtable.h"
 #include "mono/sgen/sgen-pinning.h"
 #include "mono/sgen/sgen-workers.h"
+#include "mono/sgen/sgen-numa.h"
 #include "mono/sgen/sgen-client.h"
 #include "mono/sgen/sgen-pointer-queue.h"
 #include "mono/sgen/gc-internal-agnostic.h"
@@ -345,6 +346,9 @@ static volatile mword highest_heap_address = 0;
 
 MonoCoopMutex sgen_interruption_mutex;
 
+/* Protects the pin queue when objects are pinned by parallel nursery collection workers */
+static mono_mutex_t pin_queue_mutex;
+
 int current_collection_generation = -1;
 static volatile gboolean concurrent_collection_in_progress = FALSE;
 
@@ -428,7 +432,7 @@ gray_queue_redirect (SgenGrayQueue *queue)
 		GrayQueueSection *section = sgen_gray_object_dequeue_section (queue);
 		if (!section)
 			break;
-		sgen_section_gray_queue_enqueue ((SgenSectionGrayQueue *)queue->alloc_prepare_data, section);
+		sgen_workers_enqueue_section (section);
 		wake = TRUE;
 	}
 
@@ -444,7 +448,7 @@ gray_queue_enable_redirect (SgenGrayQueue *queue)
 	if (!concurrent_collection_in_progress)
 		return;
 
-	sgen_gray_queue_set_alloc_prepare (queue, gray_queue_redirect, sgen_workers_get_distribute_section_gray_queue ());
+	sgen_gray_queue_set_alloc_prepare (queue, gray_queue_redirect, NULL);
 	gray_queue_redirect (queue);
 }
 
@@ -740,6 +744,42 @@ sgen_pin_object (GCObject *object, GrayQueue *queue)
 	GRAY_OBJECT_ENQUEUE (queue, object, sgen_obj_get_descriptor_safe (object));
 }
 
+/*
+ * Thread safe version of sgen_pin_object (), used by the parallel nursery
+ * collector.  Another worker might forward the object while we try to pin
+ * it, in which case the forwarded copy is returned.  Otherwise returns
+ * OBJECT.
+ */
+GCObject*
+sgen_pin_object_par (GCObject *object, GrayQueue *queue)
+{
+	mword vtable_word;
+	GCObject *forwarded;
+	size_t size;
+
+	for (;;) {
+		vtable_word = *(volatile mword*)object;
+		if ((forwarded = (GCObject*)SGEN_VTABLE_IS_FORWARDED (vtable_word)))
+			return forwarded;
+		if (SGEN_VTABLE_IS_PINNED (vtable_word))
+			return object;
+		if (SGEN_CAS_PTR ((gpointer*)object, SGEN_POINTER_TAG_PINNED (vtable_word), (gpointer)vtable_word) == (gpointer)vtable_word)
+			break;
+	}
+
+	size = safe_object_get_size (object);
+	binary_protocol_pin (object, (gpointer)LOAD_VTABLE (object), size);
+
+	mono_os_mutex_lock (&pin_queue_mutex);
+	sgen_pin_stage_ptr (object);
+	++objects_pinned;
+	sgen_pin_stats_register_object (object, size);
+	mono_os_mutex_unlock (&pin_queue_mutex);
+
+	GRAY_OBJECT_ENQUEUE (queue, object, sgen_obj_get_descriptor_safe (object));
+	return object;
+}
+
 /* Sort the addresses in array in increasing order.
  * Done using a by-the book heap sort. Which has decent and stable performance, is pretty cache efficient.
  */
@@ -1286,7 +1326,7 @@ reset_pinned_from_failed_allocation (void)
 void
 sgen_set_pinned_from_failed_allocation (mword objsize)
 {
-	bytes_pinned_from_failed_allocation += objsize;
+	SGEN_ATOMIC_ADD_P (bytes_pinned_from_failed_allocation, objsize);
 }
 
 gboolean
@@ -1443,6 +1483,7 @@ enqueue_scan_from_roots_jobs (char *heap_start, char *heap_end, SgenObjectOperat
 	/* Threads */
 
 	stdj = (ScanThreadDataJob*)sgen_thread_pool_job_alloc ("scan thread data", job_scan_thread_data, sizeof (ScanThreadDataJob));
+	stdj->ops = ops;
 	stdj->heap_start = heap_start;
 	stdj->heap_end = heap_end;
 	sgen_workers_enqueue_job (&stdj->job, enqueue);
@@ -1473,8 +1514,9 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	char *nursery_next;
 	mword fragment_total;
 	ScanJob *sj;
-	SgenObjectOperations *object_ops = &sgen_minor_collector.serial_ops;
-	ScanCopyContext ctx = CONTEXT_FROM_OBJECT_OPERATIONS (object_ops, &gray_queue);
+	gboolean is_parallel = sgen_minor_collector.is_parallel;
+	SgenObjectOperations *object_ops = is_parallel ? &sgen_minor_collector.parallel_ops : &sgen_minor_collector.serial_ops;
+	ScanCopyContext ctx = CONTEXT_FROM_OBJECT_OPERATIONS (&sgen_minor_collector.serial_ops, &gray_queue);
 	TV_DECLARE (atv);
 	TV_DECLARE (btv);
 
@@ -1519,9 +1561,16 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 
 	major_collector.start_nursery_collection ();
 
+	/*
+	 * The workers allocate from the major heap concurrently, which is only safe if
+	 * there is no sweeping going on.
+	 */
+	if (is_parallel)
+		major_collector.finish_sweeping ();
+
 	sgen_memgov_minor_collection_start ();
 
-	init_gray_queue (FALSE);
+	init_gray_queue (is_parallel);
 
 	gc_stats.minor_gc_count ++;
 
@@ -1552,9 +1601,15 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	SGEN_LOG (2, "Finding pinned pointers: %zd in %lld usecs", sgen_get_pinned_count (), TV_ELAPSED (btv, atv));
 	SGEN_LOG (4, "Start scan with %zd pinned objects", sgen_get_pinned_count ());
 
+	if (is_parallel) {
+		/* The pinned objects are scanned by the workers, too */
+		sgen_workers_take_from_queue (&gray_queue);
+		sgen_workers_start_all_workers (object_ops, NULL);
+	}
+
 	sj = (ScanJob*)sgen_thread_pool_job_alloc ("scan remset", job_remembered_set_scan, sizeof (ScanJob));
 	sj->ops = object_ops;
-	sgen_workers_enqueue_job (&sj->job, FALSE);
+	sgen_workers_enqueue_job (&sj->job, is_parallel);
 
 	/* we don't have complete write barrier yet, so we scan all the old generation sections */
 	TV_GETTIME (btv);
@@ -1569,7 +1624,12 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	TV_GETTIME (atv);
 	time_minor_scan_pinned += TV_ELAPSED (btv, atv);
 
-	enqueue_scan_from_roots_jobs (sgen_get_nursery_start (), nursery_next, object_ops, FALSE);
+	enqueue_scan_from_roots_jobs (sgen_get_nursery_start (), nursery_next, object_ops, is_parallel);
+
+	if (is_parallel) {
+		sgen_workers_wait_for_jobs_finished ();
+		sgen_workers_join ();
+	}
 
 	TV_GETTIME (btv);
 	time_minor_scan_roots += TV_ELAPSED (atv, btv);
@@ -1664,6 +1724,9 @@ major_copy_or_mark_from_roots (size_t *old_next_pin_slot, CopyOrMarkFromRootsMod
 	char *heap_end = (char*)-1;
 	ScanCopyContext ctx = CONTEXT_FROM_OBJECT_OPERATIONS (object_ops, WORKERS_DISTRIBUTE_GRAY_QUEUE);
 	gboolean concurrent = mode != COPY_OR_MARK_FROM_ROOTS_SERIAL;
+	/* The workers mark from the roots in parallel, the main thread only does the pinning. */
+	gboolean is_parallel = mode == COPY_OR_MARK_FROM_ROOTS_SERIAL && major_collector.is_parallel;
+	SgenObjectOperations *roots_object_ops = is_parallel ? &major_collector.major_ops_parallel : object_ops;
 
 	SGEN_ASSERT (0, !!concurrent == !!concurrent_collection_in_progress, "We've been called with the wrong mode.");
 
@@ -1678,7 +1741,7 @@ major_copy_or_mark_from_roots (size_t *old_next_pin_slot, CopyOrMarkFromRootsMod
 		sgen_nursery_alloc_prepare_for_major ();
 	}
 
-	init_gray_queue (mode == COPY_OR_MARK_FROM_ROOTS_START_CONCURRENT);
+	init_gray_queue (mode == COPY_OR_MARK_FROM_ROOTS_START_CONCURRENT || is_parallel);
 
 	TV_GETTIME (atv);
 
@@ -1805,7 +1868,18 @@ major_copy_or_mark_from_roots (size_t *old_next_pin_slot, CopyOrMarkFromRootsMod
 
 	sgen_client_collecting_major_3 (&fin_ready_queue, &critical_fin_queue);
 
-	enqueue_scan_from_roots_jobs (heap_start, heap_end, object_ops, FALSE);
+	if (is_parallel) {
+		/* The objects grayed while pinning are scanned by the workers, too */
+		sgen_workers_take_from_queue (WORKERS_DISTRIBUTE_GRAY_QUEUE);
+		sgen_workers_start_all_workers (roots_object_ops, NULL);
+	}
+
+	enqueue_scan_from_roots_jobs (heap_start, heap_end, roots_object_ops, is_parallel);
+
+	if (is_parallel) {
+		sgen_workers_wait_for_jobs_finished ();
+		sgen_workers_join ();
+	}
 
 	TV_GETTIME (btv);
 	time_major_scan_roots += TV_ELAPSED (atv, btv);
@@ -1869,7 +1943,7 @@ major_start_collection (gboolean concurrent, size_t *old_next_pin_slot)
 
 	current_collection_generation = GENERATION_OLD;
 
-	g_assert (sgen_section_gray_queue_is_empty (sgen_workers_get_distribute_section_gray_queue ()));
+	g_assert (sgen_workers_distribute_gray_queue_is_empty ());
 
 	if (!concurrent)
 		sgen_cement_reset ();
@@ -1928,7 +2002,7 @@ major_finish_collection (const char *reason, size_t old_next_pin_slot, gboolean
 		object_ops = &major_collector.major_ops_serial;
 	}
 
-	g_assert (sgen_section_gray_queue_is_empty (sgen_workers_get_distribute_section_gray_queue ()));
+	g_assert (sgen_workers_distribute_gray_queue_is_empty ());
 
 	/* all the objects in the heap */
 	finish_gray_stack (GENERATION_OLD, CONTEXT_FROM_OBJECT_OPERATIONS (object_ops, &gray_queue));
@@ -2023,7 +2097,7 @@ major_finish_collection (const char *reason, size_t old_next_pin_slot, gboolean
 	memset (&counts, 0, sizeof (ScannedObjectCounts));
 	major_collector.finish_major_collection (&counts);
 
-	g_assert (sgen_section_gray_queue_is_empty (sgen_workers_get_distribute_section_gray_queue ()));
+	g_assert (sgen_workers_distribute_gray_queue_is_empty ());
 
 	SGEN_ASSERT (0, sgen_workers_all_done (), "Can't have workers working after major collection has finished");
 	if (concurrent_collection_in_progress)
@@ -2564,6 +2638,7 @@ sgen_thread_register (SgenThreadInfo* info, void *stack_bottom_fallback)
 #endif
 
 	sgen_init_tlab_info (info);
+	info->fin_stage = NULL;
 
 	sgen_client_thread_register (info, stack_bottom_fallback);
 
@@ -2573,6 +2648,7 @@ sgen_thread_register (SgenThreadInfo* info, void *stack_bottom_fallback)
 void
 sgen_thread_unregister (SgenThreadInfo *p)
 {
+	sgen_thread_release_fin_stage (p);
 	sgen_client_thread_unregister (p);
 }
 
@@ -2769,7 +2845,11 @@ sgen_gc_init (void)
 	int result;
 	gboolean debug_print_allowance = FALSE;
 	double allowance_ratio = 0, save_target = 0;
+	int max_pause = 0;
 	gboolean cement_enabled = TRUE;
+	gboolean concurrent_los_sweep = TRUE;
+	gboolean numa = FALSE;
+	gboolean huge_pages = FALSE;
 
 	do {
 		result = InterlockedCompareExchange (&gc_initialized, -1, 0);
@@ -2800,6 +2880,7 @@ sgen_gc_init (void)
 	gc_debug_file = stderr;
 
 	mono_coop_mutex_init (&sgen_interruption_mutex);
+	mono_os_mutex_init (&pin_queue_mutex);
 
 	if ((env = g_getenv (MONO_GC_PARAMS_NAME))) {
 		opts = g_strsplit (env, ",", -1);
@@ -2833,11 +2914,13 @@ sgen_gc_init (void)
 	sgen_client_init ();
 
 	if (!minor_collector_opt) {
-		sgen_simple_nursery_init (&sgen_minor_collector);
+		sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
 	} else {
 		if (!strcmp (minor_collector_opt, "simple")) {
 		use_simple_nursery:
-			sgen_simple_nursery_init (&sgen_minor_collector);
+			sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
+		} else if (!strcmp (minor_collector_opt, "simple-par")) {
+			sgen_simple_nursery_init (&sgen_minor_collector, TRUE);
 		} else if (!strcmp (minor_collector_opt, "split")) {
 			sgen_split_nursery_init (&sgen_minor_collector);
 		} else {
@@ -2851,11 +2934,22 @@ sgen_gc_init (void)
 		sgen_marksweep_init (&major_collector);
 	} else if (!major_collector_opt || !strcmp (major_collector_opt, "marksweep-conc")) {
 		sgen_marksweep_conc_init (&major_collector);
+	} else if (!strcmp (major_collector_opt, "marksweep-par")) {
+		if (sgen_minor_collector.is_split) {
+			sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `marksweep` instead.", "The `marksweep-par` major collector requires the `simple` or `simple-par` minor collector.");
+			goto use_marksweep_major;
+		}
+		sgen_marksweep_par_init (&major_collector);
 	} else {
 		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `marksweep` instead.", "Unknown major collector `%s'.", major_collector_opt);
 		goto use_marksweep_major;
 	}
 
+	if (sgen_minor_collector.is_parallel && major_collector.is_concurrent) {
+		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `simple` instead.", "The `simple-par` minor collector can't be used with a concurrent major collector.");
+		sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
+	}
+
 	sgen_nursery_size = DEFAULT_NURSERY_SIZE;
 
 	if (opts) {
@@ -2922,6 +3016,18 @@ sgen_gc_init (void)
 				continue;
 			}
 #endif
+			if (g_str_has_prefix (opt, "max-pause=")) {
+				char *end;
+				long val;
+				opt = strchr (opt, '=') + 1;
+				val = strtol (opt, &end, 10);
+				if (end == opt || (*end && strcmp (end, "ms")) || val <= 0 || val > G_MAXINT) {
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "`max-pause` must be a positive integer number of milliseconds.");
+					continue;
+				}
+				max_pause = (int)val;
+				continue;
+			}
 			if (g_str_has_prefix (opt, "save-target-ratio=")) {
 				double val;
 				opt = strchr (opt, '=') + 1;
@@ -2950,6 +3056,33 @@ sgen_gc_init (void)
 				continue;
 			}
 
+			if (!strcmp (opt, "concurrent-los-sweep")) {
+				concurrent_los_sweep = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-concurrent-los-sweep")) {
+				concurrent_los_sweep = FALSE;
+				continue;
+			}
+
+			if (!strcmp (opt, "numa")) {
+				numa = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-numa")) {
+				numa = FALSE;
+				continue;
+			}
+
+			if (!strcmp (opt, "huge-pages")) {
+				huge_pages = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-huge-pages")) {
+				huge_pages = FALSE;
+				continue;
+			}
+
 			if (!strcmp (opt, "precleaning")) {
 				precleaning_enabled = TRUE;
 				continue;
@@ -2977,10 +3110,14 @@ sgen_gc_init (void)
 			fprintf (stderr, "  max-heap-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
 			fprintf (stderr, "  soft-heap-limit=n (where N is an integer, possibly with a k, m or a g suffix)\n");
 			fprintf (stderr, "  nursery-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
+			fprintf (stderr, "  max-pause=T (where T is the nursery pause time goal in milliseconds, possibly with a ms suffix)\n");
 			fprintf (stderr, "  major=COLLECTOR (where COLLECTOR is `marksweep', `marksweep-conc', `marksweep-par')\n");
-			fprintf (stderr, "  minor=COLLECTOR (where COLLECTOR is `simple' or `split')\n");
+			fprintf (stderr, "  minor=COLLECTOR (where COLLECTOR is `simple', `simple-par' or `split')\n");
 			fprintf (stderr, "  wbarrier=WBARRIER (where WBARRIER is `remset' or `cardtable')\n");
 			fprintf (stderr, "  [no-]cementing\n");
+			fprintf (stderr, "  [no-]concurrent-los-sweep\n");
+			fprintf (stderr, "  [no-]numa\n");
+			fprintf (stderr, "  [no-]huge-pages\n");
 			if (major_collector.print_gc_param_usage)
 				major_collector.print_gc_param_usage ();
 			if (sgen_minor_collector.print_gc_param_usage)
@@ -3002,6 +3139,9 @@ sgen_gc_init (void)
 	if (minor_collector_opt)
 		g_free (minor_collector_opt);
 
+	if (huge_pages && !sgen_memgov_enable_huge_pages ())
+		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "Huge pages are not supported on this system.");
+
 	alloc_nursery ();
 
 	sgen_cement_init (cement_enabled);
@@ -3146,10 +3286,19 @@ sgen_gc_init (void)
 	if (major_collector.post_param_init)
 		major_collector.post_param_init (&major_collector);
 
-	if (major_collector.needs_thread_pool)
+	/* This must happen before the workers are started, since they bind to their nodes. */
+	if (numa && !sgen_numa_init ())
+		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "NUMA support requires a Linux system with more than one NUMA node.");
+
+	if (sgen_minor_collector.is_parallel || major_collector.is_parallel)
+		sgen_workers_init (MIN (mono_cpu_count (), SGEN_THREADPOOL_MAX_NUM_THREADS));
+	else if (major_collector.needs_thread_pool)
 		sgen_workers_init (1);
 
-	sgen_memgov_init (max_heap, soft_limit, debug_print_allowance, allowance_ratio, save_target);
+	/* The LOS sweep job needs the thread pool, which we only have if the major collector needs it. */
+	sgen_los_set_concurrent_sweep (concurrent_los_sweep && (sgen_minor_collector.is_parallel || major_collector.needs_thread_pool));
+
+	sgen_memgov_init (max_heap, soft_limit, debug_print_allowance, allowance_ratio, save_target, max_pause);
 
 	memset (&remset, 0, sizeof (remset));
 
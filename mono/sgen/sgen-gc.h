@@ -375,9 +375,14 @@ void sgen_scan_area_with_callback (char *start, char *end, IterateObjectCallback
 /*
  * This structure extends the MonoThreadInfo structure.
  */
+typedef struct _SgenThreadFinStage SgenThreadFinStage;
+
 struct _SgenThreadInfo {
 	SgenClientThreadInfo client_info;
 
+	/* The thread's finalizer registration stage, see sgen-fin-weak-hash.c */
+	SgenThreadFinStage *fin_stage;
+
 	char **tlab_next_addr;
 	char **tlab_start_addr;
 	char **tlab_temp_end_addr;
@@ -524,10 +529,12 @@ sgen_nursery_is_object_alive (GCObject *obj)
 
 typedef struct {
 	gboolean is_split;
+	gboolean is_parallel;
 
 	GCObject* (*alloc_for_promotion) (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references);
 
 	SgenObjectOperations serial_ops;
+	SgenObjectOperations parallel_ops;
 
 	void (*prepare_to_space) (char *to_space_bitmap, size_t space_bitmap_size);
 	void (*clear_fragments) (void);
@@ -538,11 +545,17 @@ typedef struct {
 
 	gboolean (*handle_gc_param) (const char *opt); /* Optional */
 	void (*print_gc_param_usage) (void); /* Optional */
+
+	/* Optional, for collectors that age objects before promoting them. */
+	int (*get_promotion_age) (void);
+	void (*set_promotion_age) (int age);
+	/* The total size of the objects aged or promoted so far. */
+	mword (*get_bytes_copied) (void);
 } SgenMinorCollector;
 
 extern SgenMinorCollector sgen_minor_collector;
 
-void sgen_simple_nursery_init (SgenMinorCollector *collector);
+void sgen_simple_nursery_init (SgenMinorCollector *collector, gboolean parallel);
 void sgen_split_nursery_init (SgenMinorCollector *collector);
 
 /* Updating references */
@@ -554,7 +567,8 @@ sgen_update_reference (GCObject **p, GCObject *o, gboolean allow_null)
 {
 	if (!allow_null)
 		SGEN_ASSERT (0, o, "Cannot update a reference with a NULL pointer");
-	SGEN_ASSERT (0, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Can't update a reference in the worker thread");
+	/* The parallel nursery collector updates references from the workers */
+	SGEN_ASSERT (0, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()) || sgen_get_current_collection_generation () == GENERATION_NURSERY, "Can't update a reference in the worker thread");
 	*p = o;
 }
 
@@ -596,6 +610,7 @@ typedef struct _SgenMajorCollector SgenMajorCollector;
 struct _SgenMajorCollector {
 	size_t section_size;
 	gboolean is_concurrent;
+	gboolean is_parallel;
 	gboolean needs_thread_pool;
 	gboolean supports_cardtable;
 	gboolean sweeps_lazily;
@@ -608,8 +623,11 @@ struct _SgenMajorCollector {
 	SgenObjectOperations major_ops_serial;
 	SgenObjectOperations major_ops_concurrent_start;
 	SgenObjectOperations major_ops_concurrent_finish;
+	SgenObjectOperations major_ops_parallel;
 
 	GCObject* (*alloc_object) (GCVTable vtable, size_t size, gboolean has_references);
+	/* Thread safe version of `alloc_object`, for use by parallel collector workers. */
+	GCObject* (*alloc_object_par) (GCVTable vtable, size_t size, gboolean has_references);
 	void (*free_pinned_object) (GCObject *obj, size_t size);
 
 	/*
@@ -644,6 +662,8 @@ struct _SgenMajorCollector {
 	gboolean (*handle_gc_param) (const char *opt);
 	void (*print_gc_param_usage) (void);
 	void (*post_param_init) (SgenMajorCollector *collector);
+	void (*worker_init) (void); /* Optional, called on each worker thread at startup */
+	int (*get_obj_numa_node) (GCObject *obj, SgenDescriptor desc); /* Optional, -1 if `obj` is not in a block */
 	gboolean (*is_valid_object) (char *ptr);
 	GCVTable (*describe_pointer) (char *pointer);
 	guint8* (*get_cardtable_mod_union_for_reference) (char *object);
@@ -780,6 +800,7 @@ void sgen_null_link_in_range (int generation, ScanCopyContext ctx, gboolean trac
 void sgen_process_fin_stage_entries (void);
 gboolean sgen_have_pending_finalizers (void);
 void sgen_object_register_for_finalization (GCObject *obj, void *user_data);
+void sgen_thread_release_fin_stage (SgenThreadInfo *info);
 
 int sgen_gather_finalizers_if (SgenObjectPredicateFunc predicate, void *user_data, GCObject **out_array, int out_size);
 void sgen_remove_finalizers_if (SgenObjectPredicateFunc predicate, void *user_data, int generation);
@@ -797,6 +818,7 @@ enum {
 };
 
 void sgen_pin_object (GCObject *object, SgenGrayQueue *queue);
+GCObject* sgen_pin_object_par (GCObject *object, SgenGrayQueue *queue);
 void sgen_set_pinned_from_failed_allocation (mword objsize);
 
 void sgen_ensure_free_space (size_t size, int generation);
@@ -844,6 +866,9 @@ extern mword los_memory_usage;
 void sgen_los_free_object (LOSObject *obj);
 void* sgen_los_alloc_large_inner (GCVTable vtable, size_t size);
 void sgen_los_sweep (void);
+void sgen_los_set_release_free_pages (gboolean release);
+void sgen_los_set_concurrent_sweep (gboolean concurrent);
+void sgen_los_finish_sweeping (void);
 gboolean sgen_ptr_is_in_los (char *ptr, char **start);
 void sgen_los_iterate_objects (IterateObjectCallbackFunc cb, void *user_data);
 void sgen_los_iterate_live_block_ranges (sgen_cardtable_block_callback callback);
@@ -855,6 +880,7 @@ gboolean mono_sgen_los_describe_pointer (char *ptr);
 LOSObject* sgen_los_header_for_object (GCObject *data);
 mword sgen_los_object_size (LOSObject *obj);
 void sgen_los_pin_object (GCObject *obj);
+gboolean sgen_los_pin_object_par (GCObject *obj);
 gboolean sgen_los_object_is_pinned (GCObject *obj);
 void sgen_los_mark_mod_union_card (GCObject *mono_obj, void **ptr);
 
@@ -864,6 +890,7 @@ void sgen_los_mark_mod_union_card (GCObject *mono_obj, void **ptr);
 void sgen_clear_nursery_fragments (void);
 void sgen_nursery_allocator_prepare_for_pinning (void);
 void sgen_nursery_allocator_set_nursery_bounds (char *nursery_start, char *nursery_end);
+void sgen_nursery_allocator_set_budget (mword budget);
 mword sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpin_queue);
 void sgen_init_nursery_allocator (void);
 void sgen_nursery_allocator_init_heavy_stats (void);
@@ -33,9 +33,119 @@ static volatile guint32 stat_gc_handles_max_allocated = 0;
 
 typedef struct {
 	SgenArrayList entries_array;
+	/*
+	 * For each bucket of `entries_array`, a bitmap with one bit per slot, see
+	 * `get_bucket_bitmap ()`.
+	 */
+	volatile guint32 *volatile bitmaps [SGEN_ARRAY_LIST_BUCKETS];
 	guint8 type;
 } HandleData;
 
+/*
+ * The handle tables grow large and sparse when handles are churned, so collections don't
+ * look at the slots themselves, but at two bitmaps per bucket:
+ *
+ * The occupied bitmap has a bit set for each occupied slot.  It's set after a slot is
+ * occupied, and cleared before the slot is freed, so a slot with its bit set is always
+ * occupied.  A slot can be occupied while its bit is still clear, but only while the
+ * allocating thread is still in `alloc_handle ()`, with the object on its stack, where
+ * it's pinned.
+ *
+ * The young bitmap has a bit set for each slot that might refer to a nursery object.  It's
+ * set when a slot is given a nursery target, and recomputed by collections.  Nursery
+ * collections only visit the slots in the young bitmap.
+ */
+#define HANDLE_BITMAP_WORD_BITS	32
+
+static inline guint32
+bucket_bitmap_words (guint32 bucket)
+{
+	return sgen_array_list_bucket_size (bucket) / HANDLE_BITMAP_WORD_BITS;
+}
+
+/* The first `bucket_bitmap_words ()` words are the occupied bitmap, the rest the young one. */
+static volatile guint32*
+get_bucket_bitmap (HandleData *handles, guint32 bucket)
+{
+	volatile guint32 *bitmap = handles->bitmaps [bucket];
+
+	if (bitmap)
+		return bitmap;
+
+	bitmap = (volatile guint32 *)g_malloc0 (bucket_bitmap_words (bucket) * 2 * sizeof (guint32));
+	mono_memory_write_barrier ();
+	if (InterlockedCompareExchangePointer ((volatile gpointer *)&handles->bitmaps [bucket], (gpointer)bitmap, NULL) != NULL) {
+		g_free ((gpointer)bitmap);
+		bitmap = handles->bitmaps [bucket];
+	}
+	return bitmap;
+}
+
+static inline void
+bitmap_set_bit (volatile guint32 *word, guint32 bit)
+{
+	guint32 old;
+	do {
+		old = *word;
+		if (old & bit)
+			return;
+	} while (InterlockedCompareExchange ((volatile gint32 *)word, old | bit, old) != old);
+}
+
+static inline void
+bitmap_clear_bit (volatile guint32 *word, guint32 bit)
+{
+	guint32 old;
+	do {
+		old = *word;
+		if (!(old & bit))
+			return;
+	} while (InterlockedCompareExchange ((volatile gint32 *)word, old & ~bit, old) != old);
+}
+
+static inline int
+bitmap_lowest_bit (guint32 bits)
+{
+#ifdef __GNUC__
+	return __builtin_ctz (bits);
+#else
+	int i = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
+static void
+update_slot_bits (HandleData *handles, guint32 index, GCObject *obj, gboolean occupied)
+{
+	guint32 bucket, offset, bit;
+	volatile guint32 *bitmap;
+
+	sgen_array_list_bucketize (index, &bucket, &offset);
+	bitmap = get_bucket_bitmap (handles, bucket);
+	bit = 1 << (offset % HANDLE_BITMAP_WORD_BITS);
+
+	if (occupied)
+		bitmap_set_bit (&bitmap [offset / HANDLE_BITMAP_WORD_BITS], bit);
+	if (obj && sgen_ptr_in_nursery (obj))
+		bitmap_set_bit (&bitmap [bucket_bitmap_words (bucket) + offset / HANDLE_BITMAP_WORD_BITS], bit);
+}
+
+static void
+clear_slot_occupied_bit (HandleData *handles, guint32 index)
+{
+	guint32 bucket, offset;
+	volatile guint32 *bitmap;
+
+	sgen_array_list_bucketize (index, &bucket, &offset);
+	bitmap = handles->bitmaps [bucket];
+	if (bitmap)
+		bitmap_clear_bit (&bitmap [offset / HANDLE_BITMAP_WORD_BITS], 1 << (offset % HANDLE_BITMAP_WORD_BITS));
+}
+
 static void
 protocol_gchandle_update (int handle_type, gpointer link, gpointer old_value, gpointer new_value)
 {
@@ -99,10 +209,10 @@ bucket_alloc_callback (gpointer *bucket, guint32 new_bucket_size, gboolean alloc
 }
 
 static HandleData gc_handles [] = {
-	{ SGEN_ARRAY_LIST_INIT (NULL, is_slot_set, try_occupy_slot, -1), (HANDLE_WEAK) },
-	{ SGEN_ARRAY_LIST_INIT (NULL, is_slot_set, try_occupy_slot, -1), (HANDLE_WEAK_TRACK) },
-	{ SGEN_ARRAY_LIST_INIT (NULL, is_slot_set, try_occupy_slot, -1), (HANDLE_NORMAL) },
-	{ SGEN_ARRAY_LIST_INIT (bucket_alloc_callback, is_slot_set, try_occupy_slot, -1), (HANDLE_PINNED) }
+	{ SGEN_ARRAY_LIST_INIT (NULL, is_slot_set, try_occupy_slot, -1), { NULL }, (HANDLE_WEAK) },
+	{ SGEN_ARRAY_LIST_INIT (NULL, is_slot_set, try_occupy_slot, -1), { NULL }, (HANDLE_WEAK_TRACK) },
+	{ SGEN_ARRAY_LIST_INIT (NULL, is_slot_set, try_occupy_slot, -1), { NULL }, (HANDLE_NORMAL) },
+	{ SGEN_ARRAY_LIST_INIT (bucket_alloc_callback, is_slot_set, try_occupy_slot, -1), { NULL }, (HANDLE_PINNED) }
 };
 
 static HandleData *
@@ -111,27 +221,6 @@ gc_handles_for_type (GCHandleType type)
 	return type < HANDLE_TYPE_MAX ? &gc_handles [type] : NULL;
 }
 
-/* This assumes that the world is stopped. */
-void
-sgen_mark_normal_gc_handles (void *addr, SgenUserMarkFunc mark_func, void *gc_data)
-{
-	HandleData *handles = gc_handles_for_type (HANDLE_NORMAL);
-	SgenArrayList *array = &handles->entries_array;
-	volatile gpointer *slot;
-	gpointer hidden, revealed;
-
-	SGEN_ARRAY_LIST_FOREACH_SLOT (array, slot) {
-		hidden = *slot;
-		revealed = MONO_GC_REVEAL_POINTER (hidden, FALSE);
-		if (!MONO_GC_HANDLE_IS_OBJECT_POINTER (hidden))
-			continue;
-		mark_func ((MonoObject **)&revealed, gc_data);
-		g_assert (revealed);
-		*slot = MONO_GC_HANDLE_OBJECT_POINTER (revealed, FALSE);
-	} SGEN_ARRAY_LIST_END_FOREACH_SLOT;
-}
-
-
 static guint32
 alloc_handle (HandleData *handles, GCObject *obj, gboolean track)
 {
@@ -151,6 +240,7 @@ alloc_handle (HandleData *handles, GCObject *obj, gboolean track)
 	 * but hopefully some day it won't be anymore.
 	 */
 	index = sgen_array_list_add (array, obj, handles->type, TRUE);
+	update_slot_bits (handles, index, obj, TRUE);
 #ifdef HEAVY_STATISTICS
 	InterlockedIncrement ((volatile gint32 *)&stat_gc_handles_allocated);
 	if (stat_gc_handles_allocated > stat_gc_handles_max_allocated)
@@ -170,7 +260,8 @@ object_older_than (GCObject *object, int generation)
 }
 
 /*
- * Maps a function over all GC handles.
+ * Maps a function over all GC handles.  If `max_generation` is the nursery, only handles
+ * that might refer to nursery objects are visited.
  * This assumes that the world is stopped!
  */
 void
@@ -178,27 +269,105 @@ sgen_gchandle_iterate (GCHandleType handle_type, int max_generation, SgenGCHandl
 {
 	HandleData *handle_data = gc_handles_for_type (handle_type);
 	SgenArrayList *array = &handle_data->entries_array;
-	gpointer hidden, result, occupied;
-	volatile gpointer *slot;
+	const gboolean is_weak = MONO_GC_HANDLE_TYPE_IS_WEAK (handle_type);
+	const guint32 max_bucket = sgen_array_list_index_bucket (array->capacity);
+	guint32 first_free = (guint32)-1;
+	guint32 bucket, base = 0;
 
 	/* If a new bucket has been allocated, but the capacity has not yet been
 	 * increased, nothing can yet have been allocated in the bucket because the
 	 * world is stopped, so we shouldn't miss any handles during iteration.
 	 */
-	SGEN_ARRAY_LIST_FOREACH_SLOT (array, slot) {
-		hidden = *slot;
-		occupied = (gpointer) MONO_GC_HANDLE_OCCUPIED (hidden);
-		g_assert (hidden ? !!occupied : !occupied);
-		if (!occupied)
+	for (bucket = 0; bucket < max_bucket; base += sgen_array_list_bucket_size (bucket), ++bucket) {
+		volatile gpointer *entries = array->entries [bucket];
+		volatile guint32 *bitmap = handle_data->bitmaps [bucket];
+		const guint32 num_words = bucket_bitmap_words (bucket);
+		guint32 w;
+
+		if (!bitmap)
 			continue;
-		result = callback (hidden, handle_type, max_generation, user);
-		if (result)
-			SGEN_ASSERT (0, MONO_GC_HANDLE_OCCUPIED (result), "Why did the callback return an unoccupied entry?");
-		else
-			HEAVY_STAT (InterlockedDecrement ((volatile gint32 *)&stat_gc_handles_allocated));
-		protocol_gchandle_update (handle_type, (gpointer)slot, hidden, result);
-		*slot = result;
-	} SGEN_ARRAY_LIST_END_FOREACH_SLOT;
+
+		for (w = 0; w < num_words; ++w) {
+			guint32 occupied_bits = bitmap [w];
+			guint32 young_bits = bitmap [num_words + w];
+			guint32 bits = max_generation == GENERATION_NURSERY ? young_bits : occupied_bits;
+
+			if (first_free == (guint32)-1 && occupied_bits != 0xffffffff)
+				first_free = base + w * HANDLE_BITMAP_WORD_BITS + bitmap_lowest_bit (~occupied_bits);
+
+			while (bits) {
+				int b = bitmap_lowest_bit (bits);
+				guint32 bit = 1 << b;
+				volatile gpointer *slot = &entries [w * HANDLE_BITMAP_WORD_BITS + b];
+				gpointer hidden, result, occupied;
+
+				bits &= ~bit;
+
+				hidden = *slot;
+				occupied = (gpointer) MONO_GC_HANDLE_OCCUPIED (hidden);
+				g_assert (hidden ? !!occupied : !occupied);
+				if (!occupied) {
+					/* A stale young bit. */
+					young_bits &= ~bit;
+					continue;
+				}
+				result = callback (hidden, handle_type, max_generation, user);
+				if (result)
+					SGEN_ASSERT (0, MONO_GC_HANDLE_OCCUPIED (result), "Why did the callback return an unoccupied entry?");
+				else
+					HEAVY_STAT (InterlockedDecrement ((volatile gint32 *)&stat_gc_handles_allocated));
+				protocol_gchandle_update (handle_type, (gpointer)slot, hidden, result);
+				*slot = result;
+
+				if (!result)
+					occupied_bits &= ~bit;
+				if (result && MONO_GC_HANDLE_IS_OBJECT_POINTER (result) && sgen_ptr_in_nursery (MONO_GC_REVEAL_POINTER (result, is_weak)))
+					young_bits |= bit;
+				else
+					young_bits &= ~bit;
+			}
+
+			bitmap [w] = occupied_bits;
+			bitmap [num_words + w] = young_bits;
+		}
+	}
+
+	/*
+	 * After a full iteration we know where the lowest free slot is.  Starting the next
+	 * allocations there packs the handles towards the start of the table, instead of
+	 * spreading them over the buckets that churn has left sparse.
+	 */
+	if (max_generation != GENERATION_NURSERY && first_free != (guint32)-1 && first_free < array->next_slot)
+		array->slot_hint = first_free;
+}
+
+typedef struct {
+	SgenUserMarkFunc mark_func;
+	void *gc_data;
+} MarkNormalHandleClosure;
+
+static gpointer
+mark_normal_handle (gpointer hidden, GCHandleType handle_type, int max_generation, gpointer user)
+{
+	MarkNormalHandleClosure *closure = (MarkNormalHandleClosure *)user;
+	gpointer revealed;
+
+	if (!MONO_GC_HANDLE_IS_OBJECT_POINTER (hidden))
+		return hidden;
+	revealed = MONO_GC_REVEAL_POINTER (hidden, FALSE);
+	closure->mark_func ((MonoObject **)&revealed, closure->gc_data);
+	g_assert (revealed);
+	return MONO_GC_HANDLE_OBJECT_POINTER (revealed, FALSE);
+}
+
+/* This assumes that the world is stopped. */
+void
+sgen_mark_normal_gc_handles (void *addr, SgenUserMarkFunc mark_func, void *gc_data)
+{
+	MarkNormalHandleClosure closure = { mark_func, gc_data };
+	int generation = sgen_get_current_collection_generation () == GENERATION_NURSERY ? GENERATION_NURSERY : GENERATION_OLD;
+
+	sgen_gchandle_iterate (HANDLE_NORMAL, generation, mark_normal_handle, &closure);
 }
 
 /**
@@ -333,6 +502,8 @@ sgen_gchandle_set_target (guint32 gchandle, GCObject *obj)
 		entry = *slot;
 		SGEN_ASSERT (0, MONO_GC_HANDLE_OCCUPIED (entry), "Why are we setting the target on an unoccupied slot?");
 	} while (!try_set_slot (slot, obj, entry, (GCHandleType)handles->type));
+
+	update_slot_bits (handles, index, obj, FALSE);
 }
 
 static gpointer
@@ -406,6 +577,9 @@ mono_gchandle_free (guint32 gchandle)
 	entry = *slot;
 
 	if (index < handles->entries_array.capacity && MONO_GC_HANDLE_OCCUPIED (entry)) {
+		/* The occupied bit must be clear before the slot can be reused. */
+		clear_slot_occupied_bit (handles, index);
+		mono_memory_write_barrier ();
 		*slot = NULL;
 		protocol_gchandle_update (handles->type, (gpointer)slot, entry, NULL);
 		HEAVY_STAT (InterlockedDecrement ((volatile gint32 *)&stat_gc_handles_allocated));
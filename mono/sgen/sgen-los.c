@@ -28,6 +28,7 @@
 #include "mono/sgen/sgen-protocol.h"
 #include "mono/sgen/sgen-cardtable.h"
 #include "mono/sgen/sgen-memory-governor.h"
+#include "mono/sgen/sgen-thread-pool.h"
 #include "mono/sgen/sgen-client.h"
 
 #define LOS_SECTION_SIZE	(1024 * 1024)
@@ -71,6 +72,26 @@ static LOSFreeChunks *los_fast_free_lists [LOS_NUM_FAST_SIZES]; /* 0 is for larg
 static mword los_num_objects = 0;
 static int los_num_sections = 0;
 
+/*
+ * If set, sweeping returns the pages of free chunks in partially used sections to the
+ * OS.  Released chunks are marked with LOS_CHUNK_RELEASED in the free chunk map so we
+ * don't discard them again on every sweep.
+ */
+static gboolean los_release_free_pages = FALSE;
+
+#define LOS_CHUNK_FREE		1
+#define LOS_CHUNK_RELEASED	2
+
+/*
+ * If set, only unlinking dead objects from `los_object_list` is done with the world
+ * stopped.  Freeing their memory and rebuilding the free lists is done by
+ * `los_sweep_job` on the thread pool.  Until that job has finished, the dead objects
+ * are on `los_objects_to_free` and the sections and free lists must not be touched.
+ */
+static gboolean los_concurrent_sweep = FALSE;
+static SgenThreadPoolJob * volatile los_sweep_job = NULL;
+static LOSObject *los_objects_to_free = NULL;
+
 //#define USE_MALLOC
 //#define LOS_CONSISTENCY_CHECK
 //#define LOS_DUMMY
@@ -228,6 +249,8 @@ get_los_section_memory (size_t size)
 	g_assert (num_chunks > 0);
 
  retry:
+	sgen_los_finish_sweeping ();
+
 	if (num_chunks >= LOS_NUM_FAST_SIZES) {
 		free_chunks = get_from_size_list (&los_fast_free_lists [0], size);
 	} else {
@@ -263,7 +286,7 @@ get_los_section_memory (size_t size)
 	section->free_chunk_map = (unsigned char*)section + sizeof (LOSSection);
 	g_assert (sizeof (LOSSection) + LOS_SECTION_NUM_CHUNKS + 1 <= LOS_CHUNK_SIZE);
 	section->free_chunk_map [0] = 0;
-	memset (section->free_chunk_map + 1, 1, LOS_SECTION_NUM_CHUNKS);
+	memset (section->free_chunk_map + 1, LOS_CHUNK_FREE, LOS_SECTION_NUM_CHUNKS);
 
 	section->next = los_sections;
 	los_sections = section;
@@ -298,14 +321,66 @@ free_los_section_memory (LOSObject *obj, size_t size)
 	start_index = LOS_CHUNK_INDEX (obj, section);
 	for (i = start_index; i < start_index + num_chunks; ++i) {
 		g_assert (!section->free_chunk_map [i]);
-		section->free_chunk_map [i] = 1;
+		section->free_chunk_map [i] = LOS_CHUNK_FREE;
 	}
 
 	add_free_chunk ((LOSFreeChunks*)SGEN_ALIGN_DOWN_TO ((mword)obj, LOS_CHUNK_SIZE), size);
 }
 
+/*
+ * Gives the pages backing the free chunks [start, end) of the section back to the OS,
+ * except for the first chunk, which holds the LOSFreeChunks header.  The memory stays
+ * mapped, so it's transparently faulted back in (zeroed) when it's allocated again.
+ * Chunks whose pages were already released are skipped, so that every run of chunks
+ * between them is only discarded once.
+ */
+static void
+release_free_chunk_pages (LOSSection *section, int start, int end)
+{
+	int pagesize = mono_pagesize ();
+	int i = start + 1;
+
+	while (i < end) {
+		char *release_start, *release_end;
+		int run_start, j;
+
+		while (i < end && section->free_chunk_map [i] == LOS_CHUNK_RELEASED)
+			++i;
+		run_start = i;
+		while (i < end && section->free_chunk_map [i] != LOS_CHUNK_RELEASED)
+			++i;
+
+		release_start = (char*)SGEN_ALIGN_UP_TO ((mword)section + (run_start << LOS_CHUNK_BITS), pagesize);
+		release_end = (char*)SGEN_ALIGN_DOWN_TO ((mword)section + (i << LOS_CHUNK_BITS), pagesize);
+		if (release_end <= release_start)
+			continue;
+
+		mono_mprotect (release_start, release_end - release_start, MONO_MMAP_READ | MONO_MMAP_WRITE | MONO_MMAP_DISCARD);
+
+		for (j = LOS_CHUNK_INDEX (release_start, section); j < LOS_CHUNK_INDEX (release_end, section); ++j)
+			section->free_chunk_map [j] = LOS_CHUNK_RELEASED;
+	}
+}
+
 void
-sgen_los_free_object (LOSObject *obj)
+sgen_los_set_release_free_pages (gboolean release)
+{
+	los_release_free_pages = release;
+}
+
+void
+sgen_los_set_concurrent_sweep (gboolean concurrent)
+{
+	los_concurrent_sweep = concurrent;
+}
+
+/*
+ * Removes the object from the LOS accounting.  This must be done with the world stopped
+ * or the GC lock held, whereas the memory itself can be freed later by
+ * `los_free_object_memory ()`, which only touches the sections.
+ */
+static void
+los_unaccount_object (LOSObject *obj)
 {
 	SGEN_ASSERT (0, !obj->cardtable_mod_union, "We should never free a LOS object with a mod-union table.");
 
@@ -316,6 +391,14 @@ sgen_los_free_object (LOSObject *obj)
 
 	los_memory_usage -= size;
 	los_num_objects--;
+#endif
+}
+
+static void
+los_free_object_memory (LOSObject *obj)
+{
+#ifndef LOS_DUMMY
+	mword size = sgen_los_object_size (obj);
 
 #ifdef USE_MALLOC
 	free (obj);
@@ -336,6 +419,15 @@ sgen_los_free_object (LOSObject *obj)
 #endif
 }
 
+void
+sgen_los_free_object (LOSObject *obj)
+{
+	sgen_los_finish_sweeping ();
+
+	los_unaccount_object (obj);
+	los_free_object_memory (obj);
+}
+
 /*
  * Objects with size >= MAX_SMALL_SIZE are allocated in the large object space.
  * They are currently kept track of with a linked list.
@@ -420,41 +512,22 @@ sgen_los_alloc_large_inner (GCVTable vtable, size_t size)
 
 static void sgen_los_unpin_object (GCObject *data);
 
-void
-sgen_los_sweep (void)
+/*
+ * Frees the memory of the objects the last sweep found dead, returns empty sections to
+ * the OS and rebuilds the free lists.  Runs either on the thread pool, concurrently with
+ * the mutator and with nursery collections, or with the world stopped.
+ */
+static void
+sweep_los_sections (void)
 {
-	LOSObject *bigobj, *prevbo;
 	LOSSection *section, *prev;
 	int i;
 	int num_sections = 0;
 
-	/* sweep the big objects list */
-	prevbo = NULL;
-	for (bigobj = los_object_list; bigobj;) {
-		SGEN_ASSERT (0, !SGEN_OBJECT_IS_PINNED (bigobj->data), "Who pinned a LOS object?");
-
-		if (bigobj->cardtable_mod_union) {
-			sgen_card_table_free_mod_union (bigobj->cardtable_mod_union, (char*)bigobj->data, sgen_los_object_size (bigobj));
-			bigobj->cardtable_mod_union = NULL;
-		}
-
-		if (sgen_los_object_is_pinned (bigobj->data)) {
-			sgen_los_unpin_object (bigobj->data);
-			sgen_update_heap_boundaries ((mword)bigobj->data, (mword)bigobj->data + sgen_los_object_size (bigobj));
-		} else {
-			LOSObject *to_free;
-			/* not referenced anywhere, so we can free it */
-			if (prevbo)
-				prevbo->next = bigobj->next;
-			else
-				los_object_list = bigobj->next;
-			to_free = bigobj;
-			bigobj = bigobj->next;
-			sgen_los_free_object (to_free);
-			continue;
-		}
-		prevbo = bigobj;
-		bigobj = bigobj->next;
+	while (los_objects_to_free) {
+		LOSObject *to_free = los_objects_to_free;
+		los_objects_to_free = to_free->next;
+		los_free_object_memory (to_free);
 	}
 
 	/* Try to free memory */
@@ -483,6 +556,8 @@ sgen_los_sweep (void)
 				for (j = i + 1; j <= LOS_SECTION_NUM_CHUNKS && section->free_chunk_map [j]; ++j)
 					;
 				add_free_chunk ((LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS)), (j - i) << LOS_CHUNK_BITS);
+				if (los_release_free_pages)
+					release_free_chunk_pages (section, i, j);
 				i = j - 1;
 			}
 		}
@@ -493,10 +568,6 @@ sgen_los_sweep (void)
 		++num_sections;
 	}
 
-#ifdef LOS_CONSISTENCY_CHECK
-	los_consistency_check ();
-#endif
-
 	/*
 	g_print ("LOS sections: %d  objects: %d  usage: %d\n", num_sections, los_num_objects, los_memory_usage);
 	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i) {
@@ -511,6 +582,80 @@ sgen_los_sweep (void)
 	g_assert (los_num_sections == num_sections);
 }
 
+static void
+los_sweep_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
+{
+	sweep_los_sections ();
+
+	los_sweep_job = NULL;
+}
+
+/*
+ * Waits for the concurrent LOS sweep, if one is running.  Must be called with the GC
+ * lock held before touching the LOS sections or free lists.
+ */
+void
+sgen_los_finish_sweeping (void)
+{
+	SgenThreadPoolJob *job = los_sweep_job;
+
+	if (job)
+		sgen_thread_pool_job_wait (job);
+
+	SGEN_ASSERT (0, !los_sweep_job, "Why did the LOS sweep job not null itself?");
+	SGEN_ASSERT (0, !los_objects_to_free, "How is the LOS sweep done but there are objects left to free?");
+
+#ifdef LOS_CONSISTENCY_CHECK
+	los_consistency_check ();
+#endif
+}
+
+void
+sgen_los_sweep (void)
+{
+	LOSObject *bigobj, *prevbo;
+
+	sgen_los_finish_sweeping ();
+
+	/* sweep the big objects list */
+	prevbo = NULL;
+	for (bigobj = los_object_list; bigobj;) {
+		SGEN_ASSERT (0, !SGEN_OBJECT_IS_PINNED (bigobj->data), "Who pinned a LOS object?");
+
+		if (bigobj->cardtable_mod_union) {
+			sgen_card_table_free_mod_union (bigobj->cardtable_mod_union, (char*)bigobj->data, sgen_los_object_size (bigobj));
+			bigobj->cardtable_mod_union = NULL;
+		}
+
+		if (sgen_los_object_is_pinned (bigobj->data)) {
+			sgen_los_unpin_object (bigobj->data);
+			sgen_update_heap_boundaries ((mword)bigobj->data, (mword)bigobj->data + sgen_los_object_size (bigobj));
+		} else {
+			LOSObject *to_free;
+			/* not referenced anywhere, so we can free it */
+			if (prevbo)
+				prevbo->next = bigobj->next;
+			else
+				los_object_list = bigobj->next;
+			to_free = bigobj;
+			bigobj = bigobj->next;
+			los_unaccount_object (to_free);
+			to_free->next = los_objects_to_free;
+			los_objects_to_free = to_free;
+			continue;
+		}
+		prevbo = bigobj;
+		bigobj = bigobj->next;
+	}
+
+	if (los_concurrent_sweep) {
+		los_sweep_job = sgen_thread_pool_job_alloc ("LOS sweep", los_sweep_job_func, sizeof (SgenThreadPoolJob));
+		sgen_thread_pool_job_enqueue (los_sweep_job);
+	} else {
+		sweep_los_sections ();
+	}
+}
+
 gboolean
 sgen_ptr_is_in_los (char *ptr, char **start)
 {
@@ -710,6 +855,26 @@ sgen_los_pin_object (GCObject *data)
 	binary_protocol_pin (data, (gpointer)SGEN_LOAD_VTABLE (data), sgen_safe_object_get_size (data));
 }
 
+/*
+ * Thread safe version of sgen_los_pin_object (), for the parallel mark.  Returns whether
+ * the object was pinned by us, i.e. whether the caller has to scan it.
+ */
+gboolean
+sgen_los_pin_object_par (GCObject *data)
+{
+	LOSObject *obj = sgen_los_header_for_object (data);
+	mword old_size;
+
+	do {
+		old_size = obj->size;
+		if (old_size & 1)
+			return FALSE;
+	} while (SGEN_CAS_PTR ((gpointer*)&obj->size, (gpointer)(old_size | 1), (gpointer)old_size) != (gpointer)old_size);
+
+	binary_protocol_pin (data, (gpointer)SGEN_LOAD_VTABLE (data), sgen_safe_object_get_size (data));
+	return TRUE;
+}
+
 static void
 sgen_los_unpin_object (GCObject *data)
 {
@@ -18,5 +18,7 @@
 } while (0)
 
 #define COLLECTOR_SERIAL_ALLOC_FOR_PROMOTION sgen_minor_collector.alloc_for_promotion
+/* The parallel mark requires the simple nursery, which promotes straight into the major heap. */
+#define COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION(vt, obj, objsize, has_references) major_alloc_object_par ((vt), (objsize), (has_references))
 
 #include "sgen-copy-object.h"
@@ -18,6 +18,9 @@
  * draining function.
  *
  * Define COPY_OR_MARK_WITH_EVACUATION to support evacuation.
+ *
+ * Define COPY_OR_MARK_PARALLEL for the variant that runs on multiple workers at the same
+ * time.  It doesn't support evacuation.
  */
 
 /* Returns whether the object is still in the nursery. */
@@ -77,7 +80,11 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 	do_copy_object:
 #endif
 		old_obj = obj;
+#ifdef COPY_OR_MARK_PARALLEL
+		obj = copy_object_no_checks_par (obj, queue);
+#else
 		obj = copy_object_no_checks (obj, queue);
+#endif
 		if (G_UNLIKELY (old_obj == obj)) {
 			/*
 			 * If we fail to evacuate an object we just stop doing it for a
@@ -115,9 +122,19 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 		 */
 		block = MS_BLOCK_FOR_OBJ (obj);
 		MS_CALC_MARK_BIT (word, bit, obj);
+#ifdef COPY_OR_MARK_PARALLEL
+		{
+			/* Other workers might have copied it, too, but only one of us marks it. */
+			gboolean first;
+			MS_SET_MARK_BIT_PAR (block, word, bit, first);
+			if (first)
+				binary_protocol_mark (obj, (gpointer)LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
+		}
+#else
 		SGEN_ASSERT (9, !MS_MARK_BIT (block, word, bit), "object %p already marked", obj);
 		MS_SET_MARK_BIT (block, word, bit);
 		binary_protocol_mark (obj, (gpointer)LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
+#endif
 
 		return FALSE;
 #endif
@@ -173,15 +190,24 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 			}
 #endif
 
+#ifdef COPY_OR_MARK_PARALLEL
+			MS_MARK_OBJECT_AND_ENQUEUE_PAR (obj, desc, block, queue);
+#else
 			MS_MARK_OBJECT_AND_ENQUEUE (obj, desc, block, queue);
+#endif
 		} else {
 			HEAVY_STAT (++stat_optimized_copy_major_large);
 
+#ifdef COPY_OR_MARK_PARALLEL
+			if (!sgen_los_pin_object_par (obj))
+				return FALSE;
+#else
 			if (sgen_los_object_is_pinned (obj))
 				return FALSE;
 			binary_protocol_pin (obj, (gpointer)SGEN_LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
 
 			sgen_los_pin_object (obj);
+#endif
 			if (SGEN_OBJECT_HAS_REFERENCES (obj))
 				GRAY_OBJECT_ENQUEUE (queue, obj, sgen_obj_get_descriptor (obj));
 		}
@@ -313,6 +339,7 @@ DRAIN_GRAY_STACK_FUNCTION_NAME (SgenGrayQueue *queue)
 
 #undef COPY_OR_MARK_FUNCTION_NAME
 #undef COPY_OR_MARK_WITH_EVACUATION
+#undef COPY_OR_MARK_PARALLEL
 #undef COPY_OR_MARK_CONCURRENT
 #undef COPY_OR_MARK_CONCURRENT_WITH_EVACUATION
 #undef SCAN_OBJECT_FUNCTION_NAME
@@ -29,8 +29,10 @@
 #include "mono/sgen/sgen-pinning.h"
 #include "mono/sgen/sgen-workers.h"
 #include "mono/sgen/sgen-thread-pool.h"
+#include "mono/sgen/sgen-numa.h"
 #include "mono/sgen/sgen-client.h"
 #include "mono/utils/mono-memory-model.h"
+#include "mono/utils/mono-tls.h"
 
 #if defined(ARCH_MIN_MS_BLOCK_SIZE) && defined(ARCH_MIN_MS_BLOCK_SIZE_SHIFT)
 #define MS_BLOCK_SIZE	ARCH_MIN_MS_BLOCK_SIZE
@@ -103,6 +105,7 @@ struct _MSBlockInfo {
 	unsigned int has_references : 1;
 	unsigned int has_pinned : 1;	/* means cannot evacuate */
 	unsigned int is_to_space : 1;
+	unsigned int numa_node : 4;
 	void ** volatile free_list;
 	MSBlockInfo * volatile next_free;
 	guint8 * volatile cardtable_mod_union;
@@ -138,6 +141,19 @@ typedef struct {
 
 #define MS_MARK_BIT(bl,w,b)	((bl)->mark_words [(w)] & (ONE_P << (b)))
 #define MS_SET_MARK_BIT(bl,w,b)	((bl)->mark_words [(w)] |= (ONE_P << (b)))
+/* Atomically sets the mark bit.  `first` is set to whether we were the ones who set it. */
+#define MS_SET_MARK_BIT_PAR(bl,w,b,first)	do {			\
+		mword __old_word = (bl)->mark_words [(w)];		\
+		(first) = FALSE;					\
+		while (!(__old_word & (ONE_P << (b)))) {		\
+			mword __prev_word = (mword)SGEN_CAS_PTR ((gpointer*)&(bl)->mark_words [(w)], (gpointer)(__old_word | (ONE_P << (b))), (gpointer)__old_word); \
+			if (__prev_word == __old_word) {		\
+				(first) = TRUE;				\
+				break;					\
+			}						\
+			__old_word = __prev_word;			\
+		}							\
+	} while (0)
 
 #define MS_OBJ_ALLOCED(o,b)	(*(void**)(o) && (*(char**)(o) < MS_BLOCK_FOR_BLOCK_INFO (b) || *(char**)(o) >= MS_BLOCK_FOR_BLOCK_INFO (b) + MS_BLOCK_SIZE))
 
@@ -161,6 +177,15 @@ static int fast_block_obj_size_indexes [MS_NUM_FAST_BLOCK_OBJ_SIZE_INDEXES];
 static gboolean *evacuate_block_obj_sizes;
 static float evacuation_threshold = 0.666f;
 
+/*
+ * If the overall occupancy of the major heap after a sweep drops below this, the next
+ * major collection evacuates every size class that has free slots, and afterwards
+ * returns the emptied blocks to the OS.  Zero disables compaction.
+ */
+static float compaction_threshold = 0.0f;
+static gboolean compaction_requested = FALSE;
+static gboolean compaction_in_progress = FALSE;
+
 static gboolean lazy_sweep = FALSE;
 
 enum {
@@ -174,6 +199,7 @@ enum {
 static volatile int sweep_state = SWEEP_STATE_SWEPT;
 
 static gboolean concurrent_mark;
+static gboolean parallel_mark;
 static gboolean concurrent_sweep = TRUE;
 
 #define BLOCK_IS_TAGGED_HAS_REFERENCES(bl)	SGEN_POINTER_IS_TAGGED_1 ((bl))
@@ -189,8 +215,11 @@ static gboolean concurrent_sweep = TRUE;
 /* all allocated blocks in the system */
 static SgenArrayList allocated_blocks = SGEN_ARRAY_LIST_INIT (NULL, NULL, NULL, INTERNAL_MEM_PIN_QUEUE);
 
-/* non-allocated block free-list */
-static void *empty_blocks = NULL;
+/*
+ * Non-allocated block free-lists, one per NUMA node.  Without NUMA support all empty
+ * blocks are on node 0.  `num_empty_blocks` is the total over all nodes.
+ */
+static void *empty_blocks [SGEN_NUMA_MAX_NODES];
 static size_t num_empty_blocks = 0;
 
 #define FOREACH_BLOCK_NO_LOCK(bl) {					\
@@ -228,6 +257,19 @@ static volatile size_t num_major_sections = 0;
  */
 static MSBlockInfo * volatile *free_block_lists [MS_BLOCK_TYPE_MAX];
 
+/*
+ * Free block lists private to each parallel nursery collection worker.  Workers take
+ * blocks off the global free lists (or allocate new ones) into their own lists and
+ * allocate from those without contention.  The remaining blocks are returned to the
+ * global lists at the end of the collection.
+ */
+static MonoNativeTlsKey worker_block_free_list_key;
+static MSBlockInfo * volatile **workers_free_block_lists [SGEN_THREADPOOL_MAX_NUM_THREADS];
+static volatile int workers_free_block_lists_num;
+
+/* Protects `allocated_blocks` when blocks are allocated by multiple workers. */
+static mono_mutex_t allocated_blocks_lock;
+
 static guint64 stat_major_blocks_alloced = 0;
 static guint64 stat_major_blocks_freed = 0;
 static guint64 stat_major_blocks_lazy_swept = 0;
@@ -289,9 +331,9 @@ major_alloc_heap (mword nursery_size, mword nursery_align, int the_nursery_bits)
 {
 	char *start;
 	if (nursery_align)
-		start = (char *)sgen_alloc_os_memory_aligned (nursery_size, nursery_align, (SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE), "nursery");
+		start = (char *)sgen_alloc_os_memory_aligned (nursery_size, nursery_align, (SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE | SGEN_ALLOC_HUGE_PAGES), "nursery");
 	else
-		start = (char *)sgen_alloc_os_memory (nursery_size, (SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE), "nursery");
+		start = (char *)sgen_alloc_os_memory (nursery_size, (SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE | SGEN_ALLOC_HUGE_PAGES), "nursery");
 
 	return start;
 }
@@ -302,44 +344,95 @@ update_heap_boundaries_for_block (MSBlockInfo *block)
 	sgen_update_heap_boundaries ((mword)MS_BLOCK_FOR_BLOCK_INFO (block), (mword)MS_BLOCK_FOR_BLOCK_INFO (block) + MS_BLOCK_SIZE);
 }
 
+static void
+push_empty_block (int node, void *block)
+{
+	void *empty;
+
+	do {
+		empty = empty_blocks [node];
+		*(void**)block = empty;
+	} while (SGEN_CAS_PTR ((gpointer*)&empty_blocks [node], block, empty) != empty);
+}
+
+static void*
+try_pop_empty_block (int node)
+{
+	void *block, *empty, *next;
+
+	do {
+		empty = empty_blocks [node];
+		if (!empty)
+			return NULL;
+		block = empty;
+		next = *(void**)block;
+	} while (SGEN_CAS_PTR (&empty_blocks [node], next, empty) != empty);
+
+	SGEN_ATOMIC_ADD_P (num_empty_blocks, -1);
+
+	*(void**)block = NULL;
+
+	return block;
+}
+
 /*
  * Thread safe
+ *
+ * Prefers blocks on the NUMA node the calling thread is running on.  If there are none,
+ * we take empty blocks from other nodes before allocating new ones, to not grow the heap
+ * just for locality.
  */
 static void*
-ms_get_empty_block (void)
+ms_get_empty_block (int *numa_node)
 {
 	char *p;
-	int i;
-	void *block, *empty, *next;
+	int i, num_nodes;
+	int node = sgen_numa_get_current_node ();
+	void *block;
 
  retry:
-	if (!empty_blocks) {
+	num_nodes = sgen_numa_get_num_nodes ();
+	for (i = 0; i < num_nodes; ++i) {
+		int n = (node + i) % num_nodes;
+		block = try_pop_empty_block (n);
+		if (block) {
+			g_assert (!((mword)block & (MS_BLOCK_SIZE - 1)));
+			*numa_node = n;
+			return block;
+		}
+	}
+
+	{
 		/*
 		 * We try allocating MS_BLOCK_ALLOC_NUM blocks first.  If that's
 		 * unsuccessful, we halve the number of blocks and try again, until we're at
 		 * 1.  If that doesn't work, either, we assert.
+		 *
+		 * With huge pages we allocate a whole, aligned huge page at a time, since
+		 * smaller chunks can't be backed by one.
 		 */
-		int alloc_num = MS_BLOCK_ALLOC_NUM;
+		gboolean huge_pages = sgen_memgov_huge_pages_enabled ();
+		int ideal_alloc_num = huge_pages ? SGEN_HUGE_PAGE_SIZE / MS_BLOCK_SIZE : MS_BLOCK_ALLOC_NUM;
+		int alloc_num = ideal_alloc_num;
 		for (;;) {
-			p = (char *)sgen_alloc_os_memory_aligned (MS_BLOCK_SIZE * alloc_num, MS_BLOCK_SIZE,
-				(SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE),
+			p = (char *)sgen_alloc_os_memory_aligned (MS_BLOCK_SIZE * alloc_num, huge_pages ? SGEN_HUGE_PAGE_SIZE : MS_BLOCK_SIZE,
+				(SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE | SGEN_ALLOC_HUGE_PAGES),
 				alloc_num == 1 ? "major heap section" : NULL);
 			if (p)
 				break;
 			alloc_num >>= 1;
 		}
 
+		/* This must happen before we touch the memory. */
+		sgen_numa_bind_memory (p, MS_BLOCK_SIZE * alloc_num, node);
+
 		for (i = 0; i < alloc_num; ++i) {
-			block = p;
 			/*
 			 * We do the free list update one after the
 			 * other so that other threads can use the new
 			 * blocks as quickly as possible.
 			 */
-			do {
-				empty = empty_blocks;
-				*(void**)block = empty;
-			} while (SGEN_CAS_PTR ((gpointer*)&empty_blocks, block, empty) != empty);
+			push_empty_block (node, p);
 			p += MS_BLOCK_SIZE;
 		}
 
@@ -347,44 +440,28 @@ ms_get_empty_block (void)
 
 		stat_major_blocks_alloced += alloc_num;
 #if SIZEOF_VOID_P != 8
-		if (alloc_num != MS_BLOCK_ALLOC_NUM)
+		if (alloc_num != ideal_alloc_num)
 			stat_major_blocks_alloced_less_ideal += alloc_num;
 #endif
 	}
 
-	do {
-		empty = empty_blocks;
-		if (!empty)
-			goto retry;
-		block = empty;
-		next = *(void**)block;
-	} while (SGEN_CAS_PTR (&empty_blocks, next, empty) != empty);
-
-	SGEN_ATOMIC_ADD_P (num_empty_blocks, -1);
-
-	*(void**)block = NULL;
-
-	g_assert (!((mword)block & (MS_BLOCK_SIZE - 1)));
-
-	return block;
+	goto retry;
 }
 
 /*
  * This doesn't actually free a block immediately, but enqueues it into the `empty_blocks`
- * list, where it will either be freed later on, or reused in nursery collections.
+ * list of its node, where it will either be freed later on, or reused in nursery
+ * collections.
  */
 static void
-ms_free_block (void *block)
+ms_free_block (MSBlockInfo *block)
 {
-	void *empty;
+	int node = block->numa_node;
 
 	sgen_memgov_release_space (MS_BLOCK_SIZE, SPACE_MAJOR);
 	memset (block, 0, MS_BLOCK_SIZE);
 
-	do {
-		empty = empty_blocks;
-		*(void**)block = empty;
-	} while (SGEN_CAS_PTR (&empty_blocks, block, empty) != empty);
+	push_empty_block (node, block);
 
 	SGEN_ATOMIC_ADD_P (num_empty_blocks, 1);
 
@@ -433,8 +510,11 @@ check_empty_blocks (void)
 {
 	void *p;
 	size_t i = 0;
-	for (p = empty_blocks; p; p = *(void**)p)
-		++i;
+	int node;
+	for (node = 0; node < SGEN_NUMA_MAX_NODES; ++node) {
+		for (p = empty_blocks [node]; p; p = *(void**)p)
+			++i;
+	}
 	g_assert (i == num_empty_blocks);
 }
 
@@ -494,19 +574,18 @@ add_free_block (MSBlockInfo * volatile *free_blocks, int size_index, MSBlockInfo
 static void major_finish_sweep_checking (void);
 
 static gboolean
-ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
+ms_alloc_block_to (MSBlockInfo * volatile *free_blocks, int size_index, gboolean pinned, gboolean has_references)
 {
 	int size = block_obj_sizes [size_index];
 	int count = MS_BLOCK_FREE / size;
 	MSBlockInfo *info;
-	MSBlockInfo * volatile * free_blocks = FREE_BLOCKS (pinned, has_references);
 	char *obj_start;
-	int i;
+	int i, numa_node;
 
 	if (!sgen_memgov_try_alloc_space (MS_BLOCK_SIZE, SPACE_MAJOR))
 		return FALSE;
 
-	info = (MSBlockInfo*)ms_get_empty_block ();
+	info = (MSBlockInfo*)ms_get_empty_block (&numa_node);
 
 	SGEN_ASSERT (9, count >= 2, "block with %d objects, it must hold at least 2", count);
 
@@ -522,6 +601,7 @@ ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
 	 * want further evacuation. We also don't want to evacuate objects allocated during
 	 * the concurrent mark since it would add pointless stress on the finishing pause.
 	 */
+	info->numa_node = numa_node;
 	info->is_to_space = (sgen_get_current_collection_generation () == GENERATION_OLD) || sgen_concurrent_collection_in_progress ();
 	info->state = info->is_to_space ? BLOCK_STATE_MARKING : BLOCK_STATE_SWEPT;
 	SGEN_ASSERT (6, !sweep_in_progress () || info->state == BLOCK_STATE_SWEPT, "How do we add a new block to be swept while sweeping?");
@@ -555,12 +635,20 @@ ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
 	major_finish_sweep_checking ();
 	mono_memory_barrier ();
 
+	mono_os_mutex_lock (&allocated_blocks_lock);
 	sgen_array_list_add (&allocated_blocks, BLOCK_TAG (info), 0, FALSE);
+	mono_os_mutex_unlock (&allocated_blocks_lock);
 
 	SGEN_ATOMIC_ADD_P (num_major_sections, 1);
 	return TRUE;
 }
 
+static gboolean
+ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
+{
+	return ms_alloc_block_to (FREE_BLOCKS (pinned, has_references), size_index, pinned, has_references);
+}
+
 static gboolean
 ptr_is_from_pinned_alloc (char *ptr)
 {
@@ -657,6 +745,80 @@ major_alloc_object (GCVTable vtable, size_t size, gboolean has_references)
 	return alloc_obj (vtable, size, FALSE, has_references);
 }
 
+/*
+ * Pops the first block off a global free list.  Only parallel nursery collection
+ * workers remove blocks concurrently, and nobody adds blocks back while they do, so
+ * the ABA problem can't occur.
+ */
+static MSBlockInfo*
+try_remove_block_from_free_list (MSBlockInfo * volatile *free_blocks, int size_index)
+{
+	MSBlockInfo *block, *next_free_block;
+
+	do {
+		block = free_blocks [size_index];
+		if (!block)
+			return NULL;
+		next_free_block = block->next_free;
+	} while (SGEN_CAS_PTR ((volatile gpointer *)&free_blocks [size_index], next_free_block, block) != block);
+
+	block->next_free = NULL;
+	return block;
+}
+
+static GCObject*
+major_alloc_object_par (GCVTable vtable, size_t size, gboolean has_references)
+{
+	int size_index = MS_BLOCK_OBJ_SIZE_INDEX (size);
+	MSBlockInfo * volatile **worker_free_block_lists = (MSBlockInfo * volatile **)mono_native_tls_get_value (worker_block_free_list_key);
+	MSBlockInfo * volatile *free_blocks;
+	MSBlockInfo *block;
+	void *obj;
+
+	SGEN_ASSERT (9, worker_free_block_lists, "Parallel allocation from a thread that is not a worker");
+	free_blocks = FREE_BLOCKS_FROM (worker_free_block_lists, FALSE, has_references);
+
+	if (!free_blocks [size_index]) {
+		block = try_remove_block_from_free_list (FREE_BLOCKS (FALSE, has_references), size_index);
+		if (block) {
+			free_blocks [size_index] = block;
+		} else if (G_UNLIKELY (!ms_alloc_block_to (free_blocks, size_index, FALSE, has_references))) {
+			return NULL;
+		}
+	}
+
+	/* The block is private to this worker, so there is no contention on it */
+	obj = unlink_slot_from_free_list_uncontested (free_blocks, size_index);
+
+	/* FIXME: assumes object layout */
+	*(GCVTable*)obj = vtable;
+
+	return (GCObject *)obj;
+}
+
+/*
+ * Returns the blocks left in the workers' private free lists to the global lists.
+ */
+static void
+flush_workers_free_block_lists (void)
+{
+	int i, j, k;
+
+	for (i = 0; i < workers_free_block_lists_num; ++i) {
+		MSBlockInfo * volatile **worker_free_block_lists = workers_free_block_lists [i];
+		for (j = 0; j < MS_BLOCK_TYPE_MAX; ++j) {
+			for (k = 0; k < num_block_obj_sizes; ++k) {
+				MSBlockInfo *block = worker_free_block_lists [j][k];
+				if (!block)
+					continue;
+				worker_free_block_lists [j][k] = NULL;
+				SGEN_ASSERT (6, !block->next_free, "Worker free lists hold at most one block per size");
+				add_free_block (free_block_lists [j], k, block);
+			}
+		}
+	}
+}
+
 /*
  * We're not freeing the block if it's empty.  We leave that work for
  * the next major collection.
@@ -1102,6 +1264,19 @@ major_block_is_evacuating (MSBlockInfo *block)
 			INC_NUM_MAJOR_OBJECTS_MARKED ();		\
 		}							\
 	} while (0)
+#define MS_MARK_OBJECT_AND_ENQUEUE_PAR(obj,desc,block,queue) do {	\
+		int __word, __bit;					\
+		gboolean __first;					\
+		MS_CALC_MARK_BIT (__word, __bit, (obj));		\
+		SGEN_ASSERT (9, MS_OBJ_ALLOCED ((obj), (block)), "object %p not allocated", obj); \
+		MS_SET_MARK_BIT_PAR ((block), __word, __bit, __first); \
+		if (__first) {						\
+			if (sgen_gc_descr_has_references (desc))			\
+				GRAY_OBJECT_ENQUEUE ((queue), (obj), (desc)); \
+			binary_protocol_mark ((obj), (gpointer)LOAD_VTABLE ((obj)), sgen_safe_object_get_size ((obj))); \
+			INC_NUM_MAJOR_OBJECTS_MARKED ();		\
+		}							\
+	} while (0)
 
 static void
 pin_major_object (GCObject *obj, SgenGrayQueue *queue)
@@ -1177,6 +1352,14 @@ static guint64 stat_drain_loops;
 #define SCAN_PTR_FIELD_FUNCTION_NAME	major_scan_ptr_field_with_evacuation
 #include "sgen-marksweep-drain-gray-stack.h"
 
+#define COPY_OR_MARK_PARALLEL
+#define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_par_no_evacuation
+#define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_par_no_evacuation
+#define SCAN_VTYPE_FUNCTION_NAME	major_scan_vtype_par_no_evacuation
+#define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_par_no_evacuation
+#define SCAN_PTR_FIELD_FUNCTION_NAME	major_scan_ptr_field_par_no_evacuation
+#include "sgen-marksweep-drain-gray-stack.h"
+
 #define COPY_OR_MARK_CONCURRENT
 #define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_concurrent_no_evacuation
 #define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_concurrent_no_evacuation
@@ -1228,6 +1411,12 @@ major_copy_or_mark_object_canonical (GCObject **ptr, SgenGrayQueue *queue)
 	major_copy_or_mark_object_with_evacuation (ptr, *ptr, queue);
 }
 
+static void
+major_copy_or_mark_object_par_canonical (GCObject **ptr, SgenGrayQueue *queue)
+{
+	major_copy_or_mark_object_par_no_evacuation (ptr, *ptr, queue);
+}
+
 static void
 major_copy_or_mark_object_concurrent_canonical (GCObject **ptr, SgenGrayQueue *queue)
 {
@@ -1417,6 +1606,9 @@ sweep_start (void)
 	for (i = 0; i < num_block_obj_sizes; ++i)
 		sweep_slots_available [i] = sweep_slots_used [i] = sweep_num_blocks [i] = 0;
 
+	/* Return the workers' blocks first, so the sweep can rebuild all the lists */
+	flush_workers_free_block_lists ();
+
 	/* clear all the free lists */
 	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i) {
 		MSBlockInfo * volatile *free_blocks = free_block_lists [i];
@@ -1625,10 +1817,22 @@ static void
 sweep_finish (void)
 {
 	int i;
+	size_t total_slots_used = 0, total_slots_available = 0;
+
+	for (i = 0; i < num_block_obj_sizes; ++i) {
+		total_slots_used += sweep_slots_used [i];
+		total_slots_available += sweep_slots_available [i];
+	}
+
+	/* The parallel mark doesn't support evacuation, since it marks objects in place. */
+	compaction_requested = !parallel_mark && compaction_threshold > 0.0f && total_slots_available &&
+		(float)total_slots_used / (float)total_slots_available < compaction_threshold;
 
 	for (i = 0; i < num_block_obj_sizes; ++i) {
 		float usage = (float)sweep_slots_used [i] / (float)sweep_slots_available [i];
-		if (sweep_num_blocks [i] > 5 && usage < evacuation_threshold) {
+		if (compaction_requested && sweep_num_blocks [i] > 1 && sweep_slots_used [i] < sweep_slots_available [i]) {
+			evacuate_block_obj_sizes [i] = TRUE;
+		} else if (!parallel_mark && sweep_num_blocks [i] > 5 && usage < evacuation_threshold) {
 			evacuate_block_obj_sizes [i] = TRUE;
 			/*
 			g_print ("slot size %d - %d of %d used\n",
@@ -1771,6 +1975,8 @@ major_start_nursery_collection (void)
 static void
 major_finish_nursery_collection (void)
 {
+	flush_workers_free_block_lists ();
+
 #ifdef MARKSWEEP_CONSISTENCY_CHECK
 	consistency_check ();
 #endif
@@ -1784,6 +1990,8 @@ major_start_major_collection (void)
 
 	major_finish_sweep_checking ();
 
+	compaction_in_progress = compaction_requested;
+
 	/*
 	 * Clear the free lists for block sizes where we do evacuation.  For those block
 	 * sizes we will have to allocate new blocks.
@@ -1830,7 +2038,6 @@ major_finish_major_collection (ScannedObjectCounts *counts)
 #endif
 }
 
-#if SIZEOF_VOID_P != 8
 static int
 compare_pointers (const void *va, const void *vb) {
 	char *a = *(char**)va, *b = *(char**)vb;
@@ -1840,7 +2047,75 @@ compare_pointers (const void *va, const void *vb) {
 		return 1;
 	return 0;
 }
-#endif
+
+/*
+ * With huge pages, releasing a single block would split the huge page backing it, so we
+ * only release huge pages whose blocks are all empty.
+ */
+static void
+free_empty_huge_pages (size_t section_reserve)
+{
+	const int blocks_per_page = SGEN_HUGE_PAGE_SIZE / MS_BLOCK_SIZE;
+	size_t i, num_blocks = 0, num_empty_blocks_orig = num_empty_blocks;
+	size_t num_pages = 0;
+	int node;
+	void **empty_block_arr;
+	void *block;
+
+	if (num_empty_blocks < section_reserve + blocks_per_page)
+		return;
+
+	empty_block_arr = (void**)sgen_alloc_internal_dynamic (sizeof (void*) * num_empty_blocks_orig,
+			INTERNAL_MEM_MS_BLOCK_INFO_SORT, FALSE);
+	if (!empty_block_arr)
+		return;
+
+	for (node = 0; node < SGEN_NUMA_MAX_NODES; ++node) {
+		for (block = empty_blocks [node]; block; block = *(void**)block)
+			empty_block_arr [num_blocks++] = block;
+	}
+	SGEN_ASSERT (0, num_blocks == num_empty_blocks, "empty block count wrong");
+
+	sgen_qsort (empty_block_arr, num_blocks, sizeof (void*), compare_pointers);
+
+	/*
+	 * The blocks are sorted, so a page is empty if its first block and the one
+	 * blocks_per_page - 1 entries further are both at the right addresses.  The pages
+	 * are collected at the start of the array, which we've already gone past.
+	 */
+	for (i = 0; i + blocks_per_page <= num_blocks && num_empty_blocks >= section_reserve + blocks_per_page; ++i) {
+		char *first = (char *)empty_block_arr [i];
+
+		if ((mword)first & (SGEN_HUGE_PAGE_SIZE - 1))
+			continue;
+		if ((char *)empty_block_arr [i + blocks_per_page - 1] != first + SGEN_HUGE_PAGE_SIZE - MS_BLOCK_SIZE)
+			continue;
+
+		empty_block_arr [num_pages++] = first;
+		i += blocks_per_page - 1;
+		num_empty_blocks -= blocks_per_page;
+	}
+
+	/* Unlink the blocks of the pages while we can still read them. */
+	for (node = 0; node < SGEN_NUMA_MAX_NODES && num_pages; ++node) {
+		void **next = &empty_blocks [node];
+
+		while (*next) {
+			void *page = (void *)SGEN_ALIGN_DOWN_TO ((mword)*next, SGEN_HUGE_PAGE_SIZE);
+
+			if (bsearch (&page, empty_block_arr, num_pages, sizeof (void*), compare_pointers))
+				*next = *(void**)*next;
+			else
+				next = (void**)*next;
+		}
+	}
+
+	for (i = 0; i < num_pages; ++i)
+		sgen_free_os_memory (empty_block_arr [i], SGEN_HUGE_PAGE_SIZE, (SgenAllocFlags)(SGEN_ALLOC_HEAP | SGEN_ALLOC_HUGE_PAGES));
+	stat_major_blocks_freed += num_pages * blocks_per_page;
+
+	sgen_free_internal_dynamic (empty_block_arr, sizeof (void*) * num_empty_blocks_orig, INTERNAL_MEM_MS_BLOCK_INFO_SORT);
+}
 
 /*
  * This is called with sweep completed and the world stopped.
@@ -1850,9 +2125,19 @@ major_free_swept_blocks (size_t allowance)
 {
 	/* FIXME: This is probably too much.  It's assuming all objects are small. */
 	size_t section_reserve = allowance / MS_BLOCK_SIZE;
+	int node = 0;
 
 	SGEN_ASSERT (0, sweep_state == SWEEP_STATE_SWEPT, "Sweeping must have finished before freeing blocks");
 
+	/*
+	 * After a compacting collection the evacuated blocks are empty and we release all of
+	 * them, not only the ones exceeding the allowance.
+	 */
+	if (compaction_in_progress) {
+		section_reserve = 0;
+		compaction_in_progress = FALSE;
+	}
+
 #ifdef TARGET_WIN32
 		/*
 		 * sgen_free_os_memory () asserts in mono_vfree () because windows doesn't like freeing the middle of
@@ -1861,6 +2146,11 @@ major_free_swept_blocks (size_t allowance)
 		return;
 #endif
 
+	if (sgen_memgov_huge_pages_enabled ()) {
+		free_empty_huge_pages (section_reserve);
+		return;
+	}
+
 #if SIZEOF_VOID_P != 8
 	{
 		int i, num_empty_blocks_orig, num_blocks, arr_length;
@@ -1872,6 +2162,10 @@ major_free_swept_blocks (size_t allowance)
 			return;
 		SGEN_ASSERT (0, num_empty_blocks > 0, "section reserve can't be negative");
 
+		/* Looking for contiguous blocks across NUMA nodes isn't worth it. */
+		if (sgen_numa_is_enabled ())
+			goto fallback;
+
 		num_empty_blocks_orig = num_empty_blocks;
 		empty_block_arr = (void**)sgen_alloc_internal_dynamic (sizeof (void*) * num_empty_blocks_orig,
 				INTERNAL_MEM_MS_BLOCK_INFO_SORT, FALSE);
@@ -1879,7 +2173,7 @@ major_free_swept_blocks (size_t allowance)
 			goto fallback;
 
 		i = 0;
-		for (block = empty_blocks; block; block = *(void**)block)
+		for (block = empty_blocks [0]; block; block = *(void**)block)
 			empty_block_arr [i++] = block;
 		SGEN_ASSERT (0, i == num_empty_blocks, "empty block count wrong");
 
@@ -1959,7 +2253,7 @@ major_free_swept_blocks (size_t allowance)
 		}
 
 		/* rebuild empty_blocks free list */
-		rebuild_next = (void**)&empty_blocks;
+		rebuild_next = (void**)&empty_blocks [0];
 		for (i = 0; i < arr_length; ++i) {
 			void *block = empty_block_arr [i];
 			SGEN_ASSERT (6, block, "we're missing blocks");
@@ -1979,14 +2273,19 @@ major_free_swept_blocks (size_t allowance)
 	 * This is our threshold.  If there's not more empty than used blocks, we won't
 	 * release uncontiguous blocks, in fear of fragmenting the address space.
 	 */
-	if (num_empty_blocks <= num_major_sections)
+	if (num_empty_blocks <= num_major_sections && section_reserve)
 		return;
 #endif
 
+	/* Free round-robin from all NUMA nodes so that they all keep some empty blocks. */
 	while (num_empty_blocks > section_reserve) {
-		void *next = *(void**)empty_blocks;
-		sgen_free_os_memory (empty_blocks, MS_BLOCK_SIZE, SGEN_ALLOC_HEAP);
-		empty_blocks = next;
+		void *block;
+		while (!empty_blocks [node])
+			node = (node + 1) % SGEN_NUMA_MAX_NODES;
+		block = empty_blocks [node];
+		empty_blocks [node] = *(void**)block;
+		node = (node + 1) % SGEN_NUMA_MAX_NODES;
+		sgen_free_os_memory (block, MS_BLOCK_SIZE, SGEN_ALLOC_HEAP);
 		/*
 		 * Needs not be atomic because this is running
 		 * single-threaded.
@@ -2079,6 +2378,16 @@ major_handle_gc_param (const char *opt)
 		}
 		evacuation_threshold = (float)percentage / 100.0f;
 		return TRUE;
+	} else if (g_str_has_prefix (opt, "compaction-threshold=")) {
+		const char *arg = strchr (opt, '=') + 1;
+		int percentage = atoi (arg);
+		if (percentage < 0 || percentage > 100) {
+			fprintf (stderr, "compaction-threshold must be an integer in the range 0-100.\n");
+			exit (1);
+		}
+		compaction_threshold = (float)percentage / 100.0f;
+		sgen_los_set_release_free_pages (percentage > 0);
+		return TRUE;
 	} else if (!strcmp (opt, "lazy-sweep")) {
 		lazy_sweep = TRUE;
 		return TRUE;
@@ -2102,6 +2411,7 @@ major_print_gc_param_usage (void)
 	fprintf (stderr,
 			""
 			"  evacuation-threshold=P (where P is a percentage, an integer in 0-100)\n"
+			"  compaction-threshold=P (where P is a percentage, an integer in 0-100)\n"
 			"  (no-)lazy-sweep\n"
 			"  (no-)concurrent-sweep\n"
 			);
@@ -2130,42 +2440,6 @@ extern guint64 scanned_objects;
 extern guint64 remarked_cards;
 #endif
 
-#define CARD_WORDS_PER_BLOCK (CARDS_PER_BLOCK / SIZEOF_VOID_P)
-/*
- * MS blocks are 16K aligned.
- * Cardtables are 4K aligned, at least.
- * This means that the cardtable of a given block is 32 bytes aligned.
- */
-static guint8*
-initial_skip_card (guint8 *card_data)
-{
-	mword *cards = (mword*)card_data;
-	mword card;
-	int i;
-	for (i = 0; i < CARD_WORDS_PER_BLOCK; ++i) {
-		card = cards [i];
-		if (card)
-			break;
-	}
-
-	if (i == CARD_WORDS_PER_BLOCK)
-		return card_data + CARDS_PER_BLOCK;
-
-#if defined(__i386__) && defined(__GNUC__)
-	return card_data + i * 4 +  (__builtin_ffs (card) - 1) / 8;
-#elif defined(__x86_64__) && defined(__GNUC__)
-	return card_data + i * 8 +  (__builtin_ffsll (card) - 1) / 8;
-#elif defined(__s390x__) && defined(__GNUC__)
-	return card_data + i * 8 +  (__builtin_ffsll (GUINT64_TO_LE(card)) - 1) / 8;
-#else
-	for (i = i * SIZEOF_VOID_P; i < CARDS_PER_BLOCK; ++i) {
-		if (card_data [i])
-			return &card_data [i];
-	}
-	return card_data;
-#endif
-}
-
 #define MS_BLOCK_OBJ_INDEX_FAST(o,b,os)	(((char*)(o) - ((b) + MS_BLOCK_SKIP)) / (os))
 #define MS_BLOCK_OBJ_FAST(b,os,i)			((b) + MS_BLOCK_SKIP + (os) * (i))
 #define MS_OBJ_ALLOCED_FAST(o,b)		(*(void**)(o) && (*(char**)(o) < (b) || *(char**)(o) >= (b) + MS_BLOCK_SIZE))
@@ -2217,6 +2491,8 @@ scan_card_table_for_block (MSBlockInfo *block, CardTableScanType scan_type, Scan
 		}
 	} else {
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
+		if (!sgen_card_table_summary_range_is_dirty ((mword)block_start, MS_BLOCK_SIZE))
+			return;
 		card_data = card_base = sgen_card_table_get_card_scan_address ((mword)block_start);
 #else
 		if (!sgen_card_table_get_card_data (cards_copy, (mword)block_start, CARDS_PER_BLOCK))
@@ -2228,7 +2504,7 @@ scan_card_table_for_block (MSBlockInfo *block, CardTableScanType scan_type, Scan
 
 	card_data += MS_BLOCK_SKIP >> CARD_BITS;
 
-	card_data = initial_skip_card (card_data);
+	card_data = sgen_card_table_find_next_marked_card (card_data, card_data_end);
 	while (card_data < card_data_end) {
 		size_t card_index, first_object_index;
 		char *start;
@@ -2238,7 +2514,7 @@ scan_card_table_for_block (MSBlockInfo *block, CardTableScanType scan_type, Scan
 		HEAVY_STAT (++scanned_cards);
 
 		if (!*card_data) {
-			++card_data;
+			card_data = sgen_card_table_find_next_marked_card (card_data + 1, card_data_end);
 			continue;
 		}
 
@@ -2385,15 +2661,40 @@ update_cardtable_mod_union (void)
 
 #undef pthread_create
 
+static void
+major_worker_init (void)
+{
+	MSBlockInfo * volatile **worker_free_block_lists;
+	int i, index;
+
+	worker_free_block_lists = (MSBlockInfo * volatile **)sgen_alloc_internal_dynamic (sizeof (MSBlockInfo * volatile *) * MS_BLOCK_TYPE_MAX, INTERNAL_MEM_MS_TABLES, TRUE);
+	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i)
+		worker_free_block_lists [i] = (MSBlockInfo * volatile *)sgen_alloc_internal_dynamic (sizeof (MSBlockInfo*) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
+
+	index = InterlockedIncrement (&workers_free_block_lists_num) - 1;
+	SGEN_ASSERT (0, index < SGEN_THREADPOOL_MAX_NUM_THREADS, "Too many workers");
+	workers_free_block_lists [index] = worker_free_block_lists;
+
+	mono_native_tls_set_value (worker_block_free_list_key, worker_free_block_lists);
+}
+
+static int
+major_get_obj_numa_node (GCObject *obj, SgenDescriptor desc)
+{
+	if (sgen_ptr_in_nursery (obj) || !sgen_safe_object_is_small (obj, desc & DESC_TYPE_MASK))
+		return -1;
+	return MS_BLOCK_FOR_OBJ (obj)->numa_node;
+}
+
 static void
 post_param_init (SgenMajorCollector *collector)
 {
 	collector->sweeps_lazily = lazy_sweep;
-	collector->needs_thread_pool = concurrent_mark || concurrent_sweep;
+	collector->needs_thread_pool = concurrent_mark || parallel_mark || concurrent_sweep;
 }
 
 static void
-sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurrent)
+sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurrent, gboolean is_parallel)
 {
 	int i;
 
@@ -2423,6 +2724,9 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i)
 		free_block_lists [i] = (MSBlockInfo *volatile *)sgen_alloc_internal_dynamic (sizeof (MSBlockInfo*) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
 
+	mono_native_tls_alloc (&worker_block_free_list_key, NULL);
+	mono_os_mutex_init (&allocated_blocks_lock);
+
 	for (i = 0; i < MS_NUM_FAST_BLOCK_OBJ_SIZE_INDEXES; ++i)
 		fast_block_obj_size_indexes [i] = ms_find_block_obj_size_index (i * 8);
 	for (i = 0; i < MS_NUM_FAST_BLOCK_OBJ_SIZE_INDEXES * 8; ++i)
@@ -2441,8 +2745,10 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	collector->section_size = MAJOR_SECTION_SIZE;
 
 	concurrent_mark = is_concurrent;
+	parallel_mark = is_parallel;
 	collector->is_concurrent = is_concurrent;
-	collector->needs_thread_pool = is_concurrent || concurrent_sweep;
+	collector->is_parallel = is_parallel;
+	collector->needs_thread_pool = is_concurrent || is_parallel || concurrent_sweep;
 	collector->get_and_reset_num_major_objects_marked = major_get_and_reset_num_major_objects_marked;
 	collector->supports_cardtable = TRUE;
 
@@ -2452,6 +2758,7 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	collector->alloc_degraded = major_alloc_degraded;
 
 	collector->alloc_object = major_alloc_object;
+	collector->alloc_object_par = major_alloc_object_par;
 	collector->free_pinned_object = free_pinned_object;
 	collector->iterate_objects = major_iterate_objects;
 	collector->free_non_pinned_object = major_free_non_pinned_object;
@@ -2483,6 +2790,8 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	collector->handle_gc_param = major_handle_gc_param;
 	collector->print_gc_param_usage = major_print_gc_param_usage;
 	collector->post_param_init = post_param_init;
+	collector->worker_init = major_worker_init;
+	collector->get_obj_numa_node = major_get_obj_numa_node;
 	collector->is_valid_object = major_is_valid_object;
 	collector->describe_pointer = major_describe_pointer;
 	collector->count_cards = major_count_cards;
@@ -2503,6 +2812,13 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 		collector->major_ops_concurrent_finish.scan_ptr_field = major_scan_ptr_field_with_evacuation;
 		collector->major_ops_concurrent_finish.drain_gray_stack = drain_gray_stack;
 	}
+	if (is_parallel) {
+		collector->major_ops_parallel.copy_or_mark_object = major_copy_or_mark_object_par_canonical;
+		collector->major_ops_parallel.scan_object = major_scan_object_par_no_evacuation;
+		collector->major_ops_parallel.scan_vtype = major_scan_vtype_par_no_evacuation;
+		collector->major_ops_parallel.scan_ptr_field = major_scan_ptr_field_par_no_evacuation;
+		collector->major_ops_parallel.drain_gray_stack = drain_gray_stack_par_no_evacuation;
+	}
 
 #ifdef HEAVY_STATISTICS
 	mono_counters_register ("Optimized copy", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_optimized_copy);
@@ -2535,13 +2851,19 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 void
 sgen_marksweep_init (SgenMajorCollector *collector)
 {
-	sgen_marksweep_init_internal (collector, FALSE);
+	sgen_marksweep_init_internal (collector, FALSE, FALSE);
+}
+
+void
+sgen_marksweep_par_init (SgenMajorCollector *collector)
+{
+	sgen_marksweep_init_internal (collector, FALSE, TRUE);
 }
 
 void
 sgen_marksweep_conc_init (SgenMajorCollector *collector)
 {
-	sgen_marksweep_init_internal (collector, TRUE);
+	sgen_marksweep_init_internal (collector, TRUE, FALSE);
 }
 
 #endif
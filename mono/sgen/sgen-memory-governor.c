@@ -16,7 +16,11 @@
 #include "config.h"
 #ifdef HAVE_SGEN_GC
 
+#include <stdio.h>
 #include <stdlib.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "mono/sgen/sgen-gc.h"
 #include "mono/sgen/sgen-memory-governor.h"
@@ -37,6 +41,11 @@ static mword allocated_heap;
 static mword total_alloc = 0;
 static mword total_alloc_max = 0;
 
+static gboolean use_huge_pages = FALSE;
+/* The heap memory madvise () accepted to back with huge pages */
+static mword huge_pages_advised;
+static gboolean huge_pages_advice_failed;
+
 /* GC triggers. */
 
 static gboolean debug_print_allowance = FALSE;
@@ -56,6 +65,30 @@ static gboolean need_calculate_minor_collection_allowance;
 /* The size of the LOS after the last major collection, after sweeping. */
 static mword last_collection_los_memory_usage = 0;
 
+/* Never give the mutator less nursery than this between collections. */
+#define MIN_NURSERY_BUDGET	(256 * 1024)
+
+/*
+ * Pause time goal for nursery collections, in the units of SGEN_TV_ELAPSED, or zero if we
+ * don't have one.  We try to meet it by limiting how much of the nursery is used, and with
+ * the split nursery also by changing the promotion age.
+ */
+static gint64 max_pause_goal = 0;
+static mword nursery_budget;
+static mword minor_start_bytes_copied;
+/* The size of the objects the last nursery collection aged or promoted. */
+static mword last_minor_copied_size;
+
+/*
+ * The promotion age only changes after this many collections in a row asked for it, so
+ * it doesn't follow the noise of the survival rate.
+ */
+#define PROMOTION_AGE_HYSTERESIS	3
+/* Positive if the last collections asked for a higher promotion age, negative for a lower one. */
+static int promotion_age_votes;
+/* The lowest promotion age that missed the pause goal, which we don't go back to, or zero. */
+static int promotion_age_limit;
+
 static mword sgen_memgov_available_free_space (void);
 
 
@@ -160,11 +193,84 @@ sgen_need_major_collection (mword space_needed)
 void
 sgen_memgov_minor_collection_start (void)
 {
+	if (sgen_minor_collector.get_bytes_copied)
+		minor_start_bytes_copied = sgen_minor_collector.get_bytes_copied ();
 }
 
 void
 sgen_memgov_minor_collection_end (void)
 {
+	if (sgen_minor_collector.get_bytes_copied)
+		last_minor_copied_size = sgen_minor_collector.get_bytes_copied () - minor_start_bytes_copied;
+}
+
+/*
+ * Aging objects costs copying them again, so a higher promotion age raises the survival
+ * rate, which is measured from the copied objects, aged or promoted.  That keeps the age
+ * from running away, and an age that missed the pause goal is never used again.
+ */
+static void
+adjust_promotion_age (gint64 pause, float survival_rate)
+{
+	int age = sgen_minor_collector.get_promotion_age ();
+	int vote = 0;
+
+	if (pause > max_pause_goal) {
+		if (!promotion_age_limit || age < promotion_age_limit)
+			promotion_age_limit = age;
+		promotion_age_votes = 0;
+		sgen_minor_collector.set_promotion_age (age - 1);
+		return;
+	}
+
+	/*
+	 * If most objects survive anyway, aging them only costs us copying them again.  If
+	 * few do, and the pause leaves room for it, we can afford to give them more time to die.
+	 */
+	if (survival_rate > 0.5f)
+		vote = -1;
+	else if (survival_rate < 0.1f && pause < max_pause_goal / 2 && (!promotion_age_limit || age + 1 < promotion_age_limit))
+		vote = 1;
+
+	if (!vote || (vote > 0) != (promotion_age_votes > 0))
+		promotion_age_votes = vote;
+	else
+		promotion_age_votes += vote;
+
+	if (ABS (promotion_age_votes) >= PROMOTION_AGE_HYSTERESIS) {
+		sgen_minor_collector.set_promotion_age (age + vote);
+		promotion_age_votes = 0;
+	}
+}
+
+/*
+ * The new budget only takes effect when the nursery fragments are built the next time,
+ * i.e. one collection later, because they are built before the pause is over.
+ */
+static void
+adjust_nursery_for_pause_goal (gint64 pause)
+{
+	float survival_rate = (float)last_minor_copied_size / (float)nursery_budget;
+
+	if (pause > max_pause_goal) {
+		/* Shrink in proportion to the overshoot, but at most by half at a time. */
+		nursery_budget = MAX (nursery_budget / 2, (mword)(nursery_budget * ((double)max_pause_goal / pause)));
+	} else if (pause < max_pause_goal / 2) {
+		nursery_budget += nursery_budget / 4;
+	}
+	nursery_budget = MAX (MIN_NURSERY_BUDGET, MIN (nursery_budget, sgen_nursery_size));
+
+	sgen_nursery_allocator_set_budget (nursery_budget < sgen_nursery_size ? nursery_budget : 0);
+
+	if (sgen_minor_collector.set_promotion_age)
+		adjust_promotion_age (pause, survival_rate);
+
+	if (debug_print_allowance) {
+		SGEN_LOG (0, "Nursery pause: %lld usecs, survival rate: %.2f", (long long)pause / 10, survival_rate);
+		SGEN_LOG (0, "Nursery budget: %ld bytes", (long)nursery_budget);
+		if (sgen_minor_collector.get_promotion_age)
+			SGEN_LOG (0, "Promotion age: %d", sgen_minor_collector.get_promotion_age ());
+	}
 }
 
 void
@@ -196,6 +302,7 @@ sgen_memgov_major_collection_end (gboolean forced)
 
 	if (forced) {
 		sgen_get_major_collector ()->finish_sweeping ();
+		sgen_los_finish_sweeping ();
 		sgen_memgov_calculate_minor_collection_allowance ();
 	}
 }
@@ -213,6 +320,9 @@ sgen_memgov_collection_end (int generation, GGTimingInfo* info, int info_count)
 		if (info[i].generation != -1)
 			sgen_client_log_timing (&info [i], last_major_num_sections, last_los_memory_usage);
 	}
+
+	if (max_pause_goal && info_count && info [0].generation == GENERATION_NURSERY && info [1].generation == -1)
+		adjust_nursery_for_pause_goal (info [0].total_time);
 	last_major_num_sections = major_collector.get_num_major_sections ();
 }
 
@@ -238,6 +348,79 @@ sgen_assert_memory_alloc (void *ptr, size_t requested_size, const char *assert_d
 	exit (1);
 }
 
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+gboolean
+sgen_memgov_enable_huge_pages (void)
+{
+	use_huge_pages = TRUE;
+	return TRUE;
+}
+
+/* The part of a mapping which can be backed by huge pages. */
+static size_t
+huge_page_range (void *ptr, size_t size, char **start)
+{
+	char *end = (char*)SGEN_ALIGN_DOWN_TO ((mword)ptr + size, SGEN_HUGE_PAGE_SIZE);
+
+	*start = (char*)SGEN_ALIGN_UP_TO ((mword)ptr, SGEN_HUGE_PAGE_SIZE);
+	return end > *start ? end - *start : 0;
+}
+
+/*
+ * We use transparent huge pages instead of MAP_HUGETLB, because the latter needs the
+ * administrator to reserve a huge page pool.  If the kernel doesn't support them,
+ * madvise () fails and we just keep using normal pages.
+ */
+static void
+advise_huge_pages (void *ptr, size_t size)
+{
+	char *start;
+
+	size = huge_page_range (ptr, size, &start);
+	if (!use_huge_pages || huge_pages_advice_failed || !size)
+		return;
+
+	if (madvise (start, size, MADV_HUGEPAGE) == 0)
+		SGEN_ATOMIC_ADD_P (huge_pages_advised, size);
+	else
+		huge_pages_advice_failed = TRUE;
+}
+
+static void
+unadvise_huge_pages (void *ptr, size_t size)
+{
+	char *start;
+
+	size = huge_page_range (ptr, size, &start);
+	if (!use_huge_pages || huge_pages_advice_failed || !size)
+		return;
+
+	SGEN_ATOMIC_ADD_P (huge_pages_advised, -(gssize)size);
+}
+#else
+gboolean
+sgen_memgov_enable_huge_pages (void)
+{
+	return FALSE;
+}
+
+static void
+advise_huge_pages (void *ptr, size_t size)
+{
+}
+
+static void
+unadvise_huge_pages (void *ptr, size_t size)
+{
+}
+#endif
+
+gboolean
+sgen_memgov_huge_pages_enabled (void)
+{
+	return use_huge_pages;
+}
+
 /*
  * Allocate a big chunk of memory from the OS (usually 64KB to several megabytes).
  * This must not require any lock.
@@ -247,13 +430,15 @@ sgen_alloc_os_memory (size_t size, SgenAllocFlags flags, const char *assert_desc
 {
 	void *ptr;
 
-	g_assert (!(flags & ~(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE)));
+	g_assert (!(flags & ~(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE | SGEN_ALLOC_HUGE_PAGES)));
 
 	ptr = mono_valloc (0, size, prot_flags_for_activate (flags & SGEN_ALLOC_ACTIVATE));
 	sgen_assert_memory_alloc (ptr, size, assert_description);
 	if (ptr) {
 		SGEN_ATOMIC_ADD_P (total_alloc, size);
 		total_alloc_max = MAX (total_alloc_max, total_alloc);
+		if (flags & SGEN_ALLOC_HUGE_PAGES)
+			advise_huge_pages (ptr, size);
 	}
 	return ptr;
 }
@@ -264,25 +449,30 @@ sgen_alloc_os_memory_aligned (size_t size, mword alignment, SgenAllocFlags flags
 {
 	void *ptr;
 
-	g_assert (!(flags & ~(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE)));
+	g_assert (!(flags & ~(SGEN_ALLOC_HEAP | SGEN_ALLOC_ACTIVATE | SGEN_ALLOC_HUGE_PAGES)));
 
 	ptr = mono_valloc_aligned (size, alignment, prot_flags_for_activate (flags & SGEN_ALLOC_ACTIVATE));
 	sgen_assert_memory_alloc (ptr, size, assert_description);
 	if (ptr) {
 		SGEN_ATOMIC_ADD_P (total_alloc, size);
 		total_alloc_max = MAX (total_alloc_max, total_alloc);
+		if (flags & SGEN_ALLOC_HUGE_PAGES)
+			advise_huge_pages (ptr, size);
 	}
 	return ptr;
 }
 
 /*
  * Free the memory returned by sgen_alloc_os_memory (), returning it to the OS.
+ * SGEN_ALLOC_HUGE_PAGES has to be passed if it was passed to the allocation.
  */
 void
 sgen_free_os_memory (void *addr, size_t size, SgenAllocFlags flags)
 {
-	g_assert (!(flags & ~SGEN_ALLOC_HEAP));
+	g_assert (!(flags & ~(SGEN_ALLOC_HEAP | SGEN_ALLOC_HUGE_PAGES)));
 
+	if (flags & SGEN_ALLOC_HUGE_PAGES)
+		unadvise_huge_pages (addr, size);
 	mono_vfree (addr, size);
 	SGEN_ATOMIC_ADD_P (total_alloc, -(gssize)size);
 	total_alloc_max = MAX (total_alloc_max, total_alloc);
@@ -317,7 +507,7 @@ gboolean
 sgen_memgov_try_alloc_space (mword size, int space)
 {
 	if (sgen_memgov_available_free_space () < size) {
-		SGEN_ASSERT (4, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Memory shouldn't run out in worker thread");
+		SGEN_ASSERT (4, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()) || sgen_get_current_collection_generation () == GENERATION_NURSERY, "Memory shouldn't run out in worker thread outside of parallel nursery collections");
 		return FALSE;
 	}
 
@@ -327,16 +517,22 @@ sgen_memgov_try_alloc_space (mword size, int space)
 }
 
 void
-sgen_memgov_init (size_t max_heap, size_t soft_limit, gboolean debug_allowance, double allowance_ratio, double save_target)
+sgen_memgov_init (size_t max_heap, size_t soft_limit, gboolean debug_allowance, double allowance_ratio, double save_target, int max_pause_ms)
 {
 	if (soft_limit)
 		soft_heap_limit = soft_limit;
 
+	/* SGEN_TV_ELAPSED is in 100ns ticks. */
+	max_pause_goal = (gint64)max_pause_ms * 10000;
+	nursery_budget = sgen_nursery_size;
+
 	debug_print_allowance = debug_allowance;
 	major_collection_trigger_size = MIN_MINOR_COLLECTION_ALLOWANCE;
 
 	mono_counters_register ("Memgov alloc", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &total_alloc);
 	mono_counters_register ("Memgov max alloc", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_MONOTONIC, &total_alloc_max);
+	if (use_huge_pages)
+		mono_counters_register ("Memgov huge pages advised", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &huge_pages_advised);
 
 	if (max_heap == 0)
 		return;
@@ -8,7 +8,7 @@
 #define __MONO_SGEN_MEMORY_GOVERNOR_H__
 
 /* Heap limits */
-void sgen_memgov_init (size_t max_heap, size_t soft_limit, gboolean debug_allowance, double min_allowance_ratio, double save_target);
+void sgen_memgov_init (size_t max_heap, size_t soft_limit, gboolean debug_allowance, double min_allowance_ratio, double save_target, int max_pause_ms);
 void sgen_memgov_release_space (mword size, int space);
 gboolean sgen_memgov_try_alloc_space (mword size, int space);
 
@@ -29,9 +29,18 @@ gboolean sgen_need_major_collection (mword space_needed);
 typedef enum {
 	SGEN_ALLOC_INTERNAL = 0,
 	SGEN_ALLOC_HEAP = 1,
-	SGEN_ALLOC_ACTIVATE = 2
+	SGEN_ALLOC_ACTIVATE = 2,
+	/* Back the memory with huge pages if they are enabled. */
+	SGEN_ALLOC_HUGE_PAGES = 4
 } SgenAllocFlags;
 
+/* Huge pages are only used for the parts of a mapping that are aligned to this. */
+#define SGEN_HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+
+/* Returns FALSE if huge pages are not supported on this system. */
+gboolean sgen_memgov_enable_huge_pages (void);
+gboolean sgen_memgov_huge_pages_enabled (void);
+
 /* OS memory allocation */
 void* sgen_alloc_os_memory (size_t size, SgenAllocFlags flags, const char *assert_description);
 void* sgen_alloc_os_memory_aligned (size_t size, mword alignment, SgenAllocFlags flags, const char *assert_description);
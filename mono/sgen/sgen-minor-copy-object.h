@@ -8,8 +8,34 @@
  * Licensed under the MIT license. See LICENSE file in the project root for full license information.
  */
 
+#undef SERIAL_COPY_OBJECT
+#undef SERIAL_COPY_OBJECT_FROM_OBJ
+
+#if defined(SGEN_SIMPLE_NURSERY)
+
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+#define SERIAL_COPY_OBJECT simple_par_nursery_copy_object
+#define SERIAL_COPY_OBJECT_FROM_OBJ simple_par_nursery_copy_object_from_obj
+#else
+#define SERIAL_COPY_OBJECT simple_nursery_serial_copy_object
+#define SERIAL_COPY_OBJECT_FROM_OBJ simple_nursery_serial_copy_object_from_obj
+#endif
+
+#elif defined (SGEN_SPLIT_NURSERY)
+
+#define SERIAL_COPY_OBJECT split_nursery_serial_copy_object
+#define SERIAL_COPY_OBJECT_FROM_OBJ split_nursery_serial_copy_object_from_obj
+
+#else
+#error "Please define GC_CONF_NAME"
+#endif
+
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+#define COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION alloc_for_promotion_par
+#else
 #define collector_pin_object(obj, queue) sgen_pin_object (obj, queue);
 #define COLLECTOR_SERIAL_ALLOC_FOR_PROMOTION alloc_for_promotion
+#endif
 
 extern guint64 stat_nursery_copy_object_failed_to_space; /* from sgen-gc.c */
 
@@ -84,7 +110,11 @@ SERIAL_COPY_OBJECT (GCObject **obj_slot, SgenGrayQueue *queue)
 
 	HEAVY_STAT (++stat_objects_copied_nursery);
 
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+	copy = copy_object_no_checks_par (obj, queue);
+#else
 	copy = copy_object_no_checks (obj, queue);
+#endif
 	SGEN_UPDATE_REFERENCE (obj_slot, copy);
 }
 
@@ -186,7 +216,11 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 
 	HEAVY_STAT (++stat_objects_copied_nursery);
 
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+	copy = copy_object_no_checks_par (obj, queue);
+#else
 	copy = copy_object_no_checks (obj, queue);
+#endif
 	SGEN_UPDATE_REFERENCE (obj_slot, copy);
 #ifndef SGEN_SIMPLE_NURSERY
 	if (G_UNLIKELY (sgen_ptr_in_nursery (copy) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (copy)))
@@ -200,6 +234,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 #endif
 }
 
-#define FILL_MINOR_COLLECTOR_COPY_OBJECT(collector)	do {			\
-		(collector)->serial_ops.copy_or_mark_object = SERIAL_COPY_OBJECT;			\
+#undef FILL_MINOR_COLLECTOR_COPY_OBJECT
+#define FILL_MINOR_COLLECTOR_COPY_OBJECT(ops)	do {			\
+		(ops)->copy_or_mark_object = SERIAL_COPY_OBJECT;			\
 	} while (0)
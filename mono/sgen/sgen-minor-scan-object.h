@@ -10,13 +10,26 @@
 
 extern guint64 stat_scan_object_called_nursery;
 
+#undef SERIAL_SCAN_OBJECT
+#undef SERIAL_SCAN_VTYPE
+#undef SERIAL_SCAN_PTR_FIELD
+
 #if defined(SGEN_SIMPLE_NURSERY)
+
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+#define SERIAL_SCAN_OBJECT simple_par_nursery_serial_scan_object
+#define SERIAL_SCAN_VTYPE simple_par_nursery_serial_scan_vtype
+#define SERIAL_SCAN_PTR_FIELD simple_par_nursery_serial_scan_ptr_field
+#else
 #define SERIAL_SCAN_OBJECT simple_nursery_serial_scan_object
 #define SERIAL_SCAN_VTYPE simple_nursery_serial_scan_vtype
+#define SERIAL_SCAN_PTR_FIELD simple_nursery_serial_scan_ptr_field
+#endif
 
 #elif defined (SGEN_SPLIT_NURSERY)
 #define SERIAL_SCAN_OBJECT split_nursery_serial_scan_object
 #define SERIAL_SCAN_VTYPE split_nursery_serial_scan_vtype
+#define SERIAL_SCAN_PTR_FIELD split_nursery_serial_scan_ptr_field
 
 #else
 #error "Please define GC_CONF_NAME"
@@ -75,8 +88,9 @@ SERIAL_SCAN_PTR_FIELD (GCObject *full_object, GCObject **ptr, SgenGrayQueue *que
 	HANDLE_PTR (ptr, NULL);
 }
 
-#define FILL_MINOR_COLLECTOR_SCAN_OBJECT(collector)	do {			\
-		(collector)->serial_ops.scan_object = SERIAL_SCAN_OBJECT;	\
-		(collector)->serial_ops.scan_vtype = SERIAL_SCAN_VTYPE; \
-		(collector)->serial_ops.scan_ptr_field = SERIAL_SCAN_PTR_FIELD;	\
+#undef FILL_MINOR_COLLECTOR_SCAN_OBJECT
+#define FILL_MINOR_COLLECTOR_SCAN_OBJECT(ops)	do {			\
+		(ops)->scan_object = SERIAL_SCAN_OBJECT;	\
+		(ops)->scan_vtype = SERIAL_SCAN_VTYPE; \
+		(ops)->scan_ptr_field = SERIAL_SCAN_PTR_FIELD;	\
 	} while (0)
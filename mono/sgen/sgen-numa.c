@@ -0,0 +1,217 @@
+/*
+ * sgen-numa.c: NUMA topology and placement.
+ *
+ * We don't depend on libnuma.  The topology is read from sysfs, memory placement is done
+ * with the mbind system call and thread placement with sched_setaffinity ().  Nodes are
+ * numbered densely, skipping offline nodes and nodes without CPUs.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+#ifdef HAVE_SGEN_GC
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__) && defined(HAVE_SCHED_GETCPU) && defined(HAVE_SCHED_SETAFFINITY) && !defined(GLIBC_BEFORE_2_3_4_SCHED_SETAFFINITY)
+#define SGEN_HAVE_NUMA
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "mono/sgen/sgen-gc.h"
+#include "mono/sgen/sgen-numa.h"
+
+#if defined(SGEN_HAVE_NUMA) && defined(SYS_mbind)
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED	1
+#endif
+
+static int num_nodes = 0;
+/* The sysfs ids of the nodes, which can be sparse. */
+static int node_ids [SGEN_NUMA_MAX_NODES];
+/* CPUs we don't find in the topology are treated as being on node 0. */
+static guint8 cpu_to_node [CPU_SETSIZE];
+static cpu_set_t node_cpus [SGEN_NUMA_MAX_NODES];
+
+/* Parses a sysfs list of CPUs or nodes, like "0-7,16-23", into `set`. */
+static gboolean
+parse_list (const char *list, cpu_set_t *set)
+{
+	const char *p = list;
+
+	CPU_ZERO (set);
+	while (*p && *p != '\n') {
+		char *end;
+		long first, last;
+
+		first = last = strtol (p, &end, 10);
+		if (end == p)
+			return FALSE;
+		if (*end == '-') {
+			p = end + 1;
+			last = strtol (p, &end, 10);
+			if (end == p)
+				return FALSE;
+		}
+		if (first < 0 || last >= CPU_SETSIZE || first > last)
+			return FALSE;
+
+		for (; first <= last; ++first)
+			CPU_SET (first, set);
+
+		p = end;
+		if (*p == ',')
+			++p;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+read_list (const char *path, cpu_set_t *set)
+{
+	char buf [1024];
+	gboolean success;
+	FILE *file;
+
+	file = fopen (path, "r");
+	if (!file)
+		return FALSE;
+	success = fgets (buf, sizeof (buf), file) && parse_list (buf, set);
+	fclose (file);
+	return success;
+}
+
+gboolean
+sgen_numa_init (void)
+{
+	cpu_set_t online;
+	int id, cpu, node = 0;
+
+	if (!read_list ("/sys/devices/system/node/online", &online))
+		return FALSE;
+
+	for (id = 0; id < CPU_SETSIZE; ++id) {
+		char path [64];
+
+		if (!CPU_ISSET (id, &online))
+			continue;
+		if (node == SGEN_NUMA_MAX_NODES)
+			return FALSE;
+
+		snprintf (path, sizeof (path), "/sys/devices/system/node/node%d/cpulist", id);
+		if (!read_list (path, &node_cpus [node]))
+			return FALSE;
+		/* Memory-only nodes have no CPUs to run workers on. */
+		if (!CPU_COUNT (&node_cpus [node]))
+			continue;
+
+		for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET (cpu, &node_cpus [node]))
+				cpu_to_node [cpu] = node;
+		}
+		node_ids [node] = id;
+		++node;
+	}
+
+	if (node < 2)
+		return FALSE;
+
+	num_nodes = node;
+	return TRUE;
+}
+
+gboolean
+sgen_numa_is_enabled (void)
+{
+	return num_nodes > 1;
+}
+
+int
+sgen_numa_get_num_nodes (void)
+{
+	return num_nodes > 1 ? num_nodes : 1;
+}
+
+int
+sgen_numa_get_current_node (void)
+{
+	int cpu;
+
+	if (num_nodes <= 1)
+		return 0;
+
+	cpu = sched_getcpu ();
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+		return 0;
+	return cpu_to_node [cpu];
+}
+
+void
+sgen_numa_bind_memory (void *addr, size_t size, int node)
+{
+	unsigned long node_mask;
+
+	if (num_nodes <= 1 || node_ids [node] >= (int)(sizeof (node_mask) * 8))
+		return;
+
+	node_mask = 1UL << node_ids [node];
+
+	/* This is only a hint, so we don't care whether it fails. */
+	syscall (SYS_mbind, addr, size, MPOL_PREFERRED, &node_mask, sizeof (node_mask) * 8, 0);
+}
+
+void
+sgen_numa_bind_current_thread (int node)
+{
+	if (num_nodes <= 1)
+		return;
+
+	/* The thread still works unbound, only its locality suffers. */
+	if (sched_setaffinity (0, sizeof (cpu_set_t), &node_cpus [node]) != 0)
+		SGEN_LOG (1, "Could not bind thread to the CPUs of NUMA node %d", node_ids [node]);
+}
+
+#else
+
+gboolean
+sgen_numa_init (void)
+{
+	return FALSE;
+}
+
+gboolean
+sgen_numa_is_enabled (void)
+{
+	return FALSE;
+}
+
+int
+sgen_numa_get_num_nodes (void)
+{
+	return 1;
+}
+
+int
+sgen_numa_get_current_node (void)
+{
+	return 0;
+}
+
+void
+sgen_numa_bind_memory (void *addr, size_t size, int node)
+{
+}
+
+void
+sgen_numa_bind_current_thread (int node)
+{
+}
+
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * sgen-numa.h: NUMA topology and placement.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#ifndef __MONO_SGEN_NUMA_H__
+#define __MONO_SGEN_NUMA_H__
+
+#include <glib.h>
+
+#define SGEN_NUMA_MAX_NODES	16
+
+/*
+ * Reads the node topology.  Returns FALSE, and leaves NUMA support disabled, if the
+ * system doesn't have more than one node or we can't determine the topology.
+ */
+gboolean sgen_numa_init (void);
+
+gboolean sgen_numa_is_enabled (void);
+int sgen_numa_get_num_nodes (void);
+
+/* The node the calling thread is running on, or 0 if NUMA support is disabled. */
+int sgen_numa_get_current_node (void);
+
+/* Makes the kernel prefer `node` when backing the given range with physical memory. */
+void sgen_numa_bind_memory (void *addr, size_t size, int node);
+/* Restricts the calling thread to the CPUs of `node`. */
+void sgen_numa_bind_current_thread (int node);
+
+#endif
@@ -657,6 +657,19 @@ sgen_nursery_allocator_prepare_for_pinning (void)
 }
 
 static mword fragment_total = 0;
+
+/*
+ * If non-zero, at most this many bytes of the nursery are given to the mutator between
+ * two collections.  The memory governor adjusts it to meet the nursery pause time goal.
+ */
+static mword fragment_budget = 0;
+
+void
+sgen_nursery_allocator_set_budget (mword budget)
+{
+	fragment_budget = budget;
+}
+
 /*
  * We found a fragment of free memory in the nursery: memzero it and if
  * it is big enough, add it to the list of fragments that can be used for
@@ -667,6 +680,16 @@ add_nursery_frag (SgenFragmentAllocator *allocator, size_t frag_size, char* frag
 {
 	SGEN_LOG (4, "Found empty fragment: %p-%p, size: %zd", frag_start, frag_end, frag_size);
 	binary_protocol_empty (frag_start, frag_size);
+
+	if (fragment_budget && fragment_total + frag_size > fragment_budget) {
+		/* The memory over the budget stays unused until the next collection. */
+		char *budget_end = frag_start + SGEN_ALIGN_DOWN (fragment_total < fragment_budget ? fragment_budget - fragment_total : 0);
+		sgen_clear_range (budget_end, frag_end);
+		frag_end = budget_end;
+		frag_size = frag_end - frag_start;
+		if (!frag_size)
+			return;
+	}
 	/* Not worth dealing with smaller fragments: need to tune */
 	if (frag_size >= SGEN_MAX_NURSERY_WASTE) {
 		/* memsetting just the first chunk start is bound to provide better cache locality */
@@ -285,9 +285,12 @@ sgen_cement_lookup_or_register (GCObject *obj)
 
 	SGEN_ASSERT (5, sgen_ptr_in_nursery (obj), "Can only cement pointers to nursery objects");
 
+	/* This can be called concurrently by the parallel nursery collection workers */
 	if (!hash [i].obj) {
-		SGEN_ASSERT (5, !hash [i].count, "Cementing hash inconsistent");
-		hash [i].obj = obj;
+		GCObject *old_obj = (GCObject *)InterlockedCompareExchangePointer ((gpointer*)&hash [i].obj, obj, NULL);
+		/* Another worker might have claimed the slot for a different object */
+		if (old_obj && old_obj != obj)
+			return FALSE;
 	} else if (hash [i].obj != obj) {
 		return FALSE;
 	}
@@ -295,8 +298,7 @@ sgen_cement_lookup_or_register (GCObject *obj)
 	if (hash [i].count >= SGEN_CEMENT_THRESHOLD)
 		return TRUE;
 
-	++hash [i].count;
-	if (hash [i].count == SGEN_CEMENT_THRESHOLD) {
+	if (InterlockedIncrement ((gint32*)&hash [i].count) == SGEN_CEMENT_THRESHOLD) {
 		SGEN_ASSERT (9, sgen_get_current_collection_generation () >= 0, "We can only cement objects when we're in a collection pause.");
 		SGEN_ASSERT (9, SGEN_OBJECT_IS_PINNED (obj), "Can only cement pinned objects");
 		SGEN_CEMENT_OBJECT (obj);
@@ -25,6 +25,12 @@ alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean ha
 	return major_collector.alloc_object (vtable, objsize, has_references);
 }
 
+static inline GCObject*
+alloc_for_promotion_par (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references)
+{
+	return major_collector.alloc_object_par (vtable, objsize, has_references);
+}
+
 static SgenFragment*
 build_fragments_get_exclude_head (void)
 {
@@ -62,16 +68,33 @@ init_nursery (SgenFragmentAllocator *allocator, char *start, char *end)
 
 #define SGEN_SIMPLE_NURSERY
 
-#define SERIAL_COPY_OBJECT simple_nursery_serial_copy_object
-#define SERIAL_COPY_OBJECT_FROM_OBJ simple_nursery_serial_copy_object_from_obj
+#include "sgen-minor-copy-object.h"
+#include "sgen-minor-scan-object.h"
+
+static void
+fill_serial_ops (SgenObjectOperations *ops)
+{
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (ops);
+}
+
+#define SGEN_SIMPLE_PAR_NURSERY
 
 #include "sgen-minor-copy-object.h"
 #include "sgen-minor-scan-object.h"
 
+static void
+fill_parallel_ops (SgenObjectOperations *ops)
+{
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (ops);
+}
+
 void
-sgen_simple_nursery_init (SgenMinorCollector *collector)
+sgen_simple_nursery_init (SgenMinorCollector *collector, gboolean parallel)
 {
 	collector->is_split = FALSE;
+	collector->is_parallel = parallel;
 
 	collector->alloc_for_promotion = alloc_for_promotion;
 
@@ -82,8 +105,8 @@ sgen_simple_nursery_init (SgenMinorCollector *collector)
 	collector->build_fragments_finish = build_fragments_finish;
 	collector->init_nursery = init_nursery;
 
-	FILL_MINOR_COLLECTOR_COPY_OBJECT (collector);
-	FILL_MINOR_COLLECTOR_SCAN_OBJECT (collector);
+	fill_serial_ops (&collector->serial_ops);
+	fill_parallel_ops (&collector->parallel_ops);
 }
 
 
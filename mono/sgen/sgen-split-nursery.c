@@ -136,6 +136,9 @@ static AgeAllocationBuffer age_alloc_buffers [MAX_AGE];
 /* The collector allocs from here. */
 static SgenFragmentAllocator collector_allocator;
 
+/* The size of the objects aged or promoted, for the pause time goal of the memory governor. */
+static mword bytes_copied;
+
 static inline int
 get_object_age (GCObject *object)
 {
@@ -253,6 +256,8 @@ alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean ha
 	char *p = NULL;
 	int age;
 
+	bytes_copied += objsize;
+
 	age = get_object_age (obj);
 	if (age >= promote_age)
 		return major_collector.alloc_object (vtable, objsize, has_references);
@@ -401,6 +406,24 @@ handle_gc_param (const char *opt)
 	return FALSE;
 }
 
+static int
+get_promotion_age (void)
+{
+	return promote_age;
+}
+
+static void
+set_promotion_age (int age)
+{
+	promote_age = CLAMP (age, 1, MAX_AGE - 1);
+}
+
+static mword
+get_bytes_copied (void)
+{
+	return bytes_copied;
+}
+
 static void
 print_gc_param_usage (void)
 {
@@ -416,9 +439,6 @@ print_gc_param_usage (void)
 
 #define SGEN_SPLIT_NURSERY
 
-#define SERIAL_COPY_OBJECT split_nursery_serial_copy_object
-#define SERIAL_COPY_OBJECT_FROM_OBJ split_nursery_serial_copy_object_from_obj
-
 #include "sgen-minor-copy-object.h"
 #include "sgen-minor-scan-object.h"
 
@@ -426,6 +446,7 @@ void
 sgen_split_nursery_init (SgenMinorCollector *collector)
 {
 	collector->is_split = TRUE;
+	collector->is_parallel = FALSE;
 
 	collector->alloc_for_promotion = minor_alloc_for_promotion;
 
@@ -437,9 +458,12 @@ sgen_split_nursery_init (SgenMinorCollector *collector)
 	collector->init_nursery = init_nursery;
 	collector->handle_gc_param = handle_gc_param;
 	collector->print_gc_param_usage = print_gc_param_usage;
+	collector->get_promotion_age = get_promotion_age;
+	collector->set_promotion_age = set_promotion_age;
+	collector->get_bytes_copied = get_bytes_copied;
 
-	FILL_MINOR_COLLECTOR_COPY_OBJECT (collector);
-	FILL_MINOR_COLLECTOR_SCAN_OBJECT (collector);
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (&collector->serial_ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (&collector->serial_ops);
 }
 
 
@@ -21,7 +21,8 @@ static mono_mutex_t lock;
 static mono_cond_t work_cond;
 static mono_cond_t done_cond;
 
-static MonoNativeThreadId thread;
+static int threads_num;
+static MonoNativeThreadId threads [SGEN_THREADPOOL_MAX_NUM_THREADS];
 
 /* Only accessed with the lock held. */
 static SgenPointerQueue job_queue;
@@ -29,9 +30,10 @@ static SgenPointerQueue job_queue;
 static SgenThreadPoolThreadInitFunc thread_init_func;
 static SgenThreadPoolIdleJobFunc idle_job_func;
 static SgenThreadPoolContinueIdleJobFunc continue_idle_job_func;
+static void **thread_datas;
 
 static volatile gboolean threadpool_shutdown;
-static volatile gboolean thread_finished;
+static volatile int threads_finished;
 
 enum {
 	STATE_WAITING,
@@ -78,11 +80,26 @@ remove_job (SgenThreadPoolJob *job)
 }
 
 static gboolean
-continue_idle_job (void)
+continue_idle_job (void *thread_data)
 {
 	if (!continue_idle_job_func)
 		return FALSE;
-	return continue_idle_job_func ();
+	return continue_idle_job_func (thread_data);
+}
+
+/* Assumes that the lock is held. */
+static gboolean
+continue_idle_job_any_thread (void)
+{
+	int i;
+
+	if (!continue_idle_job_func)
+		return FALSE;
+	for (i = 0; i < threads_num; i++) {
+		if (continue_idle_job_func (thread_datas ? thread_datas [i] : NULL))
+			return TRUE;
+	}
+	return FALSE;
 }
 
 static mono_native_thread_return_t
@@ -98,7 +115,7 @@ thread_func (void *thread_data)
 		 * main thread might then set continue idle and signal us before we can take
 		 * the lock, and we'd lose the signal.
 		 */
-		gboolean do_idle = continue_idle_job ();
+		gboolean do_idle = continue_idle_job (thread_data);
 		SgenThreadPoolJob *job = get_job_and_set_in_progress ();
 
 		if (!job && !do_idle && !threadpool_shutdown) {
@@ -130,7 +147,7 @@ thread_func (void *thread_data)
 			SGEN_ASSERT (0, idle_job_func, "Why do we have idle work when there's no idle job function?");
 			do {
 				idle_job_func (thread_data);
-				do_idle = continue_idle_job ();
+				do_idle = continue_idle_job (thread_data);
 			} while (do_idle && !job_queue.next_slot);
 
 			mono_os_mutex_lock (&lock);
@@ -140,7 +157,7 @@ thread_func (void *thread_data)
 		} else {
 			SGEN_ASSERT (0, threadpool_shutdown, "Why did we unlock if no jobs and not shutting down?");
 			mono_os_mutex_lock (&lock);
-			thread_finished = TRUE;
+			threads_finished++;
 			mono_os_cond_signal (&done_cond);
 			mono_os_mutex_unlock (&lock);
 			return 0;
@@ -151,9 +168,14 @@ thread_func (void *thread_data)
 }
 
 void
-sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **thread_datas)
+sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **datas)
 {
-	SGEN_ASSERT (0, num_threads == 1, "We only support 1 thread pool thread for now.");
+	int i;
+
+	SGEN_ASSERT (0, num_threads > 0 && num_threads <= SGEN_THREADPOOL_MAX_NUM_THREADS, "Invalid number of thread pool threads %d", num_threads);
+	SGEN_ASSERT (0, num_threads == 1 || !idle_func || datas, "Multiple idle threads need their own data.");
+
+	threads_num = num_threads;
 
 	mono_os_mutex_init (&lock);
 	mono_os_cond_init (&work_cond);
@@ -162,20 +184,22 @@ sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func,
 	thread_init_func = init_func;
 	idle_job_func = idle_func;
 	continue_idle_job_func = continue_idle_func;
+	thread_datas = datas;
 
-	mono_native_thread_create (&thread, thread_func, thread_datas ? thread_datas [0] : NULL);
+	for (i = 0; i < threads_num; i++)
+		mono_native_thread_create (&threads [i], thread_func, datas ? datas [i] : NULL);
 }
 
 void
 sgen_thread_pool_shutdown (void)
 {
-	if (!thread)
+	if (!threads_num)
 		return;
 
 	mono_os_mutex_lock (&lock);
 	threadpool_shutdown = TRUE;
-	mono_os_cond_signal (&work_cond);
-	while (!thread_finished)
+	mono_os_cond_broadcast (&work_cond);
+	while (threads_finished < threads_num)
 		mono_os_cond_wait (&done_cond, &lock);
 	mono_os_mutex_unlock (&lock);
 
@@ -207,10 +231,6 @@ sgen_thread_pool_job_enqueue (SgenThreadPoolJob *job)
 	mono_os_mutex_lock (&lock);
 
 	sgen_pointer_queue_add (&job_queue, job);
-	/*
-	 * FIXME: We could check whether there is a job in progress.  If there is, there's
-	 * no need to signal the condition, at least as long as we have only one thread.
-	 */
 	mono_os_cond_signal (&work_cond);
 
 	mono_os_mutex_unlock (&lock);
@@ -236,8 +256,12 @@ sgen_thread_pool_idle_signal (void)
 
 	mono_os_mutex_lock (&lock);
 
-	if (continue_idle_job_func ())
-		mono_os_cond_signal (&work_cond);
+	/*
+	 * Any of the threads might have idle work to do, so we have to wake them all up.
+	 * The ones that don't will just go back to waiting.
+	 */
+	if (continue_idle_job_any_thread ())
+		mono_os_cond_broadcast (&work_cond);
 
 	mono_os_mutex_unlock (&lock);
 }
@@ -249,7 +273,7 @@ sgen_thread_pool_idle_wait (void)
 
 	mono_os_mutex_lock (&lock);
 
-	while (continue_idle_job_func ())
+	while (continue_idle_job_any_thread ())
 		mono_os_cond_wait (&done_cond, &lock);
 
 	mono_os_mutex_unlock (&lock);
@@ -269,7 +293,20 @@ sgen_thread_pool_wait_for_all_jobs (void)
 gboolean
 sgen_thread_pool_is_thread_pool_thread (MonoNativeThreadId some_thread)
 {
-	return some_thread == thread;
+	int i;
+
+	for (i = 0; i < threads_num; i++) {
+		if (some_thread == threads [i])
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+int
+sgen_thread_pool_get_num_threads (void)
+{
+	return threads_num;
 }
 
 #endif
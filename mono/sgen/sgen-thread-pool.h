@@ -9,6 +9,9 @@
 #ifndef __MONO_SGEN_THREAD_POOL_H__
 #define __MONO_SGEN_THREAD_POOL_H__
 
+/* Don't create more threads than this, even on machines with lots of cores. */
+#define SGEN_THREADPOOL_MAX_NUM_THREADS 8
+
 typedef struct _SgenThreadPoolJob SgenThreadPoolJob;
 
 typedef void (*SgenThreadPoolJobFunc) (void *thread_data, SgenThreadPoolJob *job);
@@ -22,8 +25,12 @@ struct _SgenThreadPoolJob {
 
 typedef void (*SgenThreadPoolThreadInitFunc) (void*);
 typedef void (*SgenThreadPoolIdleJobFunc) (void*);
-typedef gboolean (*SgenThreadPoolContinueIdleJobFunc) (void);
+typedef gboolean (*SgenThreadPoolContinueIdleJobFunc) (void*);
 
+/*
+ * `thread_datas`, if given, has one element per thread, which is passed to the init, idle
+ * and continue-idle functions of that thread.
+ */
 void sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **thread_datas);
 
 void sgen_thread_pool_shutdown (void);
@@ -43,4 +50,6 @@ void sgen_thread_pool_wait_for_all_jobs (void);
 
 gboolean sgen_thread_pool_is_thread_pool_thread (MonoNativeThreadId thread);
 
+int sgen_thread_pool_get_num_threads (void);
+
 #endif
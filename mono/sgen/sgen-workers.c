@@ -16,6 +16,7 @@
 #include "mono/sgen/sgen-gc.h"
 #include "mono/sgen/sgen-workers.h"
 #include "mono/sgen/sgen-thread-pool.h"
+#include "mono/sgen/sgen-numa.h"
 #include "mono/utils/mono-membar.h"
 #include "mono/sgen/sgen-client.h"
 
@@ -23,7 +24,13 @@ static int workers_num;
 static volatile gboolean forced_stop;
 static WorkerData *workers_data;
 
-static SgenSectionGrayQueue workers_distribute_gray_queue;
+/*
+ * With NUMA support enabled there is one distribute queue per node.  Shared sections go to
+ * the queue of the node most of their objects' blocks live on, and workers take sections
+ * from their own node's queue before stealing from the others.
+ */
+static SgenSectionGrayQueue workers_distribute_gray_queues [SGEN_NUMA_MAX_NODES];
+static int workers_distribute_num_queues;
 static gboolean workers_distribute_gray_queue_inited;
 
 /*
@@ -31,8 +38,8 @@ static gboolean workers_distribute_gray_queue_inited;
  *
  * | from \ to          | NOT WORKING | WORKING | WORK ENQUEUED |
  * |--------------------+-------------+---------+---------------+
- * | NOT WORKING        | -           | -       | main          |
- * | WORKING            | worker      | -       | main          |
+ * | NOT WORKING        | -           | -       | main / worker |
+ * | WORKING            | worker      | -       | main / worker |
  * | WORK ENQUEUED      | -           | worker  | -             |
  *
  * The WORK ENQUEUED state guarantees that the worker thread will inspect the queue again at
@@ -40,6 +47,10 @@ static gboolean workers_distribute_gray_queue_inited;
  * eventually, to NOT WORKING.  After enqueuing work the main thread transitions the state
  * to WORK ENQUEUED.  Signalling the worker thread to wake up is only necessary if the old
  * state was NOT WORKING.
+ *
+ * Each worker has its own state.  When there is more than one worker, a worker that shares
+ * work with the others transitions all of them to WORK ENQUEUED, so that no worker can
+ * finish while there is still work left for it to steal.
  */
 
 enum {
@@ -50,15 +61,17 @@ enum {
 
 typedef gint32 State;
 
-static volatile State workers_state;
-
 static SgenObjectOperations * volatile idle_func_object_ops;
 static SgenThreadPoolJob * volatile preclean_job;
 
 static guint64 stat_workers_num_finished;
+#ifdef HEAVY_STATISTICS
+static guint64 stat_workers_num_sections_shared;
+static guint64 stat_workers_num_sections_stolen_remote;
+#endif
 
 static gboolean
-set_state (State old_state, State new_state)
+set_state (WorkerData *data, State old_state, State new_state)
 {
 	SGEN_ASSERT (0, old_state != new_state, "Why are we transitioning to the same state?");
 	if (new_state == STATE_NOT_WORKING)
@@ -68,7 +81,7 @@ set_state (State old_state, State new_state)
 	if (new_state == STATE_NOT_WORKING || new_state == STATE_WORKING)
 		SGEN_ASSERT (6, sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Only the worker thread is allowed to transition to NOT_WORKING or WORKING");
 
-	return InterlockedCompareExchange (&workers_state, new_state, old_state) == old_state;
+	return InterlockedCompareExchange (&data->state, new_state, old_state) == old_state;
 }
 
 static gboolean
@@ -80,39 +93,45 @@ state_is_working_or_enqueued (State state)
 void
 sgen_workers_ensure_awake (void)
 {
-	State old_state;
-	gboolean did_set_state;
+	int i;
+	gboolean need_signal = FALSE;
 
-	do {
-		old_state = workers_state;
+	for (i = 0; i < workers_num; i++) {
+		State old_state;
+		gboolean did_set_state;
 
-		if (old_state == STATE_WORK_ENQUEUED)
-			break;
+		do {
+			old_state = workers_data [i].state;
+
+			if (old_state == STATE_WORK_ENQUEUED)
+				break;
 
-		did_set_state = set_state (old_state, STATE_WORK_ENQUEUED);
-	} while (!did_set_state);
+			did_set_state = set_state (&workers_data [i], old_state, STATE_WORK_ENQUEUED);
+		} while (!did_set_state);
 
-	if (!state_is_working_or_enqueued (old_state))
+		if (!state_is_working_or_enqueued (old_state))
+			need_signal = TRUE;
+	}
+
+	if (need_signal)
 		sgen_thread_pool_idle_signal ();
 }
 
 static void
-worker_try_finish (void)
+worker_try_finish (WorkerData *data)
 {
 	State old_state;
 
 	++stat_workers_num_finished;
 
 	do {
-		old_state = workers_state;
+		old_state = data->state;
 
 		SGEN_ASSERT (0, old_state != STATE_NOT_WORKING, "How did we get from doing idle work to NOT WORKING without setting it ourselves?");
 		if (old_state == STATE_WORK_ENQUEUED)
 			return;
 		SGEN_ASSERT (0, old_state == STATE_WORKING, "What other possibility is there?");
-
-		/* We are the last thread to go to sleep. */
-	} while (!set_state (old_state, STATE_NOT_WORKING));
+	} while (!set_state (data, old_state, STATE_NOT_WORKING));
 
 	binary_protocol_worker_finish (sgen_timestamp (), forced_stop);
 }
@@ -143,21 +162,60 @@ sgen_workers_wait_for_jobs_finished (void)
 	sgen_workers_ensure_awake ();
 }
 
+/*
+ * The node whose distribute queue `section` goes to: the one most of the major heap
+ * blocks of its objects are on.  Sections with only nursery or LOS objects stay on the
+ * node of the thread that filled them.
+ */
+static int
+section_numa_node (GrayQueueSection *section)
+{
+	SgenMajorCollector *major = sgen_get_major_collector ();
+	int counts [SGEN_NUMA_MAX_NODES];
+	int i, node = 0;
+
+	if (workers_distribute_num_queues == 1)
+		return 0;
+
+	memset (counts, 0, sizeof (counts));
+	for (i = 0; i < section->size; ++i) {
+		int obj_node = major->get_obj_numa_node (section->entries [i].obj, section->entries [i].desc);
+		if (obj_node >= 0)
+			++counts [obj_node];
+	}
+
+	for (i = 1; i < workers_distribute_num_queues; ++i) {
+		if (counts [i] > counts [node])
+			node = i;
+	}
+
+	if (!counts [node])
+		return sgen_numa_get_current_node ();
+	return node;
+}
+
+void
+sgen_workers_enqueue_section (GrayQueueSection *section)
+{
+	sgen_section_gray_queue_enqueue (&workers_distribute_gray_queues [section_numa_node (section)], section);
+}
+
 static gboolean
 workers_get_work (WorkerData *data)
 {
-	SgenMajorCollector *major;
+	GrayQueueSection *section = NULL;
+	int i;
 
 	g_assert (sgen_gray_object_queue_is_empty (&data->private_gray_queue));
 
-	/* If we're concurrent, steal from the workers distribute gray queue. */
-	major = sgen_get_major_collector ();
-	if (major->is_concurrent) {
-		GrayQueueSection *section = sgen_section_gray_queue_dequeue (&workers_distribute_gray_queue);
-		if (section) {
-			sgen_gray_object_enqueue_section (&data->private_gray_queue, section);
-			return TRUE;
-		}
+	/* Steal from the distribute gray queues, our own node's first. */
+	for (i = 0; i < workers_distribute_num_queues && !section; ++i)
+		section = sgen_section_gray_queue_dequeue (&workers_distribute_gray_queues [(data->numa_node + i) % workers_distribute_num_queues]);
+
+	if (section) {
+		HEAVY_STAT (stat_workers_num_sections_stolen_remote += i > 1);
+		sgen_gray_object_enqueue_section (&data->private_gray_queue, section);
+		return TRUE;
 	}
 
 	/* Nobody to steal from */
@@ -165,6 +223,53 @@ workers_get_work (WorkerData *data)
 	return FALSE;
 }
 
+static gboolean
+some_distribute_gray_queue_is_empty (void)
+{
+	int i;
+
+	for (i = 0; i < workers_distribute_num_queues; ++i) {
+		if (sgen_section_gray_queue_is_empty (&workers_distribute_gray_queues [i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+sgen_workers_distribute_gray_queue_is_empty (void)
+{
+	int i;
+
+	for (i = 0; i < workers_distribute_num_queues; ++i) {
+		if (!sgen_section_gray_queue_is_empty (&workers_distribute_gray_queues [i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Called when the private gray queue of a worker needs a new section, i.e. when its
+ * current section is full.  If the workers of some node have nothing left to take we give
+ * them the full section and make sure they're awake to take it.
+ */
+static void
+workers_gray_queue_share_work (SgenGrayQueue *queue)
+{
+	GrayQueueSection *section;
+
+	if (!some_distribute_gray_queue_is_empty ())
+		return;
+
+	section = sgen_gray_object_dequeue_section (queue);
+	if (!section)
+		return;
+
+	sgen_workers_enqueue_section (section);
+	HEAVY_STAT (++stat_workers_num_sections_shared);
+
+	sgen_workers_ensure_awake ();
+}
+
 static void
 concurrent_enqueue_check (GCObject *obj)
 {
@@ -178,6 +283,8 @@ init_private_gray_queue (WorkerData *data)
 {
 	sgen_gray_object_queue_init (&data->private_gray_queue,
 			sgen_get_major_collector ()->is_concurrent ? concurrent_enqueue_check : NULL);
+	if (workers_num > 1)
+		sgen_gray_queue_set_alloc_prepare (&data->private_gray_queue, workers_gray_queue_share_work, NULL);
 }
 
 static void
@@ -188,16 +295,28 @@ thread_pool_init_func (void *data_untyped)
 
 	sgen_client_thread_register_worker ();
 
-	if (!major->is_concurrent)
+	if (!data)
 		return;
 
 	init_private_gray_queue (data);
+
+	/*
+	 * Spread the workers over the NUMA nodes.  The blocks a worker allocates while
+	 * marking or promoting then come from its own node.
+	 */
+	if (sgen_numa_is_enabled ())
+		sgen_numa_bind_current_thread (data->numa_node);
+
+	if (major->worker_init)
+		major->worker_init ();
 }
 
 static gboolean
-continue_idle_func (void)
+continue_idle_func (void *data_untyped)
 {
-	return state_is_working_or_enqueued (workers_state);
+	WorkerData *data = (WorkerData *)data_untyped;
+
+	return state_is_working_or_enqueued (data->state);
 }
 
 static void
@@ -205,12 +324,13 @@ marker_idle_func (void *data_untyped)
 {
 	WorkerData *data = (WorkerData *)data_untyped;
 
-	SGEN_ASSERT (0, continue_idle_func (), "Why are we called when we're not supposed to work?");
-	SGEN_ASSERT (0, sgen_concurrent_collection_in_progress (), "The worker should only mark in concurrent collections.");
+	SGEN_ASSERT (0, continue_idle_func (data_untyped), "Why are we called when we're not supposed to work?");
+	SGEN_ASSERT (0, sgen_concurrent_collection_in_progress () || sgen_get_current_collection_generation () != -1,
+			"The worker should only mark in concurrent or parallel collections.");
 
-	if (workers_state == STATE_WORK_ENQUEUED) {
-		set_state (STATE_WORK_ENQUEUED, STATE_WORKING);
-		SGEN_ASSERT (0, workers_state != STATE_NOT_WORKING, "How did we get from WORK ENQUEUED to NOT WORKING?");
+	if (data->state == STATE_WORK_ENQUEUED) {
+		set_state (data, STATE_WORK_ENQUEUED, STATE_WORKING);
+		SGEN_ASSERT (0, data->state != STATE_NOT_WORKING, "How did we get from WORK ENQUEUED to NOT WORKING?");
 	}
 
 	if (!forced_stop && (!sgen_gray_object_queue_is_empty (&data->private_gray_queue) || workers_get_work (data))) {
@@ -221,33 +341,42 @@ marker_idle_func (void *data_untyped)
 		sgen_drain_gray_stack (ctx);
 	} else {
 		SgenThreadPoolJob *job = preclean_job;
-		if (job) {
+		/* Only one of the workers gets to enqueue the preclean job. */
+		if (job && SGEN_CAS_PTR ((gpointer*)&preclean_job, NULL, job) == job)
 			sgen_thread_pool_job_enqueue (job);
-			preclean_job = NULL;
-		} else {
-			worker_try_finish ();
-		}
+		else
+			worker_try_finish (data);
 	}
 }
 
 static void
 init_distribute_gray_queue (void)
 {
+	SgenMajorCollector *major = sgen_get_major_collector ();
+	int i;
+
 	if (workers_distribute_gray_queue_inited) {
-		g_assert (sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue));
-		g_assert (workers_distribute_gray_queue.locked);
+		for (i = 0; i < workers_distribute_num_queues; ++i) {
+			g_assert (sgen_section_gray_queue_is_empty (&workers_distribute_gray_queues [i]));
+			g_assert (workers_distribute_gray_queues [i].locked);
+		}
 		return;
 	}
 
-	sgen_section_gray_queue_init (&workers_distribute_gray_queue, TRUE,
-			sgen_get_major_collector ()->is_concurrent ? concurrent_enqueue_check : NULL);
+	if (sgen_numa_is_enabled () && workers_num > 1 && major->get_obj_numa_node)
+		workers_distribute_num_queues = sgen_numa_get_num_nodes ();
+	else
+		workers_distribute_num_queues = 1;
+
+	for (i = 0; i < workers_distribute_num_queues; ++i)
+		sgen_section_gray_queue_init (&workers_distribute_gray_queues [i], TRUE, major->is_concurrent ? concurrent_enqueue_check : NULL);
 	workers_distribute_gray_queue_inited = TRUE;
 }
 
 void
 sgen_workers_init_distribute_gray_queue (void)
 {
-	SGEN_ASSERT (0, sgen_get_major_collector ()->is_concurrent,
+	SGEN_ASSERT (0, sgen_get_major_collector ()->is_concurrent || sgen_get_major_collector ()->is_parallel || sgen_minor_collector.is_parallel,
 			"Why should we init the distribute gray queue if we don't need it?");
 	init_distribute_gray_queue ();
 }
@@ -258,7 +387,7 @@ sgen_workers_init (int num_workers)
 	int i;
 	void **workers_data_ptrs = (void **)alloca(num_workers * sizeof(void *));
 
-	if (!sgen_get_major_collector ()->is_concurrent) {
+	if (!sgen_get_major_collector ()->is_concurrent && !sgen_get_major_collector ()->is_parallel && !sgen_minor_collector.is_parallel) {
 		sgen_thread_pool_init (num_workers, thread_pool_init_func, NULL, NULL, NULL);
 		return;
 	}
@@ -272,12 +401,19 @@ sgen_workers_init (int num_workers)
 
 	init_distribute_gray_queue ();
 
-	for (i = 0; i < workers_num; ++i)
+	for (i = 0; i < workers_num; ++i) {
+		if (sgen_numa_is_enabled ())
+			workers_data [i].numa_node = i % sgen_numa_get_num_nodes ();
 		workers_data_ptrs [i] = (void *) &workers_data [i];
+	}
 
 	sgen_thread_pool_init (num_workers, thread_pool_init_func, marker_idle_func, continue_idle_func, workers_data_ptrs);
 
 	mono_counters_register ("# workers finished", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_finished);
+#ifdef HEAVY_STATISTICS
+	mono_counters_register ("# workers sections shared", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_sections_shared);
+	mono_counters_register ("# workers sections stolen remote", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_sections_stolen_remote);
+#endif
 }
 
 void
@@ -289,7 +425,7 @@ sgen_workers_stop_all_workers (void)
 
 	sgen_thread_pool_wait_for_all_jobs ();
 	sgen_thread_pool_idle_wait ();
-	SGEN_ASSERT (0, workers_state == STATE_NOT_WORKING, "Can only signal enqueue work when in no work state");
+	SGEN_ASSERT (0, sgen_workers_all_done (), "Can only signal enqueue work when in no work state");
 }
 
 void
@@ -310,15 +446,30 @@ sgen_workers_join (void)
 
 	sgen_thread_pool_wait_for_all_jobs ();
 	sgen_thread_pool_idle_wait ();
-	SGEN_ASSERT (0, workers_state == STATE_NOT_WORKING, "Can only signal enqueue work when in no work state");
+	SGEN_ASSERT (0, sgen_workers_all_done (), "Can only signal enqueue work when in no work state");
 
 	/* At this point all the workers have stopped. */
 
-	SGEN_ASSERT (0, sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue), "Why is there still work left to do?");
+	SGEN_ASSERT (0, sgen_workers_distribute_gray_queue_is_empty (), "Why is there still work left to do?");
 	for (i = 0; i < workers_num; ++i)
 		SGEN_ASSERT (0, sgen_gray_object_queue_is_empty (&workers_data [i].private_gray_queue), "Why is there still work left to do?");
 }
 
+/*
+ * Hands all the sections of `queue` to the workers.  The workers are not woken up - that
+ * happens when they're started.
+ */
+void
+sgen_workers_take_from_queue (SgenGrayQueue *queue)
+{
+	for (;;) {
+		GrayQueueSection *section = sgen_gray_object_dequeue_section (queue);
+		if (!section)
+			break;
+		sgen_workers_enqueue_section (section);
+	}
+}
+
 /*
  * Can only be called if the workers are stopped.
  * If we're stopped, there are also no pending jobs.
@@ -330,7 +481,7 @@ sgen_workers_have_idle_work (void)
 
 	SGEN_ASSERT (0, forced_stop && sgen_workers_all_done (), "Checking for idle work should only happen if the workers are stopped.");
 
-	if (!sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue))
+	if (!sgen_workers_distribute_gray_queue_is_empty ())
 		return TRUE;
 
 	for (i = 0; i < workers_num; ++i) {
@@ -344,20 +495,26 @@ sgen_workers_have_idle_work (void)
 gboolean
 sgen_workers_all_done (void)
 {
-	return workers_state == STATE_NOT_WORKING;
+	int i;
+
+	for (i = 0; i < workers_num; i++) {
+		if (state_is_working_or_enqueued (workers_data [i].state))
+			return FALSE;
+	}
+	return TRUE;
 }
 
 /* Must only be used for debugging */
 gboolean
 sgen_workers_are_working (void)
 {
-	return state_is_working_or_enqueued (workers_state);
+	return !sgen_workers_all_done ();
 }
 
-SgenSectionGrayQueue*
-sgen_workers_get_distribute_section_gray_queue (void)
+int
+sgen_workers_get_num_workers (void)
 {
-	return &workers_distribute_gray_queue;
+	return workers_num;
 }
 
 #endif
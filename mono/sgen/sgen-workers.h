@@ -14,6 +14,8 @@
 
 typedef struct _WorkerData WorkerData;
 struct _WorkerData {
+	volatile gint32 state;
+	int numa_node; /* the node the worker is bound to, 0 without NUMA support */
 	SgenGrayQueue private_gray_queue; /* only read/written by worker thread */
 };
 
@@ -27,9 +29,12 @@ void sgen_workers_wait_for_jobs_finished (void);
 void sgen_workers_distribute_gray_queue_sections (void);
 void sgen_workers_reset_data (void);
 void sgen_workers_join (void);
+void sgen_workers_take_from_queue (SgenGrayQueue *queue);
 gboolean sgen_workers_have_idle_work (void);
 gboolean sgen_workers_all_done (void);
 gboolean sgen_workers_are_working (void);
-SgenSectionGrayQueue* sgen_workers_get_distribute_section_gray_queue (void);
+int sgen_workers_get_num_workers (void);
+void sgen_workers_enqueue_section (GrayQueueSection *section);
+gboolean sgen_workers_distribute_gray_queue_is_empty (void);
 
 #endif
@@ -0,0 +1,7 @@
+using System;
+
+public class JitCacheLib {
+	public static int Add (int a, int b) {
+		return a + b;
+	}
+}
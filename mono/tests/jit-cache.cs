@@ -0,0 +1,18 @@
+using System;
+
+/*
+ * Run by test-jit-cache with --jit-cache: the methods JITted by the first run are loaded from the
+ * cached image by the next one, until jit-cache-lib.dll is rebuilt.
+ */
+class Tests {
+	static int Sum (int n) {
+		int res = 0;
+		for (int i = 0; i < n; ++i)
+			res = JitCacheLib.Add (res, i);
+		return res;
+	}
+
+	static int Main () {
+		return Sum (10) == 45 ? 0 : 1;
+	}
+}
@@ -25,6 +25,48 @@ public class Tests  {
 		return 1;
 	}
 
+	// Inflated locks are deflated by major collections, the hash code and the lock have to survive it
+	public static int test_0_deflate () {
+		object o = new object ();
+		int hash = o.GetHashCode ();
+		Thread t;
+
+		lock (o) {
+			// Contention inflates the lock
+			t = new Thread (delegate () {
+					lock (o) {
+					}
+				});
+			t.Start ();
+			Thread.Sleep (100);
+		}
+		t.Join ();
+
+		GC.Collect ();
+		if (o.GetHashCode () != hash)
+			return 1;
+
+		t = new Thread (delegate () {
+				lock (o) {
+					Monitor.Pulse (o);
+				}
+			});
+		lock (o) {
+			t.Start ();
+			if (!Monitor.Wait (o, 10000))
+				return 2;
+		}
+		t.Join ();
+
+		GC.Collect ();
+		if (o.GetHashCode () != hash)
+			return 3;
+		if (!Monitor.TryEnter (o))
+			return 4;
+		Monitor.Exit (o);
+		return 0;
+	}
+
 	const int thread_count = 3;
 
 	// #651546
@@ -0,0 +1,74 @@
+using System;
+
+/*
+ * Nursery collections skip old blocks and large objects whose cards aren't dirty
+ * according to the card summary.  Store young objects at sparse positions of old
+ * arrays and objects, about one per summary bit as well as many per card, and check that
+ * the nursery collections keep them alive and update the references.
+ */
+class Box
+{
+	public object value;
+}
+
+public class Tests
+{
+	/* A summary bit covers 64 cards of 512 bytes. */
+	const int summary_bytes = 64 * 512;
+	const int array_length = 16 * summary_bytes / 8;
+	const int box_count = 100000;
+
+	static int Check (object[] array, Box[] boxes, int round, int stride)
+	{
+		for (int i = 0; i < array.Length; i += stride) {
+			var s = array [i] as string;
+			if (s != round + ":" + i) {
+				Console.WriteLine ("round {0}: array element {1} is {2}", round, i, s ?? "null");
+				return 1;
+			}
+		}
+		for (int i = 0; i < boxes.Length; i += stride) {
+			var s = boxes [i].value as string;
+			if (s != round + ":" + i) {
+				Console.WriteLine ("round {0}: box {1} refers to {2}", round, i, s ?? "null");
+				return 2;
+			}
+		}
+		return 0;
+	}
+
+	public static int Main ()
+	{
+		object[] array = new object [array_length];
+		Box[] boxes = new Box [box_count];
+
+		for (int i = 0; i < box_count; ++i)
+			boxes [i] = new Box ();
+		GC.Collect ();
+
+		/* Strides of about one summary bit, and ones which don't line up with the cards. */
+		int[] strides = { summary_bytes / 8, summary_bytes / 8 - 1, 4097, 513, 1 };
+
+		for (int round = 0; round < strides.Length * 4; ++round) {
+			int stride = strides [round % strides.Length];
+
+			for (int i = 0; i < array.Length; i += stride)
+				array [i] = round + ":" + i;
+			for (int i = 0; i < boxes.Length; i += stride)
+				boxes [i].value = round + ":" + i;
+
+			GC.Collect (0);
+			int result = Check (array, boxes, round, stride);
+			if (result != 0)
+				return result;
+
+			/* Let the cards become clean again before the next round. */
+			for (int i = 0; i < array.Length; i += stride)
+				array [i] = null;
+			for (int i = 0; i < boxes.Length; i += stride)
+				boxes [i].value = null;
+			GC.Collect (0);
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,115 @@
+using System;
+
+/*
+ * With a compaction threshold the major collector evacuates sparsely used blocks and
+ * gives the emptied ones back to the OS, and the LOS discards the pages of its free
+ * chunks.  Leave the heap mostly empty, collect a few times, and check that the moved
+ * survivors kept their contents, their references and their hash codes, and that the
+ * large arrays next to discarded pages are intact.
+ */
+class Small
+{
+	public Small next;
+	public int value;
+}
+
+class Medium
+{
+	public Small small;
+	public long a, b, c, d, e, f, g, h;
+	public int value;
+}
+
+public class Tests
+{
+	const int count = 200000;
+	const int large_count = 64;
+	const int large_length = 20000;
+
+	static int Check (Small[] smalls, Medium[] mediums, int[] hashes, int[][] larges)
+	{
+		for (int i = 0; i < smalls.Length; ++i) {
+			if (smalls [i].value != i || smalls [i].next != smalls [(i + 1) % smalls.Length]) {
+				Console.WriteLine ("small object {0} is corrupt", i);
+				return 1;
+			}
+			if (mediums [i].value != i || mediums [i].small != smalls [i] || mediums [i].h != i) {
+				Console.WriteLine ("medium object {0} is corrupt", i);
+				return 2;
+			}
+			if (mediums [i].GetHashCode () != hashes [i]) {
+				Console.WriteLine ("the hash code of medium object {0} changed", i);
+				return 3;
+			}
+		}
+		for (int i = 0; i < larges.Length; ++i) {
+			if (larges [i] == null)
+				continue;
+			for (int j = 0; j < large_length; ++j) {
+				if (larges [i] [j] != i + j) {
+					Console.WriteLine ("large array {0} is corrupt at {1}", i, j);
+					return 4;
+				}
+			}
+		}
+		return 0;
+	}
+
+	public static int Main ()
+	{
+		Small[] all_smalls = new Small [count];
+		Medium[] all_mediums = new Medium [count];
+		int[][] larges = new int [large_count][];
+
+		for (int i = 0; i < count; ++i) {
+			all_smalls [i] = new Small ();
+			all_mediums [i] = new Medium ();
+		}
+		for (int i = 0; i < large_count; ++i) {
+			larges [i] = new int [large_length];
+			for (int j = 0; j < large_length; ++j)
+				larges [i] [j] = i + j;
+		}
+		GC.Collect ();
+
+		/* Keep every tenth object, and every other large array. */
+		Small[] smalls = new Small [count / 10];
+		Medium[] mediums = new Medium [count / 10];
+		int[] hashes = new int [count / 10];
+		for (int i = 0; i < smalls.Length; ++i) {
+			smalls [i] = all_smalls [i * 10];
+			smalls [i].value = i;
+			mediums [i] = all_mediums [i * 10];
+			mediums [i].value = i;
+			mediums [i].h = i;
+			mediums [i].small = smalls [i];
+			hashes [i] = mediums [i].GetHashCode ();
+		}
+		for (int i = 0; i < smalls.Length; ++i)
+			smalls [i].next = smalls [(i + 1) % smalls.Length];
+		for (int i = 1; i < large_count; i += 2)
+			larges [i] = null;
+		all_smalls = null;
+		all_mediums = null;
+
+		for (int i = 0; i < 5; ++i) {
+			GC.Collect ();
+			int result = Check (smalls, mediums, hashes, larges);
+			if (result != 0)
+				return result;
+			/* Reuse the discarded LOS pages. */
+			for (int j = 1; j < large_count; j += 2) {
+				larges [j] = new int [large_length];
+				for (int k = 0; k < large_length; ++k)
+					larges [j] [k] = j + k;
+			}
+			GC.Collect ();
+			result = Check (smalls, mediums, hashes, larges);
+			if (result != 0)
+				return result;
+			for (int j = 1; j < large_count; j += 2)
+				larges [j] = null;
+		}
+		return 0;
+	}
+}
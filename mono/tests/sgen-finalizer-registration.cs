@@ -0,0 +1,84 @@
+using System;
+using System.Threading;
+
+/*
+ * Finalizers are registered in per thread stages.  Check that a SuppressFinalize ()
+ * on another thread isn't overtaken by the registration it cancels, and that a
+ * ReRegisterForFinalize () isn't overtaken by the SuppressFinalize () before it.
+ */
+class Suppressed
+{
+	public static int finalized;
+
+	~Suppressed ()
+	{
+		Interlocked.Increment (ref finalized);
+	}
+}
+
+class Reregistered
+{
+	public static int finalized;
+
+	~Reregistered ()
+	{
+		Interlocked.Increment (ref finalized);
+	}
+}
+
+public class Tests
+{
+	const int count = 1000;
+
+	static object[] Allocate<T> () where T : new ()
+	{
+		object[] objs = null;
+		var t = new Thread (() => {
+			objs = new object [count];
+			for (int i = 0; i < count; ++i)
+				objs [i] = new T ();
+		});
+		t.Start ();
+		t.Join ();
+		return objs;
+	}
+
+	static void Run (object[] suppressed, object[] reregistered)
+	{
+		var t = new Thread (() => {
+			foreach (var o in suppressed)
+				GC.SuppressFinalize (o);
+			foreach (var o in reregistered) {
+				GC.SuppressFinalize (o);
+				GC.ReRegisterForFinalize (o);
+			}
+		});
+		t.Start ();
+		t.Join ();
+	}
+
+	static void Test ()
+	{
+		Run (Allocate<Suppressed> (), Allocate<Reregistered> ());
+	}
+
+	public static int Main ()
+	{
+		Test ();
+
+		for (int i = 0; i < 10 && Reregistered.finalized < count; ++i) {
+			GC.Collect ();
+			GC.WaitForPendingFinalizers ();
+		}
+
+		if (Suppressed.finalized != 0) {
+			Console.WriteLine ("{0} suppressed finalizers ran", Suppressed.finalized);
+			return 1;
+		}
+		if (Reregistered.finalized != count) {
+			Console.WriteLine ("expected {0} reregistered finalizers to run, but {1} did", count, Reregistered.finalized);
+			return 2;
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,113 @@
+using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+/*
+ * GC handle slots are tracked in per-bucket bitmaps of occupied slots and of slots which
+ * might refer to nursery objects.  Allocate, retarget and free handles of all types on
+ * several threads, with old and young targets, and check after nursery and major
+ * collections that every live handle still refers to its target.
+ */
+class Target
+{
+	public int value;
+
+	public Target (int value)
+	{
+		this.value = value;
+	}
+}
+
+public class Tests
+{
+	const int thread_count = 4;
+	const int handle_count = 20000;
+	const int rounds = 20;
+
+	static volatile int failed;
+
+	static GCHandleType TypeFor (int i)
+	{
+		switch (i % 3) {
+		case 0:
+			return GCHandleType.Normal;
+		case 1:
+			return GCHandleType.Weak;
+		default:
+			return GCHandleType.WeakTrackResurrection;
+		}
+	}
+
+	static bool Check (int id, int round, GCHandle[] handles, Target[] targets)
+	{
+		for (int i = 0; i < handle_count; ++i) {
+			if (!handles [i].IsAllocated)
+				continue;
+			var target = handles [i].Target as Target;
+			if (target != targets [i] || target.value != i) {
+				Console.WriteLine ("thread {0} round {1}: handle {2} lost its target", id, round, i);
+				failed = 1;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void Work (int id)
+	{
+		var rand = new Random (id);
+		var handles = new GCHandle [handle_count];
+		/* Keeps the targets of the weak handles alive. */
+		var targets = new Target [handle_count];
+
+		for (int i = 0; i < handle_count; ++i) {
+			targets [i] = new Target (i);
+			handles [i] = GCHandle.Alloc (targets [i], TypeFor (i));
+		}
+
+		for (int round = 0; round < rounds && failed == 0; ++round) {
+			/* Free some handles, and point others at young targets. */
+			for (int i = 0; i < handle_count; ++i) {
+				int r = rand.Next (10);
+				if (r == 0 && handles [i].IsAllocated) {
+					handles [i].Free ();
+				} else if (r == 1) {
+					targets [i] = new Target (i);
+					if (handles [i].IsAllocated)
+						handles [i].Target = targets [i];
+					else
+						handles [i] = GCHandle.Alloc (targets [i], TypeFor (i));
+				}
+			}
+
+			/* Fill the nursery a few times over. */
+			for (int i = 0; i < 100000; ++i)
+				new Target (i);
+			if (!Check (id, round, handles, targets))
+				return;
+
+			if (id == 0 && round % 5 == 0)
+				GC.Collect ();
+		}
+
+		for (int i = 0; i < handle_count; ++i) {
+			if (handles [i].IsAllocated)
+				handles [i].Free ();
+		}
+	}
+
+	public static int Main ()
+	{
+		var threads = new Thread [thread_count];
+
+		for (int i = 0; i < thread_count; ++i) {
+			int id = i;
+			threads [i] = new Thread (() => Work (id));
+			threads [i].Start ();
+		}
+		for (int i = 0; i < thread_count; ++i)
+			threads [i].Join ();
+
+		return failed;
+	}
+}
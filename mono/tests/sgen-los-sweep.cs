@@ -0,0 +1,72 @@
+using System;
+using System.Threading;
+
+/*
+ * The LOS is swept by a job on the thread pool, which runs while the mutators allocate
+ * large objects again.  Allocate and drop large arrays on several threads, some of them
+ * too big for a LOS section, while the main thread keeps forcing collections, and check
+ * that no array is overwritten.
+ */
+public class Tests
+{
+	const int thread_count = 4;
+	const int iterations = 2000;
+	const int ring_size = 16;
+
+	static volatile int finished;
+	static volatile int failed;
+
+	static bool Check (int[] array)
+	{
+		for (int i = 0; i < array.Length; ++i) {
+			if (array [i] != array.Length - i)
+				return false;
+		}
+		return true;
+	}
+
+	static void Work (int id)
+	{
+		var rand = new Random (id);
+		var ring = new int [ring_size][];
+
+		for (int i = 0; i < iterations && failed == 0; ++i) {
+			int slot = i % ring_size;
+			if (ring [slot] != null && !Check (ring [slot])) {
+				Console.WriteLine ("thread {0}: large array of length {1} was overwritten", id, ring [slot].Length);
+				failed = 1;
+				break;
+			}
+
+			/* Every 50th array doesn't fit into a section. */
+			int length = i % 50 == 0 ? 400000 : rand.Next (3000, 200000);
+			int[] array = new int [length];
+			for (int j = 0; j < length; ++j)
+				array [j] = length - j;
+			ring [slot] = array;
+		}
+
+		Interlocked.Increment (ref finished);
+	}
+
+	public static int Main ()
+	{
+		var threads = new Thread [thread_count];
+
+		for (int i = 0; i < thread_count; ++i) {
+			int id = i;
+			threads [i] = new Thread (() => Work (id));
+			threads [i].Start ();
+		}
+
+		while (finished < thread_count) {
+			GC.Collect ();
+			Thread.Sleep (5);
+		}
+
+		for (int i = 0; i < thread_count; ++i)
+			threads [i].Join ();
+
+		return failed;
+	}
+}
@@ -0,0 +1,94 @@
+using System;
+
+/*
+ * With major=marksweep-par the major heap is marked on several workers.  Build a graph
+ * with lots of sharing, large arrays and young objects, drop half of it, and check after
+ * each major collection that the live half is intact and that no weak reference to a
+ * reachable node was cleared.
+ */
+class Node
+{
+	public Node[] edges;
+	public object payload;
+	public int value;
+
+	public Node (int value, int degree)
+	{
+		this.value = value;
+		edges = new Node [degree];
+	}
+}
+
+public class Tests
+{
+	const int node_count = 100000;
+	const int degree = 4;
+	const int collections = 10;
+
+	static int Check (Node[] live, bool[] reachable, WeakReference[] weaks)
+	{
+		for (int i = 0; i < live.Length; ++i) {
+			Node node = live [i];
+			if (node == null)
+				continue;
+			if (node.value != i || (int)node.payload != i) {
+				Console.WriteLine ("node {0} is corrupt", i);
+				return 1;
+			}
+			for (int j = 0; j < degree; ++j) {
+				Node to = node.edges [j];
+				if (to == null || to.value != (i * 31 + j * 17) % node_count) {
+					Console.WriteLine ("edge {0} of node {1} is corrupt", j, i);
+					return 2;
+				}
+			}
+		}
+		/* Unreachable nodes might still be pinned by the conservative stack scan. */
+		for (int i = 0; i < weaks.Length; ++i) {
+			if (reachable [i] && !weaks [i].IsAlive) {
+				Console.WriteLine ("weak reference to reachable node {0} was cleared", i);
+				return 3;
+			}
+		}
+		return 0;
+	}
+
+	public static int Main ()
+	{
+		/* Large enough to be in the LOS. */
+		Node[] live = new Node [node_count];
+		bool[] reachable = new bool [node_count];
+		WeakReference[] weaks = new WeakReference [1000];
+
+		for (int i = 0; i < node_count; ++i) {
+			live [i] = new Node (i, degree);
+			live [i].payload = i;
+		}
+		for (int i = 0; i < node_count; ++i) {
+			for (int j = 0; j < degree; ++j)
+				live [i].edges [j] = live [(i * 31 + j * 17) % node_count];
+		}
+		for (int i = 0; i < weaks.Length; ++i)
+			weaks [i] = new WeakReference (live [i]);
+
+		/* Drop the odd nodes.  Some of them are kept alive by edges from the even ones. */
+		for (int i = 0; i < node_count; i += 2) {
+			reachable [i] = true;
+			for (int j = 0; j < degree; ++j)
+				reachable [(i * 31 + j * 17) % node_count] = true;
+		}
+		for (int i = 1; i < node_count; i += 2)
+			live [i] = null;
+
+		for (int i = 0; i < collections; ++i) {
+			GC.Collect ();
+			int result = Check (live, reachable, weaks);
+			if (result != 0)
+				return result;
+			/* Give the next collection some young payloads to promote. */
+			for (int j = 0; j < node_count; j += 2)
+				live [j].payload = j;
+		}
+		return 0;
+	}
+}
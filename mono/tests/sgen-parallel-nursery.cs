@@ -0,0 +1,90 @@
+using System;
+using System.Threading;
+
+/*
+ * With minor=simple-par nursery collections copy objects on several workers.  Every young
+ * node here is referenced by many old nodes and by the stack, so the workers race to
+ * forward it.  Check that all those references end up at the same copy.
+ */
+class Node
+{
+	public Node left, right;
+	public int value;
+
+	public Node (Node left, Node right, int value)
+	{
+		this.left = left;
+		this.right = right;
+		this.value = value;
+	}
+}
+
+public class Tests
+{
+	const int thread_count = 4;
+	const int rounds = 100;
+	const int old_count = 4096;
+	const int young_count = 64;
+
+	static Node[][] olds = new Node [thread_count][];
+	static volatile int failed;
+
+	static void Work (int id)
+	{
+		Node[] old = olds [id];
+
+		for (int round = 0; round < rounds && failed == 0; ++round) {
+			Node[] young = new Node [young_count];
+			for (int i = 0; i < young_count; ++i)
+				young [i] = new Node (i > 0 ? young [i - 1] : null, null, round * young_count + i);
+
+			for (int i = 0; i < old_count; ++i) {
+				old [i].left = young [i % young_count];
+				old [i].right = young [(i * 7) % young_count];
+			}
+
+			/* Fill the nursery a few times over. */
+			for (int i = 0; i < 100000; ++i)
+				new Node (null, null, i);
+
+			for (int i = 0; i < old_count; ++i) {
+				if (!Object.ReferenceEquals (old [i].left, young [i % young_count]) ||
+						!Object.ReferenceEquals (old [i].right, young [(i * 7) % young_count])) {
+					Console.WriteLine ("thread {0} round {1}: old node {2} doesn't refer to the young copy", id, round, i);
+					failed = 1;
+					return;
+				}
+			}
+			for (int i = 0; i < young_count; ++i) {
+				if (young [i].value != round * young_count + i || (i > 0 && young [i].left != young [i - 1])) {
+					Console.WriteLine ("thread {0} round {1}: young node {2} is corrupt", id, round, i);
+					failed = 1;
+					return;
+				}
+			}
+		}
+	}
+
+	public static int Main ()
+	{
+		var threads = new Thread [thread_count];
+
+		for (int i = 0; i < thread_count; ++i) {
+			olds [i] = new Node [old_count];
+			for (int j = 0; j < old_count; ++j)
+				olds [i] [j] = new Node (null, null, j);
+		}
+		/* Promote the old nodes, so the young ones are also reached through the remembered set. */
+		GC.Collect ();
+
+		for (int i = 0; i < thread_count; ++i) {
+			int id = i;
+			threads [i] = new Thread (() => Work (id));
+			threads [i].Start ();
+		}
+		for (int i = 0; i < thread_count; ++i)
+			threads [i].Join ();
+
+		return failed;
+	}
+}
@@ -0,0 +1,42 @@
+using System;
+
+/*
+ * Run by sgen-pause-goal-tests with a nursery pause time goal.  Most objects die young, but
+ * some are kept alive for about one nursery collection, so the promotion age matters.
+ */
+class Node
+{
+	public Node next;
+	public int value;
+
+	public Node (Node next, int value)
+	{
+		this.next = next;
+		this.value = value;
+	}
+}
+
+class Driver
+{
+	static int Main ()
+	{
+		Node [] ring = new Node [1 << 14];
+		Node list = null;
+
+		for (int i = 0; i < 20000000; ++i) {
+			Node node = new Node (list, i);
+			if ((i & 7) == 0)
+				ring [(i >> 3) & (ring.Length - 1)] = node;
+			if ((i & 1023) == 0)
+				list = null;
+			else
+				list = node;
+		}
+
+		for (int i = 0; i < ring.Length; ++i) {
+			if (ring [i] == null || (ring [i].value & 7) != 0)
+				return 1;
+		}
+		return 0;
+	}
+}
@@ -39,6 +39,8 @@ gboolean mono_hwcap_x86_has_ssse3 = FALSE;
 gboolean mono_hwcap_x86_has_sse41 = FALSE;
 gboolean mono_hwcap_x86_has_sse42 = FALSE;
 gboolean mono_hwcap_x86_has_sse4a = FALSE;
+gboolean mono_hwcap_x86_has_avx = FALSE;
+gboolean mono_hwcap_x86_has_avx2 = FALSE;
 
 static gboolean
 cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
@@ -89,9 +91,10 @@ cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
 #endif
 
 	/* Now issue the actual cpuid instruction. We can use
-	   MSVC's __cpuid on both 32-bit and 64-bit. */
+	   MSVC's __cpuidex on both 32-bit and 64-bit. The sub-leaf
+	   in ecx is always 0, leaf 7 depends on it. */
 #if defined(_MSC_VER)
-	__cpuid (info, id);
+	__cpuidex (info, id, 0);
 	*p_eax = info [0];
 	*p_ebx = info [1];
 	*p_ecx = info [2];
@@ -104,19 +107,42 @@ cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
 		"cpuid\n\t"
 		"xchgl\t%%ebx, %k1\n\t"
 		: "=a" (*p_eax), "=&r" (*p_ebx), "=c" (*p_ecx), "=d" (*p_edx)
-		: "0" (id)
+		: "0" (id), "2" (0)
 	);
 #else
 	__asm__ __volatile__ (
 		"cpuid\n\t"
 		: "=a" (*p_eax), "=b" (*p_ebx), "=c" (*p_ecx), "=d" (*p_edx)
-		: "a" (id)
+		: "a" (id), "2" (0)
 	);
 #endif
 
 	return TRUE;
 }
 
+/*
+ * Return the XCR0 register, which tells which register sets the OS saves on context
+ * switches. Only call this if cpuid reports OSXSAVE.
+ */
+static guint64
+xgetbv (void)
+{
+#if defined(_MSC_VER)
+	return _xgetbv (0);
+#else
+	guint32 eax, edx;
+
+	/* xgetbv, older assemblers don't know about it */
+	__asm__ __volatile__ (
+		".byte\t0x0f, 0x01, 0xd0\n\t"
+		: "=a" (eax), "=d" (edx)
+		: "c" (0)
+	);
+
+	return ((guint64) edx << 32) | eax;
+#endif
+}
+
 void
 mono_hwcap_arch_init (void)
 {
@@ -147,6 +173,17 @@ mono_hwcap_arch_init (void)
 
 		if (ecx & (1 << 20))
 			mono_hwcap_x86_has_sse42 = TRUE;
+
+		/* The ymm registers can only be used if the OS saves them (OSXSAVE and XCR0 bits 1 and 2) */
+		if ((ecx & (1 << 28)) && (ecx & (1 << 27)) && (xgetbv () & 0x6) == 0x6)
+			mono_hwcap_x86_has_avx = TRUE;
+	}
+
+	if (mono_hwcap_x86_has_avx && cpuid (0, &eax, &ebx, &ecx, &edx) && eax >= 7) {
+		if (cpuid (7, &eax, &ebx, &ecx, &edx)) {
+			if (ebx & (1 << 5))
+				mono_hwcap_x86_has_avx2 = TRUE;
+		}
 	}
 
 	if (cpuid (0x80000000, &eax, &ebx, &ecx, &edx)) {
@@ -176,4 +213,6 @@ mono_hwcap_print (FILE *f)
 	g_fprintf (f, "mono_hwcap_x86_has_sse41 = %i\n", mono_hwcap_x86_has_sse41);
 	g_fprintf (f, "mono_hwcap_x86_has_sse42 = %i\n", mono_hwcap_x86_has_sse42);
 	g_fprintf (f, "mono_hwcap_x86_has_sse4a = %i\n", mono_hwcap_x86_has_sse4a);
+	g_fprintf (f, "mono_hwcap_x86_has_avx = %i\n", mono_hwcap_x86_has_avx);
+	g_fprintf (f, "mono_hwcap_x86_has_avx2 = %i\n", mono_hwcap_x86_has_avx2);
 }